@@ -23,6 +23,15 @@ ENDIF(INSTALL_DEBUG AND NOT SPLIT_DEBUG)
 # Compress the executable with UPX.
 OPTION(COMPRESS_EXE "Compress the executable with UPX." 0)
 
+# Headless command-line program.
+OPTION(BUILD_CLI "Build mcrecover-cli, the headless command-line program." ON)
+
+# Benchmarks.
+OPTION(BUILD_BENCHMARKS "Build benchmark programs. (not installed)" OFF)
+
+# Tests.
+OPTION(BUILD_TESTING "Build test programs. (not installed)" OFF)
+
 # Enable D-Bus for DockManager / Unity API.
 IF(UNIX AND NOT APPLE)
 	OPTION(ENABLE_DBUS "Enable D-Bus support for DockManager / Unity API." 1)
@@ -7,24 +7,225 @@
  ***************************************************************************/
 
 #include "Checksum.hpp"
+#include "Checksum_p.hpp"
 #include "SonicChaoGarden.inc.h"
 
 #include "util/byteswap.h"
 
 // C includes. (C++ namespace)
+#include <cerrno>
+#include <cstddef>
 #include <cstdio>
 #include <cstring>
 
 // C++ includes.
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
+using std::lock_guard;
+using std::map;
+using std::mutex;
 using std::string;
 using std::unique_ptr;
 using std::vector;
 
 namespace Checksum {
 
+/** CRC tables. **/
+
+/**
+ * Slicing-by-8 CRC tables for a reflected polynomial.
+ * tbl[0] is the standard byte-wise table; tbl[k][n] is the
+ * CRC of byte n followed by k zero bytes.
+ *
+ * NOTE: The same tables are used for both CRC-16 and CRC-32.
+ * Reflected CRCs shift right, so a 16-bit polynomial will
+ * never set the high 16 bits.
+ */
+struct CrcTables {
+	uint32_t tbl[8][256];
+
+	explicit CrcTables(uint32_t poly)
+	{
+		for (unsigned int n = 0; n < 256; n++) {
+			uint32_t crc = n;
+			for (int i = 8; i > 0; i--) {
+				if (crc & 1)
+					crc = ((crc >> 1) ^ poly);
+				else
+					crc >>= 1;
+			}
+			tbl[0][n] = crc;
+		}
+
+		for (unsigned int n = 0; n < 256; n++) {
+			uint32_t crc = tbl[0][n];
+			for (unsigned int k = 1; k < 8; k++) {
+				crc = tbl[0][crc & 0xFF] ^ (crc >> 8);
+				tbl[k][n] = crc;
+			}
+		}
+	}
+};
+
+/**
+ * Get the CRC tables for the specified polynomial.
+ * Tables are generated on first use and cached
+ * for the lifetime of the program.
+ * @param poly Polynomial.
+ * @return CRC tables.
+ */
+static const CrcTables *GetCrcTables(uint32_t poly)
+{
+	// Common polynomials don't need to take the lock.
+	// NOTE: Function-local statics are thread-safe in C++11.
+	switch (poly) {
+		case CRC16_POLY_CCITT: {
+			static const CrcTables tables_ccitt(CRC16_POLY_CCITT);
+			return &tables_ccitt;
+		}
+		case CRC32_POLY_ZLIB: {
+			static const CrcTables tables_zlib(CRC32_POLY_ZLIB);
+			return &tables_zlib;
+		}
+		default:
+			break;
+	}
+
+	// Other polynomials are cached by polynomial.
+	static mutex tables_mutex;
+	static map<uint32_t, unique_ptr<CrcTables> > tables_map;
+
+	lock_guard<mutex> lock(tables_mutex);
+	unique_ptr<CrcTables> &tables = tables_map[poly];
+	if (!tables) {
+		tables.reset(new CrcTables(poly));
+	}
+	return tables.get();
+}
+
+/**
+ * Get the byte-wise CRC table for the specified polynomial.
+ * @param poly Polynomial. (reflected)
+ * @return CRC table. (256 entries)
+ */
+const uint32_t *CrcTable(uint32_t poly)
+{
+	return GetCrcTables(poly)->tbl[0];
+}
+
+/**
+ * Update a reflected CRC using slicing-by-8.
+ * @param tables CRC tables.
+ * @param crc Internal CRC state. (not inverted)
+ * @param buf Data buffer.
+ * @param siz Length of data buffer.
+ * @return Updated CRC state.
+ */
+static uint32_t CrcUpdate(const CrcTables *tables, uint32_t crc, const uint8_t *buf, uint32_t siz)
+{
+	const uint32_t (*const tbl)[256] = tables->tbl;
+
+	// Do eight bytes at a time.
+	// NOTE: Individual byte accesses are used to avoid
+	// alignment and endianness issues.
+	for (; siz >= 8; siz -= 8, buf += 8) {
+		crc = tbl[7][(buf[0] ^ crc) & 0xFF] ^
+		      tbl[6][(buf[1] ^ (crc >> 8)) & 0xFF] ^
+		      tbl[5][(buf[2] ^ (crc >> 16)) & 0xFF] ^
+		      tbl[4][(buf[3] ^ (crc >> 24)) & 0xFF] ^
+		      tbl[3][buf[4]] ^
+		      tbl[2][buf[5]] ^
+		      tbl[1][buf[6]] ^
+		      tbl[0][buf[7]];
+	}
+
+	// Remaining bytes.
+	for (; siz != 0; siz--, buf++) {
+		crc = tbl[0][(*buf ^ crc) & 0xFF] ^ (crc >> 8);
+	}
+
+	return crc;
+}
+
+/**
+ * Slicing-by-8 CRC tables for the Dreamcast VMU's FCS-16.
+ * Unlike the other CRCs, FCS-16 isn't reflected, so the
+ * CRC shifts left, and tbl[k][n] is the CRC of byte n
+ * followed by k zero bytes.
+ */
+struct VmuCrcTables {
+	uint16_t tbl[8][256];
+
+	VmuCrcTables()
+	{
+		for (unsigned int n = 0; n < 256; n++) {
+			unsigned int crc = (n << 8);
+			for (int i = 8; i > 0; i--) {
+				if (crc & 0x8000)
+					crc = ((crc << 1) ^ 0x1021);
+				else
+					crc <<= 1;
+			}
+			tbl[0][n] = (uint16_t)crc;
+		}
+
+		for (unsigned int n = 0; n < 256; n++) {
+			uint16_t crc = tbl[0][n];
+			for (unsigned int k = 1; k < 8; k++) {
+				crc = (uint16_t)(crc << 8) ^ tbl[0][crc >> 8];
+				tbl[k][n] = crc;
+			}
+		}
+	}
+};
+
+/**
+ * Get the Dreamcast VMU CRC tables.
+ * @return CRC tables.
+ */
+static inline const VmuCrcTables *GetVmuCrcTables(void)
+{
+	// NOTE: Function-local statics are thread-safe in C++11.
+	static const VmuCrcTables tables;
+	return &tables;
+}
+
+/**
+ * Update a Dreamcast VMU CRC using slicing-by-8.
+ * @param tables CRC tables.
+ * @param crc CRC.
+ * @param buf Data buffer.
+ * @param siz Length of data buffer.
+ * @return Updated CRC.
+ */
+static uint16_t VmuCrcUpdate(const VmuCrcTables *tables, uint16_t crc, const uint8_t *buf, uint32_t siz)
+{
+	const uint16_t (*const tbl)[256] = tables->tbl;
+
+	// Do eight bytes at a time.
+	// The CRC is XOR'd into the first two bytes.
+	for (; siz >= 8; siz -= 8, buf += 8) {
+		crc = tbl[7][buf[0] ^ (crc >> 8)] ^
+		      tbl[6][buf[1] ^ (crc & 0xFF)] ^
+		      tbl[5][buf[2]] ^
+		      tbl[4][buf[3]] ^
+		      tbl[3][buf[4]] ^
+		      tbl[2][buf[5]] ^
+		      tbl[1][buf[6]] ^
+		      tbl[0][buf[7]];
+	}
+
+	// Remaining bytes.
+	for (; siz != 0; siz--, buf++) {
+		crc = (uint16_t)(crc << 8) ^ tbl[0][*buf ^ (crc >> 8)];
+	}
+
+	return crc;
+}
+
 /** Algorithms. **/
 
 /**
@@ -36,19 +237,35 @@ namespace Checksum {
  */
 uint16_t Crc16(const uint8_t *buf, uint32_t siz, uint16_t poly)
 {
-	// TODO: Add optimized version for poly == CRC16_POLY_CCITT.
-	uint16_t crc = 0xFFFF;
+	const uint32_t crc = CrcUpdate(GetCrcTables(poly), 0xFFFF, buf, siz);
+	return ~crc & 0xFFFF;
+}
 
-	for (; siz != 0; siz--, buf++) {
-		crc ^= (*buf & 0xFF);
-		for (int i = 8; i > 0; i--) {
-			if (crc & 1)
-				crc = ((crc >> 1) ^ poly);
-			else
-				crc >>= 1;
-		}
+/**
+ * CRC-32 algorithm.
+ * @param buf Data buffer.
+ * @param siz Length of data buffer.
+ * @param poly Polynomial.
+ * @return Checksum.
+ */
+uint32_t Crc32(const uint8_t *buf, uint32_t siz, uint32_t poly)
+{
+	uint32_t crc = 0xFFFFFFFF;
+
+#ifdef MCR_CPU_X86
+	// Use PCLMULQDQ for large buffers if it's available.
+	// The folding constants are only valid for the zlib polynomial.
+	if (poly == CRC32_POLY_ZLIB && siz >= 64 &&
+	    (MCR_CPU_Flags_x86() & MCR_CPUFLAG_X86_PCLMULQDQ))
+	{
+		const uint32_t chunk = (siz & ~15U);
+		crc = Crc32_zlib_pclmul(buf, chunk, crc);
+		buf += chunk;
+		siz -= chunk;
 	}
+#endif /* MCR_CPU_X86 */
 
+	crc = CrcUpdate(GetCrcTables(poly), crc, buf, siz);
 	return ~crc;
 }
 
@@ -73,6 +290,23 @@ uint32_t AddInvDual16(const uint16_t *buf, uint32_t siz, ChkEndian endian)
 	uint16_t chk1 = 0;
 	uint16_t chk2 = (uint16_t)(-(int)siz);
 
+#ifdef MCR_CPU_X86
+	// Use SIMD for most of the buffer if it's available.
+	// x86 is little-endian, so big-endian data has to be byteswapped.
+	const uint32_t cpu_flags = MCR_CPU_Flags_x86();
+	if ((cpu_flags & MCR_CPUFLAG_X86_AVX2) && siz >= 16) {
+		const uint32_t words = (siz & ~15U);
+		chk1 = SumWords16_avx2(buf, words, (endian != CHKENDIAN_LITTLE));
+		buf += words;
+		siz -= words;
+	} else if ((cpu_flags & MCR_CPUFLAG_X86_SSE2) && siz >= 8) {
+		const uint32_t words = (siz & ~7U);
+		chk1 = SumWords16_sse2(buf, words, (endian != CHKENDIAN_LITTLE));
+		buf += words;
+		siz -= words;
+	}
+#endif /* MCR_CPU_X86 */
+
 	if (endian != CHKENDIAN_LITTLE) {
 		// Big-endian system. (PowerPC, etc.)
 		// Do four words at a time.
@@ -132,6 +366,22 @@ uint32_t AddBytes32(const uint8_t *buf, uint32_t siz)
 {
 	uint32_t checksum = 0;
 
+#ifdef MCR_CPU_X86
+	// Use SIMD for most of the buffer if it's available.
+	const uint32_t cpu_flags = MCR_CPU_Flags_x86();
+	if ((cpu_flags & MCR_CPUFLAG_X86_AVX2) && siz >= 32) {
+		const uint32_t chunk = (siz & ~31U);
+		checksum = AddBytes32_avx2(buf, chunk);
+		buf += chunk;
+		siz -= chunk;
+	} else if ((cpu_flags & MCR_CPUFLAG_X86_SSE2) && siz >= 16) {
+		const uint32_t chunk = (siz & ~15U);
+		checksum = AddBytes32_sse2(buf, chunk);
+		buf += chunk;
+		siz -= chunk;
+	}
+#endif /* MCR_CPU_X86 */
+
 	// Do four bytes at a time.
 	for (; siz > 4; siz -= 4, buf += 4) {
 		checksum += buf[0];
@@ -149,6 +399,11 @@ uint32_t AddBytes32(const uint8_t *buf, uint32_t siz)
 
 /**
  * SonicChaoGarden algorithm.
+ *
+ * NOTE: The checksum is stored within the data.
+ * Use the chk_addr overload in order to handle
+ * this properly.
+ *
  * @param buf Data buffer.
  * @param siz Length of data buffer.
  * @return Checksum.
@@ -166,6 +421,53 @@ uint32_t SonicChaoGarden(const uint8_t *buf, uint32_t siz)
 	return (a4 ^ v4);
 }
 
+/**
+ * SonicChaoGarden algorithm.
+ *
+ * The checksum bytes and random_3 in ChaoGardenChecksumData
+ * are treated as 0 without modifying the buffer. Bytes of
+ * ChaoGardenChecksumData outside of the buffer are ignored.
+ *
+ * @param buf Data buffer.
+ * @param siz Length of data buffer.
+ * @param chk_addr Address of ChaoGardenChecksumData, relative to buf. (may be negative)
+ * @return Checksum.
+ */
+uint32_t SonicChaoGarden(const uint8_t *buf, uint32_t siz, int64_t chk_addr)
+{
+	// Ported from MainMemory's C# SADX/SA2B Chao Garden checksum code.
+	const uint32_t a4 = 0x686F6765;
+	uint32_t v4 = 0x6368616F;
+
+	// Bytes in ChaoGardenChecksumData that must be 0, in address order.
+	static const uint8_t zero_offsets[] = {
+		offsetof(ChaoGardenChecksumData, checksum_1),
+		offsetof(ChaoGardenChecksumData, checksum_3),
+		offsetof(ChaoGardenChecksumData, random_3),
+		offsetof(ChaoGardenChecksumData, checksum_0),
+		offsetof(ChaoGardenChecksumData, checksum_2),
+	};
+
+	uint32_t pos = 0;
+	for (unsigned int i = 0; i < sizeof(zero_offsets); i++) {
+		const int64_t zero_pos = chk_addr + zero_offsets[i];
+		if (zero_pos < 0 || zero_pos >= (int64_t)siz)
+			continue;
+
+		for (; pos < (uint32_t)zero_pos; pos++) {
+			v4 = SonicChaoGarden_CRC32_Table[buf[pos] ^ (v4 & 0xFF)] ^ (v4 >> 8);
+		}
+		v4 = SonicChaoGarden_CRC32_Table[v4 & 0xFF] ^ (v4 >> 8);
+		pos++;
+	}
+
+	for (; pos < siz; pos++) {
+		v4 = SonicChaoGarden_CRC32_Table[buf[pos] ^ (v4 & 0xFF)] ^ (v4 >> 8);
+	}
+
+	return (a4 ^ v4);
+}
+
 /**
  * Dreamcast VMU algorithm.
  * Based on FCS-16.
@@ -182,84 +484,100 @@ uint32_t SonicChaoGarden(const uint8_t *buf, uint32_t siz)
  */
 uint16_t DreamcastVMU(const uint8_t *buf, uint32_t siz, uint32_t crc_addr)
 {
-	// TODO: Optimize this?
 	// Reference: http://mc.pp.se/dc/vms/fileheader.html
-	unsigned int n = 0;
-	for (uint32_t i = 0; i < siz; i++) {
-		uint8_t chr = buf[i];
-		if (i == crc_addr || i == (crc_addr + 1)) {
-			// CRC address. Pretend it's 0.
-			chr = 0;
-		}
+	const VmuCrcTables *const tables = GetVmuCrcTables();
+	uint16_t crc = 0;
+
+	if (crc_addr < siz) {
+		// Data before the CRC.
+		crc = VmuCrcUpdate(tables, crc, buf, crc_addr);
 
-		n ^= (chr << 8);
-		for (int c = 0; c < 8; c++) {
-			if (n & 0x8000)
-				n = (n << 1) ^ 4129;
-			else
-				n = (n << 1);
+		// CRC address. Pretend it's 0.
+		const uint32_t zero_len = (siz - crc_addr >= 2 ? 2 : 1);
+		for (uint32_t i = 0; i < zero_len; i++) {
+			crc = (uint16_t)(crc << 8) ^ tables->tbl[0][crc >> 8];
 		}
+
+		// Data after the CRC.
+		buf += crc_addr + zero_len;
+		siz -= crc_addr + zero_len;
 	}
 
-	return (n & 0xFFFF);
+	return VmuCrcUpdate(tables, crc, buf, siz);
 }
 
 /**
- * Pokémon XD algorithm.
+ * Pokémon XD algorithm. (all checksums)
  * Reference: https://github.com/TuxSH/PkmGCTools/blob/master/LibPkmGC/src/LibPkmGC/XD/SaveEditing/SaveSlot.cpp
  *
  * The data area is "encrypted", so it has to be decrypted before
- * a checksum can be calculated.
+ * the checksums can be calculated. Decryption and summation are
+ * done in a single pass, so no decryption buffer is needed.
  *
  * @param buf		[in] Data buffer.
  * @param siz		[in] Length of data buffer.
- * @param crc_addr	[in] CRC address. (Should be 0x10, 0x14, 0x18, 0x1C.)
- * @param pChkExpect	[out] Expected checksum, decrypted.
- * @return Actual checksum, decrypted.
+ * @param values	[out] Checksum values, indexed by checksum ID. ((crc_addr >> 2) & 3)
+ * @return 0 on success; negative POSIX error code on error.
  */
-uint32_t PokemonXD(const uint8_t *buf, uint32_t siz, uint32_t crc_addr, uint32_t *pChkExpect)
+int PokemonXDAll(const uint8_t *buf, uint32_t siz, ChecksumValue values[POKEMONXD_CHECKSUM_COUNT])
 {
-	// TODO: There's four 32-bit checksums. We should rework
-	// the checksum system so we don't have to decrypt the
-	// save data four times, once for each checksum.
-	static const uint32_t checksum_size = (0x9FF4*4)+8;
-	if (siz < (0x9FF4*4)+8) {
+	// Each checksum covers one quarter of the data area.
+	static const uint32_t region_size = 0x9FF4;
+	static const uint32_t checksum_size = (region_size*4)+8;
+	if (siz < checksum_size) {
 		// Incorrect buffer size.
-		if (pChkExpect) {
-			*pChkExpect = 0;
+		for (unsigned int i = 0; i < POKEMONXD_CHECKSUM_COUNT; i++) {
+			values[i].expected = 0;
+			values[i].actual = ~0U;
 		}
-		return ~0U;
+		return -EINVAL;
 	}
 
 	// All fields are in big-endian.
-	struct PokemonXDHeader {
-		uint32_t magic;		// [0x000] 0x01010100
-		uint32_t save_count;	// [0x004] Number of times the game has been saved.
-		uint16_t enc_keys[4];	// [0x008] Encryption keys
-
-		// The following data is all encrypted.
-		uint32_t checksum[4];	// [0x010] Checksums
-	};
-
-	// Decryption buffer.
-	unique_ptr<uint8_t[]> decbuf(new uint8_t[checksum_size]);
-	memcpy(decbuf.get(), buf, 16);
-
-	// Decrypt the data.
-	PokemonXDHeader *const pHdr = reinterpret_cast<PokemonXDHeader*>(decbuf.get());
+	// [0x000] magic: 0x01010100
+	// [0x004] save_count: Number of times the game has been saved.
+	// [0x008] enc_keys[4]: Encryption keys
+	// The following data is all encrypted.
+	// [0x010] checksum[4]: Checksums
+	const uint16_t *psrcbuf16 = reinterpret_cast<const uint16_t*>(buf) + 4;
 	uint16_t keys[4];
-	keys[0] = be16_to_cpu(pHdr->enc_keys[0]);
-	keys[1] = be16_to_cpu(pHdr->enc_keys[1]);
-	keys[2] = be16_to_cpu(pHdr->enc_keys[2]);
-	keys[3] = be16_to_cpu(pHdr->enc_keys[3]);
-
-	const uint16_t *psrcbuf16 = reinterpret_cast<const uint16_t*>(buf) + 8;
-	uint16_t *pdestbuf16 = reinterpret_cast<uint16_t*>(decbuf.get()) + 8;
-	for (size_t i = 16; i < checksum_size; i += 8) {
-		for (unsigned int j = 0; j < 4; j++, psrcbuf16++, pdestbuf16++) {
+	keys[0] = be16_to_cpu(psrcbuf16[0]);
+	keys[1] = be16_to_cpu(psrcbuf16[1]);
+	keys[2] = be16_to_cpu(psrcbuf16[2]);
+	keys[3] = be16_to_cpu(psrcbuf16[3]);
+
+	// Checksum regions start at 0x008, so the encryption keys
+	// are included in the first region.
+	uint32_t sums[POKEMONXD_CHECKSUM_COUNT];
+	sums[0] = (uint32_t)keys[0] + keys[1] + keys[2] + keys[3];
+	sums[1] = 0;
+	sums[2] = 0;
+	sums[3] = 0;
+	psrcbuf16 += 4;
+
+	// Decrypted checksum words. (0x010-0x01F)
+	// NOTE: These must be treated as 0 when calculating the checksums.
+	uint16_t chkwords[8];
+
+	unsigned int region = 0;
+	uint32_t region_end = 8 + region_size;
+	uint32_t offset = 16;
+	for (; offset < checksum_size; ) {
+		for (unsigned int j = 0; j < 4; j++, psrcbuf16++, offset += 2) {
 			uint16_t tmp = be16_to_cpu(*psrcbuf16);
 			tmp -= keys[j];
-			*pdestbuf16 = cpu_to_be16(tmp);
+
+			if (offset < 0x20) {
+				// Checksum field.
+				chkwords[(offset - 0x10) / 2] = tmp;
+				continue;
+			}
+			if (offset == region_end) {
+				// Next checksum region.
+				region++;
+				region_end += region_size;
+			}
+			sums[region] += tmp;
 		}
 
 		// Advance the keys.
@@ -274,34 +592,296 @@ uint32_t PokemonXD(const uint8_t *buf, uint32_t siz, uint32_t crc_addr, uint32_t
 		keys[3] = ((a >> 12) & 0xf) | ((b >> 8) & 0xf0) | ((c >> 4) & 0xf00) | (d & 0xf000);
 	}
 
-	// Get the expected checksum.
-	// NOTE: Checksum is stored weirdly:
+	// NOTE: Checksums are stored weirdly:
 	// - ID is reversed.
 	// - Checksum is stored wordswapped.
-	// We'll use crc_addr as the checksum ID in the header,
-	// then do a reverse when checking the actual data area.
+	for (unsigned int chkID = 0; chkID < POKEMONXD_CHECKSUM_COUNT; chkID++) {
+		values[chkID].expected = ((uint32_t)chkwords[(chkID*2)+1] << 16) | chkwords[chkID*2];
+		values[chkID].actual = sums[chkID ^ 3];
+	}
+	return 0;
+}
+
+/**
+ * Pokémon XD algorithm.
+ * Reference: https://github.com/TuxSH/PkmGCTools/blob/master/LibPkmGC/src/LibPkmGC/XD/SaveEditing/SaveSlot.cpp
+ *
+ * The data area is "encrypted", so it has to be decrypted before
+ * a checksum can be calculated.
+ *
+ * NOTE: If more than one checksum is needed, use PokemonXDAll().
+ *
+ * @param buf		[in] Data buffer.
+ * @param siz		[in] Length of data buffer.
+ * @param crc_addr	[in] CRC address. (Should be 0x10, 0x14, 0x18, 0x1C.)
+ * @param pChkExpect	[out] Expected checksum, decrypted.
+ * @return Actual checksum, decrypted.
+ */
+uint32_t PokemonXD(const uint8_t *buf, uint32_t siz, uint32_t crc_addr, uint32_t *pChkExpect)
+{
+	ChecksumValue values[POKEMONXD_CHECKSUM_COUNT];
+	PokemonXDAll(buf, siz, values);
+
 	const unsigned int chkID = (crc_addr >> 2) & 3;
-	uint32_t chk_expect = be32_to_cpu(pHdr->checksum[chkID]);
-	chk_expect = (chk_expect << 16) | (chk_expect >> 16);
 	if (pChkExpect) {
-		*pChkExpect = chk_expect;
+		*pChkExpect = values[chkID].expected;
+	}
+	return values[chkID].actual;
+}
+
+/** Incremental updates. **/
+
+/**
+ * Multiply two polynomials modulo a reflected CRC polynomial.
+ * @param a Polynomial A. (reflected)
+ * @param b Polynomial B. (reflected)
+ * @param poly CRC polynomial. (reflected)
+ * @param width CRC width, in bits.
+ * @return (a * b) mod poly
+ */
+uint32_t CrcMultModP(uint32_t a, uint32_t b, uint32_t poly, unsigned int width)
+{
+	uint32_t p = 0;
+	for (uint32_t m = (1U << (width - 1)); m != 0; m >>= 1) {
+		if (a & m)
+			p ^= b;
+		b = (b & 1) ? ((b >> 1) ^ poly) : (b >> 1);
+	}
+	return p;
+}
+
+/**
+ * Calculate x^(8*n) modulo a reflected CRC polynomial.
+ * This is the operator for appending n zero bytes to a CRC.
+ * @param n Number of bytes.
+ * @param poly CRC polynomial. (reflected)
+ * @param width CRC width, in bits.
+ * @return x^(8*n) mod poly
+ */
+uint32_t CrcX8nModP(uint32_t n, uint32_t poly, unsigned int width)
+{
+	uint32_t p = (1U << (width - 1));	// x^0
+	uint32_t sq = (1U << (width - 2));	// x^1
+
+	// x^1 -> x^8
+	for (int i = 0; i < 3; i++) {
+		sq = CrcMultModP(sq, sq, poly, width);
+	}
+
+	// Square-and-multiply.
+	for (; n != 0; n >>= 1) {
+		if (n & 1)
+			p = CrcMultModP(sq, p, poly, width);
+		sq = CrcMultModP(sq, sq, poly, width);
+	}
+	return p;
+}
+
+/**
+ * Calculate the CRC of the difference between two buffers.
+ * No initial value or final XOR is applied.
+ * @param tables CRC tables.
+ * @param oldData Old data.
+ * @param newData New data.
+ * @param len Length of the data.
+ * @return Raw CRC of (oldData ^ newData).
+ */
+static uint32_t CrcDelta(const CrcTables *tables, const uint8_t *oldData, const uint8_t *newData, uint32_t len)
+{
+	const uint32_t *const tbl = tables->tbl[0];
+	uint32_t crc = 0;
+	for (; len != 0; len--, oldData++, newData++) {
+		crc = tbl[(*oldData ^ *newData ^ crc) & 0xFF] ^ (crc >> 8);
+	}
+	return crc;
+}
+
+/**
+ * Combine two CRC-16 checksums.
+ * @param crc1 CRC-16 of the first buffer.
+ * @param crc2 CRC-16 of the second buffer.
+ * @param len2 Length of the second buffer.
+ * @param poly Polynomial.
+ * @return CRC-16 of both buffers, concatenated.
+ */
+uint16_t Crc16Combine(uint16_t crc1, uint16_t crc2, uint32_t len2, uint16_t poly)
+{
+	return (CrcMultModP(CrcX8nModP(len2, poly, 16), crc1, poly, 16) ^ crc2) & 0xFFFF;
+}
+
+/**
+ * Combine two CRC-32 checksums.
+ * @param crc1 CRC-32 of the first buffer.
+ * @param crc2 CRC-32 of the second buffer.
+ * @param len2 Length of the second buffer.
+ * @param poly Polynomial.
+ * @return CRC-32 of both buffers, concatenated.
+ */
+uint32_t Crc32Combine(uint32_t crc1, uint32_t crc2, uint32_t len2, uint32_t poly)
+{
+	return CrcMultModP(CrcX8nModP(len2, poly, 32), crc1, poly, 32) ^ crc2;
+}
+
+/**
+ * Update a CRC-16 checksum after part of the data has changed.
+ * @param crc CRC-16 of the original data.
+ * @param oldData Original data in the changed range.
+ * @param newData New data in the changed range.
+ * @param len Length of the changed range.
+ * @param tailLen Number of checksummed bytes after the changed range.
+ * @param poly Polynomial.
+ * @return CRC-16 of the new data.
+ */
+uint16_t Crc16Update(uint16_t crc, const uint8_t *oldData, const uint8_t *newData,
+	uint32_t len, uint32_t tailLen, uint16_t poly)
+{
+	const uint32_t delta = CrcDelta(GetCrcTables(poly), oldData, newData, len);
+	return (crc ^ CrcMultModP(CrcX8nModP(tailLen, poly, 16), delta, poly, 16)) & 0xFFFF;
+}
+
+/**
+ * Update a CRC-32 checksum after part of the data has changed.
+ * @param crc CRC-32 of the original data.
+ * @param oldData Original data in the changed range.
+ * @param newData New data in the changed range.
+ * @param len Length of the changed range.
+ * @param tailLen Number of checksummed bytes after the changed range.
+ * @param poly Polynomial.
+ * @return CRC-32 of the new data.
+ */
+uint32_t Crc32Update(uint32_t crc, const uint8_t *oldData, const uint8_t *newData,
+	uint32_t len, uint32_t tailLen, uint32_t poly)
+{
+	const uint32_t delta = CrcDelta(GetCrcTables(poly), oldData, newData, len);
+	return crc ^ CrcMultModP(CrcX8nModP(tailLen, poly, 32), delta, poly, 32);
+}
+
+/**
+ * Update an AddBytes32 checksum after part of the data has changed.
+ * @param checksum AddBytes32 checksum of the original data.
+ * @param oldData Original data in the changed range.
+ * @param newData New data in the changed range.
+ * @param len Length of the changed range.
+ * @return AddBytes32 checksum of the new data.
+ */
+uint32_t AddBytes32Update(uint32_t checksum, const uint8_t *oldData, const uint8_t *newData, uint32_t len)
+{
+	// NOTE: Integer overflow/underflow is expected here.
+	return checksum - AddBytes32(oldData, len) + AddBytes32(newData, len);
+}
+
+/**
+ * Update an AddInvDual16 checksum after part of the data has changed.
+ *
+ * NOTE: AddInvDual16 changes 0xFFFF to 0, so the original sum
+ * is recovered using both words. In the rare case where that's
+ * ambiguous, the checksum must be recalculated.
+ *
+ * @param checksum	[in] AddInvDual16 checksum of the original data.
+ * @param siz		[in] Length of the checksummed data.
+ * @param pos		[in] Position of the changed range, relative to the checksummed data.
+ * @param oldData	[in] Original data in the changed range.
+ * @param newData	[in] New data in the changed range.
+ * @param len		[in] Length of the changed range.
+ * @param endian	[in] Endianness of the data.
+ * @param pChecksum	[out] AddInvDual16 checksum of the new data.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int AddInvDual16Update(uint32_t checksum, uint32_t siz, uint32_t pos,
+	const uint8_t *oldData, const uint8_t *newData, uint32_t len,
+	ChkEndian endian, uint32_t *pChecksum)
+{
+	const uint16_t words = (uint16_t)(siz / 2);
+	uint16_t chk1 = (uint16_t)(checksum >> 16);
+	const uint16_t chk2 = (uint16_t)(checksum & 0xFFFF);
+
+	if (chk1 == 0) {
+		// chk1 may have been 0xFFFF.
+		// chk2 = -words - chk1, so check which one matches.
+		uint16_t chk2_if0 = (uint16_t)(-words);
+		uint16_t chk2_ifFFFF = (uint16_t)(-words + 1);
+		if (chk2_if0 == 0xFFFF)
+			chk2_if0 = 0;
+		if (chk2_ifFFFF == 0xFFFF)
+			chk2_ifFFFF = 0;
+
+		if (chk2_if0 == chk2_ifFFFF) {
+			// Ambiguous.
+			return -EINVAL;
+		}
+		chk1 = (chk2 == chk2_ifFFFF ? 0xFFFF : 0);
+	}
+
+	// Only whole words are checksummed.
+	if (pos + len > (siz & ~1U)) {
+		len = (pos < (siz & ~1U) ? (siz & ~1U) - pos : 0);
 	}
 
-	// Calculate the actual checksum.
-	// NOTE: Checksum values should be zeroed out here.
-	pHdr->checksum[0] = 0;
-	pHdr->checksum[1] = 0;
-	pHdr->checksum[2] = 0;
-	pHdr->checksum[3] = 0;
+	// Each byte is either the high or low byte of a word.
+	// NOTE: Integer overflow/underflow is expected here.
+	const uint32_t hi_parity = (endian != CHKENDIAN_LITTLE ? 0 : 1);
+	for (uint32_t i = 0; i < len; i++) {
+		const uint16_t diff = (uint16_t)(newData[i] - oldData[i]);
+		if (((pos + i) & 1) == hi_parity) {
+			chk1 += (uint16_t)(diff << 8);
+		} else {
+			chk1 += diff;
+		}
+	}
+
+	uint16_t new_chk2 = (uint16_t)(-words - chk1);
+	if (chk1 == 0xFFFF)
+		chk1 = 0;
+	if (new_chk2 == 0xFFFF)
+		new_chk2 = 0;
+	*pChecksum = ((uint32_t)chk1 << 16) | new_chk2;
+	return 0;
+}
+
+/**
+ * Update a Dreamcast VMU checksum after part of the data has changed.
+ * @param crc Dreamcast VMU checksum of the original data.
+ * @param siz Length of the checksummed data.
+ * @param pos Position of the changed range, relative to the checksummed data.
+ * @param oldData Original data in the changed range.
+ * @param newData New data in the changed range.
+ * @param len Length of the changed range.
+ * @param crc_addr Address of CRC in header. (Set to -1 to skip.)
+ * @return Dreamcast VMU checksum of the new data.
+ */
+uint16_t DreamcastVMUUpdate(uint16_t crc, uint32_t siz, uint32_t pos,
+	const uint8_t *oldData, const uint8_t *newData, uint32_t len, uint32_t crc_addr)
+{
+	// FCS-16 has no initial value or final XOR, so the CRC of
+	// the new data is the old CRC XOR'd with the CRC of the
+	// difference, shifted past the rest of the data.
+	const uint16_t *const tbl0 = GetVmuCrcTables()->tbl[0];
+	unsigned int n = 0;
+	for (uint32_t i = 0; i < len; i++) {
+		uint8_t chr = oldData[i] ^ newData[i];
+		if (crc_addr != ~0U && pos + i - crc_addr < 2) {
+			// CRC address. Pretend it's 0.
+			chr = 0;
+		}
+		n = ((n << 8) ^ tbl0[chr ^ (n >> 8)]) & 0xFFFF;
+	}
 
-	// Calculate only the specified checksum.
-	uint32_t chk_actual = 0;
-	psrcbuf16 = reinterpret_cast<const uint16_t*>(&decbuf[0x08]);
-	psrcbuf16 += ((chkID ^ 3) * (0x9FF4/2));
-	for (size_t i = 0; i < 0x9FF4; i += 2, psrcbuf16++) {
-		chk_actual += (uint32_t)be16_to_cpu(*psrcbuf16);
+	// FCS-16 isn't reflected, but 0x1021 reflected is 0x8408,
+	// so the reflected shift can be used on bit-reversed values.
+	const uint32_t tailLen = siz - pos - len;
+	uint32_t rev = 0;
+	for (int i = 0; i < 16; i++) {
+		if (n & (1U << i))
+			rev |= (0x8000U >> i);
+	}
+	rev = CrcMultModP(CrcX8nModP(tailLen, 0x8408, 16), rev, 0x8408, 16);
+	n = 0;
+	for (int i = 0; i < 16; i++) {
+		if (rev & (1U << i))
+			n |= (0x8000U >> i);
 	}
-	return chk_actual;
+
+	return (crc ^ n) & 0xFFFF;
 }
 
 /** General functions. **/
@@ -325,8 +905,9 @@ uint32_t Exec(ChkAlgorithm algorithm, const void *buf, uint32_t siz, ChkEndian e
 				     siz, (uint16_t)(param & 0xFFFF));
 
 		case CHKALG_CRC32:
-			// TODO: Implement CRC32 once I encounter a file that uses it.
-			break;
+			if (param == 0)
+				param = CRC32_POLY_ZLIB;
+			return Crc32(static_cast<const uint8_t*>(buf), siz, param);
 
 		case CHKALG_ADDINVDUAL16:
 			return AddInvDual16(static_cast<const uint16_t*>(buf), siz, endian);
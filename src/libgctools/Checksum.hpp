@@ -116,6 +116,15 @@ static const uint16_t ADDSUBDUAL16_SUM_GCN_MEMCARD = 0xFFFF;
 */
 uint16_t Crc16(const uint8_t *buf, uint32_t siz, uint16_t poly = CRC16_POLY_CCITT);
 
+/**
+* CRC-32 algorithm.
+* @param buf Data buffer.
+* @param siz Length of data buffer.
+* @param poly Polynomial.
+* @return Checksum.
+*/
+uint32_t Crc32(const uint8_t *buf, uint32_t siz, uint32_t poly = CRC32_POLY_ZLIB);
+
 /**
 * AddInvDual16 algorithm.
 * Adds 16-bit words together in a uint16_t.
@@ -140,12 +149,31 @@ uint32_t AddBytes32(const uint8_t *buf, uint32_t siz);
 
 /**
 * SonicChaoGarden algorithm.
+*
+* NOTE: The checksum is stored within the data.
+* Use the chk_addr overload in order to handle
+* this properly.
+*
 * @param buf Data buffer.
 * @param siz Length of data buffer.
 * @return Checksum.
 */
 uint32_t SonicChaoGarden(const uint8_t *buf, uint32_t siz);
 
+/**
+* SonicChaoGarden algorithm.
+*
+* The checksum bytes and random_3 in ChaoGardenChecksumData
+* are treated as 0 without modifying the buffer. Bytes of
+* ChaoGardenChecksumData outside of the buffer are ignored.
+*
+* @param buf Data buffer.
+* @param siz Length of data buffer.
+* @param chk_addr Address of ChaoGardenChecksumData, relative to buf. (may be negative)
+* @return Checksum.
+*/
+uint32_t SonicChaoGarden(const uint8_t *buf, uint32_t siz, int64_t chk_addr);
+
 /**
 * Dreamcast VMU algorithm.
 * Based on FCS-16.
@@ -169,6 +197,8 @@ uint16_t DreamcastVMU(const uint8_t *buf, uint32_t siz, uint32_t crc_addr = -1);
  * The data area is "encrypted", so it has to be decrypted before
  * a checksum can be calculated.
  *
+ * NOTE: If more than one checksum is needed, use PokemonXDAll().
+ *
  * @param buf		[in] Data buffer.
  * @param siz		[in] Length of data buffer.
  * @param crc_addr	[in] CRC address. (Should be 0x10, 0x14, 0x18, 0x1C.)
@@ -177,6 +207,117 @@ uint16_t DreamcastVMU(const uint8_t *buf, uint32_t siz, uint32_t crc_addr = -1);
  */
 uint32_t PokemonXD(const uint8_t *buf, uint32_t siz, uint32_t crc_addr, uint32_t *pChkExpect);
 
+// Number of checksums in a Pokémon XD save slot.
+static const unsigned int POKEMONXD_CHECKSUM_COUNT = 4;
+
+/**
+ * Pokémon XD algorithm. (all checksums)
+ * Reference: https://github.com/TuxSH/PkmGCTools/blob/master/LibPkmGC/src/LibPkmGC/XD/SaveEditing/SaveSlot.cpp
+ *
+ * The data area is "encrypted", so it has to be decrypted before
+ * the checksums can be calculated. Decryption and summation are
+ * done in a single pass, so no decryption buffer is needed.
+ *
+ * @param buf		[in] Data buffer.
+ * @param siz		[in] Length of data buffer.
+ * @param values	[out] Checksum values, indexed by checksum ID. ((crc_addr >> 2) & 3)
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int PokemonXDAll(const uint8_t *buf, uint32_t siz, ChecksumValue values[POKEMONXD_CHECKSUM_COUNT]);
+
+/** Incremental updates. **/
+
+/**
+* Combine two CRC-16 checksums.
+* @param crc1 CRC-16 of the first buffer.
+* @param crc2 CRC-16 of the second buffer.
+* @param len2 Length of the second buffer.
+* @param poly Polynomial.
+* @return CRC-16 of both buffers, concatenated.
+*/
+uint16_t Crc16Combine(uint16_t crc1, uint16_t crc2, uint32_t len2, uint16_t poly = CRC16_POLY_CCITT);
+
+/**
+* Combine two CRC-32 checksums.
+* @param crc1 CRC-32 of the first buffer.
+* @param crc2 CRC-32 of the second buffer.
+* @param len2 Length of the second buffer.
+* @param poly Polynomial.
+* @return CRC-32 of both buffers, concatenated.
+*/
+uint32_t Crc32Combine(uint32_t crc1, uint32_t crc2, uint32_t len2, uint32_t poly = CRC32_POLY_ZLIB);
+
+/**
+* Update a CRC-16 checksum after part of the data has changed.
+* @param crc CRC-16 of the original data.
+* @param oldData Original data in the changed range.
+* @param newData New data in the changed range.
+* @param len Length of the changed range.
+* @param tailLen Number of checksummed bytes after the changed range.
+* @param poly Polynomial.
+* @return CRC-16 of the new data.
+*/
+uint16_t Crc16Update(uint16_t crc, const uint8_t *oldData, const uint8_t *newData,
+	uint32_t len, uint32_t tailLen, uint16_t poly = CRC16_POLY_CCITT);
+
+/**
+* Update a CRC-32 checksum after part of the data has changed.
+* @param crc CRC-32 of the original data.
+* @param oldData Original data in the changed range.
+* @param newData New data in the changed range.
+* @param len Length of the changed range.
+* @param tailLen Number of checksummed bytes after the changed range.
+* @param poly Polynomial.
+* @return CRC-32 of the new data.
+*/
+uint32_t Crc32Update(uint32_t crc, const uint8_t *oldData, const uint8_t *newData,
+	uint32_t len, uint32_t tailLen, uint32_t poly = CRC32_POLY_ZLIB);
+
+/**
+* Update an AddBytes32 checksum after part of the data has changed.
+* @param checksum AddBytes32 checksum of the original data.
+* @param oldData Original data in the changed range.
+* @param newData New data in the changed range.
+* @param len Length of the changed range.
+* @return AddBytes32 checksum of the new data.
+*/
+uint32_t AddBytes32Update(uint32_t checksum, const uint8_t *oldData, const uint8_t *newData, uint32_t len);
+
+/**
+ * Update an AddInvDual16 checksum after part of the data has changed.
+ *
+ * NOTE: AddInvDual16 changes 0xFFFF to 0, so the original sum
+ * is recovered using both words. In the rare case where that's
+ * ambiguous, the checksum must be recalculated.
+ *
+ * @param checksum	[in] AddInvDual16 checksum of the original data.
+ * @param siz		[in] Length of the checksummed data.
+ * @param pos		[in] Position of the changed range, relative to the checksummed data.
+ * @param oldData	[in] Original data in the changed range.
+ * @param newData	[in] New data in the changed range.
+ * @param len		[in] Length of the changed range.
+ * @param endian	[in] Endianness of the data.
+ * @param pChecksum	[out] AddInvDual16 checksum of the new data.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int AddInvDual16Update(uint32_t checksum, uint32_t siz, uint32_t pos,
+	const uint8_t *oldData, const uint8_t *newData, uint32_t len,
+	ChkEndian endian, uint32_t *pChecksum);
+
+/**
+* Update a Dreamcast VMU checksum after part of the data has changed.
+* @param crc Dreamcast VMU checksum of the original data.
+* @param siz Length of the checksummed data.
+* @param pos Position of the changed range, relative to the checksummed data.
+* @param oldData Original data in the changed range.
+* @param newData New data in the changed range.
+* @param len Length of the changed range.
+* @param crc_addr Address of CRC in header. (Set to -1 to skip.)
+* @return Dreamcast VMU checksum of the new data.
+*/
+uint16_t DreamcastVMUUpdate(uint16_t crc, uint32_t siz, uint32_t pos,
+	const uint8_t *oldData, const uint8_t *newData, uint32_t len, uint32_t crc_addr = -1);
+
 /** General functions. **/
 
 /**
@@ -0,0 +1,721 @@
+/***************************************************************************
+ * GameCube Tools Library.                                                 *
+ * ChecksumPlan.cpp: Precompiled checksum definitions.                     *
+ *                                                                         *
+ * Copyright (c) 2013-2018 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "ChecksumPlan.hpp"
+
+// C includes. (C++ namespace)
+#include <cstddef>
+#include <cstring>
+
+// C++ includes.
+#include <algorithm>
+#include <vector>
+using std::vector;
+
+using namespace Checksum;
+
+/** ChecksumPlanPrivate **/
+
+class ChecksumPlanPrivate
+{
+	public:
+		explicit ChecksumPlanPrivate(const vector<ChecksumDef> &checksumDefs);
+
+	private:
+		// Not copyable.
+		ChecksumPlanPrivate(const ChecksumPlanPrivate &other);
+		ChecksumPlanPrivate &operator=(const ChecksumPlanPrivate &other);
+
+	public:
+		// Original checksum definitions.
+		vector<ChecksumDef> checksumDefs;
+
+		/**
+		 * Checksum calculation.
+		 * Each job is run once, regardless of how many
+		 * definitions use it.
+		 */
+		struct Job {
+			ChkAlgorithm algorithm;
+			uint32_t start;		// Checksummed area: start.
+			uint32_t length;	// Checksummed area: length.
+			uint32_t param;		// Algorithm parameter.
+			int64_t chk_addr;	// Chao Garden: checksum address, relative to start. (may be negative)
+			ChkEndian endian;	// Endianness. (AddInvDual16 only)
+			int value;		// Index of the first result in the job results.
+		};
+		vector<Job> jobs;	// Sorted by data range.
+		int valueCount;		// Total number of job results.
+
+		/**
+		 * Checksum definition entry.
+		 */
+		struct Entry {
+			int job;		// Job index, or -1 if the definition is invalid.
+			uint32_t width;		// Width of the stored checksum, in bytes.
+		};
+		vector<Entry> entries;	// One entry per checksum definition.
+
+		/**
+		 * Get the width of the stored checksum.
+		 * @param algorithm Checksum algorithm.
+		 * @return Width of the stored checksum, in bytes. (0 if it's in the checksummed area.)
+		 */
+		static uint32_t checksumWidth(ChkAlgorithm algorithm);
+
+		/**
+		 * Create a job for a checksum definition.
+		 * Parameters that don't affect the checksum are normalized
+		 * so equivalent definitions have identical jobs.
+		 * @param checksumDef Checksum definition.
+		 * @return Job.
+		 */
+		static Job makeJob(const ChecksumDef &checksumDef);
+
+		/**
+		 * Do two jobs calculate the same checksum?
+		 * @param a Job A.
+		 * @param b Job B.
+		 * @return True if the jobs are equivalent.
+		 */
+		static bool isSameJob(const Job &a, const Job &b);
+
+		/**
+		 * Does a checksum definition fit in the data?
+		 * @param checksumDef Checksum definition.
+		 * @param entry Entry for the checksum definition.
+		 * @param siz Size of the data.
+		 * @return True if the definition fits.
+		 */
+		static bool fits(const ChecksumDef &checksumDef, const Entry &entry, uint32_t siz);
+
+		/**
+		 * Read the stored checksum.
+		 * @param buf Data buffer.
+		 * @param checksumDef Checksum definition.
+		 * @return Stored checksum.
+		 */
+		static uint32_t readExpected(const uint8_t *buf, const ChecksumDef &checksumDef);
+
+		/**
+		 * Write a stored checksum.
+		 * NOTE: For Sonic Chao Garden, only the checksum bytes are written.
+		 * @param buf Data buffer.
+		 * @param checksumDef Checksum definition.
+		 * @param value Checksum value.
+		 */
+		static void writeExpected(uint8_t *buf, const ChecksumDef &checksumDef, uint32_t value);
+};
+
+ChecksumPlanPrivate::ChecksumPlanPrivate(const vector<ChecksumDef> &checksumDefs)
+	: checksumDefs(checksumDefs)
+	, valueCount(0)
+{
+	// Create the jobs, merging equivalent definitions.
+	entries.resize(checksumDefs.size());
+	for (size_t i = 0; i < checksumDefs.size(); i++) {
+		const ChecksumDef &checksumDef = checksumDefs[i];
+		Entry &entry = entries[i];
+		entry.width = checksumWidth(checksumDef.algorithm);
+
+		if (checksumDef.algorithm == CHKALG_NONE ||
+		    checksumDef.algorithm >= CHKALG_MAX ||
+		    checksumDef.length == 0)
+		{
+			// No algorithm or invalid algorithm set,
+			// or the checksum data has no length.
+			entry.job = -1;
+			continue;
+		}
+
+		const Job job = makeJob(checksumDef);
+		entry.job = -1;
+		for (size_t j = 0; j < jobs.size(); j++) {
+			if (isSameJob(jobs[j], job)) {
+				entry.job = (int)j;
+				break;
+			}
+		}
+		if (entry.job < 0) {
+			entry.job = (int)jobs.size();
+			jobs.push_back(job);
+		}
+	}
+
+	// Sort the jobs by data range so the data is accessed sequentially.
+	vector<int> order(jobs.size());
+	for (size_t j = 0; j < order.size(); j++) {
+		order[j] = (int)j;
+	}
+	std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+		if (jobs[a].start != jobs[b].start)
+			return (jobs[a].start < jobs[b].start);
+		return (jobs[a].length < jobs[b].length);
+	});
+
+	vector<Job> sortedJobs;
+	vector<int> newIndex(jobs.size());
+	sortedJobs.reserve(jobs.size());
+	for (size_t j = 0; j < order.size(); j++) {
+		newIndex[order[j]] = (int)j;
+		sortedJobs.push_back(jobs[order[j]]);
+
+		// Pokémon XD jobs return all four checksums.
+		Job &job = sortedJobs.back();
+		job.value = valueCount;
+		valueCount += (job.algorithm == CHKALG_POKEMONXD
+			? (int)POKEMONXD_CHECKSUM_COUNT : 1);
+	}
+	jobs.swap(sortedJobs);
+
+	for (size_t i = 0; i < entries.size(); i++) {
+		if (entries[i].job >= 0) {
+			entries[i].job = newIndex[entries[i].job];
+		}
+	}
+}
+
+/**
+ * Get the width of the stored checksum.
+ * @param algorithm Checksum algorithm.
+ * @return Width of the stored checksum, in bytes. (0 if it's in the checksummed area.)
+ */
+uint32_t ChecksumPlanPrivate::checksumWidth(ChkAlgorithm algorithm)
+{
+	switch (algorithm) {
+		case CHKALG_CRC16:
+		case CHKALG_DREAMCASTVMU:
+			return 2;
+		case CHKALG_CRC32:
+		case CHKALG_ADDINVDUAL16:
+		case CHKALG_ADDBYTES32:
+			return 4;
+		case CHKALG_SONICCHAOGARDEN:
+			return (uint32_t)sizeof(ChaoGardenChecksumData);
+		case CHKALG_POKEMONXD:
+		default:
+			return 0;
+	}
+}
+
+/**
+ * Create a job for a checksum definition.
+ * Parameters that don't affect the checksum are normalized
+ * so equivalent definitions have identical jobs.
+ * @param checksumDef Checksum definition.
+ * @return Job.
+ */
+ChecksumPlanPrivate::Job ChecksumPlanPrivate::makeJob(const ChecksumDef &checksumDef)
+{
+	Job job;
+	job.algorithm = checksumDef.algorithm;
+	job.start = checksumDef.start;
+	job.length = checksumDef.length;
+	job.param = 0;
+	job.chk_addr = 0;
+	job.endian = CHKENDIAN_BIG;
+	job.value = 0;
+
+	switch (checksumDef.algorithm) {
+		case CHKALG_CRC16:
+			job.param = (checksumDef.param != 0
+				? (checksumDef.param & 0xFFFF) : CRC16_POLY_CCITT);
+			break;
+		case CHKALG_CRC32:
+			job.param = (checksumDef.param != 0
+				? checksumDef.param : CRC32_POLY_ZLIB);
+			break;
+		case CHKALG_ADDINVDUAL16:
+			job.endian = checksumDef.endian;
+			break;
+		case CHKALG_SONICCHAOGARDEN:
+			// NOTE: This is negative if the checksum
+			// is before the checksummed area.
+			job.chk_addr = (int64_t)checksumDef.address - (int64_t)checksumDef.start;
+			break;
+		case CHKALG_DREAMCASTVMU:
+			// See Checksum::Exec().
+			job.param = (checksumDef.param != 0 ? checksumDef.param : 0x46);
+			break;
+		default:
+			break;
+	}
+
+	return job;
+}
+
+/**
+ * Do two jobs calculate the same checksum?
+ * @param a Job A.
+ * @param b Job B.
+ * @return True if the jobs are equivalent.
+ */
+bool ChecksumPlanPrivate::isSameJob(const Job &a, const Job &b)
+{
+	return (a.algorithm == b.algorithm &&
+		a.start == b.start &&
+		a.length == b.length &&
+		a.param == b.param &&
+		a.chk_addr == b.chk_addr &&
+		a.endian == b.endian);
+}
+
+/**
+ * Does a checksum definition fit in the data?
+ * @param checksumDef Checksum definition.
+ * @param entry Entry for the checksum definition.
+ * @param siz Size of the data.
+ * @return True if the definition fits.
+ */
+bool ChecksumPlanPrivate::fits(const ChecksumDef &checksumDef, const Entry &entry, uint32_t siz)
+{
+	return (entry.job >= 0 &&
+		(uint64_t)checksumDef.start + checksumDef.length <= siz &&
+		(uint64_t)checksumDef.address + entry.width <= siz);
+}
+
+/**
+ * Read the stored checksum.
+ * @param buf Data buffer.
+ * @param checksumDef Checksum definition.
+ * @return Stored checksum.
+ */
+uint32_t ChecksumPlanPrivate::readExpected(const uint8_t *buf, const ChecksumDef &checksumDef)
+{
+	const uint8_t *const p = &buf[checksumDef.address];
+	const bool isBigEndian = (checksumDef.endian != CHKENDIAN_LITTLE);
+
+	switch (checksumDef.algorithm) {
+		case CHKALG_CRC16:
+		case CHKALG_DREAMCASTVMU:
+			if (isBigEndian) {
+				return (p[0] << 8) | p[1];
+			} else {
+				return (p[1] << 8) | p[0];
+			}
+
+		case CHKALG_CRC32:
+		case CHKALG_ADDINVDUAL16:
+		case CHKALG_ADDBYTES32:
+			if (isBigEndian) {
+				return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+			} else {
+				return ((uint32_t)p[3] << 24) | (p[2] << 16) | (p[1] << 8) | p[0];
+			}
+
+		case CHKALG_SONICCHAOGARDEN: {
+			const ChaoGardenChecksumData *const chaoChk =
+				reinterpret_cast<const ChaoGardenChecksumData*>(p);
+			if (isBigEndian) {
+				return ((uint32_t)chaoChk->checksum_3 << 24) |
+				       (chaoChk->checksum_2 << 16) |
+				       (chaoChk->checksum_1 << 8) |
+				       (chaoChk->checksum_0);
+			} else {
+				// TODO: Is this correct?
+				return ((uint32_t)chaoChk->checksum_0 << 24) |
+				       (chaoChk->checksum_1 << 16) |
+				       (chaoChk->checksum_2 << 8) |
+				       (chaoChk->checksum_3);
+			}
+		}
+
+		case CHKALG_POKEMONXD:
+			// Stored checksum is encrypted. It's returned by the job.
+		default:
+			return 0;
+	}
+}
+
+/**
+ * Write a stored checksum.
+ * NOTE: For Sonic Chao Garden, only the checksum bytes are written.
+ * @param buf Data buffer.
+ * @param checksumDef Checksum definition.
+ * @param value Checksum value.
+ */
+void ChecksumPlanPrivate::writeExpected(uint8_t *buf, const ChecksumDef &checksumDef, uint32_t value)
+{
+	uint8_t *const p = &buf[checksumDef.address];
+	const bool isBigEndian = (checksumDef.endian != CHKENDIAN_LITTLE);
+
+	switch (checksumDef.algorithm) {
+		case CHKALG_CRC16:
+		case CHKALG_DREAMCASTVMU:
+			if (isBigEndian) {
+				p[0] = (value >> 8) & 0xFF;
+				p[1] = value & 0xFF;
+			} else {
+				p[0] = value & 0xFF;
+				p[1] = (value >> 8) & 0xFF;
+			}
+			break;
+
+		case CHKALG_CRC32:
+		case CHKALG_ADDINVDUAL16:
+		case CHKALG_ADDBYTES32:
+			if (isBigEndian) {
+				p[0] = (value >> 24) & 0xFF;
+				p[1] = (value >> 16) & 0xFF;
+				p[2] = (value >> 8) & 0xFF;
+				p[3] = value & 0xFF;
+			} else {
+				p[0] = value & 0xFF;
+				p[1] = (value >> 8) & 0xFF;
+				p[2] = (value >> 16) & 0xFF;
+				p[3] = (value >> 24) & 0xFF;
+			}
+			break;
+
+		case CHKALG_SONICCHAOGARDEN: {
+			ChaoGardenChecksumData *const chaoChk =
+				reinterpret_cast<ChaoGardenChecksumData*>(p);
+			if (isBigEndian) {
+				chaoChk->checksum_3 = (value >> 24) & 0xFF;
+				chaoChk->checksum_2 = (value >> 16) & 0xFF;
+				chaoChk->checksum_1 = (value >> 8) & 0xFF;
+				chaoChk->checksum_0 = value & 0xFF;
+			} else {
+				chaoChk->checksum_0 = (value >> 24) & 0xFF;
+				chaoChk->checksum_1 = (value >> 16) & 0xFF;
+				chaoChk->checksum_2 = (value >> 8) & 0xFF;
+				chaoChk->checksum_3 = value & 0xFF;
+			}
+			break;
+		}
+
+		case CHKALG_POKEMONXD:
+			// Stored checksum is encrypted.
+		default:
+			break;
+	}
+}
+
+/** ChecksumPlan **/
+
+/**
+ * Compile a checksum plan.
+ * @param checksumDefs Checksum definitions.
+ */
+ChecksumPlan::ChecksumPlan(const vector<ChecksumDef> &checksumDefs)
+	: d(new ChecksumPlanPrivate(checksumDefs))
+{ }
+
+ChecksumPlan::~ChecksumPlan()
+{
+	delete d;
+}
+
+/**
+ * Get the checksum definitions.
+ * @return Checksum definitions, in the original order.
+ */
+const vector<ChecksumDef> &ChecksumPlan::checksumDefs(void) const
+{
+	return d->checksumDefs;
+}
+
+/**
+ * Are there any valid checksum definitions?
+ * @return True if there are no valid checksum definitions.
+ */
+bool ChecksumPlan::isEmpty(void) const
+{
+	return d->jobs.empty();
+}
+
+/**
+ * Get the byte ranges needed to execute the plan.
+ * This includes the checksummed areas and the
+ * stored checksums.
+ * @param siz Size of the data.
+ * @return Byte ranges, sorted by address, with overlapping ranges merged.
+ */
+vector<ChecksumPlan::Range> ChecksumPlan::ranges(uint32_t siz) const
+{
+	vector<Range> ranges;
+	ranges.reserve(d->entries.size() * 2);
+	for (size_t i = 0; i < d->entries.size(); i++) {
+		const ChecksumDef &checksumDef = d->checksumDefs[i];
+		const ChecksumPlanPrivate::Entry &entry = d->entries[i];
+		if (!ChecksumPlanPrivate::fits(checksumDef, entry, siz))
+			continue;
+
+		Range range;
+		range.start = checksumDef.start;
+		range.end = checksumDef.start + checksumDef.length;
+		ranges.push_back(range);
+
+		if (entry.width != 0) {
+			range.start = checksumDef.address;
+			range.end = checksumDef.address + entry.width;
+			ranges.push_back(range);
+		}
+	}
+
+	if (ranges.empty())
+		return ranges;
+
+	// Merge overlapping and adjacent ranges.
+	std::sort(ranges.begin(), ranges.end(), [](const Range &a, const Range &b) {
+		return (a.start < b.start);
+	});
+	vector<Range> merged;
+	merged.push_back(ranges[0]);
+	for (size_t i = 1; i < ranges.size(); i++) {
+		Range &last = merged.back();
+		if (ranges[i].start <= last.end) {
+			last.end = std::max(last.end, ranges[i].end);
+		} else {
+			merged.push_back(ranges[i]);
+		}
+	}
+	return merged;
+}
+
+/**
+ * Execute the plan.
+ * NOTE: Only the bytes in ranges(siz) need to be valid.
+ * @param buf Data buffer.
+ * @param siz Size of the data.
+ * @return Checksum values, one for each checksum definition that fits in the data.
+ */
+vector<ChecksumValue> ChecksumPlan::exec(const uint8_t *buf, uint32_t siz) const
+{
+	// Determine which jobs are needed.
+	vector<uint8_t> needed(d->jobs.size(), 0);
+	for (size_t i = 0; i < d->entries.size(); i++) {
+		if (ChecksumPlanPrivate::fits(d->checksumDefs[i], d->entries[i], siz)) {
+			needed[d->entries[i].job] = 1;
+		}
+	}
+
+	// Run the jobs.
+	vector<ChecksumValue> results(d->valueCount);
+	for (size_t j = 0; j < d->jobs.size(); j++) {
+		if (!needed[j])
+			continue;
+
+		const ChecksumPlanPrivate::Job &job = d->jobs[j];
+		const uint8_t *const start = buf + job.start;
+		switch (job.algorithm) {
+			case CHKALG_SONICCHAOGARDEN:
+				results[job.value].actual = SonicChaoGarden(start, job.length, job.chk_addr);
+				break;
+			case CHKALG_POKEMONXD:
+				PokemonXDAll(start, job.length, &results[job.value]);
+				break;
+			default:
+				results[job.value].actual = Exec(job.algorithm,
+					start, job.length, job.endian, job.param);
+				break;
+		}
+	}
+
+	// Get the checksum values.
+	vector<ChecksumValue> checksumValues;
+	checksumValues.reserve(d->entries.size());
+	for (size_t i = 0; i < d->entries.size(); i++) {
+		const ChecksumDef &checksumDef = d->checksumDefs[i];
+		const ChecksumPlanPrivate::Entry &entry = d->entries[i];
+		if (!ChecksumPlanPrivate::fits(checksumDef, entry, siz))
+			continue;
+
+		const ChecksumPlanPrivate::Job &job = d->jobs[entry.job];
+		ChecksumValue checksumValue;
+		if (job.algorithm == CHKALG_POKEMONXD) {
+			// Pokémon XD checksums are selected by address.
+			const unsigned int chkID = (checksumDef.address >> 2) & 3;
+			checksumValue = results[job.value + chkID];
+		} else {
+			checksumValue.expected = ChecksumPlanPrivate::readExpected(buf, checksumDef);
+			checksumValue.actual = results[job.value].actual;
+		}
+		checksumValues.push_back(checksumValue);
+	}
+
+	return checksumValues;
+}
+
+/**
+ * Update checksum values after part of the data has changed.
+ * Only the changed bytes are processed, so this is much
+ * faster than exec() for small edits.
+ *
+ * NOTE: Sonic Chao Garden and Pokémon XD checksums can't
+ * be updated incrementally. If the changed range affects
+ * them, false is returned and exec() must be used instead.
+ *
+ * @param values	[in/out] Checksum values from exec().
+ * @param siz		[in] Size of the data.
+ * @param pos		[in] Position of the changed range.
+ * @param oldData	[in] Original data in the changed range.
+ * @param newData	[in] New data in the changed range.
+ * @param len		[in] Length of the changed range.
+ * @return True if the values were updated; false if exec() is needed.
+ */
+bool ChecksumPlan::update(vector<ChecksumValue> &values, uint32_t siz,
+	uint32_t pos, const uint8_t *oldData, const uint8_t *newData, uint32_t len) const
+{
+	if ((uint64_t)pos + len > siz)
+		return false;
+	const uint32_t end = pos + len;
+
+	// Updated job results.
+	// Each job is only updated once, since merged
+	// definitions share the same actual checksum.
+	vector<uint8_t> jobDone(d->jobs.size(), 0);
+	vector<uint32_t> jobActual(d->jobs.size());
+
+	vector<ChecksumValue> newValues(values);
+	size_t k = 0;
+	for (size_t i = 0; i < d->entries.size(); i++) {
+		const ChecksumDef &checksumDef = d->checksumDefs[i];
+		const ChecksumPlanPrivate::Entry &entry = d->entries[i];
+		if (!ChecksumPlanPrivate::fits(checksumDef, entry, siz))
+			continue;
+		if (k >= newValues.size()) {
+			// Values don't match the plan.
+			return false;
+		}
+		ChecksumValue &checksumValue = newValues[k++];
+
+		// Actual checksum.
+		const ChecksumPlanPrivate::Job &job = d->jobs[entry.job];
+		const uint32_t s = std::max(pos, job.start);
+		const uint32_t e = std::min(end, job.start + job.length);
+		if (s < e) {
+			if (!jobDone[entry.job]) {
+				const uint32_t off = s - pos;	// Offset in the changed range.
+				const uint32_t rel = s - job.start;	// Offset in the checksummed area.
+				const uint32_t n = e - s;
+				const uint32_t tailLen = job.length - rel - n;
+				uint32_t actual = checksumValue.actual;
+
+				switch (job.algorithm) {
+					case CHKALG_CRC16:
+						actual = Crc16Update((uint16_t)actual, &oldData[off], &newData[off],
+							n, tailLen, (uint16_t)job.param);
+						break;
+					case CHKALG_CRC32:
+						actual = Crc32Update(actual, &oldData[off], &newData[off],
+							n, tailLen, job.param);
+						break;
+					case CHKALG_ADDBYTES32:
+						actual = AddBytes32Update(actual, &oldData[off], &newData[off], n);
+						break;
+					case CHKALG_ADDINVDUAL16: {
+						int ret = AddInvDual16Update(actual, job.length, rel,
+							&oldData[off], &newData[off], n, job.endian, &actual);
+						if (ret != 0)
+							return false;
+						break;
+					}
+					case CHKALG_DREAMCASTVMU:
+						actual = DreamcastVMUUpdate((uint16_t)actual, job.length, rel,
+							&oldData[off], &newData[off], n, job.param);
+						break;
+					case CHKALG_SONICCHAOGARDEN:
+					case CHKALG_POKEMONXD:
+					default:
+						// Can't be updated incrementally.
+						return false;
+				}
+
+				jobActual[entry.job] = actual;
+				jobDone[entry.job] = 1;
+			}
+			checksumValue.actual = jobActual[entry.job];
+		}
+
+		// Stored checksum.
+		// Re-serialize the old value, apply the changed bytes,
+		// and read it back.
+		if (entry.width != 0 && pos < checksumDef.address + entry.width && end > checksumDef.address) {
+			ChecksumDef fieldDef = checksumDef;
+			fieldDef.address = 0;
+			uint8_t field[sizeof(ChaoGardenChecksumData)] = {0};
+			ChecksumPlanPrivate::writeExpected(field, fieldDef, checksumValue.expected);
+
+			const uint32_t fs = std::max(pos, checksumDef.address);
+			const uint32_t fe = std::min(end, checksumDef.address + entry.width);
+			memcpy(&field[fs - checksumDef.address], &newData[fs - pos], fe - fs);
+			checksumValue.expected = ChecksumPlanPrivate::readExpected(field, fieldDef);
+		}
+	}
+
+	if (k != newValues.size()) {
+		// Values don't match the plan.
+		return false;
+	}
+	values.swap(newValues);
+	return true;
+}
+
+/**
+ * Get the patches needed to fix invalid stored checksums.
+ *
+ * NOTE: A stored checksum may be covered by another checksum,
+ * so the values must be updated after applying the patches,
+ * and this function must be called again until no patches
+ * are returned.
+ *
+ * NOTE: Pokémon XD checksums are encrypted with the data,
+ * so they can't be fixed.
+ *
+ * @param values Checksum values from exec().
+ * @param siz Size of the data.
+ * @return Patches, or empty vector if all fixable checksums are valid.
+ */
+vector<ChecksumPlan::Patch> ChecksumPlan::patches(const vector<ChecksumValue> &values, uint32_t siz) const
+{
+	vector<Patch> patches;
+	size_t k = 0;
+	for (size_t i = 0; i < d->entries.size() && k < values.size(); i++) {
+		const ChecksumDef &checksumDef = d->checksumDefs[i];
+		const ChecksumPlanPrivate::Entry &entry = d->entries[i];
+		if (!ChecksumPlanPrivate::fits(checksumDef, entry, siz))
+			continue;
+
+		const ChecksumValue &checksumValue = values[k++];
+		if (entry.width == 0 || checksumValue.expected == checksumValue.actual) {
+			// Checksum can't be fixed, or is already valid.
+			continue;
+		}
+
+		ChecksumDef fieldDef = checksumDef;
+		fieldDef.address = 0;
+		uint8_t field[sizeof(ChaoGardenChecksumData)];
+		ChecksumPlanPrivate::writeExpected(field, fieldDef, checksumValue.actual);
+
+		Patch patch;
+		if (checksumDef.algorithm == CHKALG_SONICCHAOGARDEN) {
+			// Only the checksum bytes are written.
+			// The random bytes must not be changed.
+			static const uint8_t chaoChkOffsets[4] = {
+				offsetof(ChaoGardenChecksumData, checksum_0),
+				offsetof(ChaoGardenChecksumData, checksum_1),
+				offsetof(ChaoGardenChecksumData, checksum_2),
+				offsetof(ChaoGardenChecksumData, checksum_3),
+			};
+			for (unsigned int j = 0; j < 4; j++) {
+				patch.address = checksumDef.address + chaoChkOffsets[j];
+				patch.length = 1;
+				patch.data[0] = field[chaoChkOffsets[j]];
+				patches.push_back(patch);
+			}
+		} else {
+			patch.address = checksumDef.address;
+			patch.length = entry.width;
+			memcpy(patch.data, field, entry.width);
+			patches.push_back(patch);
+		}
+	}
+
+	return patches;
+}
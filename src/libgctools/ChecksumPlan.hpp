@@ -0,0 +1,136 @@
+/***************************************************************************
+ * GameCube Tools Library.                                                 *
+ * ChecksumPlan.hpp: Precompiled checksum definitions.                     *
+ *                                                                         *
+ * Copyright (c) 2013-2018 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __LIBGCTOOLS_CHECKSUMPLAN_HPP__
+#define __LIBGCTOOLS_CHECKSUMPLAN_HPP__
+
+#include "Checksum.hpp"
+
+// C includes.
+#include <stdint.h>
+
+// C++ includes.
+#include <vector>
+
+/**
+ * A set of checksum definitions, compiled for execution.
+ *
+ * Definitions are sorted by data range, and definitions that
+ * would calculate the same checksum over the same range are
+ * merged, so each checksum is only calculated once. The data
+ * buffer is never modified.
+ *
+ * ChecksumPlan is immutable once created, so it can be
+ * shared between multiple files and threads.
+ */
+class ChecksumPlanPrivate;
+class ChecksumPlan
+{
+	public:
+		/**
+		 * Compile a checksum plan.
+		 * @param checksumDefs Checksum definitions.
+		 */
+		explicit ChecksumPlan(const std::vector<Checksum::ChecksumDef> &checksumDefs);
+		~ChecksumPlan();
+
+	private:
+		friend class ChecksumPlanPrivate;
+		ChecksumPlanPrivate *const d;
+
+		// Not copyable.
+		ChecksumPlan(const ChecksumPlan &other);
+		ChecksumPlan &operator=(const ChecksumPlan &other);
+
+	public:
+		/**
+		 * Get the checksum definitions.
+		 * @return Checksum definitions, in the original order.
+		 */
+		const std::vector<Checksum::ChecksumDef> &checksumDefs(void) const;
+
+		/**
+		 * Are there any valid checksum definitions?
+		 * @return True if there are no valid checksum definitions.
+		 */
+		bool isEmpty(void) const;
+
+		/**
+		 * Byte range.
+		 */
+		struct Range {
+			uint32_t start;		// First byte.
+			uint32_t end;		// Last byte + 1.
+		};
+
+		/**
+		 * Get the byte ranges needed to execute the plan.
+		 * This includes the checksummed areas and the
+		 * stored checksums.
+		 * @param siz Size of the data.
+		 * @return Byte ranges, sorted by address, with overlapping ranges merged.
+		 */
+		std::vector<Range> ranges(uint32_t siz) const;
+
+		/**
+		 * Execute the plan.
+		 * NOTE: Only the bytes in ranges(siz) need to be valid.
+		 * @param buf Data buffer.
+		 * @param siz Size of the data.
+		 * @return Checksum values, one for each checksum definition that fits in the data.
+		 */
+		std::vector<Checksum::ChecksumValue> exec(const uint8_t *buf, uint32_t siz) const;
+
+		/**
+		 * Update checksum values after part of the data has changed.
+		 * Only the changed bytes are processed, so this is much
+		 * faster than exec() for small edits.
+		 *
+		 * NOTE: Sonic Chao Garden and Pokémon XD checksums can't
+		 * be updated incrementally. If the changed range affects
+		 * them, false is returned and exec() must be used instead.
+		 *
+		 * @param values	[in/out] Checksum values from exec().
+		 * @param siz		[in] Size of the data.
+		 * @param pos		[in] Position of the changed range.
+		 * @param oldData	[in] Original data in the changed range.
+		 * @param newData	[in] New data in the changed range.
+		 * @param len		[in] Length of the changed range.
+		 * @return True if the values were updated; false if exec() is needed.
+		 */
+		bool update(std::vector<Checksum::ChecksumValue> &values, uint32_t siz,
+			uint32_t pos, const uint8_t *oldData, const uint8_t *newData, uint32_t len) const;
+
+		/**
+		 * Data to write in order to fix a stored checksum.
+		 */
+		struct Patch {
+			uint32_t address;	// Address of the stored checksum.
+			uint32_t length;	// Length of the stored checksum, in bytes.
+			uint8_t data[4];	// Stored checksum.
+		};
+
+		/**
+		 * Get the patches needed to fix invalid stored checksums.
+		 *
+		 * NOTE: A stored checksum may be covered by another checksum,
+		 * so the values must be updated after applying the patches,
+		 * and this function must be called again until no patches
+		 * are returned.
+		 *
+		 * NOTE: Pokémon XD checksums are encrypted with the data,
+		 * so they can't be fixed.
+		 *
+		 * @param values Checksum values from exec().
+		 * @param siz Size of the data.
+		 * @return Patches, or empty vector if all fixable checksums are valid.
+		 */
+		std::vector<Patch> patches(const std::vector<Checksum::ChecksumValue> &values, uint32_t siz) const;
+};
+
+#endif /* __LIBGCTOOLS_CHECKSUMPLAN_HPP__ */
@@ -0,0 +1,1349 @@
+/***************************************************************************
+ * GameCube Tools Library.                                                 *
+ * ChecksumSearch.cpp: Checksum definition discovery.                      *
+ *                                                                         *
+ * Copyright (c) 2013-2018 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "ChecksumSearch.hpp"
+#include "Checksum_p.hpp"
+
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cmath>
+#include <cstddef>
+
+// C++ includes.
+#include <algorithm>
+#include <atomic>
+#include <utility>
+#include <vector>
+using std::atomic;
+using std::pair;
+using std::vector;
+
+using namespace Checksum;
+
+/** ChecksumSearchPrivate **/
+
+class ChecksumSearchPrivate
+{
+	public:
+		ChecksumSearchPrivate();
+
+	private:
+		// Not copyable.
+		ChecksumSearchPrivate(const ChecksumSearchPrivate &other);
+		ChecksumSearchPrivate &operator=(const ChecksumSearchPrivate &other);
+
+	public:
+		ChecksumSearch::Options options;
+		vector<vector<uint8_t> > samples;
+
+		// Maximum number of tasks per job.
+		static const unsigned int MAX_TASKS_PER_JOB = 64;
+
+		// Maximum cost of a free search, in table lookups.
+		// If it would take longer than this, only areas
+		// next to the stored checksum are searched.
+		static const uint64_t MAX_FREE_SEARCH_COST = (1ULL << 28);
+
+		// Maximum cost of calculating CRCs incrementally for areas
+		// that start after the stored checksum, in bytes.
+		static const uint64_t MAX_CRC_SCAN_COST = (1ULL << 30);
+
+		// Searched data.
+		uint32_t siz;		// Length of the shortest sample.
+		uint32_t align;		// Alignment of the checksummed area.
+		uint32_t posCount;	// Number of aligned positions. (siz / align + 1)
+		uint32_t minIdx;	// Minimum length of the checksummed area, in positions.
+
+		/**
+		 * Prefix tables for a sample.
+		 * Entry i is for the first (i * align) bytes.
+		 */
+		struct Prefix {
+			vector<uint32_t> addBytes;	// AddBytes32 sums.
+			vector<uint16_t> words[2];	// AddInvDual16 word sums. (indexed by ChkEndian)
+			vector<uint32_t> crc[2];	// Raw CRC states, starting from 0. (0 == CRC-16; 1 == CRC-32)
+		};
+		vector<Prefix> prefix;
+
+		/**
+		 * CRC parameters.
+		 *
+		 * With R[i] as the raw CRC state of the first i positions,
+		 * the CRC of positions [s, e) is:
+		 *   mask ^ R[e] ^ ((R[s] ^ mask) * x^(8*(e-s)))
+		 * Multiplying by x^(-8*e) separates s and e, so matching
+		 * start positions can be looked up in a sorted table.
+		 */
+		struct CrcInfo {
+			bool valid;		// False if this CRC isn't being searched for.
+			uint32_t poly;		// Polynomial. (reflected)
+			unsigned int width;	// Width, in bits.
+			uint32_t mask;		// Initial value and final XOR.
+			vector<uint32_t> xpow;	// x^(8*i*align) mod poly
+			vector<uint32_t> xinv;	// x^(-8*i*align) mod poly
+			// Normalized prefix CRCs of sample 0, sorted:
+			// (((R[i] ^ mask) * xinv[i]), i)
+			vector<pair<uint32_t, uint32_t> > norm;
+		};
+		CrcInfo crcInfo[2];
+
+		// Free search.
+		int diffSample;			// Sample compared to sample 0, or -1 if none.
+		vector<uint32_t> segments;	// First position of each run of positions
+						// without differences between them.
+
+		/**
+		 * Search job: one algorithm and endianness.
+		 */
+		struct Job {
+			ChkAlgorithm algorithm;
+			ChkEndian endian;
+			bool free;		// If true, areas anywhere are enumerated.
+			bool scanCrc;		// If true, CRCs of areas starting after the stored checksum are scanned.
+			double anchoredBits;	// Evidence needed for areas next to the stored checksum.
+			double freeBits;	// Evidence needed for other areas. (HUGE_VAL if not allowed)
+			vector<uint32_t> addrs;	// Stored checksum addresses that weren't pruned.
+
+			// Free search: (stored checksum difference, address), sorted.
+			vector<pair<uint32_t, uint32_t> > keys;
+			// Free search: difference value at the start of each segment.
+			vector<uint32_t> segValues;
+		};
+		vector<Job> jobs;
+
+		/**
+		 * Search task: a range of addresses or end positions in a job.
+		 */
+		struct Task {
+			unsigned int job;
+			uint32_t begin;
+			uint32_t end;
+		};
+		vector<Task> tasks;
+		bool exhaustive;
+
+		/**
+		 * Task context.
+		 */
+		struct Context {
+			vector<ChecksumDef> *results;
+			size_t limit;			// Stop when results reaches this size.
+			const atomic<bool> *pCancel;
+
+			inline bool isDone(void) const
+			{
+				return (results->size() >= limit ||
+					(pCancel && pCancel->load(std::memory_order_relaxed)));
+			}
+		};
+
+		/**
+		 * Get the width of the stored checksum.
+		 * @param algorithm Checksum algorithm.
+		 * @return Width of the stored checksum, in bytes.
+		 */
+		static inline uint32_t checksumWidth(ChkAlgorithm algorithm)
+		{
+			return (algorithm == CHKALG_CRC16 ? 2 : 4);
+		}
+
+		/**
+		 * Get the amount of evidence provided by a matching sample.
+		 * Sums of bytes aren't uniformly distributed,
+		 * so they provide less evidence than their width.
+		 * @param algorithm Checksum algorithm.
+		 * @return Evidence, in bits.
+		 */
+		static inline unsigned int evidenceBits(ChkAlgorithm algorithm)
+		{
+			switch (algorithm) {
+				case CHKALG_CRC32:
+				case CHKALG_ADDINVDUAL16:
+					return 32;
+				case CHKALG_CRC16:
+					return 16;
+				case CHKALG_ADDBYTES32:
+				default:
+					return 12;
+			}
+		}
+
+		/**
+		 * Get the CRC parameters for a job.
+		 * @param job Job.
+		 * @return CRC parameters.
+		 */
+		inline const CrcInfo &crc(const Job &job) const
+		{
+			return crcInfo[job.algorithm == CHKALG_CRC32 ? 1 : 0];
+		}
+
+		/**
+		 * Get the raw CRC prefix table for a job.
+		 * @param k Sample index.
+		 * @param job Job.
+		 * @return Raw CRC prefix table.
+		 */
+		inline const vector<uint32_t> &crcPrefix(int k, const Job &job) const
+		{
+			return prefix[k].crc[job.algorithm == CHKALG_CRC32 ? 1 : 0];
+		}
+
+		/**
+		 * Calculate x^n modulo a reflected CRC polynomial.
+		 * @param base x, or any other polynomial. (reflected)
+		 * @param n Exponent.
+		 * @param poly CRC polynomial. (reflected)
+		 * @param width CRC width, in bits.
+		 * @return base^n mod poly
+		 */
+		static uint32_t crcPowModP(uint32_t base, uint32_t n, uint32_t poly, unsigned int width);
+
+		/**
+		 * Initialize the CRC parameters and tables.
+		 * @param idx CRC index. (0 == CRC-16; 1 == CRC-32)
+		 * @param poly Polynomial. (reflected)
+		 * @param width Width, in bits.
+		 */
+		void initCrc(int idx, uint32_t poly, unsigned int width);
+
+		/**
+		 * Build the prefix tables for a sample.
+		 * @param k Sample index.
+		 */
+		void initPrefix(int k);
+
+		/**
+		 * Select the sample to compare to sample 0 for the free search,
+		 * and determine the segments.
+		 */
+		void initSegments(void);
+
+		/**
+		 * Initialize a job.
+		 * @param algorithm Checksum algorithm.
+		 * @param endian Endianness.
+		 */
+		void initJob(ChkAlgorithm algorithm, ChkEndian endian);
+
+		/**
+		 * Read the stored checksum.
+		 * @param k Sample index.
+		 * @param job Job.
+		 * @param address Address of the stored checksum.
+		 * @return Stored checksum.
+		 */
+		uint32_t readStored(int k, const Job &job, uint32_t address) const;
+
+		/**
+		 * Calculate the checksum of an area.
+		 * @param k Sample index.
+		 * @param job Job.
+		 * @param si Start position.
+		 * @param ei End position.
+		 * @return Checksum.
+		 */
+		uint32_t calc(int k, const Job &job, uint32_t si, uint32_t ei) const;
+
+		/**
+		 * Get the possible AddInvDual16 area lengths for a stored checksum.
+		 * The second word depends on the number of words, so the
+		 * length (modulo 128 KB) is known from the stored checksum.
+		 * @param job		[in] Job.
+		 * @param address	[in] Address of the stored checksum.
+		 * @param lengths	[out] Lengths, in positions.
+		 */
+		void addInvDual16Lengths(const Job &job, uint32_t address, vector<uint32_t> &lengths) const;
+
+		/**
+		 * Does an area overlap the stored checksum?
+		 * @param job Job.
+		 * @param address Address of the stored checksum.
+		 * @param si Start position.
+		 * @param ei End position.
+		 * @return True if the area overlaps the stored checksum.
+		 */
+		inline bool overlaps(const Job &job, uint32_t address, uint32_t si, uint32_t ei) const
+		{
+			return ((uint64_t)si * align < (uint64_t)address + checksumWidth(job.algorithm) &&
+				address < (uint64_t)ei * align);
+		}
+
+		/**
+		 * Verify a match against all samples, and add it to the results
+		 * if there's enough evidence.
+		 * @param ctx Task context.
+		 * @param job Job.
+		 * @param address Address of the stored checksum.
+		 * @param si Start position.
+		 * @param ei End position.
+		 * @return True if the match was added.
+		 */
+		bool addResult(Context &ctx, const Job &job, uint32_t address, uint32_t si, uint32_t ei) const;
+
+		/**
+		 * Find start positions in sample 0 for an end position.
+		 * @param ctx Task context.
+		 * @param job Job.
+		 * @param address Address of the stored checksum.
+		 * @param ei End position.
+		 * @param lo Lowest start position.
+		 * @param hi Highest start position.
+		 */
+		void findStarts(Context &ctx, const Job &job, uint32_t address,
+			uint32_t ei, uint32_t lo, uint32_t hi) const;
+
+		/**
+		 * Find end positions in sample 0 for a start position.
+		 * @param ctx Task context.
+		 * @param job Job.
+		 * @param address Address of the stored checksum.
+		 * @param si Start position.
+		 */
+		void findEnds(Context &ctx, const Job &job, uint32_t address, uint32_t si) const;
+
+		/**
+		 * Search for areas next to a stored checksum.
+		 * @param ctx Task context.
+		 * @param job Job.
+		 * @param address Address of the stored checksum.
+		 */
+		void searchAnchored(Context &ctx, const Job &job, uint32_t address) const;
+
+		/**
+		 * Search for areas anywhere for an AddInvDual16 stored checksum.
+		 * @param ctx Task context.
+		 * @param job Job.
+		 * @param address Address of the stored checksum.
+		 */
+		void searchFreeAddInvDual16(Context &ctx, const Job &job, uint32_t address) const;
+
+		/**
+		 * Search for areas anywhere that end at the specified position.
+		 * @param ctx Task context.
+		 * @param job Job.
+		 * @param ei End position.
+		 */
+		void searchFree(Context &ctx, const Job &job, uint32_t ei) const;
+};
+
+ChecksumSearchPrivate::ChecksumSearchPrivate()
+	: siz(0)
+	, align(1)
+	, posCount(0)
+	, minIdx(1)
+	, diffSample(-1)
+	, exhaustive(false)
+{
+	crcInfo[0].valid = false;
+	crcInfo[1].valid = false;
+}
+
+/**
+ * Calculate x^n modulo a reflected CRC polynomial.
+ * @param base x, or any other polynomial. (reflected)
+ * @param n Exponent.
+ * @param poly CRC polynomial. (reflected)
+ * @param width CRC width, in bits.
+ * @return base^n mod poly
+ */
+uint32_t ChecksumSearchPrivate::crcPowModP(uint32_t base, uint32_t n, uint32_t poly, unsigned int width)
+{
+	uint32_t p = (1U << (width - 1));	// x^0
+	for (; n != 0; n >>= 1) {
+		if (n & 1)
+			p = CrcMultModP(base, p, poly, width);
+		base = CrcMultModP(base, base, poly, width);
+	}
+	return p;
+}
+
+/**
+ * Initialize the CRC parameters and tables.
+ * @param idx CRC index. (0 == CRC-16; 1 == CRC-32)
+ * @param poly Polynomial. (reflected)
+ * @param width Width, in bits.
+ */
+void ChecksumSearchPrivate::initCrc(int idx, uint32_t poly, unsigned int width)
+{
+	CrcInfo &info = crcInfo[idx];
+	info.valid = false;
+	info.poly = poly;
+	info.width = width;
+	info.mask = (width == 32 ? 0xFFFFFFFFU : ((1U << width) - 1));
+	info.xpow.clear();
+	info.xinv.clear();
+	info.norm.clear();
+
+	// x^-1 exists if the polynomial has an x^0 term.
+	// P(x) = x^w + p(x), so x^-1 = x^(w-1) + (p(x) - 1) / x.
+	const uint32_t one = (1U << (width - 1));
+	if (!(poly & one))
+		return;
+	const uint32_t xinv1 = ((poly << 1) & info.mask) | 1;
+
+	const uint32_t step = CrcX8nModP(align, poly, width);
+	const uint32_t stepInv = crcPowModP(xinv1, 8 * align, poly, width);
+	if (CrcMultModP(step, stepInv, poly, width) != one)
+		return;
+
+	info.xpow.resize(posCount);
+	info.xinv.resize(posCount);
+	info.xpow[0] = one;
+	info.xinv[0] = one;
+	for (uint32_t i = 1; i < posCount; i++) {
+		info.xpow[i] = CrcMultModP(info.xpow[i-1], step, poly, width);
+		info.xinv[i] = CrcMultModP(info.xinv[i-1], stepInv, poly, width);
+	}
+
+	info.valid = true;
+}
+
+/**
+ * Build the prefix tables for a sample.
+ * @param k Sample index.
+ */
+void ChecksumSearchPrivate::initPrefix(int k)
+{
+	const uint8_t *const buf = samples[k].data();
+	Prefix &p = prefix[k];
+
+	if (options.algorithms & (1U << CHKALG_ADDBYTES32)) {
+		p.addBytes.resize(posCount);
+		uint32_t sum = 0;
+		p.addBytes[0] = 0;
+		for (uint32_t i = 1; i < posCount; i++) {
+			const uint8_t *const chunk = &buf[(i-1) * align];
+			for (uint32_t j = 0; j < align; j++) {
+				sum += chunk[j];
+			}
+			p.addBytes[i] = sum;
+		}
+	}
+
+	if ((options.algorithms & (1U << CHKALG_ADDINVDUAL16)) && align >= 2) {
+		for (int endian = CHKENDIAN_BIG; endian <= CHKENDIAN_LITTLE; endian++) {
+			if (!(options.endians & (1U << endian)))
+				continue;
+
+			vector<uint16_t> &words = p.words[endian];
+			const int hi = (endian == CHKENDIAN_BIG ? 0 : 1);
+			words.resize(posCount);
+			uint16_t sum = 0;
+			words[0] = 0;
+			for (uint32_t i = 1; i < posCount; i++) {
+				const uint8_t *const chunk = &buf[(i-1) * align];
+				for (uint32_t j = 0; j < align; j += 2) {
+					sum += (uint16_t)((chunk[j+hi] << 8) | chunk[j+(hi^1)]);
+				}
+				words[i] = sum;
+			}
+		}
+	}
+
+	for (int idx = 0; idx < 2; idx++) {
+		const CrcInfo &info = crcInfo[idx];
+		if (!info.valid)
+			continue;
+
+		const uint32_t *const tbl = CrcTable(info.poly);
+		vector<uint32_t> &crc = p.crc[idx];
+		crc.resize(posCount);
+		uint32_t state = 0;
+		crc[0] = 0;
+		for (uint32_t i = 1; i < posCount; i++) {
+			const uint8_t *const chunk = &buf[(i-1) * align];
+			for (uint32_t j = 0; j < align; j++) {
+				state = tbl[(chunk[j] ^ state) & 0xFF] ^ (state >> 8);
+			}
+			crc[i] = state;
+		}
+	}
+}
+
+/**
+ * Select the sample to compare to sample 0 for the free search,
+ * and determine the segments.
+ */
+void ChecksumSearchPrivate::initSegments(void)
+{
+	diffSample = -1;
+	segments.clear();
+
+	// Areas without differences can't be found by the free search,
+	// so use the sample with the most differing positions, as long
+	// as the free search is affordable. Otherwise, use the sample
+	// with the fewest differing positions.
+	const uint8_t *const buf0 = samples[0].data();
+	for (int k = 1; k < (int)samples.size(); k++) {
+		const uint8_t *const buf = samples[k].data();
+		vector<uint32_t> segs;
+		segs.push_back(0);
+		for (uint32_t i = 1; i < posCount; i++) {
+			const uint32_t pos = (i-1) * align;
+			for (uint32_t j = 0; j < align; j++) {
+				if (buf[pos+j] != buf0[pos+j]) {
+					segs.push_back(i);
+					break;
+				}
+			}
+		}
+
+		if (segs.size() <= 1) {
+			// Identical to sample 0.
+			continue;
+		}
+
+		const bool isAffordable = ((uint64_t)segs.size() * posCount <= MAX_FREE_SEARCH_COST);
+		const bool wasAffordable = ((uint64_t)segments.size() * posCount <= MAX_FREE_SEARCH_COST);
+		if (diffSample < 0 ||
+		    (isAffordable && (!wasAffordable || segs.size() > segments.size())) ||
+		    (!isAffordable && !wasAffordable && segs.size() < segments.size()))
+		{
+			diffSample = k;
+			segments.swap(segs);
+		}
+	}
+}
+
+/**
+ * Initialize a job.
+ * @param algorithm Checksum algorithm.
+ * @param endian Endianness.
+ */
+void ChecksumSearchPrivate::initJob(ChkAlgorithm algorithm, ChkEndian endian)
+{
+	Job job;
+	job.algorithm = algorithm;
+	job.endian = endian;
+	job.free = false;
+	job.scanCrc = false;
+	job.anchoredBits = 0;
+	job.freeBits = 0;
+
+	// Find the stored checksum addresses worth searching.
+	const uint32_t width = checksumWidth(algorithm);
+	const int sampleCount = (int)samples.size();
+	vector<uint32_t> lengths;
+	for (uint32_t address = 0; address + width <= siz; address += options.addressAlign) {
+		// Skip addresses that are zero in all samples.
+		// These are usually unused fields.
+		bool isAllZero = true;
+		bool isPossible = true;
+		for (int k = 0; k < sampleCount; k++) {
+			const uint32_t value = readStored(k, job, address);
+			isAllZero &= (value == 0);
+			if (algorithm == CHKALG_ADDBYTES32 && value > prefix[k].addBytes[posCount-1]) {
+				// Larger than the sum of the entire sample.
+				isPossible = false;
+				break;
+			}
+		}
+		if (isAllZero || !isPossible)
+			continue;
+
+		if (algorithm == CHKALG_ADDINVDUAL16) {
+			// The length must be consistent in all samples.
+			addInvDual16Lengths(job, address, lengths);
+			if (lengths.empty())
+				continue;
+		}
+
+		job.addrs.push_back(address);
+	}
+	if (job.addrs.empty())
+		return;
+
+	// Each matching sample with a distinct stored checksum
+	// provides evidence that a match isn't due to chance.
+	// If all of the samples combined can't provide enough
+	// evidence, don't bother searching.
+	const double addrBits = log2((double)job.addrs.size());
+	const double posBits = log2((double)posCount);
+	// AddInvDual16 lengths are taken from the stored checksum.
+	const double lengthBits = (algorithm == CHKALG_ADDINVDUAL16 ? 16.0 : posBits);
+	const unsigned int maxEvidence = evidenceBits(algorithm) * sampleCount;
+	job.anchoredBits = addrBits + 1.0 + lengthBits;
+	job.freeBits = addrBits + posBits + lengthBits;
+	if (maxEvidence < job.anchoredBits) {
+		// Not enough samples.
+		return;
+	} else if (maxEvidence < job.freeBits) {
+		// Only areas next to the stored checksum can be trusted.
+		job.freeBits = HUGE_VAL;
+	}
+
+	// Enumerate areas anywhere if it's affordable.
+	// For CRCs and AddBytes32, this is much faster than
+	// a search for areas next to the stored checksum,
+	// so it's used even if only those can be trusted.
+	if (algorithm == CHKALG_ADDINVDUAL16) {
+		job.free = (job.freeBits != HUGE_VAL &&
+			(uint64_t)job.addrs.size() * posCount <= MAX_FREE_SEARCH_COST);
+	} else {
+		job.free = (diffSample >= 0 &&
+			(uint64_t)segments.size() * posCount <= MAX_FREE_SEARCH_COST);
+	}
+	job.scanCrc = (!job.free &&
+		(uint64_t)job.addrs.size() * siz <= MAX_CRC_SCAN_COST);
+
+	uint32_t items = (uint32_t)job.addrs.size();
+	uint32_t first = 0;
+	if (job.free && algorithm != CHKALG_ADDINVDUAL16) {
+		// The free search is run for each end position, using
+		// the difference between sample 0 and the diff sample.
+		// Areas without differences have the same checksum in both,
+		// so a difference of 0 is never a match.
+		for (size_t i = 0; i < job.addrs.size(); i++) {
+			const uint32_t address = job.addrs[i];
+			const uint32_t v0 = readStored(0, job, address);
+			const uint32_t vb = readStored(diffSample, job, address);
+			const uint32_t diff = (algorithm == CHKALG_ADDBYTES32 ? (v0 - vb) : (v0 ^ vb));
+			if (diff != 0) {
+				job.keys.push_back(std::make_pair(diff, address));
+			}
+		}
+		if (job.keys.empty())
+			return;
+		std::sort(job.keys.begin(), job.keys.end());
+
+		// Difference value at the start of each segment.
+		// CRC values are normalized to position 0.
+		job.segValues.resize(segments.size());
+		for (size_t j = 0; j < segments.size(); j++) {
+			const uint32_t lo = segments[j];
+			if (algorithm == CHKALG_ADDBYTES32) {
+				job.segValues[j] = prefix[0].addBytes[lo] - prefix[diffSample].addBytes[lo];
+			} else {
+				const CrcInfo &info = crc(job);
+				const uint32_t rd = crcPrefix(0, job)[lo] ^ crcPrefix(diffSample, job)[lo];
+				job.segValues[j] = CrcMultModP(rd, info.xinv[lo], info.poly, info.width);
+			}
+		}
+
+		first = minIdx;
+		items = posCount;
+	}
+
+	// Split the job into tasks.
+	const unsigned int jobIdx = (unsigned int)jobs.size();
+	const uint32_t count = items - first;
+	if (count == 0)
+		return;
+	const uint32_t taskCount = std::min(count, (uint32_t)MAX_TASKS_PER_JOB);
+	for (uint32_t t = 0; t < taskCount; t++) {
+		Task task;
+		task.job = jobIdx;
+		task.begin = first + (uint32_t)((uint64_t)count * t / taskCount);
+		task.end = first + (uint32_t)((uint64_t)count * (t + 1) / taskCount);
+		tasks.push_back(task);
+	}
+
+	exhaustive &= (job.free && job.freeBits != HUGE_VAL);
+	jobs.push_back(job);
+}
+
+/**
+ * Read the stored checksum.
+ * @param k Sample index.
+ * @param job Job.
+ * @param address Address of the stored checksum.
+ * @return Stored checksum.
+ */
+uint32_t ChecksumSearchPrivate::readStored(int k, const Job &job, uint32_t address) const
+{
+	const uint8_t *const p = &samples[k][address];
+	if (checksumWidth(job.algorithm) == 2) {
+		if (job.endian != CHKENDIAN_LITTLE) {
+			return (p[0] << 8) | p[1];
+		} else {
+			return (p[1] << 8) | p[0];
+		}
+	}
+
+	if (job.endian != CHKENDIAN_LITTLE) {
+		return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+	} else {
+		return ((uint32_t)p[3] << 24) | (p[2] << 16) | (p[1] << 8) | p[0];
+	}
+}
+
+/**
+ * Calculate the checksum of an area.
+ * @param k Sample index.
+ * @param job Job.
+ * @param si Start position.
+ * @param ei End position.
+ * @return Checksum.
+ */
+uint32_t ChecksumSearchPrivate::calc(int k, const Job &job, uint32_t si, uint32_t ei) const
+{
+	switch (job.algorithm) {
+		case CHKALG_ADDBYTES32:
+			return prefix[k].addBytes[ei] - prefix[k].addBytes[si];
+
+		case CHKALG_ADDINVDUAL16: {
+			// See Checksum::AddInvDual16().
+			const vector<uint16_t> &words = prefix[k].words[job.endian];
+			uint16_t chk1 = words[ei] - words[si];
+			uint16_t chk2 = (uint16_t)(-(int)((ei - si) * align / 2)) - chk1;
+			if (chk1 == 0xFFFF)
+				chk1 = 0;
+			if (chk2 == 0xFFFF)
+				chk2 = 0;
+			return (chk1 << 16) | chk2;
+		}
+
+		case CHKALG_CRC16:
+		case CHKALG_CRC32: {
+			const CrcInfo &info = crc(job);
+			const vector<uint32_t> &r = crcPrefix(k, job);
+			return (info.mask ^ r[ei] ^
+				CrcMultModP(info.xpow[ei - si], r[si] ^ info.mask, info.poly, info.width)) & info.mask;
+		}
+
+		default:
+			return 0;
+	}
+}
+
+/**
+ * Get the possible AddInvDual16 area lengths for a stored checksum.
+ * The second word depends on the number of words, so the
+ * length (modulo 128 KB) is known from the stored checksum.
+ * @param job		[in] Job.
+ * @param address	[in] Address of the stored checksum.
+ * @param lengths	[out] Lengths, in positions.
+ */
+void ChecksumSearchPrivate::addInvDual16Lengths(const Job &job, uint32_t address, vector<uint32_t> &lengths) const
+{
+	lengths.clear();
+
+	// Word counts, modulo 65536, for each sample.
+	// 0xFFFF is stored as 0, so a stored 0 can be either.
+	uint16_t counts[4];
+	unsigned int countCount = 0;
+	for (int k = 0; k < (int)samples.size(); k++) {
+		const uint32_t value = readStored(k, job, address);
+		const uint16_t chk1 = value >> 16;
+		const uint16_t chk2 = value & 0xFFFF;
+		if (chk1 == 0xFFFF || chk2 == 0xFFFF) {
+			// 0xFFFF is never stored.
+			return;
+		}
+
+		uint16_t sampleCounts[4];
+		unsigned int sampleCountCount = 0;
+		for (int i = 0; i < (chk1 == 0 ? 2 : 1); i++) {
+			for (int j = 0; j < (chk2 == 0 ? 2 : 1); j++) {
+				const uint16_t c1 = (i ? 0xFFFF : chk1);
+				const uint16_t c2 = (j ? 0xFFFF : chk2);
+				sampleCounts[sampleCountCount++] = (uint16_t)(-(int)(c1 + c2));
+			}
+		}
+
+		if (k == 0) {
+			std::copy(sampleCounts, sampleCounts + sampleCountCount, counts);
+			countCount = sampleCountCount;
+			continue;
+		}
+
+		// Keep the word counts that are possible in this sample.
+		unsigned int n = 0;
+		for (unsigned int i = 0; i < countCount; i++) {
+			if (std::find(sampleCounts, sampleCounts + sampleCountCount, counts[i]) !=
+			    sampleCounts + sampleCountCount)
+			{
+				counts[n++] = counts[i];
+			}
+		}
+		countCount = n;
+		if (countCount == 0)
+			return;
+	}
+
+	for (unsigned int i = 0; i < countCount; i++) {
+		for (uint64_t len = (uint64_t)counts[i] * 2; len <= siz; len += 0x20000) {
+			if (len < options.minLength || len == 0 || (len % align) != 0)
+				continue;
+			const uint32_t li = (uint32_t)(len / align);
+			if (std::find(lengths.begin(), lengths.end(), li) == lengths.end()) {
+				lengths.push_back(li);
+			}
+		}
+	}
+}
+
+/**
+ * Verify a match against all samples, and add it to the results
+ * if there's enough evidence.
+ * @param ctx Task context.
+ * @param job Job.
+ * @param address Address of the stored checksum.
+ * @param si Start position.
+ * @param ei End position.
+ * @return True if the match was added.
+ */
+bool ChecksumSearchPrivate::addResult(Context &ctx, const Job &job, uint32_t address, uint32_t si, uint32_t ei) const
+{
+	// Count the distinct stored checksums.
+	// Identical samples don't provide any more evidence.
+	uint32_t values[8];
+	unsigned int distinct = 0;
+	for (int k = 0; k < (int)samples.size(); k++) {
+		const uint32_t value = readStored(k, job, address);
+		if (calc(k, job, si, ei) != value)
+			return false;
+
+		if (distinct < sizeof(values)/sizeof(values[0]) &&
+		    std::find(values, values + distinct, value) == values + distinct)
+		{
+			values[distinct++] = value;
+		}
+	}
+
+	const uint32_t width = checksumWidth(job.algorithm);
+	if (job.algorithm == CHKALG_ADDBYTES32) {
+		// Zero padding doesn't affect the sum, so areas
+		// are usually ambiguous. If zero padding is all that
+		// separates the area from the stored checksum,
+		// extend the area to the stored checksum.
+		bool isZero = true;
+		if ((uint64_t)ei * align <= address && (address % align) == 0) {
+			const uint32_t ci = address / align;
+			for (int k = 0; k < (int)samples.size() && isZero; k++) {
+				isZero = (prefix[k].addBytes[ci] == prefix[k].addBytes[ei]);
+			}
+			if (isZero) {
+				ei = ci;
+			}
+		} else if ((uint64_t)si * align >= (uint64_t)address + width && ((address + width) % align) == 0) {
+			const uint32_t ci = (address + width) / align;
+			for (int k = 0; k < (int)samples.size() && isZero; k++) {
+				isZero = (prefix[k].addBytes[ci] == prefix[k].addBytes[si]);
+			}
+			if (isZero) {
+				si = ci;
+			}
+		}
+	}
+
+	const bool isAnchored = ((uint64_t)ei * align == address ||
+				 (uint64_t)si * align == (uint64_t)address + width);
+	if (distinct * evidenceBits(job.algorithm) < (isAnchored ? job.anchoredBits : job.freeBits))
+		return false;
+
+	ChecksumDef checksumDef;
+	checksumDef.algorithm = job.algorithm;
+	checksumDef.address = address;
+	switch (job.algorithm) {
+		case CHKALG_CRC16:
+			checksumDef.param = options.crc16Poly;
+			break;
+		case CHKALG_CRC32:
+			checksumDef.param = options.crc32Poly;
+			break;
+		default:
+			checksumDef.param = 0;
+			break;
+	}
+	checksumDef.start = si * align;
+	checksumDef.length = (ei - si) * align;
+	checksumDef.endian = job.endian;
+	ctx.results->push_back(checksumDef);
+	return true;
+}
+
+/**
+ * Find start positions in sample 0 for an end position.
+ * @param ctx Task context.
+ * @param job Job.
+ * @param address Address of the stored checksum.
+ * @param ei End position.
+ * @param lo Lowest start position.
+ * @param hi Highest start position.
+ */
+void ChecksumSearchPrivate::findStarts(Context &ctx, const Job &job, uint32_t address,
+	uint32_t ei, uint32_t lo, uint32_t hi) const
+{
+	const uint32_t value = readStored(0, job, address);
+
+	switch (job.algorithm) {
+		case CHKALG_ADDBYTES32: {
+			// Prefix sums are non-decreasing, so the matching start
+			// positions are found using a binary search. If there's
+			// more than one, the area is zero-padded; use the
+			// shortest area that matches all samples.
+			const uint32_t *const sums = prefix[0].addBytes.data();
+			const uint32_t target = sums[ei] - value;
+			const uint32_t *p = std::upper_bound(sums + lo, sums + hi + 1, target);
+			while (p != sums + lo && *(p - 1) == target) {
+				--p;
+				const uint32_t si = (uint32_t)(p - sums);
+				if (!overlaps(job, address, si, ei) && addResult(ctx, job, address, si, ei))
+					break;
+			}
+			break;
+		}
+
+		case CHKALG_ADDINVDUAL16: {
+			vector<uint32_t> lengths;
+			addInvDual16Lengths(job, address, lengths);
+			for (size_t i = 0; i < lengths.size(); i++) {
+				if (lengths[i] > ei)
+					continue;
+				const uint32_t si = ei - lengths[i];
+				if (si >= lo && si <= hi && !overlaps(job, address, si, ei)) {
+					addResult(ctx, job, address, si, ei);
+				}
+			}
+			break;
+		}
+
+		case CHKALG_CRC16:
+		case CHKALG_CRC32: {
+			// Look up the normalized start value.
+			const CrcInfo &info = crc(job);
+			const uint32_t target = CrcMultModP(value ^ info.mask ^ crcPrefix(0, job)[ei],
+				info.xinv[ei], info.poly, info.width);
+			vector<pair<uint32_t, uint32_t> >::const_iterator iter =
+				std::lower_bound(info.norm.begin(), info.norm.end(), std::make_pair(target, lo));
+			for (; iter != info.norm.end() && iter->first == target && iter->second <= hi; ++iter) {
+				if (!overlaps(job, address, iter->second, ei)) {
+					addResult(ctx, job, address, iter->second, ei);
+				}
+			}
+			break;
+		}
+
+		default:
+			break;
+	}
+}
+
+/**
+ * Find end positions in sample 0 for a start position.
+ * @param ctx Task context.
+ * @param job Job.
+ * @param address Address of the stored checksum.
+ * @param si Start position.
+ */
+void ChecksumSearchPrivate::findEnds(Context &ctx, const Job &job, uint32_t address, uint32_t si) const
+{
+	const uint32_t value = readStored(0, job, address);
+
+	switch (job.algorithm) {
+		case CHKALG_ADDBYTES32: {
+			// Use the shortest area that matches all samples.
+			const uint32_t *const sums = prefix[0].addBytes.data();
+			const uint32_t target = sums[si] + value;
+			const uint32_t *p = std::lower_bound(sums + si + minIdx, sums + posCount, target);
+			for (; p != sums + posCount && *p == target; ++p) {
+				const uint32_t ei = (uint32_t)(p - sums);
+				if (!overlaps(job, address, si, ei) && addResult(ctx, job, address, si, ei))
+					break;
+			}
+			break;
+		}
+
+		case CHKALG_ADDINVDUAL16: {
+			vector<uint32_t> lengths;
+			addInvDual16Lengths(job, address, lengths);
+			for (size_t i = 0; i < lengths.size(); i++) {
+				const uint64_t ei = (uint64_t)si + lengths[i];
+				if (ei < posCount && !overlaps(job, address, si, (uint32_t)ei)) {
+					addResult(ctx, job, address, si, (uint32_t)ei);
+				}
+			}
+			break;
+		}
+
+		case CHKALG_CRC16:
+		case CHKALG_CRC32: {
+			// The end position can't be separated from the stored
+			// checksum here, so calculate the CRC incrementally.
+			if (!job.scanCrc)
+				break;
+			const CrcInfo &info = crc(job);
+			const uint32_t *const tbl = CrcTable(info.poly);
+			const uint8_t *buf = &samples[0][si * align];
+			uint32_t state = info.mask;
+			for (uint32_t ei = si + 1; ei < posCount; ei++) {
+				for (uint32_t j = 0; j < align; j++, buf++) {
+					state = tbl[(*buf ^ state) & 0xFF] ^ (state >> 8);
+				}
+				if (ei - si >= minIdx && ((state ^ info.mask) & info.mask) == value &&
+				    !overlaps(job, address, si, ei))
+				{
+					addResult(ctx, job, address, si, ei);
+				}
+			}
+			break;
+		}
+
+		default:
+			break;
+	}
+}
+
+/**
+ * Search for areas next to a stored checksum.
+ * @param ctx Task context.
+ * @param job Job.
+ * @param address Address of the stored checksum.
+ */
+void ChecksumSearchPrivate::searchAnchored(Context &ctx, const Job &job, uint32_t address) const
+{
+	// Area ends at the stored checksum.
+	if ((address % align) == 0) {
+		const uint32_t ei = address / align;
+		if (ei >= minIdx) {
+			findStarts(ctx, job, address, ei, 0, ei - minIdx);
+		}
+	}
+
+	// Area starts after the stored checksum.
+	const uint32_t start = address + checksumWidth(job.algorithm);
+	if ((start % align) == 0) {
+		const uint32_t si = start / align;
+		if ((uint64_t)si + minIdx < posCount) {
+			findEnds(ctx, job, address, si);
+		}
+	}
+}
+
+/**
+ * Search for areas anywhere for an AddInvDual16 stored checksum.
+ * @param ctx Task context.
+ * @param job Job.
+ * @param address Address of the stored checksum.
+ */
+void ChecksumSearchPrivate::searchFreeAddInvDual16(Context &ctx, const Job &job, uint32_t address) const
+{
+	// The length is known, so only the first word has to be checked.
+	const uint32_t value = readStored(0, job, address);
+	const uint16_t chk1 = value >> 16;
+	const uint16_t *const words = prefix[0].words[job.endian].data();
+
+	vector<uint32_t> lengths;
+	addInvDual16Lengths(job, address, lengths);
+	for (size_t i = 0; i < lengths.size(); i++) {
+		const uint32_t li = lengths[i];
+		for (uint32_t si = 0; si + li < posCount; si++) {
+			const uint16_t sum = words[si + li] - words[si];
+			if ((sum == chk1 || (chk1 == 0 && sum == 0xFFFF)) &&
+			    !overlaps(job, address, si, si + li))
+			{
+				addResult(ctx, job, address, si, si + li);
+			}
+		}
+	}
+}
+
+/**
+ * Search for areas anywhere that end at the specified position.
+ * @param ctx Task context.
+ * @param job Job.
+ * @param ei End position.
+ */
+void ChecksumSearchPrivate::searchFree(Context &ctx, const Job &job, uint32_t ei) const
+{
+	// Difference between sample 0 and the diff sample at the end position.
+	uint32_t diff;
+	bool isZeroTail = false;
+	if (job.algorithm == CHKALG_ADDBYTES32) {
+		diff = prefix[0].addBytes[ei] - prefix[diffSample].addBytes[ei];
+
+		// If the last position is zero in all samples, shorter areas
+		// are found at the previous end position.
+		isZeroTail = true;
+		for (int k = 0; k < (int)samples.size() && isZeroTail; k++) {
+			isZeroTail = (prefix[k].addBytes[ei] == prefix[k].addBytes[ei-1]);
+		}
+	} else {
+		diff = crcPrefix(0, job)[ei] ^ crcPrefix(diffSample, job)[ei];
+	}
+
+	// Positions in each segment have the same difference value,
+	// so each segment only needs one lookup.
+	const CrcInfo &info = crc(job);
+	for (size_t j = 0; j < segments.size(); j++) {
+		const uint32_t lo = segments[j];
+		if (lo + minIdx > ei)
+			break;
+		uint32_t hi = (j + 1 < segments.size() ? segments[j+1] - 1 : posCount - 1);
+		hi = std::min(hi, ei - minIdx);
+
+		uint32_t key;
+		uint32_t first = lo;
+		if (job.algorithm == CHKALG_ADDBYTES32) {
+			key = diff - job.segValues[j];
+			if (isZeroTail) {
+				// Only the minimum-length area is new.
+				first = std::max(lo, ei - minIdx);
+				if (first > hi)
+					continue;
+			}
+		} else {
+			key = diff ^ CrcMultModP(job.segValues[j], info.xpow[ei], info.poly, info.width);
+		}
+
+		vector<pair<uint32_t, uint32_t> >::const_iterator iter =
+			std::lower_bound(job.keys.begin(), job.keys.end(), std::make_pair(key, 0U));
+		for (; iter != job.keys.end() && iter->first == key; ++iter) {
+			findStarts(ctx, job, iter->second, ei, first, hi);
+		}
+	}
+}
+
+/** ChecksumSearch **/
+
+ChecksumSearch::ChecksumSearch()
+	: d(new ChecksumSearchPrivate())
+{ }
+
+ChecksumSearch::~ChecksumSearch()
+{
+	delete d;
+}
+
+/**
+ * Get the search options.
+ * @return Search options.
+ */
+const ChecksumSearch::Options &ChecksumSearch::options(void) const
+{
+	return d->options;
+}
+
+/**
+ * Set the search options.
+ * This must be done before calling prepare().
+ * @param options Search options.
+ */
+void ChecksumSearch::setOptions(const Options &options)
+{
+	d->options = options;
+}
+
+/**
+ * Add a sample.
+ * The data is copied, so the buffer can be freed afterwards.
+ * This must be done before calling prepare().
+ * @param buf Data buffer.
+ * @param siz Length of data buffer.
+ */
+void ChecksumSearch::addSample(const uint8_t *buf, uint32_t siz)
+{
+	d->samples.push_back(vector<uint8_t>(buf, buf + siz));
+}
+
+/**
+ * Get the number of samples.
+ * @return Number of samples.
+ */
+int ChecksumSearch::sampleCount(void) const
+{
+	return (int)d->samples.size();
+}
+
+/**
+ * Build the prefix tables and split the search into tasks.
+ * Only the first N bytes of each sample are searched,
+ * where N is the length of the shortest sample.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int ChecksumSearch::prepare(void)
+{
+	d->jobs.clear();
+	d->tasks.clear();
+	d->prefix.clear();
+	d->exhaustive = false;
+
+	const Options &options = d->options;
+	if (d->samples.empty()) {
+		return -ENOENT;
+	}
+	if (options.rangeAlign == 0 || (options.rangeAlign & (options.rangeAlign - 1)) != 0 ||
+	    options.addressAlign == 0)
+	{
+		// Alignment must be a power of two.
+		return -EINVAL;
+	}
+
+	d->siz = ~0U;
+	for (size_t k = 0; k < d->samples.size(); k++) {
+		d->siz = std::min(d->siz, (uint32_t)d->samples[k].size());
+	}
+	d->align = options.rangeAlign;
+	d->posCount = (d->siz / d->align) + 1;
+	d->minIdx = std::max(1U, (options.minLength + d->align - 1) / d->align);
+	if (d->posCount <= d->minIdx) {
+		// Samples are too small.
+		return 0;
+	}
+
+	// CRC parameters.
+	d->crcInfo[0].valid = false;
+	d->crcInfo[1].valid = false;
+	if (options.algorithms & (1U << CHKALG_CRC16)) {
+		d->initCrc(0, options.crc16Poly, 16);
+	}
+	if (options.algorithms & (1U << CHKALG_CRC32)) {
+		d->initCrc(1, options.crc32Poly, 32);
+	}
+
+	// Prefix tables.
+	d->prefix.resize(d->samples.size());
+	for (int k = 0; k < (int)d->samples.size(); k++) {
+		d->initPrefix(k);
+	}
+
+	// Normalized prefix CRCs of sample 0.
+	for (int idx = 0; idx < 2; idx++) {
+		ChecksumSearchPrivate::CrcInfo &info = d->crcInfo[idx];
+		if (!info.valid)
+			continue;
+
+		const vector<uint32_t> &crc = d->prefix[0].crc[idx];
+		info.norm.resize(d->posCount);
+		for (uint32_t i = 0; i < d->posCount; i++) {
+			info.norm[i] = std::make_pair(
+				CrcMultModP(crc[i] ^ info.mask, info.xinv[i], info.poly, info.width), i);
+		}
+		std::sort(info.norm.begin(), info.norm.end());
+	}
+
+	d->initSegments();
+
+	// Create the jobs.
+	d->exhaustive = true;
+	for (int endian = CHKENDIAN_BIG; endian <= CHKENDIAN_LITTLE; endian++) {
+		if (!(options.endians & (1U << endian)))
+			continue;
+
+		const ChkEndian chkEndian = (ChkEndian)endian;
+		if (d->crcInfo[0].valid) {
+			d->initJob(CHKALG_CRC16, chkEndian);
+		}
+		if (d->crcInfo[1].valid) {
+			d->initJob(CHKALG_CRC32, chkEndian);
+		}
+		if ((options.algorithms & (1U << CHKALG_ADDINVDUAL16)) && d->align >= 2) {
+			d->initJob(CHKALG_ADDINVDUAL16, chkEndian);
+		}
+		if (options.algorithms & (1U << CHKALG_ADDBYTES32)) {
+			d->initJob(CHKALG_ADDBYTES32, chkEndian);
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Are checksummed areas anywhere in the data being searched?
+ * This requires at least two different samples.
+ * Only valid after calling prepare().
+ * @return True if the whole search space is covered; false if only areas next to the checksum are.
+ */
+bool ChecksumSearch::isExhaustive(void) const
+{
+	return d->exhaustive;
+}
+
+/**
+ * Get the number of tasks.
+ * Only valid after calling prepare().
+ * @return Number of tasks.
+ */
+unsigned int ChecksumSearch::taskCount(void) const
+{
+	return (unsigned int)d->tasks.size();
+}
+
+/**
+ * Run a search task.
+ * Tasks are independent, and this function is thread-safe,
+ * so tasks can be run on multiple threads simultaneously.
+ * @param task		[in] Task number.
+ * @param results	[out] Matching checksum definitions are appended here.
+ * @param pCancel	[in,opt] If set to true, the task returns as soon as possible.
+ */
+void ChecksumSearch::runTask(unsigned int task, vector<ChecksumDef> &results,
+	const atomic<bool> *pCancel) const
+{
+	if (task >= d->tasks.size())
+		return;
+
+	const ChecksumSearchPrivate::Task &t = d->tasks[task];
+	const ChecksumSearchPrivate::Job &job = d->jobs[t.job];
+
+	ChecksumSearchPrivate::Context ctx;
+	ctx.results = &results;
+	ctx.limit = results.size() + d->options.maxResults;
+	ctx.pCancel = pCancel;
+
+	for (uint32_t i = t.begin; i < t.end && !ctx.isDone(); i++) {
+		if (!job.free) {
+			d->searchAnchored(ctx, job, job.addrs[i]);
+		} else if (job.algorithm == CHKALG_ADDINVDUAL16) {
+			d->searchFreeAddInvDual16(ctx, job, job.addrs[i]);
+		} else {
+			d->searchFree(ctx, job, i);
+		}
+	}
+
+	// The last match may have gone over the limit.
+	if (results.size() > ctx.limit) {
+		results.resize(ctx.limit);
+	}
+}
+
+/**
+ * Sort search results by address and remove duplicates.
+ * @param results Search results.
+ */
+void ChecksumSearch::sortResults(vector<ChecksumDef> &results)
+{
+	auto less = [](const ChecksumDef &a, const ChecksumDef &b) {
+		if (a.address != b.address)
+			return (a.address < b.address);
+		if (a.algorithm != b.algorithm)
+			return (a.algorithm < b.algorithm);
+		if (a.endian != b.endian)
+			return (a.endian < b.endian);
+		if (a.start != b.start)
+			return (a.start < b.start);
+		return (a.length < b.length);
+	};
+	auto equal = [](const ChecksumDef &a, const ChecksumDef &b) {
+		return (a.address == b.address && a.algorithm == b.algorithm &&
+			a.endian == b.endian && a.start == b.start &&
+			a.length == b.length && a.param == b.param);
+	};
+
+	std::sort(results.begin(), results.end(), less);
+	results.erase(std::unique(results.begin(), results.end(), equal), results.end());
+}
+
+/**
+ * Run the entire search on the current thread.
+ * @return Matching checksum definitions, sorted by address.
+ */
+vector<ChecksumDef> ChecksumSearch::search(void)
+{
+	vector<ChecksumDef> results;
+	if (prepare() != 0)
+		return results;
+
+	for (unsigned int task = 0; task < taskCount(); task++) {
+		runTask(task, results);
+	}
+	sortResults(results);
+	return results;
+}
@@ -0,0 +1,173 @@
+/***************************************************************************
+ * GameCube Tools Library.                                                 *
+ * ChecksumSearch.hpp: Checksum definition discovery.                      *
+ *                                                                         *
+ * Copyright (c) 2013-2018 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __LIBGCTOOLS_CHECKSUMSEARCH_HPP__
+#define __LIBGCTOOLS_CHECKSUMSEARCH_HPP__
+
+#include "Checksum.hpp"
+
+// C includes.
+#include <stdint.h>
+
+// C++ includes.
+#include <atomic>
+#include <vector>
+
+/**
+ * Search for checksum definitions that match one or more
+ * samples of the same save file.
+ *
+ * Every combination of algorithm, stored checksum address,
+ * endianness, and checksummed area is considered. Checksums of
+ * arbitrary areas are calculated in constant time using prefix
+ * tables: prefix sums for the additive algorithms, and prefix
+ * CRCs combined using polynomial arithmetic for CRCs.
+ *
+ * With a single sample, the checksummed area must start or end
+ * next to the stored checksum. With two or more samples, areas
+ * can be anywhere, but must include at least one byte that
+ * differs between the first sample and one of the others.
+ * (The sample with the most differences is used, as long as
+ * the search time is reasonable.)
+ *
+ * Matches are only reported if the samples provide enough
+ * evidence to rule out a chance match, so small checksums
+ * and large files need more samples.
+ *
+ * The search is split into independent tasks, which can be
+ * run on multiple threads once prepare() has been called.
+ *
+ * NOTE: SonicChaoGarden, DreamcastVMU, and PokemonXD aren't
+ * searched for. Their checksums are stored within the
+ * checksummed area, and their locations are fixed by the
+ * file format.
+ */
+class ChecksumSearchPrivate;
+class ChecksumSearch
+{
+	public:
+		ChecksumSearch();
+		~ChecksumSearch();
+
+	private:
+		friend class ChecksumSearchPrivate;
+		ChecksumSearchPrivate *const d;
+
+		// Not copyable.
+		ChecksumSearch(const ChecksumSearch &other);
+		ChecksumSearch &operator=(const ChecksumSearch &other);
+
+	public:
+		/**
+		 * Search options.
+		 */
+		struct Options {
+			uint32_t algorithms;	// Algorithms to search for. (bitfield of (1 << ChkAlgorithm))
+			uint32_t endians;	// Endiannesses to search for. (bitfield of (1 << ChkEndian))
+			uint32_t addressAlign;	// Alignment of the stored checksum.
+			uint32_t rangeAlign;	// Alignment of the checksummed area. (power of two)
+			uint32_t minLength;	// Minimum length of the checksummed area.
+			uint16_t crc16Poly;	// CRC-16 polynomial.
+			uint32_t crc32Poly;	// CRC-32 polynomial.
+			unsigned int maxResults;	// Maximum number of results per task.
+
+			Options() { clear(); }
+
+			void clear(void)
+			{
+				algorithms = (1U << Checksum::CHKALG_CRC16) |
+					     (1U << Checksum::CHKALG_CRC32) |
+					     (1U << Checksum::CHKALG_ADDINVDUAL16) |
+					     (1U << Checksum::CHKALG_ADDBYTES32);
+				endians = (1U << Checksum::CHKENDIAN_BIG) |
+					  (1U << Checksum::CHKENDIAN_LITTLE);
+				addressAlign = 2;
+				rangeAlign = 4;
+				minLength = 16;
+				crc16Poly = Checksum::CRC16_POLY_CCITT;
+				crc32Poly = Checksum::CRC32_POLY_ZLIB;
+				maxResults = 256;
+			}
+		};
+
+		/**
+		 * Get the search options.
+		 * @return Search options.
+		 */
+		const Options &options(void) const;
+
+		/**
+		 * Set the search options.
+		 * This must be done before calling prepare().
+		 * @param options Search options.
+		 */
+		void setOptions(const Options &options);
+
+		/**
+		 * Add a sample.
+		 * The data is copied, so the buffer can be freed afterwards.
+		 * This must be done before calling prepare().
+		 * @param buf Data buffer.
+		 * @param siz Length of data buffer.
+		 */
+		void addSample(const uint8_t *buf, uint32_t siz);
+
+		/**
+		 * Get the number of samples.
+		 * @return Number of samples.
+		 */
+		int sampleCount(void) const;
+
+		/**
+		 * Build the prefix tables and split the search into tasks.
+		 * Only the first N bytes of each sample are searched,
+		 * where N is the length of the shortest sample.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int prepare(void);
+
+		/**
+		 * Are checksummed areas anywhere in the data being searched?
+		 * This requires at least two different samples.
+		 * Only valid after calling prepare().
+		 * @return True if the whole search space is covered; false if only areas next to the checksum are.
+		 */
+		bool isExhaustive(void) const;
+
+		/**
+		 * Get the number of tasks.
+		 * Only valid after calling prepare().
+		 * @return Number of tasks.
+		 */
+		unsigned int taskCount(void) const;
+
+		/**
+		 * Run a search task.
+		 * Tasks are independent, and this function is thread-safe,
+		 * so tasks can be run on multiple threads simultaneously.
+		 * @param task		[in] Task number.
+		 * @param results	[out] Matching checksum definitions are appended here.
+		 * @param pCancel	[in,opt] If set to true, the task returns as soon as possible.
+		 */
+		void runTask(unsigned int task, std::vector<Checksum::ChecksumDef> &results,
+			const std::atomic<bool> *pCancel = nullptr) const;
+
+		/**
+		 * Sort search results by address and remove duplicates.
+		 * @param results Search results.
+		 */
+		static void sortResults(std::vector<Checksum::ChecksumDef> &results);
+
+		/**
+		 * Run the entire search on the current thread.
+		 * @return Matching checksum definitions, sorted by address.
+		 */
+		std::vector<Checksum::ChecksumDef> search(void);
+};
+
+#endif /* __LIBGCTOOLS_CHECKSUMSEARCH_HPP__ */
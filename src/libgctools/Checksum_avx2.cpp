@@ -0,0 +1,84 @@
+/***************************************************************************
+ * GameCube Tools Library.                                                 *
+ * Checksum_avx2.cpp: Checksum algorithm class. (AVX2)                     *
+ *                                                                         *
+ * Copyright (c) 2013-2018 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "Checksum_p.hpp"
+
+#ifdef MCR_CPU_X86
+
+// AVX2 intrinsics.
+#include <immintrin.h>
+
+namespace Checksum {
+
+/**
+ * AddBytes32 algorithm using AVX2.
+ * @param buf Data buffer.
+ * @param siz Length of data buffer. (Must be a multiple of 32.)
+ * @return Checksum.
+ */
+uint32_t AddBytes32_avx2(const uint8_t *buf, uint32_t siz)
+{
+	// VPSADBW against zero adds eight bytes into a 64-bit lane.
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i sum = _mm256_setzero_si256();
+
+	const __m256i *ymm_src = reinterpret_cast<const __m256i*>(buf);
+	for (; siz != 0; siz -= 32, ymm_src++) {
+		const __m256i data = _mm256_loadu_si256(ymm_src);
+		sum = _mm256_add_epi64(sum, _mm256_sad_epu8(data, zero));
+	}
+
+	// Combine the four 64-bit lanes.
+	// NOTE: Only the low 32 bits are needed.
+	__m128i sum128 = _mm_add_epi32(_mm256_castsi256_si128(sum),
+		_mm256_extracti128_si256(sum, 1));
+	sum128 = _mm_add_epi32(sum128, _mm_srli_si128(sum128, 8));
+	return (uint32_t)_mm_cvtsi128_si32(sum128);
+}
+
+/**
+ * Add 16-bit words using AVX2.
+ * @param buf Data buffer.
+ * @param words Number of words. (Must be a multiple of 16.)
+ * @param byteswap If true, byteswap each word before adding it.
+ * @return Sum of all words, truncated to 16 bits.
+ */
+uint16_t SumWords16_avx2(const uint16_t *buf, uint32_t words, bool byteswap)
+{
+	// Addition is done modulo 2^16, so each lane
+	// can be added independently.
+	__m256i sum = _mm256_setzero_si256();
+
+	const __m256i *ymm_src = reinterpret_cast<const __m256i*>(buf);
+	if (byteswap) {
+		// VPSHUFB mask to swap the bytes in each 16-bit word.
+		const __m256i shuf_mask = _mm256_setr_epi8(
+			1,0, 3,2, 5,4, 7,6, 9,8, 11,10, 13,12, 15,14,
+			1,0, 3,2, 5,4, 7,6, 9,8, 11,10, 13,12, 15,14);
+		for (; words != 0; words -= 16, ymm_src++) {
+			const __m256i data = _mm256_loadu_si256(ymm_src);
+			sum = _mm256_add_epi16(sum, _mm256_shuffle_epi8(data, shuf_mask));
+		}
+	} else {
+		for (; words != 0; words -= 16, ymm_src++) {
+			sum = _mm256_add_epi16(sum, _mm256_loadu_si256(ymm_src));
+		}
+	}
+
+	// Combine the sixteen 16-bit lanes.
+	__m128i sum128 = _mm_add_epi16(_mm256_castsi256_si128(sum),
+		_mm256_extracti128_si256(sum, 1));
+	sum128 = _mm_add_epi16(sum128, _mm_srli_si128(sum128, 8));
+	sum128 = _mm_add_epi16(sum128, _mm_srli_si128(sum128, 4));
+	sum128 = _mm_add_epi16(sum128, _mm_srli_si128(sum128, 2));
+	return (uint16_t)_mm_cvtsi128_si32(sum128);
+}
+
+}
+
+#endif /* MCR_CPU_X86 */
@@ -0,0 +1,100 @@
+/***************************************************************************
+ * GameCube Tools Library.                                                 *
+ * Checksum_p.hpp: Checksum algorithm class. (PRIVATE)                     *
+ *                                                                         *
+ * Copyright (c) 2013-2018 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __LIBGCTOOLS_CHECKSUM_P_HPP__
+#define __LIBGCTOOLS_CHECKSUM_P_HPP__
+
+#include "Checksum.hpp"
+#include "util/cpuflags_x86.h"
+
+namespace Checksum {
+
+/** CRC helpers. **/
+
+/**
+ * Get the byte-wise CRC table for the specified polynomial.
+ * Tables are cached for the lifetime of the program.
+ * @param poly Polynomial. (reflected)
+ * @return CRC table. (256 entries)
+ */
+const uint32_t *CrcTable(uint32_t poly);
+
+/**
+ * Multiply two polynomials modulo a reflected CRC polynomial.
+ * @param a Polynomial A. (reflected)
+ * @param b Polynomial B. (reflected)
+ * @param poly CRC polynomial. (reflected)
+ * @param width CRC width, in bits.
+ * @return (a * b) mod poly
+ */
+uint32_t CrcMultModP(uint32_t a, uint32_t b, uint32_t poly, unsigned int width);
+
+/**
+ * Calculate x^(8*n) modulo a reflected CRC polynomial.
+ * This is the operator for appending n zero bytes to a CRC.
+ * @param n Number of bytes.
+ * @param poly CRC polynomial. (reflected)
+ * @param width CRC width, in bits.
+ * @return x^(8*n) mod poly
+ */
+uint32_t CrcX8nModP(uint32_t n, uint32_t poly, unsigned int width);
+
+#ifdef MCR_CPU_X86
+/**
+ * CRC-32 algorithm using PCLMULQDQ. (zlib polynomial only)
+ * Based on Intel's "Fast CRC Computation for Generic Polynomials
+ * Using PCLMULQDQ Instruction" white paper.
+ *
+ * NOTE: crc is the internal CRC state, i.e. it is *not* inverted
+ * on input or output.
+ *
+ * @param buf Data buffer.
+ * @param siz Length of data buffer. (Must be a multiple of 16, and at least 64.)
+ * @param crc Initial CRC state.
+ * @return Updated CRC state.
+ */
+uint32_t Crc32_zlib_pclmul(const uint8_t *buf, uint32_t siz, uint32_t crc);
+
+/**
+ * AddBytes32 algorithm using SSE2.
+ * @param buf Data buffer.
+ * @param siz Length of data buffer. (Must be a multiple of 16.)
+ * @return Checksum.
+ */
+uint32_t AddBytes32_sse2(const uint8_t *buf, uint32_t siz);
+
+/**
+ * AddBytes32 algorithm using AVX2.
+ * @param buf Data buffer.
+ * @param siz Length of data buffer. (Must be a multiple of 32.)
+ * @return Checksum.
+ */
+uint32_t AddBytes32_avx2(const uint8_t *buf, uint32_t siz);
+
+/**
+ * Add 16-bit words using SSE2.
+ * @param buf Data buffer.
+ * @param words Number of words. (Must be a multiple of 8.)
+ * @param byteswap If true, byteswap each word before adding it.
+ * @return Sum of all words, truncated to 16 bits.
+ */
+uint16_t SumWords16_sse2(const uint16_t *buf, uint32_t words, bool byteswap);
+
+/**
+ * Add 16-bit words using AVX2.
+ * @param buf Data buffer.
+ * @param words Number of words. (Must be a multiple of 16.)
+ * @param byteswap If true, byteswap each word before adding it.
+ * @return Sum of all words, truncated to 16 bits.
+ */
+uint16_t SumWords16_avx2(const uint16_t *buf, uint32_t words, bool byteswap);
+#endif /* MCR_CPU_X86 */
+
+}
+
+#endif /* __LIBGCTOOLS_CHECKSUM_P_HPP__ */
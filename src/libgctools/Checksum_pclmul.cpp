@@ -0,0 +1,127 @@
+/***************************************************************************
+ * GameCube Tools Library.                                                 *
+ * Checksum_pclmul.cpp: Checksum algorithm class. (PCLMULQDQ)              *
+ *                                                                         *
+ * Copyright (c) 2013-2018 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "Checksum_p.hpp"
+
+#ifdef MCR_CPU_X86
+
+// SSE2 and PCLMULQDQ intrinsics.
+#include <emmintrin.h>
+#include <wmmintrin.h>
+
+namespace Checksum {
+
+/**
+ * CRC-32 algorithm using PCLMULQDQ. (zlib polynomial only)
+ * Based on Intel's "Fast CRC Computation for Generic Polynomials
+ * Using PCLMULQDQ Instruction" white paper.
+ *
+ * NOTE: crc is the internal CRC state, i.e. it is *not* inverted
+ * on input or output.
+ *
+ * @param buf Data buffer.
+ * @param siz Length of data buffer. (Must be a multiple of 16, and at least 64.)
+ * @param crc Initial CRC state.
+ * @return Updated CRC state.
+ */
+uint32_t Crc32_zlib_pclmul(const uint8_t *buf, uint32_t siz, uint32_t crc)
+{
+	// Bit-reflected folding constants for the zlib polynomial.
+	// k1 = x^(4*128+32) mod P, k2 = x^(4*128-32) mod P
+	// k3 = x^(128+32) mod P, k4 = x^(128-32) mod P
+	// k5 = x^64 mod P
+	// poly = P', mu = floor(x^64 / P)
+	static const uint64_t k1k2[2] = { 0x0154442bd4ULL, 0x01c6e41596ULL };
+	static const uint64_t k3k4[2] = { 0x01751997d0ULL, 0x00ccaa009eULL };
+	static const uint64_t k5k0[2] = { 0x0163cd6124ULL, 0x0000000000ULL };
+	static const uint64_t poly[2] = { 0x01db710641ULL, 0x01f7011641ULL };
+
+	__m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+	// Load the first 64 bytes.
+	x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 0x00));
+	x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 0x10));
+	x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 0x20));
+	x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 0x30));
+	x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+	buf += 64;
+	siz -= 64;
+
+	// Fold 64 bytes at a time.
+	x0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(k1k2));
+	for (; siz >= 64; siz -= 64, buf += 64) {
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+		x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+		x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5),
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 0x00)));
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6),
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 0x10)));
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7),
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 0x20)));
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8),
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 0x30)));
+	}
+
+	// Fold the four 128-bit values into one.
+	x0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(k3k4));
+
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+	// Fold 16 bytes at a time.
+	for (; siz >= 16; siz -= 16, buf += 16) {
+		x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf));
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+	}
+
+	// Fold 128 bits to 64 bits.
+	x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+	x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+	x1 = _mm_srli_si128(x1, 8);
+	x1 = _mm_xor_si128(x1, x2);
+
+	x0 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(k5k0));
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_and_si128(x1, x3);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	// Barrett reduction to 32 bits.
+	x0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(poly));
+	x2 = _mm_and_si128(x1, x3);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+	x2 = _mm_and_si128(x2, x3);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	// The CRC is in bits 63-32.
+	return (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(x1, 4));
+}
+
+}
+
+#endif /* MCR_CPU_X86 */
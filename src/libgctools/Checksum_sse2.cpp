@@ -0,0 +1,79 @@
+/***************************************************************************
+ * GameCube Tools Library.                                                 *
+ * Checksum_sse2.cpp: Checksum algorithm class. (SSE2)                     *
+ *                                                                         *
+ * Copyright (c) 2013-2018 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "Checksum_p.hpp"
+
+#ifdef MCR_CPU_X86
+
+// SSE2 intrinsics.
+#include <emmintrin.h>
+
+namespace Checksum {
+
+/**
+ * AddBytes32 algorithm using SSE2.
+ * @param buf Data buffer.
+ * @param siz Length of data buffer. (Must be a multiple of 16.)
+ * @return Checksum.
+ */
+uint32_t AddBytes32_sse2(const uint8_t *buf, uint32_t siz)
+{
+	// PSADBW against zero adds eight bytes into a 64-bit lane.
+	const __m128i zero = _mm_setzero_si128();
+	__m128i sum = _mm_setzero_si128();
+
+	const __m128i *xmm_src = reinterpret_cast<const __m128i*>(buf);
+	for (; siz != 0; siz -= 16, xmm_src++) {
+		const __m128i data = _mm_loadu_si128(xmm_src);
+		sum = _mm_add_epi64(sum, _mm_sad_epu8(data, zero));
+	}
+
+	// Combine the two 64-bit lanes.
+	// NOTE: Only the low 32 bits are needed.
+	sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 8));
+	return (uint32_t)_mm_cvtsi128_si32(sum);
+}
+
+/**
+ * Add 16-bit words using SSE2.
+ * @param buf Data buffer.
+ * @param words Number of words. (Must be a multiple of 8.)
+ * @param byteswap If true, byteswap each word before adding it.
+ * @return Sum of all words, truncated to 16 bits.
+ */
+uint16_t SumWords16_sse2(const uint16_t *buf, uint32_t words, bool byteswap)
+{
+	// Addition is done modulo 2^16, so each lane
+	// can be added independently.
+	__m128i sum = _mm_setzero_si128();
+
+	const __m128i *xmm_src = reinterpret_cast<const __m128i*>(buf);
+	if (byteswap) {
+		// SSE2 doesn't have PSHUFB, so swap the bytes using shifts.
+		for (; words != 0; words -= 8, xmm_src++) {
+			const __m128i data = _mm_loadu_si128(xmm_src);
+			const __m128i swapped = _mm_or_si128(
+				_mm_slli_epi16(data, 8), _mm_srli_epi16(data, 8));
+			sum = _mm_add_epi16(sum, swapped);
+		}
+	} else {
+		for (; words != 0; words -= 8, xmm_src++) {
+			sum = _mm_add_epi16(sum, _mm_loadu_si128(xmm_src));
+		}
+	}
+
+	// Combine the eight 16-bit lanes.
+	sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+	sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 4));
+	sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 2));
+	return (uint16_t)_mm_cvtsi128_si32(sum);
+}
+
+}
+
+#endif /* MCR_CPU_X86 */
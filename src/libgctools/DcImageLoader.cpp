@@ -10,26 +10,8 @@
 #include "DcImageLoader.hpp"
 #include "GcImage_p.hpp"
 
-// Byteswapping macros.
-#include "util/byteswap.h"
-
-// C includes. (C++ namespace)
-#include <cstring>
-/**
- * Convert an ARGB4444 pixel to ARGB32.
- * @param px16 RGB5A3 pixel.
- * @return ARGB32 pixel.
- */
-static inline uint32_t ARGB4444_to_ARGB32(uint16_t px16)
-{
-	uint32_t px32;
-	px32  =  (px16 & 0x000F);		// B
-	px32 |= ((px16 & 0x00F0) << 4);		// G
-	px32 |= ((px16 & 0x0F00) << 8);		// R
-	px32 |= ((px16 & 0xF000) << 12);	// A
-	px32 |=  (px32 << 4);			// Copy to the top nybble.
-	return px32;
-}
+// Pixel format decoders.
+#include "ImageDecoder_p.hpp"
 
 /**
  * Convert a Dreamcast 16-color image to GcImage.
@@ -58,18 +40,12 @@ GcImage *DcImageLoader::fromPalette16(int w, int h,
 	d->init(w, h, GcImage::PXFMT_CI8);
 
 	// Convert the palette.
-	// TODO: Optimize using pointers instead of indexes?
-	// TODO: Clear the top 240 entries?
-	d->palette.resize(256);
-	for (int i = 0; i < 16; i++) {
-		d->palette[i] = ARGB4444_to_ARGB32(le16_to_cpu(pal_buf[i]));
-	}
+	// NOTE: initPalette() clears the top 240 entries.
+	ImageDecoder::ARGB4444_to_ARGB32(d->initPalette(), pal_buf, 16);
 
-	uint8_t *px_dest = (uint8_t*)d->imageData;
-	for (int i = img_siz; i > 0; i--, img_buf++, px_dest += 2) {
-		*px_dest = (*img_buf >> 4);
-		*(px_dest+1) = (*img_buf & 0xF);
-	}
+	// NOTE: Only convert the pixels in the image.
+	// img_siz may be larger than the image.
+	ImageDecoder::Unpack4bpp((uint8_t*)d->imageData, img_buf, (w * h) / 2);
 
 	// Image has been converted.
 	return gcImage;
@@ -99,10 +75,9 @@ GcImage *DcImageLoader::fromARGB4444(int w, int h, const uint16_t *img_buf, int
 	GcImagePrivate *const d = gcImage->d;
 	d->init(w, h, GcImage::PXFMT_ARGB32);
 
-	uint32_t *px_dest = (uint32_t*)d->imageData;
-	for (int i = img_siz; i > 0; i--, img_buf++, px_dest++) {
-		*px_dest = ARGB4444_to_ARGB32(le16_to_cpu(*img_buf));
-	}
+	// NOTE: Only convert the pixels in the image.
+	// img_siz is in bytes, and may be larger than the image.
+	ImageDecoder::ARGB4444_to_ARGB32((uint32_t*)d->imageData, img_buf, w * h);
 
 	// Image has been converted.
 	return gcImage;
@@ -136,12 +111,11 @@ GcImage *DcImageLoader::fromMonochrome(int w, int h,
 	GcImagePrivate *const d = gcImage->d;
 	d->init(w, h, GcImage::PXFMT_CI8);
 
-	// Convert the palette.
-	// TODO: Optimize using pointers instead of indexes?
-	// TODO: Clear the top 254 entries?
-	d->palette.resize(256);
-	d->palette[0] = 0xFFFFFFFF;	// white
-	d->palette[1] = 0xFF000000;	// black
+	// Set the palette.
+	// NOTE: initPalette() clears the top 254 entries.
+	uint32_t *const palette = d->initPalette();
+	palette[0] = 0xFFFFFFFF;	// white
+	palette[1] = 0xFF000000;	// black
 
 	// NOTE: MSB == left-most pixel.
 	uint8_t *px_dest = (uint8_t*)d->imageData;
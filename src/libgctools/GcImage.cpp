@@ -16,7 +16,8 @@
 using std::vector;
 
 GcImagePrivate::GcImagePrivate()
-	: imageData(nullptr)
+	: ref(1)
+	, imageData(nullptr)
 	, imageData_len(0)
 	, pxFmt(GcImage::PXFMT_NONE)
 	, width(0)
@@ -26,22 +27,6 @@ GcImagePrivate::GcImagePrivate()
 GcImagePrivate::~GcImagePrivate()
 	{ free(imageData); }
 
-GcImagePrivate::GcImagePrivate(const GcImagePrivate &other)
-	: imageData_len(other.imageData_len)
-	, palette(other.palette)
-	, pxFmt(other.pxFmt)
-	, width(other.width)
-	, height(other.height)
-{
-	// Copy the image data.
-	if (imageData_len == 0) {
-		imageData = nullptr;
-	} else {
-		imageData = malloc(imageData_len);
-		memcpy(imageData, other.imageData, imageData_len);
-	}
-}
-
 /**
  * Initialize the GcImage.
  * @param w Width.
@@ -54,7 +39,7 @@ void GcImagePrivate::init(int w, int h, GcImage::PxFmt pxFmt)
 	free(imageData);
 	imageData = nullptr;
 	imageData_len = 0;
-	palette.clear();
+	palette.reset();
 	width = 0;
 	height = 0;
 	this->pxFmt = GcImage::PXFMT_NONE;
@@ -85,6 +70,18 @@ void GcImagePrivate::init(int w, int h, GcImage::PxFmt pxFmt)
 	}
 }
 
+/**
+ * Allocate a new palette for this image.
+ * The palette must be filled in before the image is shared.
+ * @return Pointer to the 256-element palette.
+ */
+uint32_t *GcImagePrivate::initPalette(void)
+{
+	GcImagePalette *const newPalette = new GcImagePalette(256);
+	palette.reset(newPalette);
+	return newPalette->data();
+}
+
 /** GcImage **/
 
 GcImage::GcImage()
@@ -92,11 +89,28 @@ GcImage::GcImage()
 { }
 
 GcImage::~GcImage()
-	{ delete d; }
+{
+	if (--d->ref == 0) {
+		delete d;
+	}
+}
 
 GcImage::GcImage(const GcImage &other)
-	: d(new GcImagePrivate(*other.d))
-{ }
+	: d(other.d)
+{
+	d->ref++;
+}
+
+GcImage &GcImage::operator=(const GcImage &other)
+{
+	// NOTE: Increment first in case this is a self-assignment.
+	other.d->ref++;
+	if (--d->ref == 0) {
+		delete d;
+	}
+	d = other.d;
+	return *this;
+}
 
 /**
  * Convert this GcImage to RGB5A3.
@@ -117,18 +131,25 @@ GcImage *GcImage::toRGB5A3(void) const
 			GcImagePrivate *const d_new = gcImage->d;
 			d_new->init(d->width, d->height, PXFMT_ARGB32);
 
+			const uint32_t *const pal = palette();
+			if (!pal) {
+				// No palette.
+				delete gcImage;
+				return nullptr;
+			}
+
 			const uint8_t *ci8 = static_cast<const uint8_t*>(d->imageData);
 			uint32_t *rgb5A3 = static_cast<uint32_t*>(d_new->imageData);
 			size_t len = d->imageData_len;
 			for (; len >= 4; len -= 4, ci8 += 4, rgb5A3 += 4) {
-				*(rgb5A3 + 0) = d->palette[*(ci8 + 0)];
-				*(rgb5A3 + 1) = d->palette[*(ci8 + 1)];
-				*(rgb5A3 + 2) = d->palette[*(ci8 + 2)];
-				*(rgb5A3 + 3) = d->palette[*(ci8 + 3)];
+				*(rgb5A3 + 0) = pal[*(ci8 + 0)];
+				*(rgb5A3 + 1) = pal[*(ci8 + 1)];
+				*(rgb5A3 + 2) = pal[*(ci8 + 2)];
+				*(rgb5A3 + 3) = pal[*(ci8 + 3)];
 			}
 			// Just in case the image size isn't divisible by 4...
 			for (; len > 0; len--, ci8++, rgb5A3++) {
-				*rgb5A3 = d->palette[*ci8];
+				*rgb5A3 = pal[*ci8];
 			}
 
 			// Image is converted.
@@ -162,7 +183,7 @@ int GcImage::height(void) const
  */
 const uint32_t *GcImage::palette(void) const
 {
-	if (d->pxFmt != PXFMT_CI8 || d->palette.size() != 256)
+	if (d->pxFmt != PXFMT_CI8 || !d->palette || d->palette->size() != 256)
 		return nullptr;
-	return d->palette.data();
+	return d->palette->data();
 }
@@ -27,14 +27,17 @@ class GcImage
 		GcImage();
 	public:
 		~GcImage();
-		// Copy constructor.
+
+		// Copy constructor and assignment operator.
+		// NOTE: Image data is implicitly shared. GcImage has
+		// no functions that modify the image, so copies are
+		// only a reference count increment.
 		GcImage(const GcImage &other);
+		GcImage &operator=(const GcImage &other);
 
 	private:
 		friend class GcImagePrivate;
-		GcImagePrivate *const d;
-		// Assign constructor. (TODO)
-		GcImage &operator=(const GcImage &other);
+		GcImagePrivate *d;
 
 		// Image loader classes.
 		friend class GcImageLoader;
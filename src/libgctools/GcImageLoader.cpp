@@ -10,48 +10,12 @@
 #include "GcImageLoader.hpp"
 #include "GcImage_p.hpp"
 
-// Byteswapping macros.
-#include "util/byteswap.h"
+// Pixel format decoders.
+#include "ImageDecoder_p.hpp"
 
 // C includes. (C++ namespace)
 #include <cstring>
 
-/**
- * Convert an RGB5A3 pixel to ARGB32.
- * @param px16 RGB5A3 pixel.
- * @return ARGB32 pixel.
- */
-static inline uint32_t RGB5A3_to_ARGB32(uint16_t px16)
-{
-	uint32_t px32 = 0;
-
-	// NOTE: Pixels are byteswapped.
-	if (px16 & 0x8000) {
-		// RGB555: xRRRRRGG GGGBBBBB
-		// ARGB32: AAAAAAAA RRRRRRRR GGGGGGGG BBBBBBBB
-		px32 |= (((px16 << 3) & 0x0000F8) | ((px16 >> 2) & 0x000007));	// B
-		px32 |= (((px16 << 6) & 0x00F800) | ((px16 << 1) & 0x000700));	// G
-		px32 |= (((px16 << 9) & 0xF80000) | ((px16 << 4) & 0x070000));	// R
-		px32 |= 0xFF000000U; // no alpha channel
-	} else {
-		// RGB4A3
-		px32  =  (px16 & 0x000F);	// B
-		px32 |= ((px16 & 0x00F0) << 4);	// G
-		px32 |= ((px16 & 0x0F00) << 8);	// R
-		px32 |= (px32 << 4);		// Copy to the top nybble.
-
-		// Calculate the alpha channel.
-		uint8_t a = ((px16 >> 7) & 0xE0);
-		a |= (a >> 3);
-		a |= (a >> 3);
-
-		// Apply the alpha channel.
-		px32 |= (a << 24);
-	}
-
-	return px32;
-}
-
 /**
  * Blit an ARGB32 tile to an ARGB32 linear image buffer.
  * @param pixel		[in] Pixel type.
@@ -78,23 +42,20 @@ static inline void BlitTile(pixel *imgBuf, int pitch,
 }
 
 /**
- * Convert a GameCube CI8 image to GcImage.
+ * Convert GameCube CI8 image data to a GcImage without a palette.
  * @param w Image width.
  * @param h Image height.
  * @param img_buf CI8 image buffer.
  * @param img_siz Size of image data. [must be >= (w*h)]
- * @param pal_buf Palette buffer.
- * @param pal_siz Size of palette data. [must be >= 0x200]
- * @return QImage, or empty QImage on error.
+ * @return GcImage, or nullptr on error.
  */
-GcImage *GcImageLoader::fromCI8(int w, int h,
-			const uint8_t *img_buf, int img_siz,
-			const uint16_t *pal_buf, int pal_siz)
+GcImage *GcImageLoader::fromCI8_noPalette(int w, int h,
+			const uint8_t *img_buf, int img_siz)
 {
 	// Verify parameters.
 	if (w < 0 || h < 0)
 		return nullptr;
-	if (img_siz < (w * h) || pal_siz < 0x200)
+	if (img_siz < (w * h))
 		return nullptr;
 
 	// CI8 uses 8x4 tiles.
@@ -110,13 +71,6 @@ GcImage *GcImageLoader::fromCI8(int w, int h,
 	GcImagePrivate *const d = gcImage->d;
 	d->init(w, h, GcImage::PXFMT_CI8);
 
-	// Convert the palette.
-	// TODO: Optimize using pointers instead of indexes?
-	d->palette.resize(256);
-	for (int i = 0; i < 256; i++) {
-		d->palette[i] = RGB5A3_to_ARGB32(be16_to_cpu(pal_buf[i]));
-	}
-
 	// Tile pointer.
 	const uint8_t *tileBuf = img_buf;
 
@@ -132,6 +86,59 @@ GcImage *GcImageLoader::fromCI8(int w, int h,
 	return gcImage;
 }
 
+/**
+ * Convert a GameCube CI8 image to GcImage.
+ * @param w Image width.
+ * @param h Image height.
+ * @param img_buf CI8 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @param pal_buf Palette buffer.
+ * @param pal_siz Size of palette data. [must be >= 0x200]
+ * @return GcImage, or nullptr on error.
+ */
+GcImage *GcImageLoader::fromCI8(int w, int h,
+			const uint8_t *img_buf, int img_siz,
+			const uint16_t *pal_buf, int pal_siz)
+{
+	if (pal_siz < 0x200)
+		return nullptr;
+
+	GcImage *gcImage = fromCI8_noPalette(w, h, img_buf, img_siz);
+	if (!gcImage)
+		return nullptr;
+
+	// Convert the palette.
+	ImageDecoder::RGB5A3_to_ARGB32(gcImage->d->initPalette(), pal_buf, 256);
+	return gcImage;
+}
+
+/**
+ * Convert a GameCube CI8 image to GcImage,
+ * sharing the palette of an existing CI8 image.
+ * This is used for CARD_ICON_CI_SHARED, where
+ * all icons use the same palette.
+ * @param w Image width.
+ * @param h Image height.
+ * @param img_buf CI8 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @param palImage CI8 image to get the palette from.
+ * @return GcImage, or nullptr on error.
+ */
+GcImage *GcImageLoader::fromCI8(int w, int h,
+			const uint8_t *img_buf, int img_siz,
+			const GcImage *palImage)
+{
+	if (!palImage || !palImage->palette())
+		return nullptr;
+
+	GcImage *gcImage = fromCI8_noPalette(w, h, img_buf, img_siz);
+	if (!gcImage)
+		return nullptr;
+
+	// Share the palette.
+	gcImage->d->palette = palImage->d->palette;
+	return gcImage;
+}
 
 /**
  * Convert a GameCube RGB5A3 image to GcImage.
@@ -153,30 +160,13 @@ GcImage *GcImageLoader::fromRGB5A3(int w, int h, const uint16_t *img_buf, int im
 	if (w % 4 != 0 || h % 4 != 0)
 		return nullptr;
 
-	// Calculate the total number of tiles.
-	const int tilesX = (w / 4);
-	const int tilesY = (h / 4);
-
 	// Create a GcImage.
 	GcImage *gcImage = new GcImage();
 	GcImagePrivate *const d = gcImage->d;
 	d->init(w, h, GcImage::PXFMT_ARGB32);
 
-	// Temporary tile buffer.
-	uint32_t tileBuf[4*4];
-
-	for (int y = 0; y < tilesY; y++) {
-		for (int x = 0; x < tilesX; x++) {
-			// Convert each tile to ARGB32 manually.
-			// TODO: Optimize using pointers instead of indexes?
-			for (int i = 0; i < 4*4; i++, img_buf++) {
-				tileBuf[i] = RGB5A3_to_ARGB32(be16_to_cpu(*img_buf));
-			}
-
-			// Blit the tile to the main image buffer.
-			BlitTile<uint32_t, 4, 4>((uint32_t*)d->imageData, w, tileBuf, x, y);
-		}
-	}
+	// Convert the tiles directly into the main image buffer.
+	ImageDecoder::RGB5A3_tiled_to_ARGB32((uint32_t*)d->imageData, img_buf, w, h);
 
 	// Image has been converted.
 	return gcImage;
@@ -22,6 +22,17 @@ class GcImageLoader
 		GcImageLoader(const GcImageLoader &other);
 		GcImageLoader &operator=(const GcImageLoader &other);
 
+		/**
+		 * Convert GameCube CI8 image data to a GcImage without a palette.
+		 * @param w Image width.
+		 * @param h Image height.
+		 * @param img_buf CI8 image buffer.
+		 * @param img_siz Size of image data. [must be >= (w*h)]
+		 * @return GcImage, or nullptr on error.
+		 */
+		static GcImage *fromCI8_noPalette(int w, int h,
+					const uint8_t *img_buf, int img_siz);
+
 	public:
 		/**
 		 * Convert a GameCube CI8 image to GcImage.
@@ -37,6 +48,22 @@ class GcImageLoader
 					const uint8_t *img_buf, int img_siz,
 					const uint16_t *pal_buf, int pal_siz);
 
+		/**
+		 * Convert a GameCube CI8 image to GcImage,
+		 * sharing the palette of an existing CI8 image.
+		 * This is used for CARD_ICON_CI_SHARED, where
+		 * all icons use the same palette.
+		 * @param w Image width.
+		 * @param h Image height.
+		 * @param img_buf CI8 image buffer.
+		 * @param img_siz Size of image data. [must be >= (w*h)]
+		 * @param palImage CI8 image to get the palette from.
+		 * @return GcImage, or nullptr on error.
+		 */
+		static GcImage *fromCI8(int w, int h,
+					const uint8_t *img_buf, int img_siz,
+					const GcImage *palImage);
+
 		/**
 		 * Convert a GameCube RGB5A3 image to GcImage.
 		 * @param w Image width.
@@ -14,17 +14,26 @@
 // C includes. (C++ namespace)
 #include <cstdlib>
 // C++ includes.
+#include <atomic>
+#include <memory>
 #include <vector>
 
+/**
+ * Image palette. (256 entries, ARGB32)
+ * Palettes are immutable once loaded, so they can be
+ * shared by multiple images, e.g. icons that use
+ * CARD_ICON_CI_SHARED.
+ */
+typedef std::vector<uint32_t> GcImagePalette;
+
 class GcImagePrivate
 {
 	public:
 		GcImagePrivate();
 		~GcImagePrivate();
-		// Copy constructor.
-		GcImagePrivate(const GcImagePrivate &other);
 	private:
-		// Assign constructor. (TODO)
+		// GcImagePrivate is shared by reference counting.
+		GcImagePrivate(const GcImagePrivate &other);
 		GcImagePrivate &operator=(const GcImagePrivate &other);
 
 	public:
@@ -36,9 +45,20 @@ class GcImagePrivate
 		 */
 		void init(int w, int h, GcImage::PxFmt pxFmt);
 
+		/**
+		 * Allocate a new palette for this image.
+		 * The palette must be filled in before the image is shared.
+		 * @return Pointer to the 256-element palette.
+		 */
+		uint32_t *initPalette(void);
+
+		// Reference count.
+		// GcImage copies share the same GcImagePrivate.
+		std::atomic<int> ref;
+
 		void *imageData;
 		size_t imageData_len;
-		std::vector<uint32_t> palette;
+		std::shared_ptr<const GcImagePalette> palette;
 		GcImage::PxFmt pxFmt;
 		int width;
 		int height;
@@ -0,0 +1,198 @@
+/***************************************************************************
+ * GameCube Tools Library.                                                 *
+ * ImageDecoder.cpp: Pixel format decoders.                                *
+ *                                                                         *
+ * Copyright (c) 2012-2018 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "ImageDecoder_p.hpp"
+
+// Byteswapping macros.
+#include "util/byteswap.h"
+
+namespace ImageDecoder {
+
+/** Scalar conversion functions. **/
+
+/**
+ * Convert an RGB5A3 pixel to ARGB32.
+ * @param px16 RGB5A3 pixel. (host-endian)
+ * @return ARGB32 pixel.
+ */
+static inline uint32_t RGB5A3_px_to_ARGB32(uint16_t px16)
+{
+	uint32_t px32 = 0;
+
+	if (px16 & 0x8000) {
+		// RGB555: xRRRRRGG GGGBBBBB
+		// ARGB32: AAAAAAAA RRRRRRRR GGGGGGGG BBBBBBBB
+		px32 |= (((px16 << 3) & 0x0000F8) | ((px16 >> 2) & 0x000007));	// B
+		px32 |= (((px16 << 6) & 0x00F800) | ((px16 << 1) & 0x000700));	// G
+		px32 |= (((px16 << 9) & 0xF80000) | ((px16 << 4) & 0x070000));	// R
+		px32 |= 0xFF000000U; // no alpha channel
+	} else {
+		// RGB4A3
+		px32  =  (px16 & 0x000F);	// B
+		px32 |= ((px16 & 0x00F0) << 4);	// G
+		px32 |= ((px16 & 0x0F00) << 8);	// R
+		px32 |= (px32 << 4);		// Copy to the top nybble.
+
+		// Calculate the alpha channel.
+		uint8_t a = ((px16 >> 7) & 0xE0);
+		a |= (a >> 3);
+		a |= (a >> 3);
+
+		// Apply the alpha channel.
+		px32 |= ((uint32_t)a << 24);
+	}
+
+	return px32;
+}
+
+/**
+ * Convert an ARGB4444 pixel to ARGB32.
+ * @param px16 ARGB4444 pixel. (host-endian)
+ * @return ARGB32 pixel.
+ */
+static inline uint32_t ARGB4444_px_to_ARGB32(uint16_t px16)
+{
+	uint32_t px32;
+	px32  =  (px16 & 0x000F);		// B
+	px32 |= ((px16 & 0x00F0) << 4);		// G
+	px32 |= ((px16 & 0x0F00) << 8);		// R
+	px32 |= ((px16 & 0xF000) << 12);	// A
+	px32 |=  (px32 << 4);			// Copy to the top nybble.
+	return px32;
+}
+
+/**
+ * RGB5A3 to ARGB32 lookup table.
+ * RGB5A3 decoding has a branch for each pixel, so this is
+ * used if AVX2 isn't available. (An SSE2 decoder has to
+ * decode both formats and blend them, which is slower
+ * than the lookup table.)
+ */
+struct RGB5A3_LUT {
+	uint32_t tbl[65536];
+
+	RGB5A3_LUT()
+	{
+		for (unsigned int i = 0; i < 65536; i++) {
+			tbl[i] = RGB5A3_px_to_ARGB32((uint16_t)i);
+		}
+	}
+};
+
+/**
+ * Get the RGB5A3 lookup table.
+ * The table is generated on first use.
+ * @return RGB5A3 lookup table, indexed by host-endian pixel.
+ */
+static const uint32_t *GetRGB5A3_LUT(void)
+{
+	// NOTE: Function-local statics are thread-safe in C++11.
+	static const RGB5A3_LUT lut;
+	return lut.tbl;
+}
+
+/** Public functions. **/
+
+/**
+ * Convert a line of RGB5A3 pixels to ARGB32.
+ * @param dest	[out] ARGB32 pixels.
+ * @param src	[in] RGB5A3 pixels. (big-endian)
+ * @param count	[in] Number of pixels.
+ */
+void RGB5A3_to_ARGB32(uint32_t *dest, const uint16_t *src, unsigned int count)
+{
+	const uint32_t *const lut = GetRGB5A3_LUT();
+	for (; count != 0; count--, dest++, src++) {
+		*dest = lut[be16_to_cpu(*src)];
+	}
+}
+
+/**
+ * Convert a tiled RGB5A3 image to a linear ARGB32 image.
+ * Pixels are written directly to their final positions.
+ * @param dest	[out] ARGB32 image buffer. (pitch == w)
+ * @param src	[in] RGB5A3 image data, in 4x4 tiles. (big-endian)
+ * @param w	[in] Image width. (must be a multiple of 4)
+ * @param h	[in] Image height. (must be a multiple of 4)
+ */
+void RGB5A3_tiled_to_ARGB32(uint32_t *dest, const uint16_t *src, int w, int h)
+{
+#ifdef MCR_CPU_X86
+	if (MCR_CPU_Flags_x86() & MCR_CPUFLAG_X86_AVX2) {
+		RGB5A3_tiled_to_ARGB32_avx2(dest, src, w, h);
+		return;
+	}
+#endif /* MCR_CPU_X86 */
+
+	const uint32_t *const lut = GetRGB5A3_LUT();
+	for (int y = 0; y < h; y += 4) {
+		uint32_t *const destRow = &dest[y * w];
+		for (int x = 0; x < w; x += 4) {
+			// Each tile is 4 rows of 4 pixels.
+			uint32_t *px_dest = &destRow[x];
+			for (int row = 4; row != 0; row--, src += 4, px_dest += w) {
+				px_dest[0] = lut[be16_to_cpu(src[0])];
+				px_dest[1] = lut[be16_to_cpu(src[1])];
+				px_dest[2] = lut[be16_to_cpu(src[2])];
+				px_dest[3] = lut[be16_to_cpu(src[3])];
+			}
+		}
+	}
+}
+
+/**
+ * Convert a line of ARGB4444 pixels to ARGB32.
+ * @param dest	[out] ARGB32 pixels.
+ * @param src	[in] ARGB4444 pixels. (little-endian)
+ * @param count	[in] Number of pixels.
+ */
+void ARGB4444_to_ARGB32(uint32_t *dest, const uint16_t *src, unsigned int count)
+{
+#ifdef MCR_CPU_X86
+	if ((MCR_CPU_Flags_x86() & MCR_CPUFLAG_X86_SSE2) && count >= 8) {
+		const unsigned int chunk = (count & ~7U);
+		ARGB4444_to_ARGB32_sse2(dest, src, chunk);
+		dest += chunk;
+		src += chunk;
+		count -= chunk;
+	}
+#endif /* MCR_CPU_X86 */
+
+	// NOTE: ARGB4444 decoding doesn't have any branches,
+	// so a lookup table wouldn't be any faster.
+	for (; count != 0; count--, dest++, src++) {
+		*dest = ARGB4444_px_to_ARGB32(le16_to_cpu(*src));
+	}
+}
+
+/**
+ * Unpack 4-bit color indexes to 8-bit color indexes.
+ * The high nybble is the left pixel.
+ * @param dest	[out] 8-bit color indexes. (2*count bytes)
+ * @param src	[in] 4-bit color indexes.
+ * @param count	[in] Number of source bytes.
+ */
+void Unpack4bpp(uint8_t *dest, const uint8_t *src, unsigned int count)
+{
+#ifdef MCR_CPU_X86
+	if ((MCR_CPU_Flags_x86() & MCR_CPUFLAG_X86_SSE2) && count >= 16) {
+		const unsigned int chunk = (count & ~15U);
+		Unpack4bpp_sse2(dest, src, chunk);
+		dest += chunk * 2;
+		src += chunk;
+		count -= chunk;
+	}
+#endif /* MCR_CPU_X86 */
+
+	for (; count != 0; count--, src++, dest += 2) {
+		dest[0] = (*src >> 4);
+		dest[1] = (*src & 0xF);
+	}
+}
+
+}
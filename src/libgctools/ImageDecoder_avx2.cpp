@@ -0,0 +1,91 @@
+/***************************************************************************
+ * GameCube Tools Library.                                                 *
+ * ImageDecoder_avx2.cpp: Pixel format decoders. (AVX2)                    *
+ *                                                                         *
+ * Copyright (c) 2012-2018 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "ImageDecoder_p.hpp"
+
+#ifdef MCR_CPU_X86
+
+// AVX2 intrinsics.
+#include <immintrin.h>
+
+namespace ImageDecoder {
+
+/**
+ * Convert a tiled RGB5A3 image to a linear ARGB32 image using AVX2.
+ * @param dest	[out] ARGB32 image buffer. (pitch == w)
+ * @param src	[in] RGB5A3 image data, in 4x4 tiles. (big-endian)
+ * @param w	[in] Image width. (must be a multiple of 4)
+ * @param h	[in] Image height. (must be a multiple of 4)
+ */
+void RGB5A3_tiled_to_ARGB32_avx2(uint32_t *dest, const uint16_t *src, int w, int h)
+{
+	const __m256i mask5 = _mm256_set1_epi16(0x1F);
+	const __m256i mask4 = _mm256_set1_epi16(0x0F);
+	const __m256i mask3 = _mm256_set1_epi16(0x07);
+	const __m256i alpha_ff = _mm256_set1_epi16(0xFF);
+
+	// Each tile is 16 pixels, which fits in a single register.
+	const __m256i *ymm_src = reinterpret_cast<const __m256i*>(src);
+	for (int y = 0; y < h; y += 4) {
+		uint32_t *const destRow = &dest[y * w];
+		for (int x = 0; x < w; x += 4, ymm_src++) {
+			__m256i px = _mm256_loadu_si256(ymm_src);
+			px = _mm256_or_si256(_mm256_slli_epi16(px, 8), _mm256_srli_epi16(px, 8));
+
+			// RGB555: Expand each 5-bit channel to 8 bits.
+			__m256i b5 = _mm256_and_si256(px, mask5);
+			__m256i g5 = _mm256_and_si256(_mm256_srli_epi16(px, 5), mask5);
+			__m256i r5 = _mm256_and_si256(_mm256_srli_epi16(px, 10), mask5);
+			b5 = _mm256_or_si256(_mm256_slli_epi16(b5, 3), _mm256_srli_epi16(b5, 2));
+			g5 = _mm256_or_si256(_mm256_slli_epi16(g5, 3), _mm256_srli_epi16(g5, 2));
+			r5 = _mm256_or_si256(_mm256_slli_epi16(r5, 3), _mm256_srli_epi16(r5, 2));
+
+			// RGB4A3: Expand each 4-bit channel to 8 bits,
+			// and the 3-bit alpha channel to 8 bits.
+			__m256i b4 = _mm256_and_si256(px, mask4);
+			__m256i g4 = _mm256_and_si256(_mm256_srli_epi16(px, 4), mask4);
+			__m256i r4 = _mm256_and_si256(_mm256_srli_epi16(px, 8), mask4);
+			__m256i a3 = _mm256_and_si256(_mm256_srli_epi16(px, 12), mask3);
+			b4 = _mm256_or_si256(b4, _mm256_slli_epi16(b4, 4));
+			g4 = _mm256_or_si256(g4, _mm256_slli_epi16(g4, 4));
+			r4 = _mm256_or_si256(r4, _mm256_slli_epi16(r4, 4));
+			a3 = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi16(a3, 5),
+				_mm256_slli_epi16(a3, 2)), _mm256_srli_epi16(a3, 1));
+
+			// Select RGB555 if the high bit is set; RGB4A3 otherwise.
+			const __m256i is555 = _mm256_srai_epi16(px, 15);
+			const __m256i b = _mm256_blendv_epi8(b4, b5, is555);
+			const __m256i g = _mm256_blendv_epi8(g4, g5, is555);
+			const __m256i r = _mm256_blendv_epi8(r4, r5, is555);
+			const __m256i a = _mm256_blendv_epi8(a3, alpha_ff, is555);
+
+			// Interleave into ARGB32.
+			// Unpacking works within 128-bit lanes, so:
+			// - lo: row 0 | row 2
+			// - hi: row 1 | row 3
+			const __m256i gb = _mm256_or_si256(b, _mm256_slli_epi16(g, 8));
+			const __m256i ar = _mm256_or_si256(r, _mm256_slli_epi16(a, 8));
+			const __m256i lo = _mm256_unpacklo_epi16(gb, ar);
+			const __m256i hi = _mm256_unpackhi_epi16(gb, ar);
+
+			uint32_t *const px_dest = &destRow[x];
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&px_dest[0]),
+				_mm256_castsi256_si128(lo));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&px_dest[w]),
+				_mm256_castsi256_si128(hi));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&px_dest[w*2]),
+				_mm256_extracti128_si256(lo, 1));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&px_dest[w*3]),
+				_mm256_extracti128_si256(hi, 1));
+		}
+	}
+}
+
+}
+
+#endif /* MCR_CPU_X86 */
@@ -0,0 +1,84 @@
+/***************************************************************************
+ * GameCube Tools Library.                                                 *
+ * ImageDecoder_p.hpp: Pixel format decoders. (PRIVATE)                    *
+ * Used by GcImageLoader and DcImageLoader.                                *
+ *                                                                         *
+ * Copyright (c) 2012-2018 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __LIBGCTOOLS_IMAGEDECODER_P_HPP__
+#define __LIBGCTOOLS_IMAGEDECODER_P_HPP__
+
+#include "util/cpuflags_x86.h"
+
+// C includes.
+#include <stdint.h>
+
+namespace ImageDecoder {
+
+/**
+ * Convert a line of RGB5A3 pixels to ARGB32.
+ * @param dest	[out] ARGB32 pixels.
+ * @param src	[in] RGB5A3 pixels. (big-endian)
+ * @param count	[in] Number of pixels.
+ */
+void RGB5A3_to_ARGB32(uint32_t *dest, const uint16_t *src, unsigned int count);
+
+/**
+ * Convert a tiled RGB5A3 image to a linear ARGB32 image.
+ * Pixels are written directly to their final positions.
+ * @param dest	[out] ARGB32 image buffer. (pitch == w)
+ * @param src	[in] RGB5A3 image data, in 4x4 tiles. (big-endian)
+ * @param w	[in] Image width. (must be a multiple of 4)
+ * @param h	[in] Image height. (must be a multiple of 4)
+ */
+void RGB5A3_tiled_to_ARGB32(uint32_t *dest, const uint16_t *src, int w, int h);
+
+/**
+ * Convert a line of ARGB4444 pixels to ARGB32.
+ * @param dest	[out] ARGB32 pixels.
+ * @param src	[in] ARGB4444 pixels. (little-endian)
+ * @param count	[in] Number of pixels.
+ */
+void ARGB4444_to_ARGB32(uint32_t *dest, const uint16_t *src, unsigned int count);
+
+/**
+ * Unpack 4-bit color indexes to 8-bit color indexes.
+ * The high nybble is the left pixel.
+ * @param dest	[out] 8-bit color indexes. (2*count bytes)
+ * @param src	[in] 4-bit color indexes.
+ * @param count	[in] Number of source bytes.
+ */
+void Unpack4bpp(uint8_t *dest, const uint8_t *src, unsigned int count);
+
+#ifdef MCR_CPU_X86
+/**
+ * Convert a tiled RGB5A3 image to a linear ARGB32 image using AVX2.
+ * @param dest	[out] ARGB32 image buffer. (pitch == w)
+ * @param src	[in] RGB5A3 image data, in 4x4 tiles. (big-endian)
+ * @param w	[in] Image width. (must be a multiple of 4)
+ * @param h	[in] Image height. (must be a multiple of 4)
+ */
+void RGB5A3_tiled_to_ARGB32_avx2(uint32_t *dest, const uint16_t *src, int w, int h);
+
+/**
+ * Convert ARGB4444 pixels to ARGB32 using SSE2.
+ * @param dest	[out] ARGB32 pixels.
+ * @param src	[in] ARGB4444 pixels. (little-endian)
+ * @param count	[in] Number of pixels. (Must be a multiple of 8.)
+ */
+void ARGB4444_to_ARGB32_sse2(uint32_t *dest, const uint16_t *src, unsigned int count);
+
+/**
+ * Unpack 4-bit color indexes to 8-bit color indexes using SSE2.
+ * @param dest	[out] 8-bit color indexes. (2*count bytes)
+ * @param src	[in] 4-bit color indexes.
+ * @param count	[in] Number of source bytes. (Must be a multiple of 16.)
+ */
+void Unpack4bpp_sse2(uint8_t *dest, const uint8_t *src, unsigned int count);
+#endif /* MCR_CPU_X86 */
+
+}
+
+#endif /* __LIBGCTOOLS_IMAGEDECODER_P_HPP__ */
@@ -0,0 +1,76 @@
+/***************************************************************************
+ * GameCube Tools Library.                                                 *
+ * ImageDecoder_sse2.cpp: Pixel format decoders. (SSE2)                    *
+ *                                                                         *
+ * Copyright (c) 2012-2018 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "ImageDecoder_p.hpp"
+
+#ifdef MCR_CPU_X86
+
+// SSE2 intrinsics.
+#include <emmintrin.h>
+
+namespace ImageDecoder {
+
+/**
+ * Convert ARGB4444 pixels to ARGB32 using SSE2.
+ * @param dest	[out] ARGB32 pixels.
+ * @param src	[in] ARGB4444 pixels. (little-endian)
+ * @param count	[in] Number of pixels. (Must be a multiple of 8.)
+ */
+void ARGB4444_to_ARGB32_sse2(uint32_t *dest, const uint16_t *src, unsigned int count)
+{
+	const __m128i mask4 = _mm_set1_epi16(0x0F);
+
+	const __m128i *xmm_src = reinterpret_cast<const __m128i*>(src);
+	__m128i *xmm_dest = reinterpret_cast<__m128i*>(dest);
+	for (; count != 0; count -= 8, xmm_src++, xmm_dest += 2) {
+		const __m128i px = _mm_loadu_si128(xmm_src);
+
+		// Expand each 4-bit channel to 8 bits.
+		__m128i b = _mm_and_si128(px, mask4);
+		__m128i g = _mm_and_si128(_mm_srli_epi16(px, 4), mask4);
+		__m128i r = _mm_and_si128(_mm_srli_epi16(px, 8), mask4);
+		__m128i a = _mm_srli_epi16(px, 12);
+		b = _mm_or_si128(b, _mm_slli_epi16(b, 4));
+		g = _mm_or_si128(g, _mm_slli_epi16(g, 4));
+		r = _mm_or_si128(r, _mm_slli_epi16(r, 4));
+		a = _mm_or_si128(a, _mm_slli_epi16(a, 4));
+
+		// Interleave into ARGB32.
+		const __m128i gb = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+		const __m128i ar = _mm_or_si128(r, _mm_slli_epi16(a, 8));
+		_mm_storeu_si128(&xmm_dest[0], _mm_unpacklo_epi16(gb, ar));
+		_mm_storeu_si128(&xmm_dest[1], _mm_unpackhi_epi16(gb, ar));
+	}
+}
+
+/**
+ * Unpack 4-bit color indexes to 8-bit color indexes using SSE2.
+ * @param dest	[out] 8-bit color indexes. (2*count bytes)
+ * @param src	[in] 4-bit color indexes.
+ * @param count	[in] Number of source bytes. (Must be a multiple of 16.)
+ */
+void Unpack4bpp_sse2(uint8_t *dest, const uint8_t *src, unsigned int count)
+{
+	const __m128i mask4 = _mm_set1_epi8(0x0F);
+
+	const __m128i *xmm_src = reinterpret_cast<const __m128i*>(src);
+	__m128i *xmm_dest = reinterpret_cast<__m128i*>(dest);
+	for (; count != 0; count -= 16, xmm_src++, xmm_dest += 2) {
+		const __m128i data = _mm_loadu_si128(xmm_src);
+
+		// High nybble is the left pixel.
+		const __m128i left = _mm_and_si128(_mm_srli_epi16(data, 4), mask4);
+		const __m128i right = _mm_and_si128(data, mask4);
+		_mm_storeu_si128(&xmm_dest[0], _mm_unpacklo_epi8(left, right));
+		_mm_storeu_si128(&xmm_dest[1], _mm_unpackhi_epi8(left, right));
+	}
+}
+
+}
+
+#endif /* MCR_CPU_X86 */
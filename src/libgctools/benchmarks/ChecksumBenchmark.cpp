@@ -0,0 +1,347 @@
+/***************************************************************************
+ * GameCube Tools Library.                                                 *
+ * ChecksumBenchmark.cpp: Checksum algorithm microbenchmark.               *
+ *                                                                         *
+ * Copyright (c) 2013-2018 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+/**
+ * Times each checksum algorithm over a range of buffer sizes,
+ * at each SIMD dispatch level supported by the CPU.
+ *
+ * Output is CSV on stdout, one row per measurement:
+ * algorithm,level,size,iterations,ns_per_call,gb_per_sec,cycles_per_byte
+ *
+ * Lines starting with '#' are comments.
+ * cycles_per_byte uses the x86 TSC, which counts reference cycles,
+ * not core cycles; it's empty on other CPUs.
+ */
+
+#include "Checksum.hpp"
+#include "util/array_size.h"
+#include "util/cpuflags_x86.h"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// C++ includes.
+#include <chrono>
+#include <vector>
+using std::vector;
+
+#ifdef MCR_CPU_X86
+# if defined(_MSC_VER)
+#  include <intrin.h>
+# else
+#  include <x86intrin.h>
+# endif
+#endif /* MCR_CPU_X86 */
+
+// Prevent the compiler from optimizing out the checksum calls.
+static volatile uint32_t sink;
+
+/**
+ * SIMD dispatch level.
+ * Each level also allows the instruction sets of the previous levels.
+ * Levels that don't change which code an algorithm uses are skipped.
+ */
+struct DispatchLevel {
+	const char *name;
+	uint32_t flags;		// MCR_CPUFLAG_X86_* flags allowed at this level.
+};
+
+#ifdef MCR_CPU_X86
+static const DispatchLevel dispatchLevels[] = {
+	{"generic", 0},
+	{"sse2", MCR_CPUFLAG_X86_SSE2},
+	{"pclmul", MCR_CPUFLAG_X86_SSE2 | MCR_CPUFLAG_X86_PCLMULQDQ},
+	{"avx2", MCR_CPUFLAG_X86_SSE2 | MCR_CPUFLAG_X86_PCLMULQDQ |
+		 MCR_CPUFLAG_X86_AVX | MCR_CPUFLAG_X86_AVX2},
+};
+#else /* !MCR_CPU_X86 */
+static const DispatchLevel dispatchLevels[] = {
+	{"generic", 0},
+};
+#endif /* MCR_CPU_X86 */
+
+/**
+ * Benchmarked algorithm.
+ */
+struct BenchAlgorithm {
+	const char *name;
+	uint32_t (*func)(const uint8_t *buf, uint32_t siz);
+	uint32_t simdFlags;	// MCR_CPUFLAG_X86_* flags used by this algorithm.
+	uint32_t fixedSize;	// If non-zero, only this size is benchmarked.
+};
+
+static uint32_t bench_Crc16(const uint8_t *buf, uint32_t siz)
+{
+	return Checksum::Crc16(buf, siz);
+}
+
+static uint32_t bench_Crc32(const uint8_t *buf, uint32_t siz)
+{
+	return Checksum::Crc32(buf, siz);
+}
+
+static uint32_t bench_AddInvDual16(const uint8_t *buf, uint32_t siz)
+{
+	return Checksum::AddInvDual16(reinterpret_cast<const uint16_t*>(buf), siz,
+		Checksum::CHKENDIAN_BIG);
+}
+
+static uint32_t bench_AddBytes32(const uint8_t *buf, uint32_t siz)
+{
+	return Checksum::AddBytes32(buf, siz);
+}
+
+static uint32_t bench_SonicChaoGarden(const uint8_t *buf, uint32_t siz)
+{
+	return Checksum::SonicChaoGarden(buf, siz, 0);
+}
+
+static uint32_t bench_DreamcastVMU(const uint8_t *buf, uint32_t siz)
+{
+	return Checksum::DreamcastVMU(buf, siz, 0x46);
+}
+
+static uint32_t bench_PokemonXD(const uint8_t *buf, uint32_t siz)
+{
+	Checksum::ChecksumValue values[Checksum::POKEMONXD_CHECKSUM_COUNT];
+	Checksum::PokemonXDAll(buf, siz, values);
+	return values[0].actual;
+}
+
+#ifdef MCR_CPU_X86
+# define SIMD_SUMS	(MCR_CPUFLAG_X86_SSE2 | MCR_CPUFLAG_X86_AVX2)
+# define SIMD_PCLMUL	MCR_CPUFLAG_X86_PCLMULQDQ
+#else /* !MCR_CPU_X86 */
+# define SIMD_SUMS	0
+# define SIMD_PCLMUL	0
+#endif /* MCR_CPU_X86 */
+
+static const BenchAlgorithm algorithms[] = {
+	{"CRC-16",		bench_Crc16,		0,		0},
+	{"CRC-32",		bench_Crc32,		SIMD_PCLMUL,	0},
+	{"AddInvDual16",	bench_AddInvDual16,	SIMD_SUMS,	0},
+	{"AddBytes32",		bench_AddBytes32,	SIMD_SUMS,	0},
+	{"SonicChaoGarden",	bench_SonicChaoGarden,	0,		0},
+	{"DreamcastVMU",	bench_DreamcastVMU,	0,		0},
+	// Pokémon XD always checksums the same area. (4 regions of 0x9FF4, plus 8)
+	{"PokemonXD",		bench_PokemonXD,	0,		(0x9FF4*4)+8},
+};
+
+/**
+ * Read the CPU's timestamp counter.
+ * @return Timestamp, or 0 if not supported.
+ */
+static inline uint64_t read_tsc(void)
+{
+#ifdef MCR_CPU_X86
+	return __rdtsc();
+#else /* !MCR_CPU_X86 */
+	return 0;
+#endif /* MCR_CPU_X86 */
+}
+
+/**
+ * Benchmark result.
+ */
+struct BenchResult {
+	uint64_t iterations;
+	double ns_per_call;
+	double tsc_per_call;
+};
+
+/**
+ * Benchmark one algorithm at one size.
+ * The iteration count is increased until a run takes at least minTime;
+ * the fastest of several runs is reported.
+ * @param alg Algorithm.
+ * @param buf Data buffer.
+ * @param siz Size.
+ * @param minTime Minimum time per run, in seconds.
+ * @param runs Number of runs.
+ * @return Benchmark result.
+ */
+static BenchResult benchmark(const BenchAlgorithm &alg, const uint8_t *buf, uint32_t siz,
+	double minTime, unsigned int runs)
+{
+	typedef std::chrono::steady_clock clock;
+	BenchResult result;
+
+	// Calibrate the iteration count.
+	uint64_t iterations = 1;
+	for (;;) {
+		const clock::time_point start = clock::now();
+		for (uint64_t i = 0; i < iterations; i++) {
+			sink = alg.func(buf, siz);
+		}
+		const double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+		if (elapsed >= minTime)
+			break;
+		if (elapsed < minTime / 16) {
+			iterations *= 16;
+		} else {
+			iterations = (uint64_t)(iterations * (minTime / elapsed) * 1.1) + 1;
+		}
+	}
+
+	result.iterations = iterations;
+	result.ns_per_call = 0;
+	result.tsc_per_call = 0;
+	for (unsigned int run = 0; run < runs; run++) {
+		const clock::time_point start = clock::now();
+		const uint64_t tsc_start = read_tsc();
+		for (uint64_t i = 0; i < iterations; i++) {
+			sink = alg.func(buf, siz);
+		}
+		const uint64_t tsc_end = read_tsc();
+		const double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+
+		const double ns_per_call = ns / iterations;
+		if (run == 0 || ns_per_call < result.ns_per_call) {
+			result.ns_per_call = ns_per_call;
+			result.tsc_per_call = (double)(tsc_end - tsc_start) / iterations;
+		}
+	}
+
+	return result;
+}
+
+static void print_usage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [-a algorithm] [-t seconds] [-r runs] [-m max_size]\n"
+		"  -a algorithm   Only benchmark the specified algorithm.\n"
+		"  -t seconds     Minimum time per run. (default: 0.05)\n"
+		"  -r runs        Number of runs; the fastest is reported. (default: 3)\n"
+		"  -m max_size    Maximum buffer size, in bytes. (default: 16777216)\n",
+		argv0);
+}
+
+int main(int argc, char *argv[])
+{
+	static const uint32_t MIN_SIZE = 64;
+	const char *onlyAlgorithm = nullptr;
+	double minTime = 0.05;
+	unsigned int runs = 3;
+	uint32_t maxSize = 16*1024*1024;
+
+	for (int i = 1; i < argc; i++) {
+		if (i + 1 < argc && !strcmp(argv[i], "-a")) {
+			onlyAlgorithm = argv[++i];
+		} else if (i + 1 < argc && !strcmp(argv[i], "-t")) {
+			minTime = atof(argv[++i]);
+		} else if (i + 1 < argc && !strcmp(argv[i], "-r")) {
+			runs = (unsigned int)strtoul(argv[++i], nullptr, 0);
+		} else if (i + 1 < argc && !strcmp(argv[i], "-m")) {
+			maxSize = (uint32_t)strtoul(argv[++i], nullptr, 0);
+		} else {
+			print_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (minTime <= 0 || runs == 0 || maxSize < MIN_SIZE) {
+		print_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	// Sizes: 64 bytes to maxSize, in powers of 4.
+	vector<uint32_t> sizes;
+	for (uint32_t siz = MIN_SIZE; siz <= maxSize; siz *= 4) {
+		sizes.push_back(siz);
+		if (siz > (0xFFFFFFFFU / 4))
+			break;
+	}
+
+	// Fill the buffer with pseudo-random data.
+	uint32_t bufSize = maxSize;
+	for (unsigned int i = 0; i < ARRAY_SIZE(algorithms); i++) {
+		if (algorithms[i].fixedSize > bufSize)
+			bufSize = algorithms[i].fixedSize;
+	}
+	vector<uint32_t> buf32((bufSize + 3) / 4);
+	uint32_t seed = 0x12345678;
+	for (size_t i = 0; i < buf32.size(); i++) {
+		seed = (seed * 1103515245U) + 12345U;
+		buf32[i] = seed;
+	}
+	const uint8_t *const buf = reinterpret_cast<const uint8_t*>(buf32.data());
+
+#ifdef MCR_CPU_X86
+	const uint32_t cpuFlags = MCR_CPU_Flags_x86();
+	printf("# cpu_flags:%s%s%s%s%s%s\n",
+		(cpuFlags & MCR_CPUFLAG_X86_SSE2) ? " sse2" : "",
+		(cpuFlags & MCR_CPUFLAG_X86_SSSE3) ? " ssse3" : "",
+		(cpuFlags & MCR_CPUFLAG_X86_SSE41) ? " sse4.1" : "",
+		(cpuFlags & MCR_CPUFLAG_X86_PCLMULQDQ) ? " pclmulqdq" : "",
+		(cpuFlags & MCR_CPUFLAG_X86_AVX) ? " avx" : "",
+		(cpuFlags & MCR_CPUFLAG_X86_AVX2) ? " avx2" : "");
+#else /* !MCR_CPU_X86 */
+	const uint32_t cpuFlags = 0;
+	printf("# cpu_flags: none\n");
+#endif /* MCR_CPU_X86 */
+	printf("algorithm,level,size,iterations,ns_per_call,gb_per_sec,cycles_per_byte\n");
+	fflush(stdout);
+
+	bool found = false;
+	for (unsigned int a = 0; a < ARRAY_SIZE(algorithms); a++) {
+		const BenchAlgorithm &alg = algorithms[a];
+		if (onlyAlgorithm && strcmp(onlyAlgorithm, alg.name) != 0)
+			continue;
+		found = true;
+
+		// Only run levels that are supported by the CPU
+		// and change which code this algorithm uses.
+		uint32_t lastFlags = ~0U;
+		for (unsigned int l = 0; l < ARRAY_SIZE(dispatchLevels); l++) {
+			const DispatchLevel &level = dispatchLevels[l];
+			if ((level.flags & cpuFlags) != level.flags)
+				break;
+			const uint32_t algFlags = (level.flags & alg.simdFlags);
+			if (algFlags == lastFlags)
+				continue;
+			lastFlags = algFlags;
+
+#ifdef MCR_CPU_X86
+			MCR_CPU_SetFlagsMask_x86(level.flags);
+#endif /* MCR_CPU_X86 */
+
+			vector<uint32_t> algSizes;
+			if (alg.fixedSize != 0) {
+				algSizes.push_back(alg.fixedSize);
+			} else {
+				algSizes = sizes;
+			}
+
+			for (size_t s = 0; s < algSizes.size(); s++) {
+				const uint32_t siz = algSizes[s];
+				const BenchResult result = benchmark(alg, buf, siz, minTime, runs);
+				printf("%s,%s,%u,%llu,%.1f,%.3f,",
+					alg.name, level.name, siz,
+					(unsigned long long)result.iterations,
+					result.ns_per_call,
+					(double)siz / result.ns_per_call);
+				if (result.tsc_per_call > 0) {
+					printf("%.3f", result.tsc_per_call / siz);
+				}
+				putchar('\n');
+				fflush(stdout);
+			}
+		}
+	}
+
+#ifdef MCR_CPU_X86
+	MCR_CPU_SetFlagsMask_x86(~0U);
+#endif /* MCR_CPU_X86 */
+
+	if (!found) {
+		fprintf(stderr, "%s: unknown algorithm '%s'\n", argv[0], onlyAlgorithm);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,274 @@
+/***************************************************************************
+ * GameCube Tools Library.                                                 *
+ * ImageBenchmark.cpp: Banner and icon decoding microbenchmark.            *
+ *                                                                         *
+ * Copyright (c) 2013-2018 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+/**
+ * Times GcImageLoader on GameCube banners and icons,
+ * at each SIMD dispatch level supported by the CPU.
+ *
+ * Output is CSV on stdout, one row per measurement:
+ * image,level,pixels,iterations,ns_per_call,ns_per_pixel
+ *
+ * Lines starting with '#' are comments.
+ */
+
+#include "GcImage.hpp"
+#include "GcImageLoader.hpp"
+#include "card.h"
+#include "util/array_size.h"
+#include "util/cpuflags_x86.h"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// C++ includes.
+#include <chrono>
+#include <vector>
+using std::vector;
+
+// Prevent the compiler from optimizing out the decoder calls.
+static volatile const void *sink;
+
+/**
+ * SIMD dispatch level.
+ * Each level also allows the instruction sets of the previous levels.
+ */
+struct DispatchLevel {
+	const char *name;
+	uint32_t flags;		// MCR_CPUFLAG_X86_* flags allowed at this level.
+};
+
+#ifdef MCR_CPU_X86
+static const DispatchLevel dispatchLevels[] = {
+	{"generic", 0},
+	{"sse2", MCR_CPUFLAG_X86_SSE2},
+	{"avx2", MCR_CPUFLAG_X86_SSE2 | MCR_CPUFLAG_X86_AVX | MCR_CPUFLAG_X86_AVX2},
+};
+#else /* !MCR_CPU_X86 */
+static const DispatchLevel dispatchLevels[] = {
+	{"generic", 0},
+};
+#endif /* MCR_CPU_X86 */
+
+// Source data. (pseudo-random; large enough for any image here)
+static vector<uint16_t> srcBuf;
+
+/**
+ * Benchmarked image.
+ */
+struct BenchImage {
+	const char *name;
+	void (*func)(void);
+	int pixels;	// Pixels decoded per call.
+};
+
+static void bench_BannerCI8(void)
+{
+	const uint8_t *const img = reinterpret_cast<const uint8_t*>(srcBuf.data());
+	GcImage *gcImage = GcImageLoader::fromCI8(CARD_BANNER_W, CARD_BANNER_H,
+		img, CARD_BANNER_W * CARD_BANNER_H,
+		&srcBuf[CARD_BANNER_W * CARD_BANNER_H / 2], 0x200);
+	sink = gcImage;
+	delete gcImage;
+}
+
+static void bench_BannerRGB5A3(void)
+{
+	GcImage *gcImage = GcImageLoader::fromRGB5A3(CARD_BANNER_W, CARD_BANNER_H,
+		srcBuf.data(), CARD_BANNER_W * CARD_BANNER_H * 2);
+	sink = gcImage;
+	delete gcImage;
+}
+
+static void bench_IconCI8(void)
+{
+	const uint8_t *const img = reinterpret_cast<const uint8_t*>(srcBuf.data());
+	GcImage *gcImage = GcImageLoader::fromCI8(CARD_ICON_W, CARD_ICON_H,
+		img, CARD_ICON_W * CARD_ICON_H,
+		&srcBuf[CARD_ICON_W * CARD_ICON_H / 2], 0x200);
+	sink = gcImage;
+	delete gcImage;
+}
+
+static void bench_IconRGB5A3(void)
+{
+	GcImage *gcImage = GcImageLoader::fromRGB5A3(CARD_ICON_W, CARD_ICON_H,
+		srcBuf.data(), CARD_ICON_W * CARD_ICON_H * 2);
+	sink = gcImage;
+	delete gcImage;
+}
+
+/**
+ * Largest GCN save images: RGB5A3 banner and CARD_MAXICONS RGB5A3 icons.
+ */
+static void bench_SaveRGB5A3(void)
+{
+	bench_BannerRGB5A3();
+	for (int i = 0; i < CARD_MAXICONS; i++) {
+		bench_IconRGB5A3();
+	}
+}
+
+static const BenchImage images[] = {
+	{"BannerCI8",		bench_BannerCI8,	CARD_BANNER_W * CARD_BANNER_H},
+	{"BannerRGB5A3",	bench_BannerRGB5A3,	CARD_BANNER_W * CARD_BANNER_H},
+	{"IconCI8",		bench_IconCI8,		CARD_ICON_W * CARD_ICON_H},
+	{"IconRGB5A3",		bench_IconRGB5A3,	CARD_ICON_W * CARD_ICON_H},
+	{"SaveRGB5A3",		bench_SaveRGB5A3,
+		(CARD_BANNER_W * CARD_BANNER_H) + (CARD_MAXICONS * CARD_ICON_W * CARD_ICON_H)},
+};
+
+/**
+ * Benchmark result.
+ */
+struct BenchResult {
+	uint64_t iterations;
+	double ns_per_call;
+};
+
+/**
+ * Benchmark one image.
+ * The iteration count is increased until a run takes at least minTime;
+ * the fastest of several runs is reported.
+ * @param image Image.
+ * @param minTime Minimum time per run, in seconds.
+ * @param runs Number of runs.
+ * @return Benchmark result.
+ */
+static BenchResult benchmark(const BenchImage &image, double minTime, unsigned int runs)
+{
+	typedef std::chrono::steady_clock clock;
+	BenchResult result;
+
+	// Calibrate the iteration count.
+	uint64_t iterations = 1;
+	for (;;) {
+		const clock::time_point start = clock::now();
+		for (uint64_t i = 0; i < iterations; i++) {
+			image.func();
+		}
+		const double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+		if (elapsed >= minTime)
+			break;
+		if (elapsed < minTime / 16) {
+			iterations *= 16;
+		} else {
+			iterations = (uint64_t)(iterations * (minTime / elapsed) * 1.1) + 1;
+		}
+	}
+
+	result.iterations = iterations;
+	result.ns_per_call = 0;
+	for (unsigned int run = 0; run < runs; run++) {
+		const clock::time_point start = clock::now();
+		for (uint64_t i = 0; i < iterations; i++) {
+			image.func();
+		}
+		const double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+
+		const double ns_per_call = ns / iterations;
+		if (run == 0 || ns_per_call < result.ns_per_call) {
+			result.ns_per_call = ns_per_call;
+		}
+	}
+
+	return result;
+}
+
+static void print_usage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [-i image] [-t seconds] [-r runs]\n"
+		"  -i image       Only benchmark the specified image.\n"
+		"  -t seconds     Minimum time per run. (default: 0.05)\n"
+		"  -r runs        Number of runs; the fastest is reported. (default: 3)\n",
+		argv0);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *onlyImage = nullptr;
+	double minTime = 0.05;
+	unsigned int runs = 3;
+
+	for (int i = 1; i < argc; i++) {
+		if (i + 1 < argc && !strcmp(argv[i], "-i")) {
+			onlyImage = argv[++i];
+		} else if (i + 1 < argc && !strcmp(argv[i], "-t")) {
+			minTime = atof(argv[++i]);
+		} else if (i + 1 < argc && !strcmp(argv[i], "-r")) {
+			runs = (unsigned int)strtoul(argv[++i], nullptr, 0);
+		} else {
+			print_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (minTime <= 0 || runs == 0) {
+		print_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	// Fill the source buffer with pseudo-random data.
+	srcBuf.resize(CARD_BANNER_W * CARD_BANNER_H * 2);
+	uint32_t seed = 0x12345678;
+	for (size_t i = 0; i < srcBuf.size(); i++) {
+		seed = (seed * 1103515245U) + 12345U;
+		srcBuf[i] = (uint16_t)(seed >> 16);
+	}
+
+#ifdef MCR_CPU_X86
+	const uint32_t cpuFlags = MCR_CPU_Flags_x86();
+	printf("# cpu_flags:%s%s%s\n",
+		(cpuFlags & MCR_CPUFLAG_X86_SSE2) ? " sse2" : "",
+		(cpuFlags & MCR_CPUFLAG_X86_AVX) ? " avx" : "",
+		(cpuFlags & MCR_CPUFLAG_X86_AVX2) ? " avx2" : "");
+#else /* !MCR_CPU_X86 */
+	const uint32_t cpuFlags = 0;
+	printf("# cpu_flags: none\n");
+#endif /* MCR_CPU_X86 */
+	printf("image,level,pixels,iterations,ns_per_call,ns_per_pixel\n");
+	fflush(stdout);
+
+	bool found = false;
+	for (unsigned int n = 0; n < ARRAY_SIZE(images); n++) {
+		const BenchImage &image = images[n];
+		if (onlyImage && strcmp(onlyImage, image.name) != 0)
+			continue;
+		found = true;
+
+		// Only run levels that are supported by the CPU.
+		for (unsigned int l = 0; l < ARRAY_SIZE(dispatchLevels); l++) {
+			const DispatchLevel &level = dispatchLevels[l];
+			if ((level.flags & cpuFlags) != level.flags)
+				break;
+
+#ifdef MCR_CPU_X86
+			MCR_CPU_SetFlagsMask_x86(level.flags);
+#endif /* MCR_CPU_X86 */
+
+			const BenchResult result = benchmark(image, minTime, runs);
+			printf("%s,%s,%d,%llu,%.1f,%.3f\n",
+				image.name, level.name, image.pixels,
+				(unsigned long long)result.iterations,
+				result.ns_per_call,
+				result.ns_per_call / image.pixels);
+			fflush(stdout);
+		}
+	}
+
+#ifdef MCR_CPU_X86
+	MCR_CPU_SetFlagsMask_x86(~0U);
+#endif /* MCR_CPU_X86 */
+
+	if (!found) {
+		fprintf(stderr, "%s: unknown image '%s'\n", argv[0], onlyImage);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
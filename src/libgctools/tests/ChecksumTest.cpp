@@ -0,0 +1,884 @@
+/***************************************************************************
+ * GameCube Tools Library.                                                 *
+ * ChecksumTest.cpp: Checksum algorithm tests.                             *
+ *                                                                         *
+ * Copyright (c) 2013-2018 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+/**
+ * Checks the optimized checksum code against simple reference code.
+ *
+ * Each failure is printed on stderr.
+ * The exit status is non-zero if any check failed.
+ */
+
+#include "Checksum.hpp"
+#include "ChecksumPlan.hpp"
+#include "ChecksumSearch.hpp"
+#include "util/array_size.h"
+#include "util/cpuflags_x86.h"
+
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// C++ includes.
+#include <vector>
+using std::vector;
+
+using namespace Checksum;
+
+// Number of failed checks.
+static unsigned int failures = 0;
+
+/**
+ * Check a test condition.
+ * @param ok Condition.
+ * @param fmt Description of the check, printed if it failed.
+ * @return ok
+ */
+static bool check(bool ok, const char *fmt, ...)
+{
+	if (!ok) {
+		va_list ap;
+		va_start(ap, fmt);
+		fputs("FAIL: ", stderr);
+		vfprintf(stderr, fmt, ap);
+		fputc('\n', stderr);
+		va_end(ap);
+		failures++;
+	}
+	return ok;
+}
+
+/**
+ * Fill a buffer with pseudo-random data.
+ * @param buf Buffer.
+ * @param seed Seed.
+ */
+static void fillRandom(vector<uint8_t> &buf, uint32_t seed)
+{
+	for (size_t i = 0; i < buf.size(); i++) {
+		seed = (seed * 1103515245U) + 12345U;
+		buf[i] = (uint8_t)(seed >> 16);
+	}
+}
+
+/** SIMD kernels **/
+
+/**
+ * SIMD dispatch level.
+ * Each level also allows the instruction sets of the previous levels.
+ */
+struct DispatchLevel {
+	const char *name;
+	uint32_t flags;		// MCR_CPUFLAG_X86_* flags allowed at this level.
+};
+
+#ifdef MCR_CPU_X86
+static const DispatchLevel dispatchLevels[] = {
+	{"generic", 0},
+	{"sse2", MCR_CPUFLAG_X86_SSE2},
+	{"pclmul", MCR_CPUFLAG_X86_SSE2 | MCR_CPUFLAG_X86_PCLMULQDQ},
+	{"avx2", MCR_CPUFLAG_X86_SSE2 | MCR_CPUFLAG_X86_PCLMULQDQ |
+		 MCR_CPUFLAG_X86_AVX | MCR_CPUFLAG_X86_AVX2},
+};
+#else /* !MCR_CPU_X86 */
+static const DispatchLevel dispatchLevels[] = {
+	{"generic", 0},
+};
+#endif /* MCR_CPU_X86 */
+
+/**
+ * Algorithm with SIMD kernels.
+ */
+struct SimdAlgorithm {
+	const char *name;
+	uint32_t (*func)(const uint8_t *buf, uint32_t siz);
+};
+
+static uint32_t simd_Crc32(const uint8_t *buf, uint32_t siz)
+{
+	return Crc32(buf, siz);
+}
+
+static uint32_t simd_AddInvDual16_BE(const uint8_t *buf, uint32_t siz)
+{
+	return AddInvDual16(reinterpret_cast<const uint16_t*>(buf), siz, CHKENDIAN_BIG);
+}
+
+static uint32_t simd_AddInvDual16_LE(const uint8_t *buf, uint32_t siz)
+{
+	return AddInvDual16(reinterpret_cast<const uint16_t*>(buf), siz, CHKENDIAN_LITTLE);
+}
+
+static uint32_t simd_AddBytes32(const uint8_t *buf, uint32_t siz)
+{
+	return AddBytes32(buf, siz);
+}
+
+static const SimdAlgorithm simdAlgorithms[] = {
+	{"CRC-32",		simd_Crc32},
+	{"AddInvDual16 (BE)",	simd_AddInvDual16_BE},
+	{"AddInvDual16 (LE)",	simd_AddInvDual16_LE},
+	{"AddBytes32",		simd_AddBytes32},
+};
+
+/**
+ * Compare the SIMD kernels to the generic code
+ * at every alignment and every length up to SIMD_MAX_LEN,
+ * plus a few lengths that are larger than the kernels' blocks.
+ */
+static void test_SimdKernels(void)
+{
+	// Alignments: 0 to 31 bytes. (AVX2 registers are 32 bytes.)
+	static const uint32_t SIMD_ALIGNMENTS = 32;
+	// All lengths up to this are checked.
+	static const uint32_t SIMD_MAX_LEN = 512;
+	static const uint32_t largeLengths[] = {4095, 4096, 4097, 65536+13};
+	static const uint32_t BUF_SIZE = 65536+64+SIMD_ALIGNMENTS;
+
+	vector<uint32_t> lengths;
+	for (uint32_t len = 0; len <= SIMD_MAX_LEN; len++) {
+		lengths.push_back(len);
+	}
+	for (int i = 0; i < ARRAY_SIZE(largeLengths); i++) {
+		lengths.push_back(largeLengths[i]);
+	}
+
+	// Random data, and all 0xFF to check for overflow in the sums.
+	vector<uint8_t> bufs[2];
+	bufs[0].resize(BUF_SIZE);
+	fillRandom(bufs[0], 0x12345678);
+	bufs[1].assign(BUF_SIZE, 0xFF);
+
+#ifdef MCR_CPU_X86
+	const uint32_t cpuFlags = MCR_CPU_Flags_x86();
+#else /* !MCR_CPU_X86 */
+	const uint32_t cpuFlags = 0;
+#endif /* MCR_CPU_X86 */
+
+	for (int a = 0; a < ARRAY_SIZE(simdAlgorithms); a++) {
+		const SimdAlgorithm &alg = simdAlgorithms[a];
+		for (int b = 0; b < ARRAY_SIZE(bufs); b++) {
+			// Expected values, from the generic code.
+			vector<uint32_t> expected;
+			expected.reserve(SIMD_ALIGNMENTS * lengths.size());
+
+			for (int l = 0; l < ARRAY_SIZE(dispatchLevels); l++) {
+				const DispatchLevel &level = dispatchLevels[l];
+				if ((level.flags & cpuFlags) != level.flags) {
+					printf("%s: %s: skipped (not supported by the CPU)\n",
+						alg.name, level.name);
+					continue;
+				}
+#ifdef MCR_CPU_X86
+				MCR_CPU_SetFlagsMask_x86(level.flags);
+#endif /* MCR_CPU_X86 */
+
+				size_t k = 0;
+				for (uint32_t align = 0; align < SIMD_ALIGNMENTS; align++) {
+					const uint8_t *const buf = &bufs[b][align];
+					for (size_t i = 0; i < lengths.size(); i++, k++) {
+						const uint32_t actual = alg.func(buf, lengths[i]);
+						if (l == 0) {
+							expected.push_back(actual);
+							continue;
+						}
+						check(actual == expected[k],
+							"%s: %s: buffer %d, alignment %u, length %u: %08X != %08X",
+							alg.name, level.name, b, align, lengths[i],
+							actual, expected[k]);
+					}
+				}
+			}
+		}
+	}
+
+#ifdef MCR_CPU_X86
+	MCR_CPU_SetFlagsMask_x86(~0U);
+#endif /* MCR_CPU_X86 */
+}
+
+/** ChecksumPlan **/
+
+/**
+ * Calculate checksums the way File::calculateChecksum() did
+ * before ChecksumPlan was added. This is the reference for exec().
+ *
+ * NOTE: Sonic Chao Garden fields are cleared in a copy of the data.
+ *
+ * @param fileData File data.
+ * @param checksumDefs Checksum definitions.
+ * @return Checksum values.
+ */
+static vector<ChecksumValue> referenceChecksums(vector<uint8_t> fileData,
+	const vector<ChecksumDef> &checksumDefs)
+{
+	vector<ChecksumValue> checksumValues;
+	uint8_t *const data = fileData.data();
+
+	for (size_t i = 0; i < checksumDefs.size(); i++) {
+		const ChecksumDef &checksumDef = checksumDefs[i];
+		if (checksumDef.algorithm == CHKALG_NONE ||
+		    checksumDef.algorithm >= CHKALG_MAX ||
+		    checksumDef.length == 0)
+		{
+			continue;
+		}
+		if (fileData.size() < checksumDef.address ||
+		    fileData.size() < (uint64_t)checksumDef.start + checksumDef.length)
+		{
+			continue;
+		}
+
+		const bool isBigEndian = (checksumDef.endian != CHKENDIAN_LITTLE);
+		const uint8_t *const p = &data[checksumDef.address];
+		const uint8_t *const start = &data[checksumDef.start];
+		uint32_t expected = 0;
+		uint32_t actual = 0;
+		ChaoGardenChecksumData chaoChk_orig = {};
+		bool useExec = true;
+
+		switch (checksumDef.algorithm) {
+			case CHKALG_CRC16:
+			case CHKALG_DREAMCASTVMU:
+				expected = (isBigEndian
+					? ((p[0] << 8) | p[1])
+					: ((p[1] << 8) | p[0]));
+				break;
+
+			case CHKALG_CRC32:
+			case CHKALG_ADDINVDUAL16:
+			case CHKALG_ADDBYTES32:
+				expected = (isBigEndian
+					? (((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3])
+					: (((uint32_t)p[3] << 24) | (p[2] << 16) | (p[1] << 8) | p[0]));
+				break;
+
+			case CHKALG_SONICCHAOGARDEN: {
+				memcpy(&chaoChk_orig, p, sizeof(chaoChk_orig));
+				ChaoGardenChecksumData chaoChk = chaoChk_orig;
+				if (isBigEndian) {
+					expected = ((uint32_t)chaoChk.checksum_3 << 24) |
+						   (chaoChk.checksum_2 << 16) |
+						   (chaoChk.checksum_1 << 8) |
+						   (chaoChk.checksum_0);
+				} else {
+					expected = ((uint32_t)chaoChk.checksum_0 << 24) |
+						   (chaoChk.checksum_1 << 16) |
+						   (chaoChk.checksum_2 << 8) |
+						   (chaoChk.checksum_3);
+				}
+				chaoChk.checksum_3 = 0;
+				chaoChk.checksum_2 = 0;
+				chaoChk.checksum_1 = 0;
+				chaoChk.checksum_0 = 0;
+				chaoChk.random_3 = 0;
+				memcpy(&data[checksumDef.address], &chaoChk, sizeof(chaoChk));
+				break;
+			}
+
+			case CHKALG_POKEMONXD:
+				useExec = false;
+				actual = PokemonXD(start, checksumDef.length,
+					checksumDef.address, &expected);
+				break;
+
+			default:
+				break;
+		}
+
+		if (useExec) {
+			actual = Exec(checksumDef.algorithm, start, checksumDef.length,
+				checksumDef.endian, checksumDef.param);
+		}
+		if (checksumDef.algorithm == CHKALG_SONICCHAOGARDEN) {
+			memcpy(&data[checksumDef.address], &chaoChk_orig, sizeof(chaoChk_orig));
+		}
+
+		ChecksumValue checksumValue;
+		checksumValue.expected = expected;
+		checksumValue.actual = actual;
+		checksumValues.push_back(checksumValue);
+	}
+
+	return checksumValues;
+}
+
+/**
+ * Compare ChecksumPlan::exec() to the reference code.
+ * @param name Test name.
+ * @param data Data.
+ * @param checksumDefs Checksum definitions.
+ */
+static void checkPlanParity(const char *name, const vector<uint8_t> &data,
+	const vector<ChecksumDef> &checksumDefs)
+{
+	const ChecksumPlan plan(checksumDefs);
+	const vector<ChecksumValue> actual = plan.exec(data.data(), (uint32_t)data.size());
+	const vector<ChecksumValue> expected = referenceChecksums(data, checksumDefs);
+
+	if (!check(actual.size() == expected.size(), "%s: %u values != %u values",
+		name, (unsigned int)actual.size(), (unsigned int)expected.size()))
+	{
+		return;
+	}
+	for (size_t i = 0; i < actual.size(); i++) {
+		check(actual[i].expected == expected[i].expected &&
+		      actual[i].actual == expected[i].actual,
+			"%s: value %u: %08X/%08X != %08X/%08X",
+			name, (unsigned int)i,
+			actual[i].expected, actual[i].actual,
+			expected[i].expected, expected[i].actual);
+	}
+}
+
+/**
+ * Make a checksum definition.
+ */
+static ChecksumDef makeDef(ChkAlgorithm algorithm, uint32_t address,
+	uint32_t start, uint32_t length, ChkEndian endian = CHKENDIAN_BIG, uint32_t param = 0)
+{
+	ChecksumDef checksumDef;
+	checksumDef.algorithm = algorithm;
+	checksumDef.address = address;
+	checksumDef.param = param;
+	checksumDef.start = start;
+	checksumDef.length = length;
+	checksumDef.endian = endian;
+	return checksumDef;
+}
+
+/**
+ * Compare ChecksumPlan::exec() to the reference code
+ * using Sonic Chao Garden checksums stored around the
+ * start of the checksummed area.
+ */
+static void test_PlanChaoGardenField(void)
+{
+	vector<uint8_t> data(2048);
+	fillRandom(data, 0x9ABCDEF0);
+
+	// NOTE: A field ending just before the start of
+	// the checksummed area must not be confused with
+	// a missing field. (address == start - 1)
+	static const uint32_t start = 348;
+	char name[64];
+	for (uint32_t address = start - 12; address <= start + 12; address++) {
+		vector<ChecksumDef> checksumDefs;
+		checksumDefs.push_back(makeDef(CHKALG_SONICCHAOGARDEN, address, start, 200));
+		snprintf(name, sizeof(name), "Chao Garden field at start%+d",
+			(int)address - (int)start);
+		checkPlanParity(name, data, checksumDefs);
+	}
+
+	// Field at the end of the checksummed area.
+	vector<ChecksumDef> checksumDefs;
+	checksumDefs.push_back(makeDef(CHKALG_SONICCHAOGARDEN, start + 196, start, 200));
+	checkPlanParity("Chao Garden field at end", data, checksumDefs);
+}
+
+/**
+ * Compare ChecksumPlan::exec() to the reference code
+ * using all four Pokémon XD checksums.
+ */
+static void test_PlanPokemonXD(void)
+{
+	vector<uint8_t> data(0x28000);
+	fillRandom(data, 0x0BADF00D);
+
+	vector<ChecksumDef> checksumDefs;
+	for (uint32_t address = 0x10; address < 0x20; address += 4) {
+		checksumDefs.push_back(makeDef(CHKALG_POKEMONXD, address, 0, (0x9FF4*4)+8));
+	}
+	checkPlanParity("Pokémon XD", data, checksumDefs);
+}
+
+/**
+ * Get the next pseudo-random number.
+ * @param seed [in/out] Seed.
+ * @return Pseudo-random number. (24-bit)
+ */
+static inline uint32_t nextRandom(uint32_t &seed)
+{
+	seed = (seed * 1103515245U) + 12345U;
+	return (seed >> 8);
+}
+
+/**
+ * Make random checksum definitions.
+ * Pokémon XD definitions aren't included, since they
+ * need a specific data size.
+ * @param seed		[in/out] Seed.
+ * @param dataSize	[in] Size of the data.
+ * @return Checksum definitions. (1 to 6)
+ */
+static vector<ChecksumDef> randomChecksumDefs(uint32_t &seed, uint32_t dataSize)
+{
+	static const uint32_t crc16Polys[] = {0, CRC16_POLY_CCITT, 0xA001};
+	static const uint32_t crc32Polys[] = {0, CRC32_POLY_ZLIB, 0x82F63B78};
+
+	vector<ChecksumDef> checksumDefs;
+	const unsigned int count = 1 + (nextRandom(seed) % 6);
+	for (unsigned int i = 0; i < count; i++) {
+		uint32_t r[6];
+		for (int j = 0; j < ARRAY_SIZE(r); j++) {
+			r[j] = nextRandom(seed);
+		}
+
+		if (i > 0 && (r[0] % 8) == 0) {
+			// Duplicate a definition, so it's merged.
+			checksumDefs.push_back(checksumDefs[r[1] % checksumDefs.size()]);
+			continue;
+		}
+
+		// Algorithms from CHKALG_CRC16 to CHKALG_DREAMCASTVMU.
+		const ChkAlgorithm algorithm = (ChkAlgorithm)(CHKALG_CRC16 + (r[0] % 6));
+		const uint32_t width = (algorithm == CHKALG_SONICCHAOGARDEN
+			? (uint32_t)sizeof(ChaoGardenChecksumData)
+			: (algorithm == CHKALG_CRC16 || algorithm == CHKALG_DREAMCASTVMU ? 2 : 4));
+		const uint32_t start = r[1] % (dataSize - 1);
+		const uint32_t length = 1 + (r[2] % (dataSize - start));
+		uint32_t address;
+		if (r[3] & 1) {
+			// Stored checksum within or near the checksummed area.
+			address = start + length - (r[3] >> 1) % (length + 2*width);
+			if ((int32_t)address < 0 || address + width > dataSize)
+				address = start;
+			if (address + width > dataSize)
+				address = dataSize - width;
+		} else {
+			address = (r[3] >> 1) % (dataSize - width + 1);
+		}
+
+		uint32_t param = 0;
+		switch (algorithm) {
+			case CHKALG_CRC16:
+				param = crc16Polys[r[4] % ARRAY_SIZE(crc16Polys)];
+				break;
+			case CHKALG_CRC32:
+				param = crc32Polys[r[4] % ARRAY_SIZE(crc32Polys)];
+				break;
+			case CHKALG_DREAMCASTVMU:
+				// CRC address, relative to start.
+				param = ((r[4] & 1) ? 0 : (r[4] >> 1) % (length + 2));
+				break;
+			default:
+				break;
+		}
+
+		checksumDefs.push_back(makeDef(algorithm, address, start, length,
+			(r[5] & 1) ? CHKENDIAN_LITTLE : CHKENDIAN_BIG, param));
+	}
+
+	return checksumDefs;
+}
+
+/**
+ * Compare ChecksumPlan::exec() to the reference code
+ * using random checksum definitions.
+ */
+static void test_PlanRandom(void)
+{
+	static const uint32_t DATA_SIZE = 2048;
+	static const unsigned int ITERATIONS = 2000;
+
+	vector<uint8_t> data(DATA_SIZE);
+	uint32_t seed = 0x2468ACE0;
+	char name[64];
+
+	for (unsigned int iter = 0; iter < ITERATIONS; iter++) {
+		fillRandom(data, iter);
+		const vector<ChecksumDef> checksumDefs = randomChecksumDefs(seed, DATA_SIZE);
+		snprintf(name, sizeof(name), "random definitions %u", iter);
+		checkPlanParity(name, data, checksumDefs);
+	}
+}
+
+/** Incremental updates **/
+
+/**
+ * Random edit of a buffer.
+ */
+struct Edit {
+	uint32_t pos;		// Position of the changed range.
+	uint32_t len;		// Length of the changed range.
+	vector<uint8_t> oldData;
+	vector<uint8_t> newData;
+};
+
+/**
+ * Make a random edit and apply it to a buffer.
+ * @param seed	[in/out] Seed.
+ * @param buf	[in/out] Buffer.
+ * @param maxLen	[in] Maximum length of the changed range.
+ * @return Edit.
+ */
+static Edit randomEdit(uint32_t &seed, vector<uint8_t> &buf, uint32_t maxLen)
+{
+	Edit edit;
+	edit.pos = nextRandom(seed) % (uint32_t)buf.size();
+	edit.len = 1 + (nextRandom(seed) % maxLen);
+	if (edit.pos + edit.len > buf.size())
+		edit.len = (uint32_t)buf.size() - edit.pos;
+
+	edit.oldData.assign(buf.begin() + edit.pos, buf.begin() + edit.pos + edit.len);
+	edit.newData.resize(edit.len);
+	for (uint32_t i = 0; i < edit.len; i++) {
+		edit.newData[i] = (uint8_t)nextRandom(seed);
+		buf[edit.pos + i] = edit.newData[i];
+	}
+	return edit;
+}
+
+/**
+ * Check Crc16Combine() and Crc32Combine() against
+ * the CRC of the concatenated buffers.
+ */
+static void test_CrcCombine(void)
+{
+	vector<uint8_t> data(1024);
+	fillRandom(data, 0x13579BDF);
+	const uint32_t siz = (uint32_t)data.size();
+
+	for (uint32_t len1 = 0; len1 <= siz; len1 += 37) {
+		const uint32_t len2 = siz - len1;
+		const uint8_t *const buf2 = &data[len1];
+
+		const uint16_t crc16 = Crc16Combine(Crc16(data.data(), len1),
+			Crc16(buf2, len2), len2);
+		check(crc16 == Crc16(data.data(), siz),
+			"Crc16Combine: %u + %u bytes: %04X != %04X",
+			len1, len2, crc16, Crc16(data.data(), siz));
+
+		const uint32_t crc32 = Crc32Combine(Crc32(data.data(), len1),
+			Crc32(buf2, len2), len2);
+		check(crc32 == Crc32(data.data(), siz),
+			"Crc32Combine: %u + %u bytes: %08X != %08X",
+			len1, len2, crc32, Crc32(data.data(), siz));
+	}
+}
+
+/**
+ * Check the *Update() functions against recalculating
+ * the checksum of the edited buffer.
+ */
+static void test_ChecksumUpdate(void)
+{
+	static const unsigned int ITERATIONS = 2000;
+	vector<uint8_t> data(1024);
+	uint32_t seed = 0xFEDCBA98;
+
+	for (unsigned int iter = 0; iter < ITERATIONS; iter++) {
+		fillRandom(data, iter);
+		// Checksum a random part of the buffer.
+		const uint32_t start = nextRandom(seed) % 64;
+		const uint32_t siz = 1 + (nextRandom(seed) % ((uint32_t)data.size() - start));
+		const ChkEndian endian = (iter & 1) ? CHKENDIAN_LITTLE : CHKENDIAN_BIG;
+		const uint32_t crc_addr = (iter & 2) ? ~0U : (nextRandom(seed) % (siz + 2));
+
+		const uint8_t *const buf = &data[start];
+		const uint16_t oldCrc16 = Crc16(buf, siz, 0xA001);
+		const uint32_t oldCrc32 = Crc32(buf, siz);
+		const uint32_t oldAddBytes32 = AddBytes32(buf, siz);
+		const uint32_t oldAddInvDual16 = AddInvDual16(
+			reinterpret_cast<const uint16_t*>(buf), siz, endian);
+		const uint16_t oldVmu = DreamcastVMU(buf, siz, crc_addr);
+
+		vector<uint8_t> area(buf, buf + siz);
+		const Edit edit = randomEdit(seed, area, 64);
+		memcpy(&data[start], area.data(), siz);
+		const uint32_t tailLen = siz - edit.pos - edit.len;
+		const uint8_t *const o = edit.oldData.data();
+		const uint8_t *const n = edit.newData.data();
+
+		const uint16_t crc16 = Crc16Update(oldCrc16, o, n, edit.len, tailLen, 0xA001);
+		check(crc16 == Crc16(buf, siz, 0xA001),
+			"Crc16Update: iteration %u: %04X != %04X",
+			iter, crc16, Crc16(buf, siz, 0xA001));
+
+		const uint32_t crc32 = Crc32Update(oldCrc32, o, n, edit.len, tailLen);
+		check(crc32 == Crc32(buf, siz),
+			"Crc32Update: iteration %u: %08X != %08X",
+			iter, crc32, Crc32(buf, siz));
+
+		const uint32_t addBytes32 = AddBytes32Update(oldAddBytes32, o, n, edit.len);
+		check(addBytes32 == AddBytes32(buf, siz),
+			"AddBytes32Update: iteration %u: %08X != %08X",
+			iter, addBytes32, AddBytes32(buf, siz));
+
+		uint32_t addInvDual16 = 0;
+		const uint32_t expAddInvDual16 = AddInvDual16(
+			reinterpret_cast<const uint16_t*>(buf), siz, endian);
+		int ret = AddInvDual16Update(oldAddInvDual16, siz, edit.pos,
+			o, n, edit.len, endian, &addInvDual16);
+		if (ret != -EINVAL) {
+			check(ret == 0 && addInvDual16 == expAddInvDual16,
+				"AddInvDual16Update: iteration %u: %d, %08X != %08X",
+				iter, ret, addInvDual16, expAddInvDual16);
+		}
+
+		const uint16_t vmu = DreamcastVMUUpdate(oldVmu, siz, edit.pos,
+			o, n, edit.len, crc_addr);
+		check(vmu == DreamcastVMU(buf, siz, crc_addr),
+			"DreamcastVMUUpdate: iteration %u: %04X != %04X",
+			iter, vmu, DreamcastVMU(buf, siz, crc_addr));
+	}
+}
+
+/**
+ * Check AddInvDual16Update() when the first word was 0xFFFF,
+ * which AddInvDual16 stores as 0.
+ */
+static void test_AddInvDual16Update_FFFF(void)
+{
+	// Two words that add up to 0xFFFF.
+	// chk2 tells if chk1 was 0 or 0xFFFF, so this can be updated.
+	const uint8_t oldData[4] = {0xFF, 0xFF, 0x00, 0x00};
+	const uint8_t newData[4] = {0xFF, 0xFF, 0x12, 0x34};
+	uint32_t checksum = AddInvDual16(reinterpret_cast<const uint16_t*>(oldData),
+		sizeof(oldData), CHKENDIAN_BIG);
+	check((checksum >> 16) == 0, "AddInvDual16: 0xFFFF sum wasn't stored as 0");
+
+	uint32_t updated = 0;
+	int ret = AddInvDual16Update(checksum, sizeof(oldData), 2,
+		&oldData[2], &newData[2], 2, CHKENDIAN_BIG, &updated);
+	const uint32_t expected = AddInvDual16(reinterpret_cast<const uint16_t*>(newData),
+		sizeof(newData), CHKENDIAN_BIG);
+	check(ret == 0 && updated == expected,
+		"AddInvDual16Update: 0xFFFF sum: %d, %08X != %08X",
+		ret, updated, expected);
+
+	// One word: 0x0000 and 0xFFFF have the same checksum,
+	// so the checksum can't be updated.
+	const uint8_t word0[2] = {0x00, 0x00};
+	const uint8_t wordFFFF[2] = {0xFF, 0xFF};
+	const uint8_t newWord[2] = {0x12, 0x34};
+	checksum = AddInvDual16(reinterpret_cast<const uint16_t*>(word0), 2, CHKENDIAN_BIG);
+	check(checksum == AddInvDual16(reinterpret_cast<const uint16_t*>(wordFFFF), 2, CHKENDIAN_BIG),
+		"AddInvDual16: 0x0000 and 0xFFFF should have the same checksum");
+	ret = AddInvDual16Update(checksum, 2, 0, word0, newWord, 2, CHKENDIAN_BIG, &updated);
+	check(ret == -EINVAL, "AddInvDual16Update: ambiguous checksum: %d != -EINVAL", ret);
+}
+
+/**
+ * Check ChecksumPlan::update() against ChecksumPlan::exec()
+ * of the edited buffer.
+ */
+static void test_PlanUpdate(void)
+{
+	static const uint32_t DATA_SIZE = 2048;
+	static const unsigned int ITERATIONS = 2000;
+	vector<uint8_t> data(DATA_SIZE);
+	uint32_t seed = 0x31415926;
+	unsigned int updated = 0;
+
+	for (unsigned int iter = 0; iter < ITERATIONS; iter++) {
+		fillRandom(data, iter);
+		const ChecksumPlan plan(randomChecksumDefs(seed, DATA_SIZE));
+		vector<ChecksumValue> values = plan.exec(data.data(), DATA_SIZE);
+
+		// Small edits, so stored checksums are sometimes partially changed.
+		const Edit edit = randomEdit(seed, data, (iter & 1) ? 8 : 256);
+		if (!plan.update(values, DATA_SIZE, edit.pos,
+		    edit.oldData.data(), edit.newData.data(), edit.len))
+		{
+			// Sonic Chao Garden, or an ambiguous AddInvDual16 checksum.
+			continue;
+		}
+		updated++;
+
+		const vector<ChecksumValue> expected = plan.exec(data.data(), DATA_SIZE);
+		if (!check(values.size() == expected.size(),
+			"ChecksumPlan::update(): iteration %u: %u values != %u values",
+			iter, (unsigned int)values.size(), (unsigned int)expected.size()))
+		{
+			continue;
+		}
+		for (size_t i = 0; i < values.size(); i++) {
+			check(values[i].expected == expected[i].expected &&
+			      values[i].actual == expected[i].actual,
+				"ChecksumPlan::update(): iteration %u, value %u: %08X/%08X != %08X/%08X",
+				iter, (unsigned int)i,
+				values[i].expected, values[i].actual,
+				expected[i].expected, expected[i].actual);
+		}
+	}
+
+	// Most plans don't have a Sonic Chao Garden checksum
+	// in the edited range, so most of them should be updated.
+	check(updated >= ITERATIONS / 2,
+		"ChecksumPlan::update(): only %u of %u plans were updated",
+		updated, ITERATIONS);
+
+	// Sonic Chao Garden checksums can't be updated.
+	fillRandom(data, 0);
+	vector<ChecksumDef> checksumDefs;
+	checksumDefs.push_back(makeDef(CHKALG_SONICCHAOGARDEN, 0, 0, 256));
+	const ChecksumPlan chaoPlan(checksumDefs);
+	vector<ChecksumValue> values = chaoPlan.exec(data.data(), DATA_SIZE);
+	const uint8_t newByte = data[100] ^ 0xFF;
+	check(!chaoPlan.update(values, DATA_SIZE, 100, &data[100], &newByte, 1),
+		"ChecksumPlan::update(): Sonic Chao Garden checksum was updated");
+}
+
+/** Checksum search **/
+
+/**
+ * Calculate a checksum and store it in a buffer.
+ * @param buf		[in/out] Buffer.
+ * @param checksumDef	[in] Checksum definition.
+ */
+static void plantChecksum(vector<uint8_t> &buf, const ChecksumDef &checksumDef)
+{
+	const uint32_t value = Exec(checksumDef.algorithm, &buf[checksumDef.start],
+		checksumDef.length, checksumDef.endian, checksumDef.param);
+	const unsigned int width = (checksumDef.algorithm == CHKALG_CRC16 ? 2 : 4);
+	for (unsigned int i = 0; i < width; i++) {
+		const unsigned int shift = (checksumDef.endian == CHKENDIAN_LITTLE ? i : (width - 1 - i)) * 8;
+		buf[checksumDef.address + i] = (uint8_t)(value >> shift);
+	}
+}
+
+/**
+ * Check that a checksum search found exactly the planted definition.
+ * @param name		[in] Test name.
+ * @param results	[in] Search results.
+ * @param checksumDef	[in] Planted checksum definition.
+ */
+static void checkSearchResults(const char *name, const vector<ChecksumDef> &results,
+	const ChecksumDef &checksumDef)
+{
+	if (!check(results.size() == 1, "ChecksumSearch: %s: %u results != 1",
+		name, (unsigned int)results.size()))
+	{
+		for (size_t i = 0; i < results.size(); i++) {
+			fprintf(stderr, "  result %u: algorithm %d, address 0x%X, start 0x%X, length 0x%X, endian %d\n",
+				(unsigned int)i, results[i].algorithm, results[i].address,
+				results[i].start, results[i].length, results[i].endian);
+		}
+		return;
+	}
+
+	const ChecksumDef &result = results[0];
+	check(result.algorithm == checksumDef.algorithm &&
+	      result.address == checksumDef.address &&
+	      result.start == checksumDef.start &&
+	      result.length == checksumDef.length &&
+	      result.endian == checksumDef.endian &&
+	      result.param == checksumDef.param,
+		"ChecksumSearch: %s: found algorithm %d, address 0x%X, start 0x%X, length 0x%X, endian %d, param 0x%X",
+		name, result.algorithm, result.address, result.start,
+		result.length, result.endian, result.param);
+}
+
+/**
+ * Checksums planted for the search tests.
+ * Lengths are multiples of the default range alignment.
+ */
+static const ChecksumDef *searchDefs(bool isFree)
+{
+	// Anchored: The stored checksum is right before or after the area.
+	static const ChecksumDef anchoredDefs[4] = {
+		makeDef(CHKALG_CRC16, 0x30, 0x08, 0x28, CHKENDIAN_BIG, CRC16_POLY_CCITT),
+		makeDef(CHKALG_CRC32, 0x0C, 0x10, 0x24, CHKENDIAN_LITTLE, CRC32_POLY_ZLIB),
+		makeDef(CHKALG_ADDBYTES32, 0x38, 0x04, 0x34, CHKENDIAN_LITTLE),
+		makeDef(CHKALG_ADDINVDUAL16, 0x00, 0x04, 0x38, CHKENDIAN_BIG),
+	};
+
+	// Free: The stored checksum isn't next to the area.
+	static const ChecksumDef freeDefs[4] = {
+		makeDef(CHKALG_CRC16, 0x1A2, 0x060, 0x0A0, CHKENDIAN_LITTLE, CRC16_POLY_CCITT),
+		makeDef(CHKALG_CRC32, 0x020, 0x080, 0x100, CHKENDIAN_BIG, CRC32_POLY_ZLIB),
+		makeDef(CHKALG_ADDBYTES32, 0x1F0, 0x040, 0x0C0, CHKENDIAN_BIG),
+		makeDef(CHKALG_ADDINVDUAL16, 0x010, 0x090, 0x120, CHKENDIAN_LITTLE),
+	};
+
+	return (isFree ? freeDefs : anchoredDefs);
+}
+
+/**
+ * Plant each algorithm's checksum in a single random sample
+ * and check that ChecksumSearch finds it next to the area.
+ */
+static void test_ChecksumSearchAnchored(void)
+{
+	static const char *const names[4] = {
+		"anchored CRC-16", "anchored CRC-32",
+		"anchored AddBytes32", "anchored AddInvDual16",
+	};
+
+	const ChecksumDef *const checksumDefs = searchDefs(false);
+	vector<uint8_t> data(64);
+	for (int i = 0; i < 4; i++) {
+		fillRandom(data, 0x5EA4C400 + i);
+		plantChecksum(data, checksumDefs[i]);
+
+		ChecksumSearch search;
+		search.addSample(data.data(), (uint32_t)data.size());
+		const vector<ChecksumDef> results = search.search();
+		check(!search.isExhaustive(), "ChecksumSearch: %s: search is exhaustive", names[i]);
+		checkSearchResults(names[i], results, checksumDefs[i]);
+	}
+}
+
+/**
+ * Plant each algorithm's checksum in several random samples
+ * that differ within the area, and check that ChecksumSearch
+ * finds it away from the stored checksum.
+ */
+static void test_ChecksumSearchFree(void)
+{
+	static const char *const names[4] = {
+		"free CRC-16", "free CRC-32",
+		"free AddBytes32", "free AddInvDual16",
+	};
+	static const int SAMPLE_COUNT = 4;
+	// Field that differs between the samples. (within all areas)
+	static const uint32_t FIELD_START = 0xA0;
+	static const uint32_t FIELD_LENGTH = 0x10;
+
+	const ChecksumDef *const checksumDefs = searchDefs(true);
+	vector<uint8_t> data(512);
+	vector<uint8_t> field(FIELD_LENGTH);
+	for (int i = 0; i < 4; i++) {
+		ChecksumSearch search;
+		fillRandom(data, 0xF4EE5EA4 + i);
+		for (int k = 0; k < SAMPLE_COUNT; k++) {
+			fillRandom(field, 0x00F1E1D0 + (i * SAMPLE_COUNT) + k);
+			memcpy(&data[FIELD_START], field.data(), FIELD_LENGTH);
+			plantChecksum(data, checksumDefs[i]);
+			search.addSample(data.data(), (uint32_t)data.size());
+		}
+
+		const vector<ChecksumDef> results = search.search();
+		check(search.isExhaustive(), "ChecksumSearch: %s: search isn't exhaustive", names[i]);
+		checkSearchResults(names[i], results, checksumDefs[i]);
+	}
+}
+
+int main(void)
+{
+	test_SimdKernels();
+	test_PlanChaoGardenField();
+	test_PlanPokemonXD();
+	test_PlanRandom();
+	test_CrcCombine();
+	test_ChecksumUpdate();
+	test_AddInvDual16Update_FFFF();
+	test_PlanUpdate();
+	test_ChecksumSearchAnchored();
+	test_ChecksumSearchFree();
+
+	if (failures != 0) {
+		fprintf(stderr, "%u check(s) failed.\n", failures);
+		return EXIT_FAILURE;
+	}
+	printf("All checks passed.\n");
+	return EXIT_SUCCESS;
+}
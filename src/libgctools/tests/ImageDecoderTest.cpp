@@ -0,0 +1,362 @@
+/***************************************************************************
+ * GameCube Tools Library.                                                 *
+ * ImageDecoderTest.cpp: Pixel format decoder tests.                       *
+ *                                                                         *
+ * Copyright (c) 2012-2018 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+/**
+ * Checks the pixel format decoders against simple reference code
+ * at each SIMD dispatch level supported by the CPU.
+ *
+ * Each failure is printed on stderr.
+ * The exit status is non-zero if any check failed.
+ */
+
+#include "ImageDecoder_p.hpp"
+#include "util/array_size.h"
+#include "util/byteswap.h"
+#include "util/cpuflags_x86.h"
+
+// C includes. (C++ namespace)
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+
+// C++ includes.
+#include <vector>
+using std::vector;
+
+// Number of failed checks.
+static unsigned int failures = 0;
+
+/**
+ * Check a test condition.
+ * @param ok Condition.
+ * @param fmt Description of the check, printed if it failed.
+ * @return ok
+ */
+static bool check(bool ok, const char *fmt, ...)
+{
+	if (!ok) {
+		va_list ap;
+		va_start(ap, fmt);
+		fputs("FAIL: ", stderr);
+		vfprintf(stderr, fmt, ap);
+		fputc('\n', stderr);
+		va_end(ap);
+		failures++;
+	}
+	return ok;
+}
+
+/**
+ * Fill a buffer with pseudo-random data.
+ * @param buf Buffer.
+ * @param seed Seed.
+ */
+static void fillRandom(vector<uint8_t> &buf, uint32_t seed)
+{
+	for (size_t i = 0; i < buf.size(); i++) {
+		seed = (seed * 1103515245U) + 12345U;
+		buf[i] = (uint8_t)(seed >> 16);
+	}
+}
+
+/**
+ * SIMD dispatch level.
+ * Each level also allows the instruction sets of the previous levels.
+ */
+struct DispatchLevel {
+	const char *name;
+	uint32_t flags;		// MCR_CPUFLAG_X86_* flags allowed at this level.
+};
+
+#ifdef MCR_CPU_X86
+static const DispatchLevel dispatchLevels[] = {
+	{"generic", 0},
+	{"sse2", MCR_CPUFLAG_X86_SSE2},
+	{"avx2", MCR_CPUFLAG_X86_SSE2 | MCR_CPUFLAG_X86_AVX | MCR_CPUFLAG_X86_AVX2},
+};
+#else /* !MCR_CPU_X86 */
+static const DispatchLevel dispatchLevels[] = {
+	{"generic", 0},
+};
+#endif /* MCR_CPU_X86 */
+
+/** Reference decoders **/
+
+/**
+ * Expand an n-bit color channel to 8 bits by replicating its bits.
+ * @param c Color channel.
+ * @param bits Number of bits. (3 to 5)
+ * @return 8-bit color channel.
+ */
+static inline uint32_t expand(uint32_t c, int bits)
+{
+	uint32_t c8 = 0;
+	for (int shift = 8 - bits; shift > -bits; shift -= bits) {
+		c8 |= (shift >= 0 ? (c << shift) : (c >> -shift));
+	}
+	return (c8 & 0xFF);
+}
+
+/**
+ * Convert an RGB5A3 pixel to ARGB32.
+ * @param px16 RGB5A3 pixel. (host-endian)
+ * @return ARGB32 pixel.
+ */
+static uint32_t ref_RGB5A3(uint16_t px16)
+{
+	if (px16 & 0x8000) {
+		// RGB555
+		return 0xFF000000U |
+		       (expand((px16 >> 10) & 0x1F, 5) << 16) |
+		       (expand((px16 >>  5) & 0x1F, 5) <<  8) |
+		        expand( px16        & 0x1F, 5);
+	}
+
+	// RGB4A3
+	return (expand((px16 >> 12) & 0x07, 3) << 24) |
+	       (expand((px16 >>  8) & 0x0F, 4) << 16) |
+	       (expand((px16 >>  4) & 0x0F, 4) <<  8) |
+	        expand( px16        & 0x0F, 4);
+}
+
+/**
+ * Convert an ARGB4444 pixel to ARGB32.
+ * @param px16 ARGB4444 pixel. (host-endian)
+ * @return ARGB32 pixel.
+ */
+static uint32_t ref_ARGB4444(uint16_t px16)
+{
+	return (expand((px16 >> 12) & 0x0F, 4) << 24) |
+	       (expand((px16 >>  8) & 0x0F, 4) << 16) |
+	       (expand((px16 >>  4) & 0x0F, 4) <<  8) |
+	        expand( px16        & 0x0F, 4);
+}
+
+/** Tests **/
+
+// Alignments: 0 to 31 pixels. (AVX2 registers are 32 bytes.)
+static const unsigned int ALIGNMENTS = 32;
+// All counts up to this are checked.
+static const unsigned int MAX_COUNT = 80;
+
+/**
+ * Get the CPU flags.
+ * @return CPU flags.
+ */
+static inline uint32_t cpuFlags(void)
+{
+#ifdef MCR_CPU_X86
+	return MCR_CPU_Flags_x86();
+#else /* !MCR_CPU_X86 */
+	return 0;
+#endif /* MCR_CPU_X86 */
+}
+
+/**
+ * Set the CPU flags mask for a dispatch level.
+ * @param level Dispatch level.
+ * @param name Test name, for the "skipped" message.
+ * @return True if the level is supported by the CPU.
+ */
+static bool setLevel(const DispatchLevel &level, const char *name)
+{
+	if ((level.flags & cpuFlags()) != level.flags) {
+		printf("%s: %s: skipped (not supported by the CPU)\n", name, level.name);
+		return false;
+	}
+#ifdef MCR_CPU_X86
+	MCR_CPU_SetFlagsMask_x86(level.flags);
+#endif /* MCR_CPU_X86 */
+	return true;
+}
+
+/**
+ * Check a linear 16-bit to ARGB32 decoder with every pixel value,
+ * then at every alignment and every count up to MAX_COUNT.
+ * @param name Test name.
+ * @param func Decoder.
+ * @param ref Reference decoder.
+ * @param bigEndian True if the source pixels are big-endian.
+ */
+static void test_Linear16(const char *name,
+	void (*func)(uint32_t *dest, const uint16_t *src, unsigned int count),
+	uint32_t (*ref)(uint16_t px16), bool bigEndian)
+{
+	// Every pixel value.
+	vector<uint16_t> allSrc(65536);
+	for (unsigned int i = 0; i < 65536; i++) {
+		allSrc[i] = (bigEndian ? cpu_to_be16((uint16_t)i) : cpu_to_le16((uint16_t)i));
+	}
+
+	// Random pixels.
+	vector<uint8_t> rnd((ALIGNMENTS + MAX_COUNT) * 2);
+	fillRandom(rnd, 0x12345678);
+	const uint16_t *const rndSrc = reinterpret_cast<const uint16_t*>(rnd.data());
+
+	vector<uint32_t> dest(65536 + 1);
+	for (int l = 0; l < ARRAY_SIZE(dispatchLevels); l++) {
+		const DispatchLevel &level = dispatchLevels[l];
+		if (!setLevel(level, name))
+			continue;
+
+		func(dest.data(), allSrc.data(), 65536);
+		for (unsigned int i = 0; i < 65536; i++) {
+			if (!check(dest[i] == ref((uint16_t)i), "%s: %s: pixel %04X: %08X != %08X",
+				name, level.name, i, dest[i], ref((uint16_t)i)))
+			{
+				break;
+			}
+		}
+
+		for (unsigned int align = 0; align < ALIGNMENTS; align++) {
+			for (unsigned int count = 0; count <= MAX_COUNT; count++) {
+				// Make sure nothing is written past the end.
+				dest[count] = 0xDEADBEEF;
+				func(&dest[0], &rndSrc[align], count);
+				for (unsigned int i = 0; i < count; i++) {
+					const uint16_t px16 = (bigEndian
+						? be16_to_cpu(rndSrc[align + i])
+						: le16_to_cpu(rndSrc[align + i]));
+					check(dest[i] == ref(px16),
+						"%s: %s: alignment %u, count %u, pixel %u: %08X != %08X",
+						name, level.name, align, count, i, dest[i], ref(px16));
+				}
+				check(dest[count] == 0xDEADBEEF,
+					"%s: %s: alignment %u, count %u: wrote past the end",
+					name, level.name, align, count);
+			}
+		}
+	}
+
+#ifdef MCR_CPU_X86
+	MCR_CPU_SetFlagsMask_x86(~0U);
+#endif /* MCR_CPU_X86 */
+}
+
+/**
+ * Check RGB5A3_tiled_to_ARGB32() with every pixel value,
+ * and with the GCN banner and icon sizes.
+ */
+static void test_RGB5A3_tiled(void)
+{
+	static const char name[] = "RGB5A3 (tiled)";
+	static const struct {
+		int w, h;
+	} sizes[] = {
+		{256, 256},	// Every pixel value.
+		{96, 32},	// Banner
+		{32, 32},	// Icon
+		{4, 4},		// Single tile
+	};
+
+	for (int s = 0; s < ARRAY_SIZE(sizes); s++) {
+		const int w = sizes[s].w;
+		const int h = sizes[s].h;
+
+		// Source pixels, in 4x4 tiles.
+		vector<uint16_t> src(w * h);
+		if (w * h == 65536) {
+			for (unsigned int i = 0; i < 65536; i++) {
+				src[i] = cpu_to_be16((uint16_t)i);
+			}
+		} else {
+			vector<uint8_t> rnd(w * h * 2);
+			fillRandom(rnd, 0x9ABCDEF0 + s);
+			for (int i = 0; i < w * h; i++) {
+				src[i] = (uint16_t)(rnd[i*2] | (rnd[i*2+1] << 8));
+			}
+		}
+
+		// Expected image.
+		vector<uint32_t> expected(w * h);
+		const uint16_t *px_src = src.data();
+		for (int y = 0; y < h; y += 4) {
+			for (int x = 0; x < w; x += 4) {
+				for (int row = 0; row < 4; row++) {
+					for (int col = 0; col < 4; col++, px_src++) {
+						expected[((y + row) * w) + x + col] = ref_RGB5A3(be16_to_cpu(*px_src));
+					}
+				}
+			}
+		}
+
+		vector<uint32_t> dest(w * h);
+		for (int l = 0; l < ARRAY_SIZE(dispatchLevels); l++) {
+			const DispatchLevel &level = dispatchLevels[l];
+			if (!setLevel(level, name))
+				continue;
+
+			ImageDecoder::RGB5A3_tiled_to_ARGB32(dest.data(), src.data(), w, h);
+			for (int i = 0; i < w * h; i++) {
+				if (!check(dest[i] == expected[i], "%s: %s: %dx%d, pixel (%d,%d): %08X != %08X",
+					name, level.name, w, h, i % w, i / w, dest[i], expected[i]))
+				{
+					break;
+				}
+			}
+		}
+	}
+
+#ifdef MCR_CPU_X86
+	MCR_CPU_SetFlagsMask_x86(~0U);
+#endif /* MCR_CPU_X86 */
+}
+
+/**
+ * Check Unpack4bpp() at every alignment and every count up to MAX_COUNT.
+ */
+static void test_Unpack4bpp(void)
+{
+	static const char name[] = "Unpack4bpp";
+	vector<uint8_t> src(ALIGNMENTS + MAX_COUNT);
+	fillRandom(src, 0x0BADF00D);
+
+	vector<uint8_t> dest((MAX_COUNT * 2) + 1);
+	for (int l = 0; l < ARRAY_SIZE(dispatchLevels); l++) {
+		const DispatchLevel &level = dispatchLevels[l];
+		if (!setLevel(level, name))
+			continue;
+
+		for (unsigned int align = 0; align < ALIGNMENTS; align++) {
+			for (unsigned int count = 0; count <= MAX_COUNT; count++) {
+				// Make sure nothing is written past the end.
+				dest[count * 2] = 0xA5;
+				ImageDecoder::Unpack4bpp(dest.data(), &src[align], count);
+				for (unsigned int i = 0; i < count; i++) {
+					const uint8_t b = src[align + i];
+					check(dest[i*2] == (b >> 4) && dest[i*2+1] == (b & 0x0F),
+						"%s: %s: alignment %u, count %u, byte %u: %X%X != %02X",
+						name, level.name, align, count, i,
+						dest[i*2], dest[i*2+1], b);
+				}
+				check(dest[count * 2] == 0xA5,
+					"%s: %s: alignment %u, count %u: wrote past the end",
+					name, level.name, align, count);
+			}
+		}
+	}
+
+#ifdef MCR_CPU_X86
+	MCR_CPU_SetFlagsMask_x86(~0U);
+#endif /* MCR_CPU_X86 */
+}
+
+int main(void)
+{
+	test_Linear16("RGB5A3", ImageDecoder::RGB5A3_to_ARGB32, ref_RGB5A3, true);
+	test_Linear16("ARGB4444", ImageDecoder::ARGB4444_to_ARGB32, ref_ARGB4444, false);
+	test_RGB5A3_tiled();
+	test_Unpack4bpp();
+
+	if (failures != 0) {
+		fprintf(stderr, "%u check(s) failed.\n", failures);
+		return EXIT_FAILURE;
+	}
+	printf("All checks passed.\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,142 @@
+/***************************************************************************
+ * GameCube Tools Library.                                                 *
+ * cpuflags_x86.c: x86 CPU flags detection.                                *
+ *                                                                         *
+ * Copyright (c) 2017-2018 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "cpuflags_x86.h"
+
+#ifdef MCR_CPU_X86
+
+#if defined(_MSC_VER)
+# include <intrin.h>
+#elif defined(__GNUC__)
+# include <cpuid.h>
+#endif
+
+// CPUID function 1: Processor Info and Feature Bits
+#define CPUID_ECX_SSSE3		(1U << 9)
+#define CPUID_ECX_SSE41		(1U << 19)
+#define CPUID_ECX_PCLMULQDQ	(1U << 1)
+#define CPUID_ECX_OSXSAVE	(1U << 27)
+#define CPUID_ECX_AVX		(1U << 28)
+#define CPUID_EDX_SSE2		(1U << 26)
+
+// CPUID function 7: Extended Features
+#define CPUID_EBX_AVX2		(1U << 5)
+
+// XCR0: SSE and AVX state are saved by the OS.
+#define XCR0_YMM_STATE		0x06
+
+// Cached CPU flags.
+// NOTE: Multiple threads may detect the flags at the same time,
+// but they'll all write the same value.
+static volatile uint32_t cpu_flags = 0;
+static volatile int cpu_flags_init = 0;
+
+// Flags allowed by MCR_CPU_SetFlagsMask_x86().
+static volatile uint32_t cpu_flags_mask = ~0U;
+
+/**
+ * Run the CPUID instruction.
+ * @param level	[in] CPUID level.
+ * @param regs	[out] EAX, EBX, ECX, EDX.
+ */
+static void do_cpuid(unsigned int level, unsigned int regs[4])
+{
+#if defined(_MSC_VER)
+	__cpuidex((int*)regs, (int)level, 0);
+#elif defined(__GNUC__)
+	__cpuid_count(level, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+/**
+ * Read XCR0 using XGETBV.
+ * Only valid if CPUID reports OSXSAVE.
+ * @return XCR0 (low 32 bits)
+ */
+static uint32_t do_xgetbv(void)
+{
+#if defined(_MSC_VER)
+	return (uint32_t)_xgetbv(0);
+#elif defined(__GNUC__)
+	uint32_t eax, edx;
+	// NOTE: Using the opcode directly for old assemblers.
+	__asm__ (".byte 0x0f, 0x01, 0xd0" : "=a" (eax), "=d" (edx) : "c" (0));
+	return eax;
+#endif
+}
+
+/**
+ * Get the x86 CPU flags.
+ * The flags are detected on the first call.
+ * AVX and AVX2 are only reported if the OS saves the YMM registers.
+ * @return MCR_CPUFLAG_X86_* flags.
+ */
+uint32_t MCR_CPU_Flags_x86(void)
+{
+	unsigned int regs[4];
+	unsigned int max_level;
+	uint32_t flags = 0;
+
+	if (cpu_flags_init) {
+		return cpu_flags & cpu_flags_mask;
+	}
+
+#if defined(__GNUC__) && defined(__i386__)
+	// i386: CPUID might not be supported.
+	if (!__get_cpuid_max(0, NULL)) {
+		cpu_flags_init = 1;
+		return 0;
+	}
+#endif
+
+	do_cpuid(0, regs);
+	max_level = regs[0];
+	if (max_level >= 1) {
+		do_cpuid(1, regs);
+		if (regs[3] & CPUID_EDX_SSE2)
+			flags |= MCR_CPUFLAG_X86_SSE2;
+		if (regs[2] & CPUID_ECX_SSSE3)
+			flags |= MCR_CPUFLAG_X86_SSSE3;
+		if (regs[2] & CPUID_ECX_SSE41)
+			flags |= MCR_CPUFLAG_X86_SSE41;
+		if (regs[2] & CPUID_ECX_PCLMULQDQ)
+			flags |= MCR_CPUFLAG_X86_PCLMULQDQ;
+
+		// AVX requires OS support for saving the YMM registers.
+		if ((regs[2] & (CPUID_ECX_OSXSAVE | CPUID_ECX_AVX)) ==
+		    (CPUID_ECX_OSXSAVE | CPUID_ECX_AVX))
+		{
+			if ((do_xgetbv() & XCR0_YMM_STATE) == XCR0_YMM_STATE) {
+				flags |= MCR_CPUFLAG_X86_AVX;
+			}
+		}
+	}
+
+	if (max_level >= 7 && (flags & MCR_CPUFLAG_X86_AVX)) {
+		do_cpuid(7, regs);
+		if (regs[1] & CPUID_EBX_AVX2)
+			flags |= MCR_CPUFLAG_X86_AVX2;
+	}
+
+	cpu_flags = flags;
+	cpu_flags_init = 1;
+	return flags & cpu_flags_mask;
+}
+
+/**
+ * Restrict the x86 CPU flags reported by MCR_CPU_Flags_x86().
+ * This forces a lower SIMD dispatch level, e.g. for benchmarking.
+ * NOTE: Not thread-safe; call this while no checksums are being calculated.
+ * @param mask MCR_CPUFLAG_X86_* flags to allow. (~0 to allow all flags)
+ */
+void MCR_CPU_SetFlagsMask_x86(uint32_t mask)
+{
+	cpu_flags_mask = mask;
+}
+
+#endif /* MCR_CPU_X86 */
@@ -0,0 +1,56 @@
+/***************************************************************************
+ * GameCube Tools Library.                                                 *
+ * cpuflags_x86.h: x86 CPU flags detection.                                *
+ *                                                                         *
+ * Copyright (c) 2017-2018 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __LIBGCTOOLS_UTIL_CPUFLAGS_X86_H__
+#define __LIBGCTOOLS_UTIL_CPUFLAGS_X86_H__
+
+#include <stdint.h>
+
+// Check if this is an x86 or x86-64 CPU.
+#if defined(__i386__) || defined(__x86_64__) || \
+    defined(_M_IX86) || defined(_M_X64)
+# define MCR_CPU_X86 1
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef MCR_CPU_X86
+
+// CPU flags.
+#define MCR_CPUFLAG_X86_SSE2		(1U << 0)
+#define MCR_CPUFLAG_X86_SSSE3		(1U << 1)
+#define MCR_CPUFLAG_X86_SSE41		(1U << 2)
+#define MCR_CPUFLAG_X86_PCLMULQDQ	(1U << 3)
+#define MCR_CPUFLAG_X86_AVX		(1U << 4)
+#define MCR_CPUFLAG_X86_AVX2		(1U << 5)
+
+/**
+ * Get the x86 CPU flags.
+ * The flags are detected on the first call.
+ * AVX and AVX2 are only reported if the OS saves the YMM registers.
+ * @return MCR_CPUFLAG_X86_* flags.
+ */
+uint32_t MCR_CPU_Flags_x86(void);
+
+/**
+ * Restrict the x86 CPU flags reported by MCR_CPU_Flags_x86().
+ * This forces a lower SIMD dispatch level, e.g. for benchmarking.
+ * NOTE: Not thread-safe; call this while no checksums are being calculated.
+ * @param mask MCR_CPUFLAG_X86_* flags to allow. (~0 to allow all flags)
+ */
+void MCR_CPU_SetFlagsMask_x86(uint32_t mask);
+
+#endif /* MCR_CPU_X86 */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LIBGCTOOLS_UTIL_CPUFLAGS_X86_H__ */
@@ -10,20 +10,77 @@
 #include "Card_p.hpp"
 #include "File.hpp"
 
+#include "config.libmemcard.h"
+
 // C includes. (C++ namespace)
 #include <cstring>
 #include <cstdio>
 #include <cassert>
 
 // C++ includes.
+#include <algorithm>
 #include <limits>
 
+#if defined(HAVE_POSIX_FADVISE) || defined(HAVE_POSIX_MADVISE)
+// posix_fadvise(), posix_madvise()
+# include <fcntl.h>
+# include <sys/mman.h>
+#endif
+
 // Qt includes.
 #include <QtCore/QFile>
 #include <QtCore/QVector>
 
 #define NUM_ELEMENTS(x) ((int)(sizeof(x) / sizeof(x[0])))
 
+/** Card::MappedImage **/
+
+/**
+ * Memory-mapped card image data.
+ * The card image is mapped using a separate read-only QFile,
+ * so the mapping isn't affected if the Card reopens its QFile.
+ */
+struct Card::MappedImage::Data
+{
+	QFile file;
+	const uint8_t *data;
+	qint64 size;
+	uint32_t blockSize;
+	uint32_t headerSize;
+
+	Data(const QString &filename, uint32_t blockSize, uint32_t headerSize)
+		: file(filename)
+		, data(nullptr)
+		, size(0)
+		, blockSize(blockSize)
+		, headerSize(headerSize) { }
+
+	~Data()
+	{
+		if (data) {
+			file.unmap(const_cast<uchar*>(reinterpret_cast<const uchar*>(data)));
+		}
+	}
+
+	private:
+		Q_DISABLE_COPY(Data)
+};
+
+/**
+ * Get a pointer to a block.
+ * @param blockIdx Block index.
+ * @return Pointer to the block, or nullptr if the image is null or blockIdx is out of range.
+ */
+const uint8_t *Card::MappedImage::block(uint16_t blockIdx) const
+{
+	if (!d)
+		return nullptr;
+	const qint64 pos = ((qint64)blockIdx * d->blockSize) + d->headerSize;
+	if (pos + d->blockSize > d->size)
+		return nullptr;
+	return d->data + pos;
+}
+
 /** CardPrivate **/
 
 CardPrivate::CardPrivate(Card *q, uint32_t blockSize,
@@ -72,6 +129,7 @@ CardPrivate::~CardPrivate()
 	lstFiles.clear();
 
 	if (file) {
+		unmapFile();
 		file->close();
 		delete file;
 	}
@@ -143,6 +201,9 @@ int CardPrivate::open(const QString &filename, QIODevice::OpenModeFlag openMode)
 		this->errors |= Card::MCE_SZ_NON_POW2;
 	}
 
+	// Map the card image into memory.
+	mapFile();
+
 	// Card is open.
 	return 0;
 }
@@ -158,6 +219,7 @@ void CardPrivate::close(void)
 		return;
 	}
 
+	unmapFile();
 	file->close();
 	delete file;
 	file = nullptr;
@@ -170,6 +232,55 @@ void CardPrivate::close(void)
 	freeBlocks = 0;
 }
 
+/**
+ * Map the card image into memory.
+ * If mmap() fails, the mapping is set to a null MappedImage,
+ * and the QFile will be used for reading.
+ * Any existing mapping is released first.
+ */
+void CardPrivate::mapFile(void)
+{
+	unmapFile();
+	if (!file)
+		return;
+
+	// NOTE: filesize may be truncated to maxBlocks,
+	// so only map the part of the file that's used.
+	const qint64 size = std::min((qint64)file->size(), (qint64)(filesize + headerSize));
+	if (size <= 0)
+		return;
+
+	// NOTE: Writes must be flushed before mapping.
+	file->flush();
+
+	// Map the file using a separate read-only QFile.
+	QSharedPointer<Card::MappedImage::Data> data(
+		new Card::MappedImage::Data(filename, blockSize, headerSize));
+	if (!data->file.open(QIODevice::ReadOnly))
+		return;
+	const uchar *const map = data->file.map(0, size);
+	if (!map)
+		return;
+	data->data = reinterpret_cast<const uint8_t*>(map);
+	data->size = size;
+
+	QMutexLocker locker(&mappingMutex);
+	mapping.d = data;
+}
+
+/**
+ * Release the memory-mapped card image.
+ * The mapping is unmapped once all
+ * MappedImage references are released.
+ */
+void CardPrivate::unmapFile(void)
+{
+	// NOTE: Don't release the last reference while holding the mutex.
+	Card::MappedImage old;
+	QMutexLocker locker(&mappingMutex);
+	std::swap(old.d, mapping.d);
+}
+
 /**
  * Find the most common byte in a block of data.
  * This is useful for determining header garbage.
@@ -318,6 +429,7 @@ int Card::setReadOnly(bool readOnly)
 
 	// TODO: Validate that this file is the same as the one we had before.
 	// TODO: Atomic swap of d->file and tmp_file.
+	// NOTE: The mapping has its own QFile, so it isn't affected.
 	std::swap(d->file, tmp_file);
 	d->readOnly = readOnly;
 	tmp_file->close();
@@ -614,12 +726,20 @@ int Card::readBlock(void *buf, int siz, uint16_t blockIdx)
 {
 	Q_D(Card);
 	if (!isOpen())
-		return EBADF;
+		return -EBADF;
 	else if (siz < (int)d->blockSize)
 		return -EINVAL;
 	else if (siz == 0)
 		return 0;
 
+	// If the card image is mapped, copy the block from memory.
+	const MappedImage mapping = d->mappedImage();
+	const uint8_t *const block = mapping.block(blockIdx);
+	if (block) {
+		memcpy(buf, block, d->blockSize);
+		return (int)d->blockSize;
+	}
+
 	// Read the specified block.
 	const qint64 pos = ((qint64)blockIdx * d->blockSize) + d->headerSize;
 	if (!d->file->seek(pos))
@@ -655,10 +775,213 @@ int Card::writeBlock(const void *buf, int siz, uint16_t blockIdx)
 		return -EIO;    // TODO: Proper error code?
 	// TODO: Check for errors?
 	int ret = (int)d->file->write((char*)buf, d->blockSize);
-	return (ret >= 0 ? ret : -EIO);
+	if (ret < 0)
+		return -EIO;
+
+	// Flush the write so the memory-mapped
+	// card image sees the new data.
+	if (!d->mapping.isNull() && !d->file->flush())
+		return -EIO;
+	return ret;
 }
 
-// TODO: Add readBlocks() and writeBlocks() functions?
+/**
+ * Get the memory-mapped card image.
+ *
+ * This avoids copying the block data when scanning the card.
+ * Keep the MappedImage for as long as its block pointers are used.
+ *
+ * @return Memory-mapped card image, or null MappedImage if the card isn't mapped.
+ */
+Card::MappedImage Card::mappedImage(void) const
+{
+	Q_D(const Card);
+	return d->mappedImage();
+}
+
+/**
+ * Indicate that the card will be read sequentially, e.g. during a scan.
+ * This is only a hint; it may be ignored on some systems.
+ * @param sequential True to enable sequential access; false to restore normal access.
+ */
+void Card::setSequentialAccessHint(bool sequential)
+{
+	if (!isOpen())
+		return;
+	Q_D(Card);
+
+#ifdef HAVE_POSIX_FADVISE
+	const int fd = d->file->handle();
+	if (fd >= 0) {
+		if (sequential) {
+			posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+			posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+		} else {
+			posix_fadvise(fd, 0, 0, POSIX_FADV_NORMAL);
+		}
+	}
+#endif /* HAVE_POSIX_FADVISE */
+
+#ifdef HAVE_POSIX_MADVISE
+	const MappedImage mapping = d->mappedImage();
+	if (!mapping.isNull()) {
+		posix_madvise(const_cast<uint8_t*>(mapping.d->data), (size_t)mapping.d->size,
+			(sequential ? POSIX_MADV_SEQUENTIAL : POSIX_MADV_NORMAL));
+	}
+#endif /* HAVE_POSIX_MADVISE */
+
+#if !defined(HAVE_POSIX_FADVISE) && !defined(HAVE_POSIX_MADVISE)
+	Q_UNUSED(d)
+	Q_UNUSED(sequential)
+#endif
+}
+
+/**
+ * Get the length of a run of physically contiguous blocks.
+ * @param blockList Block indexes.
+ * @param start First block in blockList.
+ * @return Number of contiguous blocks starting at blockList[start].
+ */
+static int ContiguousRunLength(const QVector<uint16_t> &blockList, int start)
+{
+	int end = start + 1;
+	for (; end < blockList.size(); end++) {
+		if (blockList.at(end) != blockList.at(end - 1) + 1)
+			break;
+	}
+	return (end - start);
+}
+
+/**
+ * Read multiple blocks.
+ *
+ * Physically contiguous blocks in blockList are
+ * coalesced into a single read.
+ *
+ * Blocks that couldn't be read are zero-filled.
+ *
+ * @param buf		[out] Buffer to read the block data into.
+ * @param siz		[in] Size of buffer. (Must be >= blockList.size() * blockSize.)
+ * @param blockList	[in] Block indexes, e.g. a file's FAT entries.
+ * @param blockErrors	[out,opt] Per-block error codes. (0 on success; negative POSIX error code on error.)
+ * @return Bytes read on success; negative POSIX error code on error.
+ * (If some blocks couldn't be read, they aren't counted.)
+ */
+int Card::readBlocks(void *buf, int siz, const QVector<uint16_t> &blockList,
+	QVector<int> *blockErrors)
+{
+	Q_D(Card);
+	if (!isOpen())
+		return -EBADF;
+	else if (siz < (qint64)blockList.size() * d->blockSize)
+		return -EINVAL;
+
+	if (blockErrors) {
+		blockErrors->fill(0, blockList.size());
+	}
+
+	// Keep a reference to the mapping while reading.
+	const MappedImage mapping = d->mappedImage();
+
+	uint8_t *buf_u8 = static_cast<uint8_t*>(buf);
+	int bytesRead = 0;
+	for (int i = 0; i < blockList.size(); ) {
+		const int runLen = ContiguousRunLength(blockList, i);
+		const int runSize = runLen * d->blockSize;
+		int runBlocksRead;
+
+		const uint8_t *const block = mapping.block(blockList.at(i));
+		if (block && mapping.block(blockList.at(i + runLen - 1))) {
+			// The run is in the memory-mapped card image.
+			memcpy(buf_u8, block, runSize);
+			runBlocksRead = runLen;
+		} else {
+			// Read the run from the file.
+			const qint64 pos = ((qint64)blockList.at(i) * d->blockSize) + d->headerSize;
+			qint64 ret = -1;
+			if (d->file->seek(pos)) {
+				ret = d->file->read((char*)buf_u8, runSize);
+			}
+			runBlocksRead = (ret > 0 ? (int)(ret / d->blockSize) : 0);
+
+			// Zero-fill blocks that weren't read.
+			memset(buf_u8 + (runBlocksRead * d->blockSize), 0,
+				runSize - (runBlocksRead * d->blockSize));
+			if (blockErrors) {
+				for (int j = runBlocksRead; j < runLen; j++) {
+					(*blockErrors)[i + j] = -EIO;
+				}
+			}
+		}
+
+		bytesRead += runBlocksRead * d->blockSize;
+		buf_u8 += runSize;
+		i += runLen;
+	}
+
+	return bytesRead;
+}
+
+/**
+ * Write multiple blocks.
+ *
+ * Physically contiguous blocks in blockList are
+ * coalesced into a single write.
+ *
+ * @param buf		[in] Buffer containing the data to write.
+ * @param siz		[in] Size of buffer. (Must be >= blockList.size() * blockSize.)
+ * @param blockList	[in] Block indexes, e.g. a file's FAT entries.
+ * @param blockErrors	[out,opt] Per-block error codes. (0 on success; negative POSIX error code on error.)
+ * @return Bytes written on success; negative POSIX error code on error.
+ * (If some blocks couldn't be written, they aren't counted.)
+ */
+int Card::writeBlocks(const void *buf, int siz, const QVector<uint16_t> &blockList,
+	QVector<int> *blockErrors)
+{
+	Q_D(Card);
+	if (!isOpen())
+		return -EBADF;
+	else if (siz < (qint64)blockList.size() * d->blockSize)
+		return -EINVAL;
+
+	// Make sure the card isn't read-only.
+	if (d->readOnly)
+		return -EROFS;
+
+	if (blockErrors) {
+		blockErrors->fill(0, blockList.size());
+	}
+
+	const uint8_t *buf_u8 = static_cast<const uint8_t*>(buf);
+	int bytesWritten = 0;
+	for (int i = 0; i < blockList.size(); ) {
+		const int runLen = ContiguousRunLength(blockList, i);
+		const int runSize = runLen * d->blockSize;
+
+		// Write the run to the file.
+		const qint64 pos = ((qint64)blockList.at(i) * d->blockSize) + d->headerSize;
+		qint64 ret = -1;
+		if (d->file->seek(pos)) {
+			ret = d->file->write((const char*)buf_u8, runSize);
+		}
+		const int runBlocksWritten = (ret > 0 ? (int)(ret / d->blockSize) : 0);
+		if (blockErrors) {
+			for (int j = runBlocksWritten; j < runLen; j++) {
+				(*blockErrors)[i + j] = -EIO;
+			}
+		}
+
+		bytesWritten += runBlocksWritten * d->blockSize;
+		buf_u8 += runSize;
+		i += runLen;
+	}
+
+	// Flush the writes so the memory-mapped
+	// card image sees the new data.
+	if (!d->mapping.isNull() && !d->file->flush())
+		return -EIO;
+	return bytesWritten;
+}
 
 /** File management **/
 
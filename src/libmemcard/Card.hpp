@@ -15,8 +15,10 @@
 // Qt includes and classes.
 #include <QtCore/QDateTime>
 #include <QtCore/QObject>
+#include <QtCore/QSharedPointer>
 #include <QtCore/QString>
 #include <QtCore/QTextCodec>
+#include <QtCore/QVector>
 #include <QtGui/QColor>
 
 class File;
@@ -316,6 +318,93 @@ class Card : public QObject
 		 */
 		int writeBlock(const void *buf, int siz, uint16_t blockIdx);
 
+		/**
+		 * Read multiple blocks.
+		 *
+		 * Physically contiguous blocks in blockList are
+		 * coalesced into a single read.
+		 *
+		 * Blocks that couldn't be read are zero-filled.
+		 *
+		 * @param buf		[out] Buffer to read the block data into.
+		 * @param siz		[in] Size of buffer. (Must be >= blockList.size() * blockSize.)
+		 * @param blockList	[in] Block indexes, e.g. a file's FAT entries.
+		 * @param blockErrors	[out,opt] Per-block error codes. (0 on success; negative POSIX error code on error.)
+		 * @return Bytes read on success; negative POSIX error code on error.
+		 * (If some blocks couldn't be read, they aren't counted.)
+		 */
+		int readBlocks(void *buf, int siz, const QVector<uint16_t> &blockList,
+			QVector<int> *blockErrors = nullptr);
+
+		/**
+		 * Write multiple blocks.
+		 *
+		 * Physically contiguous blocks in blockList are
+		 * coalesced into a single write.
+		 *
+		 * @param buf		[in] Buffer containing the data to write.
+		 * @param siz		[in] Size of buffer. (Must be >= blockList.size() * blockSize.)
+		 * @param blockList	[in] Block indexes, e.g. a file's FAT entries.
+		 * @param blockErrors	[out,opt] Per-block error codes. (0 on success; negative POSIX error code on error.)
+		 * @return Bytes written on success; negative POSIX error code on error.
+		 * (If some blocks couldn't be written, they aren't counted.)
+		 */
+		int writeBlocks(const void *buf, int siz, const QVector<uint16_t> &blockList,
+			QVector<int> *blockErrors = nullptr);
+
+		/**
+		 * Memory-mapped card image.
+		 *
+		 * The mapping is reference-counted. Block pointers stay valid
+		 * as long as a MappedImage that refers to the mapping exists,
+		 * even if the card is closed, reformatted, or switched between
+		 * read-only and read-write in the meantime.
+		 *
+		 * NOTE: The block data must not be modified.
+		 * Use writeBlock() to write to the card.
+		 */
+		class MappedImage
+		{
+			public:
+				MappedImage() { }
+
+				/**
+				 * Is this a null MappedImage?
+				 * @return True if the card image isn't mapped.
+				 */
+				bool isNull(void) const { return d.isNull(); }
+
+				/**
+				 * Get a pointer to a block.
+				 * @param blockIdx Block index.
+				 * @return Pointer to the block, or nullptr if the image is null or blockIdx is out of range.
+				 */
+				const uint8_t *block(uint16_t blockIdx) const;
+
+			private:
+				friend class Card;
+				friend class CardPrivate;
+				struct Data;
+				QSharedPointer<const Data> d;
+		};
+
+		/**
+		 * Get the memory-mapped card image.
+		 *
+		 * This avoids copying the block data when scanning the card.
+		 * Keep the MappedImage for as long as its block pointers are used.
+		 *
+		 * @return Memory-mapped card image, or null MappedImage if the card isn't mapped.
+		 */
+		MappedImage mappedImage(void) const;
+
+		/**
+		 * Indicate that the card will be read sequentially, e.g. during a scan.
+		 * This is only a hint; it may be ignored on some systems.
+		 * @param sequential True to enable sequential access; false to restore normal access.
+		 */
+		void setSequentialAccessHint(bool sequential);
+
 		/** File management **/
 	signals:
 		/**
@@ -14,6 +14,7 @@
 // Qt includes.
 #include <QtCore/QFile>
 #include <QtCore/QFlags>
+#include <QtCore/QMutex>
 #include <QtCore/QString>
 #include <QtCore/QVector>
 #include <QtGui/QPixmap>
@@ -60,6 +61,16 @@ class CardPrivate
 		bool readOnly;
 		bool canMakeWritable;	// subclass should set this
 
+		// Memory-mapped card image.
+		// Null if the file couldn't be mapped.
+		// NOTE: The mapping is always treated as read-only.
+		// Writes go through the QFile and are flushed so the
+		// mapping stays coherent.
+		// The mapping is guarded by mappingMutex, since it may be
+		// copied by worker threads, e.g. GcnSearchWorker.
+		Card::MappedImage mapping;
+		mutable QMutex mappingMutex;
+
 		// Card properties.
 		Card::Encoding encoding;
 		QColor color;
@@ -136,6 +147,30 @@ class CardPrivate
 		 */
 		void close(void);
 
+		/**
+		 * Map the card image into memory.
+		 * If mmap() fails, the mapping is set to a null MappedImage,
+		 * and the QFile will be used for reading.
+		 * Any existing mapping is released first.
+		 */
+		void mapFile(void);
+
+		/**
+		 * Release the memory-mapped card image.
+		 * The mapping is unmapped once all
+		 * MappedImage references are released.
+		 */
+		void unmapFile(void);
+
+		/**
+		 * Get the memory-mapped card image.
+		 * @return Memory-mapped card image, or null MappedImage if not mapped.
+		 */
+		inline Card::MappedImage mappedImage(void) const {
+			QMutexLocker locker(&mappingMutex);
+			return mapping;
+		}
+
 		/**
 		 * Find the most common byte in a block of data.
 		 * This is useful for determining header garbage.
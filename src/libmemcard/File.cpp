@@ -18,6 +18,7 @@
 // C includes. (C++ namespace)
 #include <cerrno>
 #include <cassert>
+#include <cstring>
 
 // C++ includes.
 #include <string>
@@ -30,6 +31,9 @@ using std::vector;
 #include <QtCore/QTextCodec>
 #include <QtCore/QFile>
 #include <QtCore/QIODevice>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QRunnable>
+#include <QtCore/QThreadPool>
 
 #define NUM_ELEMENTS(x) ((int)(sizeof(x) / sizeof(x[0])))
 
@@ -44,13 +48,17 @@ FilePrivate::FilePrivate(File *q, Card *card)
 	: q_ptr(q)
 	, card(card)
 	, mode(0)
-	, gcBanner(nullptr)
 	, iconAnimMode(0)
+	, iconMask(0)
+	, imagesLoaded(false)
+	, gcBanner(nullptr)
+	, pixmapsLoaded(false)
 	, lostFile(false)
 { }
 
 FilePrivate::~FilePrivate()
 {
+	// NOTE: cancelPrefetch() was called by ~File().
 	// Delete the GcImages.
 	delete gcBanner;
 	qDeleteAll(gcIcons);
@@ -88,29 +96,18 @@ uint16_t FilePrivate::fileBlockAddrToPhysBlockAddr(uint16_t fileBlock) const
  */
 QByteArray FilePrivate::loadFileData(void)
 {
-	// TODO: Combine with readBlocks()?
-	// TODO: Add a generic read() function?
-	const int blockSize = card->blockSize();
 	if (this->size() > card->totalUserBlocks()) {
 		// File is larger than the card.
 		// This shouldn't happen...
 		return QByteArray();
 	}
 
-	QByteArray fileData;
-	// FIXME: Optimize blockSize multiplication by using shifts.
-	fileData.resize(this->size() * blockSize);
-
-	uint8_t *fileDataPtr = (uint8_t*)fileData.data();
-	for (int i = 0; i < this->size(); i++, fileDataPtr += blockSize) {
-		const uint16_t physBlockAddr = fileBlockAddrToPhysBlockAddr(i);
-		card->readBlock(fileDataPtr, blockSize, physBlockAddr);
-	}
-	return fileData;
+	return readBlocks(0, this->size());
 }
 
 /**
  * Read the specified range from the file.
+ * Physically contiguous blocks are read using a single read.
  * @param blockStart First block.
  * @param len Length, in blocks.
  * @return QByteArray with file data, or empty QByteArray on error.
@@ -118,33 +115,127 @@ QByteArray FilePrivate::loadFileData(void)
 QByteArray FilePrivate::readBlocks(uint16_t blockStart, int len)
 {
 	// Check if the starting block is valid.
-	if (blockStart >= this->size()) {
+	if (blockStart >= this->size() || len <= 0) {
 		// Starting block is larger than the filesize.
 		return QByteArray();
 	}
 
 	// Check if the length is valid.
-	// FIXME: Check for overflow?
-	uint16_t blockEnd = (uint16_t)(blockStart + len);
-	if (blockEnd > this->size()) {
+	if (len > this->size() - blockStart) {
 		// Reading too much data.
 		// Truncate it to the available data.
-		blockEnd = this->size();
-		len = (uint16_t)(this->size() - blockStart);
+		len = this->size() - blockStart;
 	}
 
 	const int blockSize = card->blockSize();
 	QByteArray blockData;
 	blockData.resize(len * blockSize);
 
-	uint8_t *blockDataPtr = (uint8_t*)blockData.data();
-	for (int i = 0; i < len; i++, blockDataPtr += blockSize) {
-		const uint16_t physBlockAddr = fileBlockAddrToPhysBlockAddr(i);
-		card->readBlock(blockDataPtr, blockSize, physBlockAddr);
-	}
+	// NOTE: Blocks that couldn't be read are zero-filled.
+	// Lost files may have bad blocks, so this isn't an error.
+	card->readBlocks(blockData.data(), blockData.size(), fatEntries.mid(blockStart, len));
 	return blockData;
 }
 
+/**
+ * Read the specified byte range from the file.
+ * @param address Address to read from.
+ * @param length Amount of data to read, in bytes.
+ * @return QByteArray with file data, or empty QByteArray on error.
+ */
+QByteArray FilePrivate::readData(uint32_t address, uint32_t length)
+{
+	if (length == 0)
+		return QByteArray();
+
+	const int blockSize = card->blockSize();
+	const uint16_t blockStart = (uint16_t)(address / blockSize);
+	const int len = (int)((address + length - 1) / blockSize) - blockStart + 1;
+	const QByteArray blockData = readBlocks(blockStart, len);
+	return blockData.mid(address % blockSize, length);
+}
+
+/**
+ * Write data to the file.
+ * This doesn't update the checksums.
+ * NOTE: The range must have already been validated.
+ * @param address Address to write to.
+ * @param data Data to write.
+ * @param length Amount of data to write, in bytes.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int FilePrivate::writeData(uint32_t address, const uint8_t *data, uint32_t length)
+{
+	const uint8_t *data_u8 = data;
+	const int blockSize = card->blockSize();
+
+	// Temporary block buffer.
+	// NOTE: Only resized (allocated) if necessary.
+	std::vector<uint8_t> block;
+
+	// Check if we're not starting on a block boundary.
+	const uint32_t blockStartOffset = (address % blockSize);
+	if (blockStartOffset != 0) {
+		// Not a block boundary.
+		// Read the block first.
+		block.resize(blockSize);
+		const uint16_t physBlockStartIdx = fileBlockAddrToPhysBlockAddr(address / blockSize);
+		card->readBlock(block.data(), blockSize, physBlockStartIdx);
+
+		// Bytes remaining in the block.
+		const uint32_t remaining = blockSize - (blockStartOffset);
+		if (length <= remaining) {
+			// This is the only block being written.
+			memcpy(block.data() + blockStartOffset, data_u8, length);
+			card->writeBlock(block.data(), blockSize, physBlockStartIdx);
+			// FIXME: Trigger card metadata update.
+			return 0;
+		}
+
+		// Write 'remaining' bytes worth of data.
+		memcpy(block.data() + blockStartOffset, data_u8, remaining);
+		card->writeBlock(block.data(), blockSize, physBlockStartIdx);
+
+		// Adjust for the remaining blocks.
+		address += remaining;
+		data_u8 += remaining;
+		length -= remaining;
+	}
+
+	// Write entire blocks.
+	// Physically contiguous blocks are written using a single write.
+	const int fullBlocks = (int)(length / blockSize);
+	if (fullBlocks > 0) {
+		const uint32_t fullLength = (uint32_t)fullBlocks * blockSize;
+		int ret = card->writeBlocks(data_u8, (int)fullLength,
+			fatEntries.mid(address / blockSize, fullBlocks));
+		if (ret < 0)
+			return ret;
+		else if (ret != (int)fullLength)
+			return -EIO;
+
+		address += fullLength;
+		data_u8 += fullLength;
+		length -= fullLength;
+	}
+
+	// Check if we still have data left (not a full block).
+	if (length != 0) {
+		// Not a full block.
+		// Read the block first.
+		block.resize(blockSize);
+		const uint16_t physBlockEndIdx = fileBlockAddrToPhysBlockAddr(address / blockSize);
+		card->readBlock(block.data(), blockSize, physBlockEndIdx);
+
+		// Copy data into the block and write it back.
+		memcpy(block.data(), data_u8, length);
+		card->writeBlock(block.data(), blockSize, physBlockEndIdx);
+	}
+
+	// Data written successfully.
+	return 0;
+}
+
 /**
  * Strip invalid DOS characters from a filename.
  * @param filename Filename.
@@ -240,28 +331,122 @@ QString FilePrivate::decodeText_SJISorCP1252(const char *str, int len)
 /** Images **/
 
 /**
- * Load the banner and icon images.
- * TODO: Move to File?
+ * Image prefetch state.
+ * Shared with the prefetch task, so it outlives the File.
+ */
+struct FileImagePrefetchState {
+	// Locked while the task is decoding,
+	// so cancelPrefetch() can wait for it.
+	QMutex mutex;
+	FilePrivate *d;
+
+	explicit FileImagePrefetchState(FilePrivate *d)
+		: d(d) { }
+};
+
+/**
+ * Decode a file's images on a thread pool.
+ * The image data is copied from the memory-mapped card image,
+ * so the task never accesses the Card.
+ */
+class FileImagePrefetchTask : public QRunnable
+{
+	public:
+		FileImagePrefetchTask(const QSharedPointer<FileImagePrefetchState> &state,
+			const Card::MappedImage &mapping, const QVector<uint16_t> &blockList,
+			int blockSize, const FilePrivate::ImageDataRange &range)
+			: state(state)
+			, mapping(mapping)
+			, blockList(blockList)
+			, blockSize(blockSize)
+			, range(range)
+		{ }
+
+		void run(void) final
+		{
+			// Copy the image data blocks.
+			// NOTE: Blocks that aren't mapped are zero-filled,
+			// same as Card::readBlocks().
+			QByteArray imgData(blockList.size() * blockSize, Qt::Uninitialized);
+			char *const data = imgData.data();
+			for (int i = 0; i < blockList.size(); i++) {
+				const uint8_t *const block = mapping.block(blockList.at(i));
+				if (block) {
+					memcpy(&data[i * blockSize], block, blockSize);
+				} else {
+					memset(&data[i * blockSize], 0, blockSize);
+				}
+			}
+			FilePrivate::extractImageData(imgData, range);
+
+			QMutexLocker locker(&state->mutex);
+			FilePrivate *const d = state->d;
+			if (!d) {
+				// File was deleted.
+				return;
+			}
+
+			QMutexLocker imageLocker(&d->imageMutex);
+			if (!d->imagesLoaded) {
+				d->decodeImages(imgData);
+			}
+		}
+
+	private:
+		const QSharedPointer<FileImagePrefetchState> state;
+		const Card::MappedImage mapping;
+		const QVector<uint16_t> blockList;
+		const int blockSize;
+		const FilePrivate::ImageDataRange range;
+};
+
+/**
+ * Get the number of icons, as indicated by iconMask.
+ * @return Number of icons.
+ */
+int FilePrivate::iconCount(void) const
+{
+	int count = 0;
+	for (unsigned int mask = iconMask; mask != 0; mask >>= 1) {
+		count++;
+	}
+	return count;
+}
+
+/**
+ * Decode the banner and icon images if they haven't been decoded yet.
+ * This reads from the card, so it must be called from the card's thread.
  */
 void FilePrivate::loadImages(void)
 {
-	// Load the banner.
-	this->gcBanner = loadBannerImage();
+	QMutexLocker locker(&imageMutex);
+	if (imagesLoaded)
+		return;
+	decodeImages(readImageData());
+}
+
+/**
+ * Convert the banner and icon images to QPixmap if they haven't been converted yet.
+ * This must be called from the GUI thread.
+ */
+void FilePrivate::loadPixmaps(void)
+{
+	if (pixmapsLoaded)
+		return;
+	loadImages();
+	pixmapsLoaded = true;
+
+	// NOTE: The GcImages won't change once loaded,
+	// so they can be used without locking.
+
+	// Convert the banner.
 	if (gcBanner) {
-		// Set the new banner image.
 		QImage qBanner = gcImageToQImage(gcBanner);
 		if (!qBanner.isNull())
 			banner = QPixmap::fromImage(qBanner);
-		else
-			banner = QPixmap();
-	} else {
-		// No banner image.
-		banner = QPixmap();
 	}
 
-	// Load the icons.
-	this->gcIcons = loadIconImages();
-	icons.clear();
+	// Convert the icons.
 	icons.reserve(gcIcons.size());
 	foreach (GcImage *gcIcon, gcIcons) {
 		if (gcIcon) {
@@ -277,156 +462,172 @@ void FilePrivate::loadImages(void)
 	}
 }
 
-/** Checksums **/
-
 /**
- * Calculate the file checksum.
+ * Decode the banner and icon images on a thread pool.
+ * The pool copies the image data from the memory-mapped
+ * card image, so the card isn't read on this thread.
+ * If the card isn't mapped, nothing is prefetched,
+ * and the images are decoded on first use.
+ * @param threadPool Thread pool.
  */
-void FilePrivate::calculateChecksum(void)
+void FilePrivate::prefetchImages(QThreadPool *threadPool)
 {
-	checksumValues.clear();
+	if (prefetchState)
+		return;
 
-	if (checksumDefs.empty()) {
-		// No checksum definitions were set.
+	{
+		QMutexLocker locker(&imageMutex);
+		if (imagesLoaded)
+			return;
+	}
+
+	const Card::MappedImage mapping = card->mappedImage();
+	if (mapping.isNull()) {
+		// Card isn't mapped.
 		return;
 	}
 
-	// Load the file data.
-	QByteArray fileData = loadFileData();
-	if (fileData.isEmpty()) {
-		// File is empty.
+	const ImageDataRange range = imageDataRange();
+	if (range.blockCount <= 0) {
+		// No image data.
 		return;
 	}
 
-	// Pointer to fileData's internal data array.
-	uint8_t *data = reinterpret_cast<uint8_t*>(fileData.data());
+	prefetchState.reset(new FileImagePrefetchState(this));
+	threadPool->start(new FileImagePrefetchTask(prefetchState, mapping,
+		fatEntries.mid(range.blockStart, range.blockCount),
+		card->blockSize(), range));
+}
 
-	// Process all of the checksum definitions.
-	for (int i = 0; i < (int)checksumDefs.size(); i++) {
-		const Checksum::ChecksumDef &checksumDef = checksumDefs.at(i);
+/**
+ * Cancel the image prefetch task.
+ * If the task is running, this waits for it to finish.
+ * This must be called before the subclass is destroyed.
+ */
+void FilePrivate::cancelPrefetch(void)
+{
+	if (!prefetchState)
+		return;
 
-		if (checksumDef.algorithm == Checksum::CHKALG_NONE ||
-		    checksumDef.algorithm >= Checksum::CHKALG_MAX ||
-		    checksumDef.length == 0)
-		{
-			// No algorithm or invalid algorithm set,
-			// or the checksum data has no length.
-			continue;
-		}
+	QMutexLocker locker(&prefetchState->mutex);
+	prefetchState->d = nullptr;
+}
 
-		// Make sure the checksum definition is in range.
-		if (fileData.size() < (int)checksumDef.address ||
-		    fileData.size() < (int)(checksumDef.start + checksumDef.length))
-		{
-			// File is too small...
-			// TODO: Also check the size of the checksum itself.
-			continue;
-		}
+/**
+ * Extract the image data from the blocks in an ImageDataRange.
+ * @param blockData	[in/out] Data from range's blocks; replaced with the image data.
+ * @param range		[in] Image data range.
+ */
+void FilePrivate::extractImageData(QByteArray &blockData, const ImageDataRange &range)
+{
+	blockData.remove(0, range.offset);
+	if (range.length >= 0) {
+		blockData.truncate(range.length);
+	}
+}
 
-		// Get the expected checksum.
-		// NOTE: Assuming big-endian for all values.
-		uint32_t expected = 0;
-		Checksum::ChaoGardenChecksumData chaoChk_orig;
-
-		// Use Exec() for most algorithms.
-		// Some unusual ones need to be run manually.
-		bool useExec = true;
-
-		const char *const start = (fileData.constData() + checksumDef.start);
-		uint32_t actual = 0;
-
-		switch (checksumDef.algorithm) {
-			case Checksum::CHKALG_CRC16:
-			case Checksum::CHKALG_DREAMCASTVMU:
-				if (checksumDef.endian != Checksum::CHKENDIAN_LITTLE) {
-					// Big-endian.
-					expected = (data[checksumDef.address+0] << 8) |
-						   (data[checksumDef.address+1]);
-				} else {
-					// Little-endian.
-					expected = (data[checksumDef.address+1] << 8) |
-						   (data[checksumDef.address+0]);
-				}
-				break;
+/**
+ * Read the banner and icon image data from the card.
+ * @return Image data, or empty QByteArray on error.
+ */
+QByteArray FilePrivate::readImageData(void)
+{
+	const ImageDataRange range = imageDataRange();
+	if (range.blockCount <= 0) {
+		// No image data.
+		return QByteArray();
+	}
 
-			case Checksum::CHKALG_CRC32:
-			case Checksum::CHKALG_ADDINVDUAL16:
-			case Checksum::CHKALG_ADDBYTES32:
-				if (checksumDef.endian != Checksum::CHKENDIAN_LITTLE) {
-					// Big-endian.
-					expected = (data[checksumDef.address+0] << 24) |
-						   (data[checksumDef.address+1] << 16) |
-						   (data[checksumDef.address+2] << 8) |
-						   (data[checksumDef.address+3]);
-				} else {
-					// Little-endian.
-					expected = (data[checksumDef.address+3] << 24) |
-						   (data[checksumDef.address+2] << 16) |
-						   (data[checksumDef.address+1] << 8) |
-						   (data[checksumDef.address+0]);
-				}
-				break;
+	QByteArray imgData = readBlocks(range.blockStart, range.blockCount);
+	extractImageData(imgData, range);
+	return imgData;
+}
 
-			case Checksum::CHKALG_SONICCHAOGARDEN: {
-				memcpy(&chaoChk_orig, &data[checksumDef.address], sizeof(chaoChk_orig));
-
-				// Temporary working copy.
-				Checksum::ChaoGardenChecksumData chaoChk = chaoChk_orig;
-				if (checksumDef.endian != Checksum::CHKENDIAN_LITTLE) {
-					// Big-endian.
-					expected = (chaoChk.checksum_3 << 24) |
-						   (chaoChk.checksum_2 << 16) |
-						   (chaoChk.checksum_1 << 8) |
-						   (chaoChk.checksum_0);
-				} else {
-					// Little-endian.
-					// TODO: Is this correct?
-					expected = (chaoChk.checksum_0 << 24) |
-						   (chaoChk.checksum_1 << 16) |
-						   (chaoChk.checksum_2 << 8) |
-						   (chaoChk.checksum_3);
-				}
+/**
+ * Decode the banner and icon images.
+ * NOTE: imageMutex must be locked by the caller.
+ * @param imgData Image data from readImageData().
+ */
+void FilePrivate::decodeImages(const QByteArray &imgData)
+{
+	gcBanner = decodeBannerImage(imgData);
+	gcIcons = decodeIconImages(imgData);
+	imagesLoaded = true;
+}
 
-				// Clear some fields that must be 0 when calculating the checksum.
-				chaoChk.checksum_3 = 0;
-				chaoChk.checksum_2 = 0;
-				chaoChk.checksum_1 = 0;
-				chaoChk.checksum_0 = 0;
-				chaoChk.random_3 = 0;
-				memcpy(&data[checksumDef.address], &chaoChk, sizeof(chaoChk));
-				break;
-			}
+/** Checksums **/
 
-			case Checksum::CHKALG_POKEMONXD:
-				// Pokémon XD has a more complicated checksum.
-				useExec = false;
-				actual = Checksum::PokemonXD(reinterpret_cast<const uint8_t*>(start),
-					checksumDef.length, checksumDef.address, &expected);
-				break;
+/**
+ * Calculate the file checksum.
+ */
+void FilePrivate::calculateChecksum(void)
+{
+	checksumValues.clear();
 
-			case Checksum::CHKALG_NONE:
-			default:
-				// Unsupported algorithm.
-				expected = 0;
-				break;
-		}
+	if (!checksumPlan || checksumPlan->isEmpty()) {
+		// No checksum definitions were set.
+		return;
+	}
 
-		if (useExec) {
-			// Use Checksum::Exec().
-			actual = Checksum::Exec(checksumDef.algorithm,
-				start, checksumDef.length, checksumDef.endian, checksumDef.param);
-		}
+	if (this->size() <= 0 || this->size() > card->totalUserBlocks()) {
+		// File is empty, or is larger than the card.
+		return;
+	}
 
-		if (checksumDef.algorithm == Checksum::CHKALG_SONICCHAOGARDEN) {
-			// Restore the Chao Garden checksum data.
-			memcpy(&data[checksumDef.address], &chaoChk_orig, sizeof(chaoChk_orig));
+	const int blockSize = card->blockSize();
+	const uint32_t fileSize = (uint32_t)this->size() * (uint32_t)blockSize;
+	const std::vector<ChecksumPlan::Range> ranges = checksumPlan->ranges(fileSize);
+	if (ranges.empty()) {
+		// No checksum definitions fit in the file.
+		return;
+	}
+
+	// Read only the blocks covered by the checksums.
+	// NOTE: The rest of the buffer is left uninitialized,
+	// since the checksum plan won't access it.
+	QByteArray fileData(fileSize, Qt::Uninitialized);
+	uint8_t *const data = reinterpret_cast<uint8_t*>(fileData.data());
+	int nextBlock = 0;
+	for (auto iter = ranges.cbegin(); iter != ranges.cend(); ++iter) {
+		int blockStart = (int)(iter->start / blockSize);
+		const int blockEnd = (int)((iter->end - 1) / blockSize) + 1;
+		if (blockStart < nextBlock) {
+			// First block was already read by the previous range.
+			blockStart = nextBlock;
 		}
+		if (blockStart >= blockEnd)
+			continue;
 
-		// Save the checksums.
-		Checksum::ChecksumValue checksumValue;
-		checksumValue.expected = expected;
-		checksumValue.actual = actual;
-		checksumValues.push_back(checksumValue);
+		const int len = blockEnd - blockStart;
+		card->readBlocks(&data[blockStart * blockSize], len * blockSize,
+			fatEntries.mid(blockStart, len));
+		nextBlock = blockEnd;
+	}
+
+	const std::vector<Checksum::ChecksumValue> values = checksumPlan->exec(data, fileSize);
+	checksumValues = QVector<Checksum::ChecksumValue>::fromStdVector(values);
+}
+
+/**
+ * Update the file checksum after part of the file has changed.
+ * @param address Address of the changed data.
+ * @param oldData Original data.
+ * @param newData New data.
+ * @param length Length of the changed data, in bytes.
+ */
+void FilePrivate::updateChecksum(uint32_t address, const uint8_t *oldData, const uint8_t *newData, uint32_t length)
+{
+	if (!checksumPlan || checksumValues.isEmpty())
+		return;
+
+	// Only the changed bytes need to be processed,
+	// unless an algorithm can't be updated incrementally.
+	const uint32_t fileSize = (uint32_t)this->size() * (uint32_t)card->blockSize();
+	std::vector<Checksum::ChecksumValue> values = checksumValues.toStdVector();
+	if (checksumPlan->update(values, fileSize, address, oldData, newData, length)) {
+		checksumValues = QVector<Checksum::ChecksumValue>::fromStdVector(values);
+	} else {
+		calculateChecksum();
 	}
 }
 
@@ -453,6 +654,9 @@ File::File(FilePrivate *d, Card *card)
 File::~File()
 {
 	Q_D(File);
+	// The prefetch task uses the subclass's FilePrivate,
+	// so it must be cancelled before anything is destroyed.
+	d->cancelPrefetch();
 	delete d;
 }
 
@@ -490,10 +694,14 @@ QByteArray File::loadFileData(void)
  * Write data to the file.
  * NOTE: This function cannot expand files at the moment.
  * Length+size must be <= total file size.
+ *
+ * If checksum definitions are set, the checksum values
+ * are updated to reflect the new data.
+ *
  * @param address Address to write to.
  * @param data Data to write.
  * @param length Amount of data to write, in bytes.
- * @return Bytes written on success; negative POSIX error code on error.
+ * @return 0 on success; negative POSIX error code on error.
  */
 int File::write(uint32_t address, const void *const data, uint32_t length)
 {
@@ -501,67 +709,35 @@ int File::write(uint32_t address, const void *const data, uint32_t length)
 		return -EROFS;
 
 	Q_D(File);
-	const uint8_t *data_u8 = static_cast<const uint8_t*>(data);
-	const int blockSize = d->card->blockSize();
+	const uint8_t *const data_u8 = static_cast<const uint8_t*>(data);
+	const uint32_t fileSize = (uint32_t)d->size() * (uint32_t)d->card->blockSize();
 
 	// Make sure address + length <= file size.
-	if (address + length > d->size() * blockSize)
+	if ((uint64_t)address + length > fileSize)
 		return -ERANGE;
-
-	// Temporary block buffer.
-	// NOTE: Only resized (allocated) if necessary.
-	std::vector<uint8_t> block;
-
-	// Check if we're not starting on a block boundary.
-	const uint32_t blockStartOffset = (address % blockSize);
-	if (blockStartOffset != 0) {
-		// Not a block boundary.
-		// Read the block first.
-		block.resize(blockSize);
-		const uint16_t physBlockStartIdx = d->fileBlockAddrToPhysBlockAddr(address / blockSize);
-		d->card->readBlock(block.data(), blockSize, physBlockStartIdx);
-
-		// Bytes remaining in the block.
-		const uint32_t remaining = blockSize - (blockStartOffset);
-		if (length <= remaining) {
-			// This is the only block being written.
-			memcpy(block.data() + blockStartOffset, data_u8, length);
-			d->card->writeBlock(block.data(), blockSize, physBlockStartIdx);
-			// FIXME: Trigger card metadata update.
-			return 0;
-		}
-
-		// Write 'remaining' bytes worth of data.
-		memcpy(block.data() + blockStartOffset, data_u8, remaining);
-		d->card->writeBlock(block.data(), blockSize, physBlockStartIdx);
-
-		// Adjust for the remaining blocks.
-		address += remaining;
-		data_u8 += remaining;
-		length -= remaining;
+	if (length == 0)
+		return 0;
+
+	// If checksums were calculated, save the original data
+	// so the checksums can be updated incrementally.
+	QByteArray oldData;
+	if (!d->checksumValues.isEmpty()) {
+		oldData = d->readData(address, length);
 	}
 
-	// Write entire blocks.
-	for (; length >= (uint32_t)blockSize; length -= blockSize, data_u8 += blockSize, address += blockSize) {
-		const uint16_t physBlockIdx = d->fileBlockAddrToPhysBlockAddr(address / blockSize);
-		d->card->writeBlock(data, blockSize, physBlockIdx);
-	}
-
-	// Check if we still have data left (not a full block).
-	if (length != 0) {
-		// Not a full block.
-		// Read the block first.
-		block.resize(blockSize);
-		const uint16_t physBlockEndIdx = d->fileBlockAddrToPhysBlockAddr(address / blockSize);
-		d->card->readBlock(block.data(), blockSize, physBlockEndIdx);
-
-		// Copy data into the block and write it back.
-		memcpy(block.data(), data_u8, length);
-		d->card->writeBlock(block.data(), blockSize, physBlockEndIdx);
+	int ret = d->writeData(address, data_u8, length);
+	if (!d->checksumValues.isEmpty()) {
+		if (ret != 0 || oldData.size() != (int)length) {
+			// Write failed, so the file may be partially written.
+			d->calculateChecksum();
+		} else {
+			d->updateChecksum(address,
+				reinterpret_cast<const uint8_t*>(oldData.constData()),
+				data_u8, length);
+		}
+		emit checksumValuesChanged();
 	}
-
-	// Data written successfully.
-	return 0;
+	return ret;
 }
 
 /**
@@ -623,37 +799,75 @@ int File::size(void) const
 
 /**
  * Get the banner image.
+ * The banner is decoded on first use.
  * @return Banner image, or null QPixmap on error.
  */
 QPixmap File::banner(void) const
 {
 	Q_D(const File);
+	// NOTE: Images are loaded on demand.
+	const_cast<FilePrivate*>(d)->loadPixmaps();
 	return d->banner;
 }
 
 /**
  * Get the number of icons in the file.
+ * This doesn't require decoding the icons.
  * @return Number of icons.
  */
 int File::iconCount(void) const
 {
 	Q_D(const File);
-	return d->icons.size();
+	return d->iconCount();
+}
+
+/**
+ * Is an icon present?
+ * This doesn't require decoding the icons.
+ * @param idx Icon number.
+ * @return True if the icon is present; false if not.
+ */
+bool File::hasIcon(int idx) const
+{
+	Q_D(const File);
+	if (idx < 0 || idx >= 8)
+		return false;
+	return !!(d->iconMask & (1U << idx));
 }
 
 /**
  * Get an icon from the file.
+ * The icons are decoded on first use.
  * @param idx Icon number.
  * @return Icon, or null QPixmap on error.
  */
 QPixmap File::icon(int idx) const
 {
+	if (!hasIcon(idx))
+		return QPixmap();
+
 	Q_D(const File);
-	if (idx < 0 || idx >= d->icons.size())
+	// NOTE: Images are loaded on demand.
+	const_cast<FilePrivate*>(d)->loadPixmaps();
+	if (idx >= d->icons.size())
 		return QPixmap();
 	return d->icons.at(idx);
 }
 
+/**
+ * Decode the banner and icons in the background.
+ * The image data is read immediately, but decoding
+ * is done by the thread pool. If the images are
+ * needed before decoding finishes, they'll be
+ * decoded on demand instead.
+ * @param threadPool Thread pool.
+ */
+void File::prefetchImages(QThreadPool *threadPool)
+{
+	Q_D(File);
+	d->prefetchImages(threadPool);
+}
+
 /**
  * Get the delay for a given icon.
  * FIXME: Make this use system-independent values.
@@ -730,10 +944,11 @@ int File::exportToFile(const QString &filename)
  */
 int File::saveBanner(const QString &filenameNoExt) const
 {
-	Q_D(const File);
 	// TODO: Make GcImageWriter more generic and move the
 	// internal image data here.
-	if (d->banner.isNull())
+	Q_D(const File);
+	const_cast<FilePrivate*>(d)->loadImages();
+	if (!d->gcBanner)
 		return -EINVAL;
 
 	// Append the correct extension.
@@ -770,6 +985,7 @@ int File::saveBanner(const QString &filenameNoExt) const
 int File::saveBanner(QIODevice *qioDevice) const
 {
 	Q_D(const File);
+	const_cast<FilePrivate*>(d)->loadImages();
 	if (!d->gcBanner)
 		return -EINVAL;
 
@@ -798,6 +1014,7 @@ int File::saveIcon(const QString &filenameNoExt,
 	GcImageWriter::AnimImageFormat animImgf) const
 {
 	Q_D(const File);
+	const_cast<FilePrivate*>(d)->loadImages();
 	if (d->gcIcons.isEmpty())
 		return -EINVAL;
 
@@ -916,7 +1133,52 @@ void File::setChecksumDefs(const QVector<Checksum::ChecksumDef> &checksumDefs)
 {
 	Q_D(File);
 	d->checksumDefs = checksumDefs;
+	d->checksumPlan.reset(new ChecksumPlan(checksumDefs.toStdVector()));
+	d->calculateChecksum();
+	emit checksumValuesChanged();
+}
+
+/**
+ * Set the checksum definitions from a precompiled ChecksumPlan.
+ * This is faster than setChecksumDefs() if the same
+ * definitions are used for multiple files.
+ * @param checksumPlan Checksum plan. (may be nullptr)
+ */
+void File::setChecksumPlan(const QSharedPointer<const ChecksumPlan> &checksumPlan)
+{
+	Q_D(File);
+	d->checksumPlan = checksumPlan;
+	if (checksumPlan) {
+		d->checksumDefs = QVector<Checksum::ChecksumDef>::fromStdVector(
+			checksumPlan->checksumDefs());
+	} else {
+		d->checksumDefs.clear();
+	}
 	d->calculateChecksum();
+	emit checksumValuesChanged();
+}
+
+/**
+ * Set the checksum definitions from a precompiled ChecksumPlan,
+ * along with checksum values that were already calculated,
+ * e.g. by an integrity audit running in another thread.
+ * @param checksumPlan Checksum plan. (may be nullptr)
+ * @param checksumValues Checksum values, as returned by ChecksumPlan::exec().
+ */
+void File::setChecksumPlan(const QSharedPointer<const ChecksumPlan> &checksumPlan,
+	const QVector<Checksum::ChecksumValue> &checksumValues)
+{
+	Q_D(File);
+	d->checksumPlan = checksumPlan;
+	if (checksumPlan) {
+		d->checksumDefs = QVector<Checksum::ChecksumDef>::fromStdVector(
+			checksumPlan->checksumDefs());
+		d->checksumValues = checksumValues;
+	} else {
+		d->checksumDefs.clear();
+		d->checksumValues.clear();
+	}
+	emit checksumValuesChanged();
 }
 
 /**
@@ -952,6 +1214,47 @@ Checksum::ChkStatus File::checksumStatus(void) const
 	return Checksum::ChecksumStatus(d->checksumValues.toStdVector());
 }
 
+/**
+ * Fix invalid stored checksums by writing the actual checksums to the file.
+ * Checksums that cover other stored checksums are handled by
+ * repeating until all checksums are valid.
+ *
+ * NOTE: Pokémon XD checksums are encrypted with the data,
+ * so they can't be fixed. Check checksumStatus() afterwards.
+ *
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int File::fixChecksums(void)
+{
+	if (isReadOnly())
+		return -EROFS;
+
+	Q_D(File);
+	if (!d->checksumPlan || d->checksumValues.isEmpty()) {
+		// No checksums.
+		return 0;
+	}
+
+	// Each pass fixes at least one checksum, unless
+	// the checksums depend on each other in a loop.
+	const uint32_t fileSize = (uint32_t)d->size() * (uint32_t)d->card->blockSize();
+	for (int pass = d->checksumValues.size(); pass >= 0; pass--) {
+		const std::vector<ChecksumPlan::Patch> patches =
+			d->checksumPlan->patches(d->checksumValues.toStdVector(), fileSize);
+		if (patches.empty())
+			break;
+
+		// NOTE: write() updates the checksum values.
+		for (auto iter = patches.cbegin(); iter != patches.cend(); ++iter) {
+			int ret = write(iter->address, iter->data, iter->length);
+			if (ret != 0)
+				return ret;
+		}
+	}
+
+	return 0;
+}
+
 /**
  * Format checksum values as HTML for display purposes.
  * @return QVector containing one or two HTML strings.
@@ -16,14 +16,17 @@
 
 // Checksums.
 #include "Checksum.hpp"
+class ChecksumPlan;
 
 // Qt includes.
 #include <QtCore/QDateTime>
 #include <QtCore/QObject>
+#include <QtCore/QSharedPointer>
 #include <QtCore/QString>
 #include <QtCore/QVector>
 #include <QtCore/QIODevice>
 #include <QtGui/QPixmap>
+class QThreadPool;
 
 class FilePrivate;
 class File : public QObject
@@ -114,10 +117,14 @@ class File : public QObject
 		 * Write data to the file.
 		 * NOTE: This function cannot expand files at the moment.
 		 * Length+size must be <= total file size.
+		 *
+		 * If checksum definitions are set, the checksum values
+		 * are updated to reflect the new data.
+		 *
 		 * @param address Address to write to.
 		 * @param data Data to write.
 		 * @param length Amount of data to write, in bytes.
-		 * @return Bytes written on success; negative POSIX error code on error.
+		 * @return 0 on success; negative POSIX error code on error.
 		 */
 		int write(uint32_t address, const void *data, uint32_t length);
 
@@ -190,6 +197,14 @@ class File : public QObject
 		 */
 		int iconCount(void) const;
 
+		/**
+		 * Is an icon present?
+		 * This doesn't require decoding the icons.
+		 * @param idx Icon number.
+		 * @return True if the icon is present; false if not.
+		 */
+		bool hasIcon(int idx) const;
+
 		/**
 		 * Get an icon from the file.
 		 * @param idx Icon number.
@@ -214,6 +229,16 @@ class File : public QObject
 		 */
 		int iconAnimMode(void) const;
 
+		/**
+		 * Decode the banner and icons in the background.
+		 * The image data is read immediately, but decoding
+		 * is done by the thread pool. If the images are
+		 * needed before decoding finishes, they'll be
+		 * decoded on demand instead.
+		 * @param threadPool Thread pool.
+		 */
+		void prefetchImages(QThreadPool *threadPool);
+
 	public:
 		/** Lost File information **/
 
@@ -292,6 +317,24 @@ class File : public QObject
 		 */
 		void setChecksumDefs(const QVector<Checksum::ChecksumDef> &checksumDefs);
 
+		/**
+		 * Set the checksum definitions from a precompiled ChecksumPlan.
+		 * This is faster than setChecksumDefs() if the same
+		 * definitions are used for multiple files.
+		 * @param checksumPlan Checksum plan. (may be nullptr)
+		 */
+		void setChecksumPlan(const QSharedPointer<const ChecksumPlan> &checksumPlan);
+
+		/**
+		 * Set the checksum definitions from a precompiled ChecksumPlan,
+		 * along with checksum values that were already calculated,
+		 * e.g. by an integrity audit running in another thread.
+		 * @param checksumPlan Checksum plan. (may be nullptr)
+		 * @param checksumValues Checksum values, as returned by ChecksumPlan::exec().
+		 */
+		void setChecksumPlan(const QSharedPointer<const ChecksumPlan> &checksumPlan,
+			const QVector<Checksum::ChecksumValue> &checksumValues);
+
 		/**
 		 * Get the checksum values.
 		 * @return Checksum values, or empty QVector if no checksum definitions were set.
@@ -311,6 +354,18 @@ class File : public QObject
 		 */
 		Checksum::ChkStatus checksumStatus(void) const;
 
+		/**
+		 * Fix invalid stored checksums by writing the actual checksums to the file.
+		 * Checksums that cover other stored checksums are handled by
+		 * repeating until all checksums are valid.
+		 *
+		 * NOTE: Pokémon XD checksums are encrypted with the data,
+		 * so they can't be fixed. Check checksumStatus() afterwards.
+		 *
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int fixChecksums(void);
+
 		/**
 		 * Format checksum values as HTML for display purposes.
 		 * @return QVector containing one or two HTML strings.
@@ -327,6 +382,12 @@ class File : public QObject
 		 */
 		void readOnlyChanged(bool readOnly);
 
+		/**
+		 * The file's checksum values have changed.
+		 * This includes setting new checksum definitions.
+		 */
+		void checksumValuesChanged(void);
+
 	public:
 		/**
 		 * Is this file read-only?
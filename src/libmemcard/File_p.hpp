@@ -12,12 +12,19 @@
 #include "File.hpp"
 class Card;
 class GcImage;
+struct FileImagePrefetchState;
 
 #include "Checksum.hpp"
+#include "ChecksumPlan.hpp"
 
 // C includes.
 #include <stdint.h>
 
+// Qt includes.
+#include <QtCore/QMutex>
+#include <QtCore/QSharedPointer>
+class QThreadPool;
+
 class FilePrivate
 {
 	public:
@@ -51,15 +58,29 @@ class FilePrivate
 		uint32_t mode;		// Mode. (attributes, permissions)
 		// Size is calculated using fatEntries.size().
 
-		// GcImages. (internal use only)
-		GcImage *gcBanner;
-		QVector<GcImage*> gcIcons;
+		// Icon information.
+		// Loaded by loadIconInfo(), which doesn't decode the icons.
 		// FIXME: Use system-independent values.
 		// Currently uses GCN values.
 		QVector<uint8_t> iconSpeed;
 		uint8_t iconAnimMode;
+		uint8_t iconMask;	// Bit N is set if icon N is present.
+
+		// GcImages. (internal use only)
+		// Decoded on first use, or by a prefetch task.
+		// These are protected by imageMutex.
+		QMutex imageMutex;
+		bool imagesLoaded;
+		GcImage *gcBanner;
+		QVector<GcImage*> gcIcons;
+
+		// Image prefetch task.
+		QSharedPointer<FileImagePrefetchState> prefetchState;
 
 		// QPixmap images.
+		// Converted from the GcImages on first use.
+		// NOTE: QPixmap can only be used on the GUI thread.
+		bool pixmapsLoaded;
 		QPixmap banner;
 		QVector<QPixmap> icons;
 
@@ -93,6 +114,25 @@ class FilePrivate
 		 */
 		QByteArray readBlocks(uint16_t blockStart, int len);
 
+		/**
+		 * Read the specified byte range from the file.
+		 * @param address Address to read from.
+		 * @param length Amount of data to read, in bytes.
+		 * @return QByteArray with file data, or empty QByteArray on error.
+		 */
+		QByteArray readData(uint32_t address, uint32_t length);
+
+		/**
+		 * Write data to the file.
+		 * This doesn't update the checksums.
+		 * NOTE: The range must have already been validated.
+		 * @param address Address to write to.
+		 * @param data Data to write.
+		 * @param length Amount of data to write, in bytes.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int writeData(uint32_t address, const uint8_t *data, uint32_t length);
+
 		/**
 		 * Strip invalid DOS characters from a filename.
 		 * @param filename Filename.
@@ -113,32 +153,128 @@ class FilePrivate
 		/** Images **/
 
 		/**
-		 * Load the banner and icon images.
+		 * Get the number of icons, as indicated by iconMask.
+		 * @return Number of icons.
+		 */
+		int iconCount(void) const;
+
+		/**
+		 * Decode the banner and icon images if they haven't been decoded yet.
+		 * This reads from the card, so it must be called from the card's thread.
 		 */
 		void loadImages(void);
 
 		/**
-		 * Load the banner image.
+		 * Convert the banner and icon images to QPixmap if they haven't been converted yet.
+		 * This must be called from the GUI thread.
+		 */
+		void loadPixmaps(void);
+
+		/**
+		 * Decode the banner and icon images on a thread pool.
+		 * The pool copies the image data from the memory-mapped
+		 * card image, so the card isn't read on this thread.
+		 * If the card isn't mapped, nothing is prefetched,
+		 * and the images are decoded on first use.
+		 * @param threadPool Thread pool.
+		 */
+		void prefetchImages(QThreadPool *threadPool);
+
+		/**
+		 * Cancel the image prefetch task.
+		 * If the task is running, this waits for it to finish.
+		 * This must be called before the subclass is destroyed.
+		 */
+		void cancelPrefetch(void);
+
+		/**
+		 * Decode the banner and icon images.
+		 * NOTE: imageMutex must be locked by the caller.
+		 * @param imgData Image data from readImageData().
+		 */
+		void decodeImages(const QByteArray &imgData);
+
+		/**
+		 * Load the icon information.
+		 * This sets iconSpeed, iconAnimMode, and iconMask
+		 * without decoding the icons.
+		 */
+		virtual void loadIconInfo(void) = 0;
+
+		/**
+		 * Location of the banner and icon image data in the file.
+		 */
+		struct ImageDataRange {
+			uint16_t blockStart;	// First file block.
+			int blockCount;		// Number of blocks. (0 if there's no image data)
+			int offset;		// Offset of the image data in the first block.
+			int length;		// Image data length. (-1 for the rest of the blocks)
+
+			ImageDataRange()
+				: blockStart(0)
+				, blockCount(0)
+				, offset(0)
+				, length(-1) { }
+		};
+
+		/**
+		 * Get the location of the banner and icon image data in the file.
+		 * This doesn't read from the card.
+		 * @return Image data range. (blockCount is 0 if there's no image data, or if it's out of range.)
+		 */
+		virtual ImageDataRange imageDataRange(void) const = 0;
+
+		/**
+		 * Extract the image data from the blocks in an ImageDataRange.
+		 * @param blockData	[in/out] Data from range's blocks; replaced with the image data.
+		 * @param range		[in] Image data range.
+		 */
+		static void extractImageData(QByteArray &blockData, const ImageDataRange &range);
+
+		/**
+		 * Read the banner and icon image data from the card.
+		 * @return Image data, or empty QByteArray on error.
+		 */
+		QByteArray readImageData(void);
+
+		/**
+		 * Decode the banner image.
+		 * NOTE: This may be called from a worker thread,
+		 * so it must not access the card.
+		 * @param imgData Image data from readImageData().
 		 * @return GcImage containing the banner image, or nullptr on error.
 		 */
-		virtual GcImage *loadBannerImage(void) = 0;
+		virtual GcImage *decodeBannerImage(const QByteArray &imgData) const = 0;
 
 		/**
-		 * Load the icon images.
+		 * Decode the icon images.
+		 * NOTE: This may be called from a worker thread,
+		 * so it must not access the card.
+		 * @param imgData Image data from readImageData().
 		 * @return QVector<GcImage*> containing the icon images, or empty QVector on error.
 		 */
-		virtual QVector<GcImage*> loadIconImages(void) = 0;
+		virtual QVector<GcImage*> decodeIconImages(const QByteArray &imgData) const = 0;
 
 		/** Checksums **/
 
 		// Checksum data.
 		QVector<Checksum::ChecksumDef> checksumDefs;
+		QSharedPointer<const ChecksumPlan> checksumPlan;
 		QVector<Checksum::ChecksumValue> checksumValues;
 
 		/**
 		 * Calculate the file checksum.
 		 */
 		void calculateChecksum(void);
+
+		/**
+		 * Update the file checksum after part of the file has changed.
+		 * @param address Address of the changed data.
+		 * @param oldData Original data.
+		 * @param newData New data.
+		 * @param length Length of the changed data, in bytes.
+		 */
+		void updateChecksum(uint32_t address, const uint8_t *oldData, const uint8_t *newData, uint32_t length);
 };
 
 #endif /* __LIBMEMCARD_FILE_P_HPP__ */
@@ -240,7 +240,9 @@ int GcnCardPrivate::format(const QString &filename)
 	// TODO: Parameters.
 	// TODO: Separate Card::open()'s block count initialization
 	// so it can be used in this function.
+	// NOTE: The card image can't be resized while it's mapped.
 	totalPhysBlocks = 256;
+	unmapFile();
 	file->resize(totalPhysBlocks * blockSize);
 	filesize = file->size();
 	// TODO: Verify that the filesize matches.
@@ -317,6 +319,9 @@ int GcnCardPrivate::format(const QString &filename)
 	file->write((char*)mc_bat_int, sizeof(mc_bat_int));
 	file->flush();
 
+	// Map the resized card image.
+	mapFile();
+
 #if SYS_BYTEORDER != SYS_BIG_ENDIAN
 	// Un-byteswap the tables.
 	mc_header.sramBias	= be32_to_cpu(mc_header.sramBias);
@@ -999,7 +1004,7 @@ QList<GcnFile*> GcnCard::addLostFiles(const std::list<GcnSearchData> &filesFound
 		if (file) {
 			files.append(file);
 			d->lstFiles.append(file);
-			file->setChecksumDefs(searchData.checksumDefs);
+			file->setChecksumPlan(searchData.checksumPlan);
 		}
 	}
 
@@ -108,16 +108,44 @@ class GcnFilePrivate : public FilePrivate
 		QString fileDesc;
 
 		/**
-		 * Load the banner image.
+		 * Get the size of the banner image data.
+		 * @return Banner image data size, or 0 if there's no banner.
+		 */
+		uint32_t bannerDataSize(void) const;
+
+		/**
+		 * Get the size of the icon image data.
+		 * @return Icon image data size, or 0 if there are no icons.
+		 */
+		uint32_t iconDataSize(void) const;
+
+		/**
+		 * Load the icon information.
+		 * This sets iconSpeed, iconAnimMode, and iconMask
+		 * without decoding the icons.
+		 */
+		void loadIconInfo(void) final;
+
+		/**
+		 * Get the location of the banner and icon image data in the file.
+		 * This doesn't read from the card.
+		 * @return Image data range. (blockCount is 0 if there's no image data, or if it's out of range.)
+		 */
+		ImageDataRange imageDataRange(void) const final;
+
+		/**
+		 * Decode the banner image.
+		 * @param imgData Image data from readImageData().
 		 * @return GcImage containing the banner image, or nullptr on error.
 		 */
-		GcImage *loadBannerImage(void) final;
+		GcImage *decodeBannerImage(const QByteArray &imgData) const final;
 
 		/**
-		 * Load the icon images.
+		 * Decode the icon images.
+		 * @param imgData Image data from readImageData().
 		 * @return QVector<GcImage*> containing the icon images, or empty QVector on error.
 		 */
-		QVector<GcImage*> loadIconImages(void) final;
+		QVector<GcImage*> decodeIconImages(const QByteArray &imgData) const final;
 };
 
 /**
@@ -376,90 +404,37 @@ void GcnFilePrivate::loadFileInfo(void)
 	// pointing to description.
 	description = gameDesc + QChar(L'\0') + fileDesc;
 
-	// Load the banner and icon images.
-	loadImages();
+	// Load the icon information.
+	// The images are decoded on demand.
+	loadIconInfo();
 }
 
 /**
- * Load the banner image.
- * @return GcImage* containing the banner image, or nullptr on error.
+ * Get the size of the banner image data.
+ * @return Banner image data size, or 0 if there's no banner.
  */
-GcImage *GcnFilePrivate::loadBannerImage(void)
+uint32_t GcnFilePrivate::bannerDataSize(void) const
 {
-	// Determine the banner length.
-	uint32_t imgSize = 0;
-	switch (dirEntry->bannerfmt & CARD_BANNER_MASK) {
-		case CARD_BANNER_CI:
-			imgSize = (CARD_BANNER_W * CARD_BANNER_H * 1);
-			break;
-		case CARD_BANNER_RGB:
-			imgSize = (CARD_BANNER_W * CARD_BANNER_H * 2);
-			break;
-		default:
-			// No banner.
-			return nullptr;
-	}
-
-	// Load the banner.
-	uint32_t imgAddr = dirEntry->iconaddr;
-	const int blockSize = card->blockSize();
-	const uint16_t blockStart = (imgAddr / blockSize);
-	QByteArray imgData = readBlocks(blockStart, 1);
-	if (imgData.size() != blockSize)
-		return nullptr;
-	imgAddr &= 0x1FFF;
-
-	GcImage *gcBannerImg = nullptr;
 	switch (dirEntry->bannerfmt & CARD_BANNER_MASK) {
 		case CARD_BANNER_CI:
 			// CI8 palette is right after the banner.
 			// (256 entries in RGB5A3 format.)
-			gcBannerImg = GcImageLoader::fromCI8(CARD_BANNER_W, CARD_BANNER_H,
-					(const uint8_t*)&imgData.constData()[imgAddr], imgSize,
-					(const uint16_t*)&imgData.constData()[imgAddr + imgSize], 0x200);
-			break;
-
+			return (CARD_BANNER_W * CARD_BANNER_H * 1) + 0x200;
 		case CARD_BANNER_RGB:
-			gcBannerImg = GcImageLoader::fromRGB5A3(CARD_BANNER_W, CARD_BANNER_H,
-					(const uint16_t*)&imgData.constData()[imgAddr], imgSize);
-			break;
-
+			return (CARD_BANNER_W * CARD_BANNER_H * 2);
 		default:
-			break;
+			// No banner.
+			return 0;
 	}
-
-	return gcBannerImg;
 }
 
 /**
- * Load the icon images.
- * @return QVector<GcImage*> containing the icon images, or empty QVector on error.
+ * Get the size of the icon image data.
+ * @return Icon image data size, or 0 if there are no icons.
  */
-QVector<GcImage*> GcnFilePrivate::loadIconImages(void)
+uint32_t GcnFilePrivate::iconDataSize(void) const
 {
-	// TODO: Convert these to system-independent values.
-	// Icon animation metadata.
-	// TODO: Should be part of a struct that's returned...
-	this->iconAnimMode = (dirEntry->bannerfmt & CARD_ANIM_MASK);
-
-	// Calculate the first icon address.
-	uint32_t imgAddr = dirEntry->iconaddr;
-	switch (dirEntry->bannerfmt & CARD_BANNER_MASK) {
-		case CARD_BANNER_CI:
-			imgAddr += (CARD_BANNER_W * CARD_BANNER_H * 1);
-			imgAddr += 0x200; // palette
-			break;
-		case CARD_BANNER_RGB:
-			imgAddr += (CARD_BANNER_W * CARD_BANNER_H * 2);
-			break;
-		default:
-			// No banner.
-			break;
-	}
-
-	// Calculate the icon sizes.
-	int iconSizes[8];
-	int iconLenTotal = 0;
+	uint32_t iconLenTotal = 0;
 	bool isShared = false;
 	uint16_t iconfmt = dirEntry->iconfmt;
 	uint16_t iconspeed = dirEntry->iconspeed;
@@ -469,17 +444,16 @@ QVector<GcImage*> GcnFilePrivate::loadIconImages(void)
 
 		switch (iconfmt & CARD_ICON_MASK) {
 			case CARD_ICON_CI_SHARED:
-				iconSizes[i] = (CARD_ICON_W * CARD_ICON_H * 1);
-				iconLenTotal += iconSizes[i];
+				iconLenTotal += (CARD_ICON_W * CARD_ICON_H * 1);
 				isShared = true;
 				break;
 			case CARD_ICON_CI_UNIQUE:
-				iconSizes[i] = (CARD_ICON_W * CARD_ICON_H * 1);
-				iconLenTotal += iconSizes[i] + 0x200;
+				iconLenTotal += (CARD_ICON_W * CARD_ICON_H * 1) + 0x200;
+				break;
+			case CARD_ICON_RGB:
+				iconLenTotal += (CARD_ICON_W * CARD_ICON_H * 2);
 				break;
-			case CARD_BANNER_RGB:
-				iconSizes[i] = (CARD_ICON_W * CARD_ICON_H * 2);
-				iconLenTotal += iconSizes[i];
+			default:
 				break;
 		}
 	}
@@ -490,15 +464,117 @@ QVector<GcImage*> GcnFilePrivate::loadIconImages(void)
 		iconLenTotal += 0x200;
 	}
 
-	// Load the icon data.
-	const int blockSize = card->blockSize();
-	const uint16_t blockStart = (imgAddr / blockSize);
-	const uint16_t blockEnd = ((imgAddr + iconLenTotal) / blockSize);
-	const int blockLen = ((blockEnd - blockStart) + 1);
-	QByteArray imgData = readBlocks(blockStart, blockLen);
-	if (imgData.size() != (blockLen * blockSize))
+	return iconLenTotal;
+}
+
+/**
+ * Load the icon information.
+ * This sets iconSpeed, iconAnimMode, and iconMask
+ * without decoding the icons.
+ */
+void GcnFilePrivate::loadIconInfo(void)
+{
+	// TODO: Convert these to system-independent values.
+	this->iconAnimMode = (dirEntry->bannerfmt & CARD_ANIM_MASK);
+	this->iconSpeed.clear();
+	this->iconMask = 0;
+
+	uint16_t iconfmt = dirEntry->iconfmt;
+	uint16_t iconspeed = dirEntry->iconspeed;
+	for (int i = 0; i < CARD_MAXICONS; i++, iconfmt >>= 2, iconspeed >>= 2) {
+		if ((iconspeed & CARD_SPEED_MASK) == CARD_SPEED_END)
+			break;
+		this->iconSpeed.append(iconspeed & CARD_SPEED_MASK);
+		if ((iconfmt & CARD_ICON_MASK) != CARD_ICON_NONE) {
+			this->iconMask |= (1U << i);
+		}
+	}
+
+	// Make sure the icons are actually in the file.
+	if (imageDataRange().blockCount <= 0) {
+		// Image data is out of range.
+		this->iconMask = 0;
+	}
+}
+
+/**
+ * Get the location of the banner and icon image data in the file.
+ * This doesn't read from the card.
+ * @return Image data range. (blockCount is 0 if there's no image data, or if it's out of range.)
+ */
+FilePrivate::ImageDataRange GcnFilePrivate::imageDataRange(void) const
+{
+	ImageDataRange range;
+	const uint32_t imgSize = bannerDataSize() + iconDataSize();
+	if (imgSize == 0) {
+		// No banner or icons.
+		return range;
+	}
+
+	// Blocks containing the banner and icons.
+	const uint32_t imgAddr = dirEntry->iconaddr;
+	const uint32_t blockSize = (uint32_t)card->blockSize();
+	const uint32_t blockStart = (imgAddr / blockSize);
+	const uint32_t blockEnd = ((imgAddr + imgSize - 1) / blockSize);
+	if (blockEnd < blockStart || blockEnd >= (uint32_t)this->size()) {
+		// Image data is out of range.
+		return range;
+	}
+
+	// Image data starts at the banner.
+	range.blockStart = (uint16_t)blockStart;
+	range.blockCount = (int)((blockEnd - blockStart) + 1);
+	range.offset = (int)(imgAddr % blockSize);
+	range.length = (int)imgSize;
+	return range;
+}
+
+/**
+ * Decode the banner image.
+ * @param imgData Image data from readImageData().
+ * @return GcImage containing the banner image, or nullptr on error.
+ */
+GcImage *GcnFilePrivate::decodeBannerImage(const QByteArray &imgData) const
+{
+	const uint32_t bannerSize = bannerDataSize();
+	if (bannerSize == 0 || (uint32_t)imgData.size() < bannerSize)
+		return nullptr;
+
+	const char *const pImgData = imgData.constData();
+	switch (dirEntry->bannerfmt & CARD_BANNER_MASK) {
+		case CARD_BANNER_CI: {
+			// CI8 palette is right after the banner.
+			// (256 entries in RGB5A3 format.)
+			const int imageSize = (CARD_BANNER_W * CARD_BANNER_H * 1);
+			return GcImageLoader::fromCI8(CARD_BANNER_W, CARD_BANNER_H,
+					(const uint8_t*)pImgData, imageSize,
+					(const uint16_t*)&pImgData[imageSize], 0x200);
+		}
+
+		case CARD_BANNER_RGB:
+			return GcImageLoader::fromRGB5A3(CARD_BANNER_W, CARD_BANNER_H,
+					(const uint16_t*)pImgData, (int)bannerSize);
+
+		default:
+			break;
+	}
+
+	return nullptr;
+}
+
+/**
+ * Decode the icon images.
+ * @param imgData Image data from readImageData().
+ * @return QVector<GcImage*> containing the icon images, or empty QVector on error.
+ */
+QVector<GcImage*> GcnFilePrivate::decodeIconImages(const QByteArray &imgData) const
+{
+	// Icons start after the banner.
+	uint32_t imgAddr = bannerDataSize();
+	const uint32_t iconLenTotal = iconDataSize();
+	if (iconLenTotal == 0 || (uint32_t)imgData.size() < (imgAddr + iconLenTotal))
 		return QVector<GcImage*>();
-	imgAddr &= 0x1FFF;
+	const char *const pImgData = imgData.constData();
 
 	// Info for icons using a shared CI8 palette.
 	struct CI8_SHARED_data {
@@ -509,16 +585,12 @@ QVector<GcImage*> GcnFilePrivate::loadIconImages(void)
 	// Decode the icon(s).
 	QVector<CI8_SHARED_data> lst_CI8_SHARED;
 	QVector<GcImage*> gcImages;
-	// TODO: Should be part of a struct that's returned...
-	this->iconSpeed.clear();
 
-	iconfmt = dirEntry->iconfmt;
-	iconspeed = dirEntry->iconspeed;
+	uint16_t iconfmt = dirEntry->iconfmt;
+	uint16_t iconspeed = dirEntry->iconspeed;
 	for (int i = 0; i < CARD_MAXICONS; i++, iconfmt >>= 2, iconspeed >>= 2) {
 		if ((iconspeed & CARD_SPEED_MASK) == CARD_SPEED_END)
 			break;
-		// TODO: Should be part of a struct that's returned...
-		this->iconSpeed.append(iconspeed & CARD_SPEED_MASK);
 
 		switch (iconfmt & CARD_ICON_MASK) {
 			case CARD_ICON_CI_SHARED: {
@@ -543,17 +615,17 @@ QVector<GcImage*> GcnFilePrivate::loadIconImages(void)
 				// (256 entries in RGB5A3 format.)
 				const int imageSize = (CARD_ICON_W * CARD_ICON_H * 1);
 				GcImage *gcIcon = GcImageLoader::fromCI8(CARD_ICON_W, CARD_ICON_H,
-						(const uint8_t*)&imgData.constData()[imgAddr], imageSize,
-						(const uint16_t*)&imgData.constData()[imgAddr + imageSize], 0x200);
+						(const uint8_t*)&pImgData[imgAddr], imageSize,
+						(const uint16_t*)&pImgData[imgAddr + imageSize], 0x200);
 				gcImages.append(gcIcon);
 				imgAddr += imageSize + 0x200;
 				break;
 			}
 
-			case CARD_BANNER_RGB: {
+			case CARD_ICON_RGB: {
 				const int imageSize = (CARD_ICON_W * CARD_ICON_H * 2);
 				GcImage *gcIcon = GcImageLoader::fromRGB5A3(CARD_ICON_W, CARD_ICON_H,
-						(const uint16_t*)&imgData.constData()[imgAddr], imageSize);
+						(const uint16_t*)&pImgData[imgAddr], imageSize);
 				gcImages.append(gcIcon);
 				imgAddr += imageSize;
 				break;
@@ -569,12 +641,22 @@ QVector<GcImage*> GcnFilePrivate::loadIconImages(void)
 
 	if (!lst_CI8_SHARED.isEmpty()) {
 		// Process CI8 SHARED icons.
-		// TODO: Convert the palette once instead of every time?
+		// The palette is converted for the first icon,
+		// and the other icons share it.
 		const int imageSize = (CARD_ICON_W * CARD_ICON_H * 1);
+		const GcImage *palImage = nullptr;
 		foreach (const CI8_SHARED_data& data, lst_CI8_SHARED) {
-			GcImage *gcIcon = GcImageLoader::fromCI8(CARD_ICON_W, CARD_ICON_H,
-						(const uint8_t*)&imgData.constData()[data.iconAddr], imageSize,
-						(const uint16_t*)&imgData.constData()[imgAddr], 0x200);
+			GcImage *gcIcon;
+			if (!palImage) {
+				gcIcon = GcImageLoader::fromCI8(CARD_ICON_W, CARD_ICON_H,
+						(const uint8_t*)&pImgData[data.iconAddr], imageSize,
+						(const uint16_t*)&pImgData[imgAddr], 0x200);
+				palImage = gcIcon;
+			} else {
+				gcIcon = GcImageLoader::fromCI8(CARD_ICON_W, CARD_ICON_H,
+						(const uint8_t*)&pImgData[data.iconAddr], imageSize,
+						palImage);
+			}
 			gcImages[data.iconIdx] = gcIcon;
 		}
 	}
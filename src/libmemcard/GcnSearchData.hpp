@@ -10,16 +10,17 @@
 #define __LIBMEMCARD_GCNSEARCHDATA_HPP__
 
 #include "card.h"
-#include "Checksum.hpp"
+#include "ChecksumPlan.hpp"
 
 // Qt includes.
+#include <QtCore/QSharedPointer>
 #include <QtCore/QVector>
 
 struct GcnSearchData
 {
 	card_direntry dirEntry;
 	QVector<uint16_t> fatEntries;
-	QVector<Checksum::ChecksumDef> checksumDefs;
+	QSharedPointer<const ChecksumPlan> checksumPlan;
 };
 
 #endif /* __LIBMEMCARD_GCNSEARCHDATA_HPP__ */
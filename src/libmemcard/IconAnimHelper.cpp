@@ -82,7 +82,7 @@ void IconAnimHelperPrivate::reset(void)
 		// File is specified.
 		// Determine the initial state.
 		enabled = true;
-		frameHasIcon = !(file->icon(frame).isNull());
+		frameHasIcon = file->hasIcon(frame);
 		delayLen = file->iconDelay(frame);
 		mode = file->iconAnimMode();
 	}
@@ -147,7 +147,7 @@ bool IconAnimHelperPrivate::tick(void)
 	delayLen = file->iconDelay(frame);
 
 	// Check if this frame has an icon.
-	frameHasIcon = !file->icon(frame).isNull();
+	frameHasIcon = file->hasIcon(frame);
 	if (frameHasIcon && lastValidFrame != frame) {
 		// Frame has an icon. Save this frame as the last valid frame.
 		lastValidFrame = frame;
@@ -251,6 +251,16 @@ QPixmap IconAnimHelper::icon(void) const
 	return d->file->icon(d->lastValidFrame);
 }
 
+/**
+ * Get the current icon index for this file.
+ * @return Current icon index.
+ */
+int IconAnimHelper::frame(void) const
+{
+	Q_D(const IconAnimHelper);
+	return d->lastValidFrame;
+}
+
 /**
  * Timer tick for the animation counter.
  * WRAPPER FUNCTION for d->tick().
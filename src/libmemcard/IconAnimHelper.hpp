@@ -73,6 +73,12 @@ class IconAnimHelper : public QObject
 		 */
 		QPixmap icon(void) const;
 
+		/**
+		 * Get the current icon index for this file.
+		 * @return Current icon index.
+		 */
+		int frame(void) const;
+
 		/**
 		 * Timer tick for the animation counter.
 		 * @return True if the current icon has been changed; false if not.
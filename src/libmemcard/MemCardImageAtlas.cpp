@@ -0,0 +1,171 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard]                      *
+ * MemCardImageAtlas.cpp: Image atlas for MemCardModel.                    *
+ *                                                                         *
+ * Copyright (c) 2012-2018 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "MemCardImageAtlas.hpp"
+
+// C++ includes.
+#include <algorithm>
+
+// Qt includes.
+#include <QtCore/QVector>
+#include <QtGui/QPainter>
+
+/** MemCardImageAtlasPrivate **/
+
+class MemCardImageAtlasPrivate
+{
+	public:
+		MemCardImageAtlasPrivate();
+
+	private:
+		Q_DISABLE_COPY(MemCardImageAtlasPrivate)
+
+	public:
+		// Page size, in pixels.
+		// A 1024x1024 page holds over 900 GCN icons or 300 GCN banners.
+		static const int PAGE_SIZE = 1024;
+
+		// Empty space between images, in pixels.
+		// This prevents neighboring images from bleeding
+		// in if the view scales the images.
+		static const int PADDING = 1;
+
+		// Atlas pages.
+		QVector<QPixmap> pages;
+
+		// Images are packed into shelves: rows of images
+		// that are as tall as the tallest image in the row.
+		// Only the last page's current shelf has free space.
+		int shelfX;	// Next free column in the shelf.
+		int shelfY;	// Top of the shelf.
+		int shelfH;	// Height of the shelf.
+
+		/**
+		 * Add a new page to the atlas.
+		 */
+		void addPage(void);
+};
+
+MemCardImageAtlasPrivate::MemCardImageAtlasPrivate()
+	: shelfX(0)
+	, shelfY(0)
+	, shelfH(0)
+{ }
+
+/**
+ * Add a new page to the atlas.
+ */
+void MemCardImageAtlasPrivate::addPage(void)
+{
+	QPixmap page(PAGE_SIZE, PAGE_SIZE);
+	page.fill(Qt::transparent);
+	pages.append(page);
+
+	shelfX = 0;
+	shelfY = 0;
+	shelfH = 0;
+}
+
+/** MemCardImageAtlas **/
+
+MemCardImageAtlas::MemCardImageAtlas()
+	: d_ptr(new MemCardImageAtlasPrivate())
+{ }
+
+MemCardImageAtlas::~MemCardImageAtlas()
+{
+	delete d_ptr;
+}
+
+/**
+ * Add an image to the atlas.
+ * @param pixmap Image.
+ * @return Location of the image, or null Entry if it couldn't be added.
+ */
+MemCardImageAtlas::Entry MemCardImageAtlas::add(const QPixmap &pixmap)
+{
+	Q_D(MemCardImageAtlas);
+	static const int PAGE_SIZE = MemCardImageAtlasPrivate::PAGE_SIZE;
+	static const int PADDING = MemCardImageAtlasPrivate::PADDING;
+
+	Entry entry;
+	const int w = pixmap.width();
+	const int h = pixmap.height();
+	if (pixmap.isNull() || w > PAGE_SIZE || h > PAGE_SIZE) {
+		// Image can't be added to the atlas.
+		return entry;
+	}
+
+	if (d->pages.isEmpty()) {
+		// First image.
+		d->addPage();
+	} else if (d->shelfX + w > PAGE_SIZE) {
+		// Not enough room in the current shelf.
+		// Start a new shelf below it.
+		d->shelfY += d->shelfH;
+		d->shelfX = 0;
+		d->shelfH = 0;
+	}
+
+	if (d->shelfY + h > PAGE_SIZE) {
+		// Not enough room in the current page.
+		d->addPage();
+	}
+
+	entry.page = d->pages.size() - 1;
+	entry.rect = QRect(d->shelfX, d->shelfY, w, h);
+
+	// Copy the image into the page.
+	// NOTE: Pages are transparent, and images are never
+	// drawn over each other, so SourceOver is fine here.
+	QPainter painter(&d->pages[entry.page]);
+	painter.drawPixmap(entry.rect.topLeft(), pixmap);
+	painter.end();
+
+	d->shelfX += w + PADDING;
+	d->shelfH = std::max(d->shelfH, h + PADDING);
+	return entry;
+}
+
+/**
+ * Get an image from the atlas.
+ * @param entry Location of the image.
+ * @return Image, or Image with a null page if the entry is invalid.
+ */
+MemCardImageAtlas::Image MemCardImageAtlas::image(const Entry &entry) const
+{
+	Q_D(const MemCardImageAtlas);
+	Image image;
+	if (entry.page >= 0 && entry.page < d->pages.size()) {
+		image.page = d->pages.at(entry.page);
+		image.rect = entry.rect;
+	}
+	return image;
+}
+
+/**
+ * Remove all images from the atlas.
+ */
+void MemCardImageAtlas::clear(void)
+{
+	Q_D(MemCardImageAtlas);
+	d->pages.clear();
+	d->shelfX = 0;
+	d->shelfY = 0;
+	d->shelfH = 0;
+}
+
+/**
+ * Get the number of pages in the atlas.
+ * @return Number of pages.
+ */
+int MemCardImageAtlas::pageCount(void) const
+{
+	Q_D(const MemCardImageAtlas);
+	return d->pages.size();
+}
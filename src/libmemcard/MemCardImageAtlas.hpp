@@ -0,0 +1,89 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard]                      *
+ * MemCardImageAtlas.hpp: Image atlas for MemCardModel.                    *
+ *                                                                         *
+ * Copyright (c) 2012-2018 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __LIBMEMCARD_MEMCARDIMAGEATLAS_HPP__
+#define __LIBMEMCARD_MEMCARDIMAGEATLAS_HPP__
+
+// Qt includes.
+#include <QtCore/QMetaType>
+#include <QtCore/QRect>
+#include <QtGui/QPixmap>
+
+class MemCardImageAtlasPrivate;
+
+/**
+ * Image atlas for banners and icons.
+ *
+ * Images are packed into a few large pages, so item views
+ * can draw every banner and icon from the same pixmap.
+ * Animated icons are drawn by changing the source rectangle.
+ *
+ * NOTE: QPixmap can only be used on the GUI thread.
+ */
+class MemCardImageAtlas
+{
+	public:
+		MemCardImageAtlas();
+		~MemCardImageAtlas();
+
+	protected:
+		MemCardImageAtlasPrivate *const d_ptr;
+		Q_DECLARE_PRIVATE(MemCardImageAtlas)
+	private:
+		Q_DISABLE_COPY(MemCardImageAtlas)
+
+	public:
+		/**
+		 * Location of an image in the atlas.
+		 */
+		struct Entry {
+			int page;	// Page index. (-1 if the image isn't in the atlas)
+			QRect rect;	// Image rectangle within the page.
+
+			Entry() : page(-1) { }
+			bool isNull(void) const { return (page < 0); }
+		};
+
+		/**
+		 * Image in the atlas, for use with QVariant.
+		 * Draw it using QPainter::drawPixmap(target, page, rect).
+		 */
+		struct Image {
+			QPixmap page;	// Atlas page.
+			QRect rect;	// Image rectangle within the page.
+		};
+
+		/**
+		 * Add an image to the atlas.
+		 * @param pixmap Image.
+		 * @return Location of the image, or null Entry if it couldn't be added.
+		 */
+		Entry add(const QPixmap &pixmap);
+
+		/**
+		 * Get an image from the atlas.
+		 * @param entry Location of the image.
+		 * @return Image, or Image with a null page if the entry is invalid.
+		 */
+		Image image(const Entry &entry) const;
+
+		/**
+		 * Remove all images from the atlas.
+		 */
+		void clear(void);
+
+		/**
+		 * Get the number of pages in the atlas.
+		 * @return Number of pages.
+		 */
+		int pageCount(void) const;
+};
+
+Q_DECLARE_METATYPE(MemCardImageAtlas::Image)
+
+#endif /* __LIBMEMCARD_MEMCARDIMAGEATLAS_HPP__ */
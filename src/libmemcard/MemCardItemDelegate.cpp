@@ -9,6 +9,7 @@
 #include "MemCardItemDelegate.hpp"
 
 #include "MemCardModel.hpp"
+#include "MemCardImageAtlas.hpp"
 #include "card.h"
 
 // Qt includes.
@@ -16,6 +17,7 @@
 #include <QApplication>
 #include <QtGui/QFont>
 #include <QtGui/QFontMetrics>
+#include <QtGui/QIcon>
 #include <QStyle>
 
 #ifdef Q_OS_WIN
@@ -38,6 +40,18 @@ class MemCardItemDelegatePrivate
 		QFont fontGameDesc(const QWidget *widget = 0) const;
 		QFont fontFileDesc(const QWidget *widget = 0) const;
 
+		/**
+		 * Paint an image from the model's image atlas.
+		 * @param painter QPainter.
+		 * @param option Style option.
+		 * @param index Model index.
+		 * @param image Image from MemCardModel::AtlasImageRole.
+		 */
+		void paintAtlasImage(QPainter *painter,
+			const QStyleOptionViewItem &option,
+			const QModelIndex &index,
+			const MemCardImageAtlas::Image &image) const;
+
 #ifdef Q_OS_WIN
 		// Win32: Theming functions.
 	private:
@@ -99,6 +113,65 @@ QFont MemCardItemDelegatePrivate::fontFileDesc(const QWidget *widget) const
 	return fontFileDesc;
 }
 
+/**
+ * Paint an image from the model's image atlas.
+ * @param painter QPainter.
+ * @param option Style option.
+ * @param index Model index.
+ * @param image Image from MemCardModel::AtlasImageRole.
+ */
+void MemCardItemDelegatePrivate::paintAtlasImage(QPainter *painter,
+	const QStyleOptionViewItem &option,
+	const QModelIndex &index,
+	const MemCardImageAtlas::Image &image) const
+{
+	// NOTE: initStyleOption() isn't used here, since it
+	// would retrieve the image as a separate QPixmap.
+	QStyleOptionViewItem opt = option;
+	opt.index = index;
+	QStyle *const style = opt.widget ? opt.widget->style() : QApplication::style();
+
+	// Get the alignment.
+	int alignment = 0;
+	const QVariant align_var = index.data(Qt::TextAlignmentRole);
+	if (align_var.canConvert(QVariant::Int))
+		alignment = align_var.toInt();
+	if (alignment == 0)
+		alignment = opt.displayAlignment;
+
+	// Draw the background color first.
+	const QVariant bg_var = index.data(Qt::BackgroundRole);
+	if (bg_var.canConvert<QBrush>())
+		opt.backgroundBrush = bg_var.value<QBrush>();
+
+	// Draw the style element.
+	painter->save();
+	style->drawControl(QStyle::CE_ItemViewItem, &opt, painter, opt.widget);
+
+	// Draw the image using the same margins as QStyledItemDelegate.
+	const int hmargin = style->pixelMetric(QStyle::PM_FocusFrameHMargin, &opt, opt.widget) + 1;
+	const QRect rect = opt.rect.adjusted(hmargin, 0, -hmargin, 0);
+	const QRect target = QStyle::alignedRect(opt.direction,
+		(Qt::Alignment)alignment, image.rect.size(), rect);
+
+	// Disabled and selected items use the style's icon effects,
+	// the same as QStyledItemDelegate. Normal items are drawn
+	// directly from the atlas page.
+	QIcon::Mode mode = QIcon::Normal;
+	if (!(opt.state & QStyle::State_Enabled))
+		mode = QIcon::Disabled;
+	else if (opt.state & QStyle::State_Selected)
+		mode = QIcon::Selected;
+
+	if (mode == QIcon::Normal) {
+		painter->drawPixmap(target, image.page, image.rect);
+	} else {
+		const QPixmap pxm = style->generatedIconPixmap(mode, image.page.copy(image.rect), &opt);
+		painter->drawPixmap(target, pxm);
+	}
+	painter->restore();
+}
+
 #ifdef Q_OS_WIN
 typedef bool (WINAPI *PtrIsAppThemed)(void);
 typedef bool (WINAPI *PtrIsThemeActive)(void);
@@ -188,6 +261,15 @@ void MemCardItemDelegate::paint(QPainter *painter,
 		return;
 	}
 
+	// Icons and banners are drawn from the model's image atlas.
+	Q_D(const MemCardItemDelegate);
+	const QVariant atlas_var = index.data(MemCardModel::AtlasImageRole);
+	if (atlas_var.canConvert<MemCardImageAtlas::Image>()) {
+		d->paintAtlasImage(painter, option, index,
+			atlas_var.value<MemCardImageAtlas::Image>());
+		return;
+	}
+
 	// TODO: Combine code with sizeHint().
 
 	// GCN file comments: "GameDesc\0FileDesc"
@@ -236,7 +318,6 @@ void MemCardItemDelegate::paint(QPainter *painter,
 	//textRect.adjust(hmargin, 0, -hmargin, 0);
 
 	// Get the fonts.
-	Q_D(const MemCardItemDelegate);
 	QFont fontGameDesc = d->fontGameDesc(bgOption.widget);
 	QFont fontFileDesc = d->fontFileDesc(bgOption.widget);
 
@@ -18,6 +18,7 @@
 
 // Icon animation helper.
 #include "IconAnimHelper.hpp"
+#include "MemCardImageAtlas.hpp"
 
 // C includes. (C++ namespace)
 #include <cassert>
@@ -25,6 +26,8 @@
 
 // Qt includes.
 #include <QtCore/QHash>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
 #include <QtCore/QTimer>
 #include <QApplication>
 #include <QtGui/QColor>
@@ -69,6 +72,41 @@ class MemCardModelPrivate
 		 */
 		void updateAnimTimerState(void);
 
+		// Image atlas for banners and icons.
+		// Files are added on first use, so only files
+		// that have been displayed use atlas space.
+		MemCardImageAtlas atlas;
+		struct AtlasEntries {
+			MemCardImageAtlas::Entry banner;
+			QVector<MemCardImageAtlas::Entry> icons;
+		};
+		QHash<const File*, AtlasEntries> atlasEntries;
+
+		/**
+		 * Get the image atlas entries for a file.
+		 * The file's images are added to the atlas if necessary.
+		 * @param file File.
+		 * @return Image atlas entries.
+		 */
+		const AtlasEntries &getAtlasEntries(const File *file);
+
+		/**
+		 * Clear the image atlas.
+		 */
+		void clearAtlas(void);
+
+		// Thread pool for decoding icons and banners.
+		QThreadPool threadPool;
+
+		/**
+		 * Decode icons and banners in the background.
+		 * Visible rows are decoded on demand, so this only
+		 * makes the rest of the images ready ahead of time.
+		 * @param start First file index.
+		 * @param end Last file index.
+		 */
+		void prefetchImages(int start, int end);
+
 		// Animation timer.
 		QTimer *animTimer;
 		// Pause count. If >0, animation is paused.
@@ -136,6 +174,8 @@ MemCardModelPrivate::MemCardModelPrivate(MemCardModel *q)
 	, insertStart(-1)
 	, insertEnd(-1)
 {
+	threadPool.setMaxThreadCount(QThread::idealThreadCount());
+
 	// Connect animTimer's timeout() signal.
 	QObject::connect(animTimer, &QTimer::timeout,
 			 q, &MemCardModel::animTimerSlot);
@@ -298,6 +338,52 @@ void MemCardModelPrivate::updateAnimTimerState(void)
 	}
 }
 
+/**
+ * Get the image atlas entries for a file.
+ * The file's images are added to the atlas if necessary.
+ * @param file File.
+ * @return Image atlas entries.
+ */
+const MemCardModelPrivate::AtlasEntries &MemCardModelPrivate::getAtlasEntries(const File *file)
+{
+	auto iter = atlasEntries.find(file);
+	if (iter != atlasEntries.end())
+		return *iter;
+
+	// Add the file's banner and icons to the atlas.
+	AtlasEntries entries;
+	entries.banner = atlas.add(file->banner());
+	const int iconCount = file->iconCount();
+	entries.icons.reserve(iconCount);
+	for (int i = 0; i < iconCount; i++) {
+		entries.icons.append(atlas.add(file->icon(i)));
+	}
+	return *atlasEntries.insert(file, entries);
+}
+
+/**
+ * Clear the image atlas.
+ */
+void MemCardModelPrivate::clearAtlas(void)
+{
+	atlasEntries.clear();
+	atlas.clear();
+}
+
+/**
+ * Decode icons and banners in the background.
+ * Visible rows are decoded on demand, so this only
+ * makes the rest of the images ready ahead of time.
+ * @param start First file index.
+ * @param end Last file index.
+ */
+void MemCardModelPrivate::prefetchImages(int start, int end)
+{
+	for (int i = start; i <= end; i++) {
+		card->getFile(i)->prefetchImages(&threadPool);
+	}
+}
+
 /** MemCardModel **/
 
 MemCardModel::MemCardModel(QObject *parent)
@@ -399,6 +485,33 @@ QVariant MemCardModel::data(const QModelIndex& index, int role) const
 			}
 			break;
 
+		case MemCardModel::AtlasImageRole: {
+			// Images packed into the image atlas.
+			// MemCardItemDelegate draws these directly.
+			MemCardImageAtlas::Entry entry;
+			switch (index.column()) {
+				case COL_ICON: {
+					// Animated icons use the current frame.
+					const MemCardModelPrivate::AtlasEntries &entries =
+						const_cast<MemCardModelPrivate*>(d)->getAtlasEntries(file);
+					const IconAnimHelper *helper = d->animState.value(file);
+					entry = entries.icons.value(helper ? helper->frame() : 0);
+					break;
+				}
+
+				case COL_BANNER:
+					entry = const_cast<MemCardModelPrivate*>(d)->getAtlasEntries(file).banner;
+					break;
+
+				default:
+					break;
+			}
+
+			if (entry.isNull())
+				break;
+			return QVariant::fromValue(d->atlas.image(entry));
+		}
+
 		case Qt::TextAlignmentRole:
 			switch (index.column()) {
 				case COL_SIZE:
@@ -552,6 +665,10 @@ void MemCardModel::setCard(Card *card)
 			   this, &MemCardModel::card_filesAboutToBeRemoved_slot);
 		disconnect(d->card, &Card::filesRemoved,
 			   this, &MemCardModel::card_filesRemoved_slot);
+		for (int i = 0; i < fileCount; i++) {
+			disconnect(d->card->getFile(i), &File::checksumValuesChanged,
+				   this, &MemCardModel::file_checksumValuesChanged_slot);
+		}
 
 		d->card = nullptr;
 
@@ -561,6 +678,9 @@ void MemCardModel::setCard(Card *card)
 			endRemoveRows();
 	}
 
+	// Clear the image atlas.
+	d->clearAtlas();
+
 	if (card) {
 		// Notify the view that we're about to add rows.
 		const int fileCount = card->fileCount();
@@ -587,9 +707,19 @@ void MemCardModel::setCard(Card *card)
 		connect(d->card, &Card::filesRemoved,
 			this, &MemCardModel::card_filesRemoved_slot);
 
+		// Connect the Files' signals.
+		// Checksums may be calculated after the card is loaded.
+		for (int i = 0; i < fileCount; i++) {
+			connect(card->getFile(i), &File::checksumValuesChanged,
+				this, &MemCardModel::file_checksumValuesChanged_slot);
+		}
+
 		// Done adding rows.
 		if (fileCount > 0)
 			endInsertRows();
+
+		// Decode the images in the background.
+		d->prefetchImages(0, fileCount - 1);
 	}
 }
 
@@ -640,23 +770,41 @@ void MemCardModel::animTimerSlot(void)
 		return;
 	}
 
+	// Only the icon images have changed.
+	static const QVector<int> roles = QVector<int>()
+		<< Qt::DecorationRole << MemCardModel::AtlasImageRole;
+
 	// Check for icon animations.
+	// Consecutive rows with updated icons are combined
+	// into a single dataChanged() signal.
+	int firstRow = -1;
 	for (int i = 0; i < d->fileCount; i++) {
 		const File *file = d->card->getFile(i);
 		IconAnimHelper *helper = d->animState.value(file);
-		if (!helper)
-			continue;
 
 		// Tell the IconAnimHelper that a timer tick has occurred.
 		// TODO: Connect the timer to the IconAnimHelper directly?
-		bool iconUpdated = helper->tick();
+		const bool iconUpdated = (helper && helper->tick());
 		if (iconUpdated) {
 			// Icon has been updated.
-			// Notify the UI that the icon has changed.
-			QModelIndex iconIndex = createIndex(i, MemCardModel::COL_ICON);
-			emit dataChanged(iconIndex, iconIndex);
+			if (firstRow < 0)
+				firstRow = i;
+			continue;
+		}
+
+		if (firstRow >= 0) {
+			// Notify the UI that the icons have changed.
+			emit dataChanged(createIndex(firstRow, MemCardModel::COL_ICON),
+					 createIndex(i - 1, MemCardModel::COL_ICON), roles);
+			firstRow = -1;
 		}
 	}
+
+	if (firstRow >= 0) {
+		// Notify the UI that the icons have changed.
+		emit dataChanged(createIndex(firstRow, MemCardModel::COL_ICON),
+				 createIndex(d->fileCount - 1, MemCardModel::COL_ICON), roles);
+	}
 }
 
 /**
@@ -676,6 +824,7 @@ void MemCardModel::card_destroyed_slot(QObject *obj)
 		d->fileCount = 0;
 		if (old_fileCount > 0)
 			endRemoveRows();
+		d->clearAtlas();
 	}
 }
 
@@ -707,8 +856,13 @@ void MemCardModel::card_filesInserted_slot(void)
 		for (int i = d->insertStart; i <= d->insertEnd; i++) {
 			const File *file = d->card->getFile(i);
 			d->initAnimState(file);
+			connect(file, &File::checksumValuesChanged,
+				this, &MemCardModel::file_checksumValuesChanged_slot);
 		}
 
+		// Decode the images in the background.
+		d->prefetchImages(d->insertStart, d->insertEnd);
+
 		// Reset the row insert start/end indexes.
 		d->insertStart = -1;
 		d->insertEnd = -1;
@@ -735,11 +889,13 @@ void MemCardModel::card_filesAboutToBeRemoved_slot(int start, int end)
 	// Start removing rows.
 	beginRemoveRows(QModelIndex(), start, end);
 
-	// Remove animation states for these files.
+	// Remove animation states and image atlas entries for these files.
+	// NOTE: Atlas space isn't reused until the atlas is cleared.
 	Q_D(MemCardModel);
 	for (int i = start; i <= end; i++) {
 		const File *file = d->card->getFile(i);
 		d->animState.remove(file);
+		d->atlasEntries.remove(file);
 	}
 }
 
@@ -757,6 +913,27 @@ void MemCardModel::card_filesRemoved_slot(void)
 	endRemoveRows();
 }
 
+/**
+ * A File's checksum values have changed.
+ * The File is determined using sender().
+ */
+void MemCardModel::file_checksumValuesChanged_slot(void)
+{
+	Q_D(MemCardModel);
+	const File *const file = qobject_cast<const File*>(sender());
+	if (!d->card || !file)
+		return;
+
+	for (int i = 0; i < d->fileCount; i++) {
+		if (d->card->getFile(i) == file) {
+			// Notify the UI that the checksum status has changed.
+			QModelIndex validIndex = createIndex(i, MemCardModel::COL_ISVALID);
+			emit dataChanged(validIndex, validIndex);
+			break;
+		}
+	}
+}
+
 /** Slots. **/
 
 /**
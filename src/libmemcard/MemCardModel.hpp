@@ -46,6 +46,17 @@ class MemCardModel : public QAbstractListModel
 			COL_MAX
 		};
 
+		/**
+		 * Custom data roles.
+		 */
+		enum Role {
+			// Image in the model's image atlas. (MemCardImageAtlas::Image)
+			// Valid for COL_ICON and COL_BANNER. Animated icons use
+			// the current frame. Qt::DecorationRole has the same image
+			// as a separate QPixmap.
+			AtlasImageRole = Qt::UserRole,
+		};
+
 		// Qt Model/View interface.
 		int rowCount(const QModelIndex& parent = QModelIndex()) const final;
 		int columnCount(const QModelIndex& parent = QModelIndex()) const final;
@@ -113,6 +124,12 @@ class MemCardModel : public QAbstractListModel
 		 */
 		void card_filesRemoved_slot(void);
 
+		/**
+		 * A File's checksum values have changed.
+		 * The File is determined using sender().
+		 */
+		void file_checksumValuesChanged_slot(void);
+
 		/**
 		 * The system theme has changed.
 		 */
@@ -32,6 +32,9 @@ using std::vector;
 #include <QtCore/QTextCodec>
 #include <QtCore/QFile>
 #include <QtCore/QIODevice>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
 
 #define NUM_ELEMENTS(x) ((int)(sizeof(x) / sizeof(x[0])))
 
@@ -87,6 +90,7 @@ class VmuFilePrivate : public FilePrivate
 		QString dc_desc;
 
 		// VMU icons. (ICONDATA_VMS)
+		// Loaded by loadIconInfo(), and not changed afterwards.
 		// NOTE: These must NOT be the same as
 		// gcBanner or any icon in gcIcons.
 		bool isIconData;
@@ -94,16 +98,32 @@ class VmuFilePrivate : public FilePrivate
 		GcImage *vmu_icon_color;
 
 		/**
-		 * Load the banner image.
+		 * Load the icon information.
+		 * This sets iconSpeed, iconAnimMode, and iconMask
+		 * without decoding the icons.
+		 */
+		void loadIconInfo(void) final;
+
+		/**
+		 * Get the location of the banner and icon image data in the file.
+		 * This doesn't read from the card.
+		 * @return Image data range. (blockCount is 0 if there's no image data, or if it's out of range.)
+		 */
+		ImageDataRange imageDataRange(void) const final;
+
+		/**
+		 * Decode the banner image.
+		 * @param imgData Image data from readImageData().
 		 * @return GcImage containing the banner image, or nullptr on error.
 		 */
-		GcImage *loadBannerImage(void) final;
+		GcImage *decodeBannerImage(const QByteArray &imgData) const final;
 
 		/**
-		 * Load the icon images.
+		 * Decode the icon images.
+		 * @param imgData Image data from readImageData().
 		 * @return QVector<GcImage*> containing the icon images, or empty QVector on error.
 		 */
-		QVector<GcImage*> loadIconImages(void) final;
+		QVector<GcImage*> decodeIconImages(const QByteArray &imgData) const final;
 
 		/**
 		 * Load the icon images.
@@ -114,6 +134,15 @@ class VmuFilePrivate : public FilePrivate
 		 * check those variables afterwards.
 		 */
 		void loadIconImages_ICONDATA_VMS(void);
+
+		/**
+		 * Get the checksum plan for a data file.
+		 * Plans are shared by all data files of the same length,
+		 * so loading a full VMU only compiles a few plans.
+		 * @param length File length, in bytes.
+		 * @return Checksum plan.
+		 */
+		static QSharedPointer<const ChecksumPlan> dataFileChecksumPlan(uint32_t length);
 };
 
 /**
@@ -285,15 +314,104 @@ void VmuFilePrivate::loadFileInfo(void)
 		description = filename + QChar(L'\0') + dc_desc;
 	}
 
-	// Load the banner and icon images.
-	loadImages();
+	// Load the icon information.
+	// The images are decoded on demand.
+	loadIconInfo();
 }
 
 /**
- * Load the banner image.
- * @return GcImage* containing the banner image, or nullptr on error.
+ * Load the icon information.
+ * This sets iconSpeed, iconAnimMode, and iconMask
+ * without decoding the icons.
  */
-GcImage *VmuFilePrivate::loadBannerImage(void)
+void VmuFilePrivate::loadIconInfo(void)
+{
+	// DC only supports looping icon animations.
+	// TODO: Use system-independent values?
+	this->iconAnimMode = 0;
+	this->iconSpeed.clear();
+	this->iconMask = 0;
+
+	if (isIconData) {
+		// ICONDATA_VMS
+		// VmuCard uses these icons for the card icon,
+		// so they're always loaded.
+		loadIconImages_ICONDATA_VMS();
+		if (vmu_icon_color || vmu_icon_mono) {
+			this->iconMask = 1;
+		}
+		return;
+	}
+
+	if (!fileHeader || fileHeader->icon_count == 0) {
+		// No file header or icons.
+		return;
+	}
+
+	// Sanity check: Clamp to 8 icons maximum.
+	int iconCount = fileHeader->icon_count;
+	if (iconCount > 8)
+		iconCount = 8;
+
+	// Make sure the icons are actually in the file.
+	const int blockSize = card->blockSize();
+	const int iconEnd = (dirEntry->header_addr * blockSize) +
+			    sizeof(*fileHeader) + sizeof(vmu_icon_palette) +
+			    (sizeof(vmu_icon_data) * iconCount);
+	if (this->size() * blockSize < iconEnd) {
+		// File is too small.
+		return;
+	}
+
+	for (int i = 0; i < iconCount; i++) {
+		// TODO: Convert DC icon speed to system-independent value.
+		this->iconSpeed.append(3);
+	}
+	this->iconMask = (uint8_t)((1U << iconCount) - 1);
+}
+
+/**
+ * Get the location of the banner and icon image data in the file.
+ * The image data starts at the file header.
+ * This doesn't read from the card.
+ * @return Image data range. (blockCount is 0 if there's no image data, or if it's out of range.)
+ */
+FilePrivate::ImageDataRange VmuFilePrivate::imageDataRange(void) const
+{
+	ImageDataRange range;
+	if (isIconData || !fileHeader) {
+		// ICONDATA_VMS icons are loaded by loadIconInfo().
+		// Other files must have a file header.
+		return range;
+	}
+
+	if (fileHeader->icon_count == 0 &&
+	    fileHeader->eyecatch_type != VMU_EYECATCH_PALETTE_16)
+	{
+		// No supported images.
+		return range;
+	}
+
+	if (this->size() > card->totalUserBlocks() ||
+	    dirEntry->header_addr >= this->size())
+	{
+		// File header is out of range.
+		return range;
+	}
+
+	// Image offsets are relative to the file header.
+	// TODO: Optimize by only reading in required data.
+	range.blockStart = dirEntry->header_addr;
+	range.blockCount = this->size() - dirEntry->header_addr;
+	return range;
+}
+
+/**
+ * Decode the banner image.
+ * @param imgData Image data from readImageData().
+ * @return GcImage containing the banner image, or nullptr on error.
+ */
+GcImage *VmuFilePrivate::decodeBannerImage(const QByteArray &imgData) const
 {
 	if (isIconData) {
 		// ICONDATA_VMS
@@ -313,15 +431,8 @@ GcImage *VmuFilePrivate::loadBannerImage(void)
 		return nullptr;
 	}
 
-	// Load the file into memory.
-	// TODO: Optimize by only reading in required data.
-	// TODO: Copy over the block code from GcnFile::loadIconImages(),
-	// but move the "read from X to Y" code down to File.
-	QByteArray data = this->loadFileData();
-
 	// Eyecatch start address.
-	int eyecatchStart = (dirEntry->header_addr * card->blockSize());
-	eyecatchStart += sizeof(*fileHeader);
+	int eyecatchStart = sizeof(*fileHeader);
 	if (fileHeader->icon_count > 0) {
 		eyecatchStart += sizeof(vmu_icon_palette);
 		eyecatchStart += (sizeof(vmu_icon_data) * fileHeader->icon_count);
@@ -329,13 +440,13 @@ GcImage *VmuFilePrivate::loadBannerImage(void)
 
 	// TODO: Other variants.
 	const int eyecatchSize = VMU_EYECATCH_PALETTE_16_LEN;
-	if (data.size() < (int)(eyecatchStart + eyecatchSize)) {
+	if (imgData.size() < (int)(eyecatchStart + eyecatchSize)) {
 		// File is too small.
 		// The eyecatch isn't actually there...
 		return nullptr;
 	}
 
-	const vmu_eyecatch_palette_16 *eyecatch16 = (const vmu_eyecatch_palette_16*)(data.data() + eyecatchStart);
+	const vmu_eyecatch_palette_16 *eyecatch16 = (const vmu_eyecatch_palette_16*)(imgData.constData() + eyecatchStart);
 	GcImage *gcImage = DcImageLoader::fromPalette16(
 				VMU_EYECATCH_W, VMU_EYECATCH_H,
 				eyecatch16->eyecatch, sizeof(eyecatch16->eyecatch),
@@ -344,10 +455,11 @@ GcImage *VmuFilePrivate::loadBannerImage(void)
 }
 
 /**
- * Load the icon images.
+ * Decode the icon images.
+ * @param imgData Image data from readImageData().
  * @return QVector<GcImage*> containing the icon images, or empty QVector on error.
  */
-QVector<GcImage*> VmuFilePrivate::loadIconImages(void)
+QVector<GcImage*> VmuFilePrivate::decodeIconImages(const QByteArray &imgData) const
 {
 	if (isIconData) {
 		// ICONDATA_VMS
@@ -358,9 +470,8 @@ QVector<GcImage*> VmuFilePrivate::loadIconImages(void)
 		// file is hidden in the File Manager, so a
 		// custom icon wouldn't be visible.
 
-		// Load the ICONDATA_VMS icons for CardView.
-		// The "regular" icon will be loaded here.
-		loadIconImages_ICONDATA_VMS();
+		// The ICONDATA_VMS icons for CardView were
+		// loaded by loadIconInfo().
 
 		// TODO: If the ICONDATA_VMS icon doesn't start
 		// at 0x60, load a separate icon. For now, just
@@ -381,49 +492,29 @@ QVector<GcImage*> VmuFilePrivate::loadIconImages(void)
 		return ret;
 	}
 
-	// DC only supports looping icon animations.
-	// TODO: Use system-independent values?
-	this->iconAnimMode = 0;
-
-	if (!fileHeader || fileHeader->icon_count == 0) {
-		// No file header or icons.
+	// Icon count was validated by loadIconInfo().
+	const int iconCount = this->iconCount();
+	if (iconCount == 0) {
+		// No icons.
 		return QVector<GcImage*>();
 	}
 
-	// Sanity check: Clamp to 8 icons maximum.
-	int iconCount = fileHeader->icon_count;
-	if (iconCount > 8)
-		iconCount = 8;
-
-	// Load the file into memory.
-	// TODO: Optimize by only reading in required data.
-	// TODO: Copy over the block code from GcnFile::loadIconImages(),
-	// but move the "read from X to Y" code down to File.
-	QByteArray data = this->loadFileData();
-
-	// Icon start address.
-	int iconStart = (dirEntry->header_addr * card->blockSize());
-	iconStart += sizeof(*fileHeader);
-
 	// Calculate the total icon length.
+	const int iconStart = sizeof(*fileHeader);
 	const int totalIconLen = sizeof(vmu_icon_palette) +
 				(sizeof(vmu_icon_data) * iconCount);
-	if (data.size() < (int)(iconStart + totalIconLen)) {
+	if (imgData.size() < (int)(iconStart + totalIconLen)) {
 		// File is too small.
 		// The icons aren't actually there...
 		return QVector<GcImage*>();
 	}
 
-	const char *pIconStart = (data.data() + iconStart);
+	const char *pIconStart = (imgData.constData() + iconStart);
 	const vmu_icon_palette *palette = (const vmu_icon_palette*)pIconStart;
 	const vmu_icon_data *iconData = (const vmu_icon_data*)(pIconStart + sizeof(*palette));
 	QVector<GcImage*> gcImages;
-	// TODO: Should be part of a struct that's returned...
-	this->iconSpeed.clear();
+	gcImages.reserve(iconCount);
 	for (int i = 0; i < iconCount; i++, iconData++) {
-		// TODO: Should be part of a struct that's returned...
-		// TODO: Convert DC icon speed to system-independent value.
-		this->iconSpeed.append(3);
 		GcImage *gcImage = DcImageLoader::fromPalette16(
 					VMU_ICON_W, VMU_ICON_H,
 					iconData->icon, sizeof(iconData->icon),
@@ -456,7 +547,7 @@ void VmuFilePrivate::loadIconImages_ICONDATA_VMS(void)
 
 	// Load the file into memory.
 	// TODO: Optimize by only reading in required data.
-	// TODO: Copy over the block code from GcnFile::loadIconImages(),
+	// TODO: Copy over the block code from GcnFile::imageDataRange(),
 	// but move the "read from X to Y" code down to File.
 	QByteArray data = this->loadFileData();
 
@@ -505,6 +596,37 @@ void VmuFilePrivate::loadIconImages_ICONDATA_VMS(void)
 	}
 }
 
+/**
+ * Get the checksum plan for a data file.
+ * Plans are shared by all data files of the same length,
+ * so loading a full VMU only compiles a few plans.
+ * @param length File length, in bytes.
+ * @return Checksum plan.
+ */
+QSharedPointer<const ChecksumPlan> VmuFilePrivate::dataFileChecksumPlan(uint32_t length)
+{
+	static QMutex plansMutex;
+	static QHash<uint32_t, QSharedPointer<const ChecksumPlan> > plans;
+
+	QMutexLocker locker(&plansMutex);
+	QSharedPointer<const ChecksumPlan> &plan = plans[length];
+	if (!plan) {
+		// The header's CRC covers the entire file.
+		Checksum::ChecksumDef checksumDef;
+		checksumDef.algorithm = Checksum::CHKALG_DREAMCASTVMU;
+		checksumDef.address = 0x46;
+		checksumDef.param = 0x46;
+		checksumDef.start = 0;
+		checksumDef.length = length;
+		checksumDef.endian = Checksum::CHKENDIAN_LITTLE;
+
+		vector<Checksum::ChecksumDef> checksumDefs;
+		checksumDefs.push_back(checksumDef);
+		plan.reset(new ChecksumPlan(checksumDefs));
+	}
+	return plan;
+}
+
 /** VmuFile **/
 
 /**
@@ -526,18 +648,8 @@ VmuFile::VmuFile(VmuCard *card,
 	Q_D(VmuFile);
 	if (d->dirEntry->filetype == VMU_DIR_FILETYPE_DATA) {
 		// Data file. Verify the header's CRC.
-		Checksum::ChecksumDef checksumDef;
-		checksumDef.algorithm = Checksum::CHKALG_DREAMCASTVMU;
-		checksumDef.address = 0x46;
-		checksumDef.param = 0x46;
-		checksumDef.start = 0;
-		checksumDef.length = (this->size() * card->blockSize());
-		checksumDef.endian = Checksum::CHKENDIAN_LITTLE;
-
-		// TODO: Optimize this?
-		QVector<Checksum::ChecksumDef> checksumDefs;
-		checksumDefs.append(checksumDef);
-		setChecksumDefs(checksumDefs);
+		setChecksumPlan(VmuFilePrivate::dataFileChecksumPlan(
+			(uint32_t)(this->size() * card->blockSize())));
 	}
 }
 
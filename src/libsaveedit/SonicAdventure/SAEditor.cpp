@@ -100,6 +100,14 @@ class SAEditorPrivate : public EditorWidgetPrivate
 		 */
 		void saveCurrentSlot(void);
 
+		/**
+		 * Make sure the file has checksum definitions
+		 * for the save slots, so File::write() and
+		 * File::fixChecksums() keep them current.
+		 * Existing checksum definitions are kept.
+		 */
+		void addSlotChecksumDefs(void);
+
 		/**
 		 * Byteswap an sa_save_slot.
 		 * @param sa_save sa_save_slot.
@@ -331,6 +339,63 @@ void SAEditorPrivate::saveCurrentSlot(void)
 	}
 }
 
+/**
+ * Make sure the file has checksum definitions
+ * for the save slots, so File::write() and
+ * File::fixChecksums() keep them current.
+ * Existing checksum definitions are kept.
+ */
+void SAEditorPrivate::addSlotChecksumDefs(void)
+{
+	// Each save slot has a CRC-16, stored right before the
+	// slot data. The DC version's VMS checksum is handled
+	// by VmuFile.
+	QVector<Checksum::ChecksumDef> slotDefs;
+	Checksum::ChecksumDef checksumDef;
+	checksumDef.algorithm = Checksum::CHKALG_CRC16;
+	if (qobject_cast<VmuFile*>(file) != nullptr) {
+		// DC version: Three slots. (little-endian)
+		checksumDef.endian = Checksum::CHKENDIAN_LITTLE;
+		checksumDef.length = sizeof(sa_save_slot) - 4;
+		for (int i = 0; i < 3; i++) {
+			const uint32_t slotAddress = SA_SAVE_ADDRESS_DC_0 + (i * sizeof(sa_save_slot));
+			checksumDef.address = slotAddress + 2;
+			checksumDef.start = slotAddress + 4;
+			slotDefs.append(checksumDef);
+		}
+	} else if (qobject_cast<GcnFile*>(file) != nullptr) {
+		// GCN version: One slot, including the SADX extras. (big-endian)
+		// NOTE: Stored as uint32_t; only the low 16 bits are used.
+		checksumDef.endian = Checksum::CHKENDIAN_BIG;
+		checksumDef.address = SA_SAVE_ADDRESS_GCN + 2;
+		checksumDef.start = SA_SAVE_ADDRESS_GCN + 4;
+		checksumDef.length = sizeof(sa_save_slot) + sizeof(sadx_extra_save_slot) - 4;
+		slotDefs.append(checksumDef);
+	}
+
+	QVector<Checksum::ChecksumDef> checksumDefs = file->checksumDefs();
+	bool isChanged = false;
+	foreach (const Checksum::ChecksumDef &slotDef, slotDefs) {
+		bool isFound = false;
+		foreach (const Checksum::ChecksumDef &def, checksumDefs) {
+			if (def.algorithm == slotDef.algorithm && def.address == slotDef.address &&
+			    def.start == slotDef.start && def.length == slotDef.length)
+			{
+				isFound = true;
+				break;
+			}
+		}
+		if (!isFound) {
+			checksumDefs.append(slotDef);
+			isChanged = true;
+		}
+	}
+
+	if (isChanged) {
+		file->setChecksumDefs(checksumDefs);
+	}
+}
+
 /**
  * Byteswap an sa_save_slot.
  * @param sa_save sa_save_slot.
@@ -616,27 +681,11 @@ int SAEditor::save(void)
 				// Zero out the data.
 				memset(sa_save, 0, sizeof(*sa_save));
 			}
-
-			// Update the checksums.
-			// TODO: Not tested!
-			// Note that there are two sets of checksums:
-			// - Game checksum (CRC-16) [one per slot]
-			// - VMS checksum (custom)
-			uint8_t *src = (uint8_t*)data.data() + SA_SAVE_ADDRESS_DC_0;
-			for (int i = 0; i < 3; i++, src += sizeof(*sa_save)) {
-				uint16_t crc16 = Checksum::Crc16(src + 4, sizeof(*sa_save) - 4);
-				crc16 = cpu_to_le16(crc16);
-				memcpy(src + 2, &crc16, sizeof(crc16));
-			}
-
-			// VMS checksum.
-			uint16_t vmschk = Checksum::DreamcastVMU(src, data.size(), 0x46);
-			vmschk = cpu_to_le16(vmschk);
-			memcpy(&src[0x46], &vmschk, sizeof(vmschk));
-
-			// Save slots copied.
-			// Now it needs to be written to the file.
 		}
+
+		// Save slots copied.
+		// Now it needs to be written to the file.
+		ret = 0;
 	} else if (qobject_cast<GcnFile*>(d->file) != nullptr) {
 		// GameCube verison.
 
@@ -674,12 +723,6 @@ int SAEditor::save(void)
 			memset(sadx_extra_save, 0, sizeof(*sadx_extra_save));
 		}
 
-		// Update the checksum.
-		uint16_t crc16 = Checksum::Crc16((const uint8_t*)data.data() + SA_SAVE_ADDRESS_GCN + 4,
-			sizeof(*sa_save) + sizeof(*sadx_extra_save) - 4);
-		crc16 = cpu_to_be16(crc16);
-		memcpy(data.data() + 0x1442, &crc16, sizeof(crc16));
-
 		// Save slots copied.
 		// Now it needs to be written to the file.
 		ret = 0;
@@ -690,8 +733,14 @@ int SAEditor::save(void)
 		goto end;
 	}
 
-	// Write the data.
-	ret = d->file->write(0, data.data(), data.size());
+	// Write the data, then update the checksums.
+	// File::write() keeps the checksum values current,
+	// so fixChecksums() only has to write the stored fields.
+	d->addSlotChecksumDefs();
+	ret = d->file->write(0, data.constData(), data.size());
+	if (ret == 0) {
+		ret = d->file->fixChecksums();
+	}
 
 end:
 	return ret;
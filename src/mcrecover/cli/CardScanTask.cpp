@@ -0,0 +1,249 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program.                                  *
+ * CardScanTask.cpp: Headless memory card scan task.                       *
+ *                                                                         *
+ * Copyright (c) 2013-2018 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "CardScanTask.hpp"
+
+// GcnCard
+#include "libmemcard/GcnCard.hpp"
+#include "libmemcard/GcnFile.hpp"
+
+// GCN Memory Card File Database
+#include "db/GcnSearchWorker.hpp"
+
+// Checksum algorithm class.
+#include "Checksum.hpp"
+
+// C++ includes.
+#include <memory>
+using std::unique_ptr;
+
+// Qt includes.
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QMutexLocker>
+
+/** CardScanReporter **/
+
+CardScanReporter::CardScanReporter(FILE *out)
+	: out(out)
+	, cards(0)
+	, cardsFailed(0)
+	, lostFilesFound(0)
+	, filesExported(0)
+	, exportErrors(0)
+{ }
+
+/**
+ * Write a JSON object as a single line.
+ * Caller must hold the mutex.
+ * @param obj JSON object.
+ */
+void CardScanReporter::writeLine(const QJsonObject &obj)
+{
+	const QByteArray json = QJsonDocument(obj).toJson(QJsonDocument::Compact);
+	fwrite(json.constData(), 1, json.size(), out);
+	fputc('\n', out);
+	fflush(out);
+}
+
+/**
+ * Report a card scan result.
+ * @param result Card scan result.
+ */
+void CardScanReporter::report(const QJsonObject &result)
+{
+	QMutexLocker locker(&mutex);
+	cards++;
+	if (result.value(QLatin1String("status")).toString() != QLatin1String("ok")) {
+		cardsFailed++;
+	}
+	lostFilesFound += result.value(QLatin1String("lostFilesFound")).toInt();
+	filesExported += result.value(QLatin1String("filesExported")).toInt();
+	exportErrors += result.value(QLatin1String("exportErrors")).toInt();
+	writeLine(result);
+}
+
+/**
+ * Write the summary of all reported results.
+ */
+void CardScanReporter::writeSummary(void)
+{
+	QMutexLocker locker(&mutex);
+	QJsonObject summary;
+	summary.insert(QLatin1String("cards"), cards);
+	summary.insert(QLatin1String("cardsFailed"), cardsFailed);
+	summary.insert(QLatin1String("lostFilesFound"), lostFilesFound);
+	summary.insert(QLatin1String("filesExported"), filesExported);
+	summary.insert(QLatin1String("exportErrors"), exportErrors);
+
+	QJsonObject obj;
+	obj.insert(QLatin1String("summary"), summary);
+	writeLine(obj);
+}
+
+/**
+ * Were all cards scanned and exported successfully?
+ * @return True if all cards were successful; false if not.
+ */
+bool CardScanReporter::isSuccessful(void) const
+{
+	QMutexLocker locker(&mutex);
+	return (cardsFailed == 0 && exportErrors == 0);
+}
+
+/** CardScanTask **/
+
+/**
+ * Create a CardScanTask.
+ * @param scanOptions Scan options. (must remain valid until the task is done)
+ * @param cardFile Memory card image filename.
+ * @param outDir Output directory for exported files.
+ * @param scanReporter Result reporter.
+ */
+CardScanTask::CardScanTask(const CardScanOptions *scanOptions,
+		const QString &cardFile,
+		const QString &outDir,
+		CardScanReporter *scanReporter)
+	: options(scanOptions)
+	, cardFilename(cardFile)
+	, outputDir(outDir)
+	, reporter(scanReporter)
+{ }
+
+/**
+ * Get the name of a checksum status.
+ * @param status Checksum status.
+ * @return Name of the checksum status.
+ */
+static QString ChkStatusName(Checksum::ChkStatus status)
+{
+	switch (status) {
+		case Checksum::CHKST_GOOD:
+			return QLatin1String("good");
+		case Checksum::CHKST_INVALID:
+			return QLatin1String("invalid");
+		case Checksum::CHKST_UNKNOWN:
+		default:
+			return QLatin1String("unknown");
+	}
+}
+
+void CardScanTask::run(void)
+{
+	QJsonObject result;
+	result.insert(QLatin1String("card"), cardFilename);
+
+	// Open the memory card.
+	// NOTE: The card must be deleted in this thread.
+	unique_ptr<GcnCard> card(GcnCard::open(cardFilename, nullptr));
+	if (!card->isOpen()) {
+		result.insert(QLatin1String("status"), QLatin1String("error"));
+		result.insert(QLatin1String("error"), card->errorString());
+		reporter->report(result);
+		return;
+	}
+
+	// Search the memory card.
+	GcnSearchWorker worker;
+	worker.setCard(card.get());
+	worker.setDatabases(options->databases);
+	worker.setPreferredRegion(options->preferredRegion);
+	worker.setSearchUsedBlocks(options->searchUsedBlocks);
+	worker.setMaxThreadCount(options->searchThreadCount);
+	int ret = worker.searchMemCard();
+	if (ret < 0) {
+		result.insert(QLatin1String("status"), QLatin1String("error"));
+		result.insert(QLatin1String("error"), worker.errorString());
+		reporter->report(result);
+		return;
+	}
+
+	// Add the "lost" files to the card.
+	const QList<GcnFile*> files = card->addLostFiles(worker.filesFoundList());
+
+	if (options->exportFiles && !files.isEmpty()) {
+		if (!QDir().mkpath(outputDir)) {
+			result.insert(QLatin1String("status"), QLatin1String("error"));
+			result.insert(QLatin1String("error"),
+				QLatin1String("Unable to create output directory: ") + outputDir);
+			reporter->report(result);
+			return;
+		}
+		result.insert(QLatin1String("outputDir"), outputDir);
+	}
+
+	int filesExported = 0;
+	int exportErrors = 0;
+	QJsonArray jsonFiles;
+	foreach (GcnFile *file, files) {
+		QJsonObject jsonFile;
+		jsonFile.insert(QLatin1String("filename"), file->filename());
+		jsonFile.insert(QLatin1String("gameID"), file->gameID());
+
+		// Description may contain a '\0' to separate
+		// the game description from the file description.
+		const QString description = file->description();
+		const int nulPos = description.indexOf(QChar(L'\0'));
+		if (nulPos >= 0) {
+			jsonFile.insert(QLatin1String("gameDesc"), description.left(nulPos));
+			jsonFile.insert(QLatin1String("fileDesc"), description.mid(nulPos + 1));
+		} else {
+			jsonFile.insert(QLatin1String("gameDesc"), description);
+		}
+
+		jsonFile.insert(QLatin1String("blocks"), file->size());
+		jsonFile.insert(QLatin1String("checksum"), ChkStatusName(file->checksumStatus()));
+
+		if (options->exportFiles) {
+			const QString filename = outputDir + QChar(L'/') + file->defaultExportFilename();
+			jsonFile.insert(QLatin1String("export"), filename);
+
+			QString exportStatus;
+			if (!options->overwrite && QFile::exists(filename)) {
+				// Don't overwrite existing files.
+				exportStatus = QLatin1String("exists");
+			} else if (file->exportToFile(filename) == 0) {
+				exportStatus = QLatin1String("ok");
+				filesExported++;
+			} else {
+				exportStatus = QLatin1String("error");
+				exportErrors++;
+			}
+			jsonFile.insert(QLatin1String("exportStatus"), exportStatus);
+
+			// Banner and icon filenames don't include the extension.
+			QString filenameNoExt = filename;
+			const int dotPos = filenameNoExt.lastIndexOf(QChar(L'.'));
+			if (dotPos > filenameNoExt.lastIndexOf(QChar(L'/'))) {
+				filenameNoExt.truncate(dotPos);
+			}
+
+			// Extract the banner.
+			// NOTE: Not all files have banners, so errors are ignored.
+			if (options->extractBanners) {
+				file->saveBanner(filenameNoExt + QLatin1String(".banner"));
+			}
+
+			// Extract the icon.
+			if (options->extractIcons && file->iconCount() >= 1) {
+				file->saveIcon(filenameNoExt + QLatin1String(".icon"), options->animImgf);
+			}
+		}
+
+		jsonFiles.append(jsonFile);
+	}
+
+	result.insert(QLatin1String("status"), QLatin1String("ok"));
+	result.insert(QLatin1String("lostFilesFound"), files.size());
+	result.insert(QLatin1String("filesExported"), filesExported);
+	result.insert(QLatin1String("exportErrors"), exportErrors);
+	result.insert(QLatin1String("files"), jsonFiles);
+	reporter->report(result);
+}
@@ -0,0 +1,137 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program.                                  *
+ * CardScanTask.hpp: Headless memory card scan task.                       *
+ *                                                                         *
+ * Copyright (c) 2013-2018 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __MCRECOVER_CLI_CARDSCANTASK_HPP__
+#define __MCRECOVER_CLI_CARDSCANTASK_HPP__
+
+// GcImageWriter::AnimImageFormat
+#include "GcImageWriter.hpp"
+
+// C includes.
+#include <stdio.h>
+
+// Qt includes.
+#include <QtCore/QJsonObject>
+#include <QtCore/QMutex>
+#include <QtCore/QRunnable>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+class GcnMcFileDb;
+
+/**
+ * Options shared by all CardScanTasks.
+ */
+struct CardScanOptions {
+	// Databases. (must remain loaded until all tasks are done)
+	QVector<GcnMcFileDb*> databases;
+
+	char preferredRegion;		// Preferred region. (0 for none)
+	bool searchUsedBlocks;		// Search used blocks in addition to free blocks.
+	int searchThreadCount;		// Threads to use for each card's search.
+
+	bool exportFiles;		// Export recovered files as GCIs.
+	bool extractBanners;		// Extract banners.
+	bool extractIcons;		// Extract icons.
+	bool overwrite;			// Overwrite existing files.
+	GcImageWriter::AnimImageFormat animImgf;	// Animated icon format.
+
+	CardScanOptions()
+		: preferredRegion(0)
+		, searchUsedBlocks(false)
+		, searchThreadCount(1)
+		, exportFiles(true)
+		, extractBanners(false)
+		, extractIcons(false)
+		, overwrite(false)
+		, animImgf(GcImageWriter::ANIMGF_APNG) { }
+};
+
+/**
+ * Collects CardScanTask results and writes
+ * them to a stream as JSON, one line per card.
+ * This class is thread-safe.
+ */
+class CardScanReporter
+{
+	public:
+		explicit CardScanReporter(FILE *out);
+
+	private:
+		Q_DISABLE_COPY(CardScanReporter)
+
+	public:
+		/**
+		 * Report a card scan result.
+		 * @param result Card scan result.
+		 */
+		void report(const QJsonObject &result);
+
+		/**
+		 * Write the summary of all reported results.
+		 */
+		void writeSummary(void);
+
+		/**
+		 * Were all cards scanned and exported successfully?
+		 * @return True if all cards were successful; false if not.
+		 */
+		bool isSuccessful(void) const;
+
+	private:
+		FILE *const out;
+		mutable QMutex mutex;
+
+		// Summary counters.
+		int cards;
+		int cardsFailed;
+		int lostFilesFound;
+		int filesExported;
+		int exportErrors;
+
+		/**
+		 * Write a JSON object as a single line.
+		 * Caller must hold the mutex.
+		 * @param obj JSON object.
+		 */
+		void writeLine(const QJsonObject &obj);
+};
+
+/**
+ * Scan a single memory card image for "lost" files
+ * and export them. Results are sent to a CardScanReporter.
+ */
+class CardScanTask : public QRunnable
+{
+	public:
+		/**
+		 * Create a CardScanTask.
+		 * @param options Scan options. (must remain valid until the task is done)
+		 * @param cardFilename Memory card image filename.
+		 * @param outputDir Output directory for exported files.
+		 * @param reporter Result reporter.
+		 */
+		CardScanTask(const CardScanOptions *options,
+			const QString &cardFilename,
+			const QString &outputDir,
+			CardScanReporter *reporter);
+
+	private:
+		Q_DISABLE_COPY(CardScanTask)
+
+	public:
+		void run(void) final;
+
+	private:
+		const CardScanOptions *const options;
+		const QString cardFilename;
+		const QString outputDir;
+		CardScanReporter *const reporter;
+};
+
+#endif /* __MCRECOVER_CLI_CARDSCANTASK_HPP__ */
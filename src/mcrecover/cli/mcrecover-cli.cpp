@@ -0,0 +1,264 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program.                                  *
+ * mcrecover-cli.cpp: Headless command-line program.                       *
+ *                                                                         *
+ * Copyright (c) 2011-2018 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+/**
+ * mcrecover-cli scans GameCube memory card images for "lost"
+ * files and exports them without a GUI. It's intended for
+ * processing memory card dumps in bulk.
+ *
+ * Results are written to stdout as JSON, one line per card,
+ * followed by a summary line. Diagnostic messages are
+ * written to stderr.
+ *
+ * NOTE: No QWidgets may be used here.
+ */
+
+#include "CardScanTask.hpp"
+
+// GCN Memory Card File Database
+#include "db/GcnMcFileDb.hpp"
+#include "db/GcnMcFileDbManager.hpp"
+
+// C includes.
+#include <stdio.h>
+#include <stdlib.h>
+
+// C++ includes.
+#include <algorithm>
+
+// Qt includes.
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QDir>
+#include <QtCore/QDirIterator>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSet>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+#include <QtGui/QGuiApplication>
+
+/**
+ * Exit status codes.
+ */
+enum CliExitStatus {
+	CLI_EXIT_SUCCESS	= 0,	// All cards were scanned and exported.
+	CLI_EXIT_CARD_ERRORS	= 1,	// One or more cards or exports failed.
+	CLI_EXIT_USAGE		= 2,	// Invalid command line arguments.
+	CLI_EXIT_DB_ERROR	= 3,	// Databases could not be loaded.
+};
+
+/**
+ * Find memory card images in the specified paths.
+ * Directories are searched for *.raw files.
+ * @param paths Files and directories.
+ * @param recursive If true, search subdirectories.
+ * @return Memory card image filenames.
+ */
+static QStringList FindCardImages(const QStringList &paths, bool recursive)
+{
+	QStringList cardFilenames;
+	const QStringList nameFilters(QLatin1String("*.raw"));
+
+	foreach (const QString &path, paths) {
+		const QFileInfo fileInfo(path);
+		if (!fileInfo.isDir()) {
+			// Regular file. (or nonexistent; the task will report an error)
+			cardFilenames.append(QDir::fromNativeSeparators(path));
+			continue;
+		}
+
+		// Directory. Sort the results so the order is consistent.
+		QStringList dirFilenames;
+		QDirIterator iter(path, nameFilters, QDir::Files,
+			(recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags));
+		while (iter.hasNext()) {
+			dirFilenames.append(iter.next());
+		}
+		dirFilenames.sort();
+		cardFilenames += dirFilenames;
+	}
+
+	return cardFilenames;
+}
+
+/**
+ * Main entry point.
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ * @return CliExitStatus.
+ */
+int main(int argc, char *argv[])
+{
+	// libmemcard uses QPixmap for banners and icons, which
+	// requires QGuiApplication. Use the offscreen platform
+	// plugin so a display server isn't required.
+	if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+	}
+
+	QGuiApplication app(argc, argv);
+	QCoreApplication::setOrganizationName(QLatin1String("GerbilSoft"));
+	QCoreApplication::setApplicationName(QLatin1String("mcrecover-cli"));
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription(QLatin1String(
+		"Scan GameCube memory card images for lost files."));
+	const QCommandLineOption helpOption = parser.addHelpOption();
+	parser.addPositionalArgument(QLatin1String("paths"),
+		QLatin1String("Memory card images, or directories containing *.raw files."),
+		QLatin1String("paths..."));
+
+	const QCommandLineOption outputOption(QStringList() << QLatin1String("o") << QLatin1String("output"),
+		QLatin1String("Output directory. Files are exported to a subdirectory for each card."),
+		QLatin1String("dir"), QLatin1String("."));
+	const QCommandLineOption jobsOption(QStringList() << QLatin1String("j") << QLatin1String("jobs"),
+		QLatin1String("Number of cards to scan concurrently. (default is the number of CPUs)"),
+		QLatin1String("n"));
+	const QCommandLineOption recursiveOption(QStringList() << QLatin1String("r") << QLatin1String("recursive"),
+		QLatin1String("Search directories recursively."));
+	const QCommandLineOption dbOption(QLatin1String("db"),
+		QLatin1String("Use the specified database file. May be specified multiple times."),
+		QLatin1String("file"));
+	const QCommandLineOption regionOption(QLatin1String("region"),
+		QLatin1String("Preferred region: E, P, J, or K."),
+		QLatin1String("region"));
+	const QCommandLineOption usedBlocksOption(QLatin1String("search-used-blocks"),
+		QLatin1String("Search used blocks in addition to free blocks."));
+	const QCommandLineOption noExportOption(QLatin1String("no-export"),
+		QLatin1String("Scan only; don't export recovered files."));
+	const QCommandLineOption overwriteOption(QLatin1String("overwrite"),
+		QLatin1String("Overwrite existing files."));
+	const QCommandLineOption bannersOption(QLatin1String("banners"),
+		QLatin1String("Extract banners."));
+	const QCommandLineOption iconsOption(QLatin1String("icons"),
+		QLatin1String("Extract icons."));
+	const QCommandLineOption iconFormatOption(QLatin1String("icon-format"),
+		QLatin1String("Animated icon format: APNG, GIF, PNG-FPF, PNG-VS, or PNG-HS."),
+		QLatin1String("format"), QLatin1String("APNG"));
+
+	parser.addOption(outputOption);
+	parser.addOption(jobsOption);
+	parser.addOption(recursiveOption);
+	parser.addOption(dbOption);
+	parser.addOption(regionOption);
+	parser.addOption(usedBlocksOption);
+	parser.addOption(noExportOption);
+	parser.addOption(overwriteOption);
+	parser.addOption(bannersOption);
+	parser.addOption(iconsOption);
+	parser.addOption(iconFormatOption);
+
+	if (!parser.parse(QCoreApplication::arguments())) {
+		fprintf(stderr, "mcrecover-cli: %s\n", parser.errorText().toLocal8Bit().constData());
+		return CLI_EXIT_USAGE;
+	}
+	if (parser.isSet(helpOption)) {
+		fputs(parser.helpText().toLocal8Bit().constData(), stdout);
+		return CLI_EXIT_SUCCESS;
+	}
+
+	// Scan options.
+	CardScanOptions options;
+	options.searchUsedBlocks = parser.isSet(usedBlocksOption);
+	options.exportFiles = !parser.isSet(noExportOption);
+	options.overwrite = parser.isSet(overwriteOption);
+	options.extractBanners = parser.isSet(bannersOption);
+	options.extractIcons = parser.isSet(iconsOption);
+
+	if (parser.isSet(regionOption)) {
+		const QString region = parser.value(regionOption).toUpper();
+		if (region.size() != 1 || !QString(QLatin1String("EPJK")).contains(region)) {
+			fprintf(stderr, "mcrecover-cli: invalid region: %s\n", region.toLocal8Bit().constData());
+			return CLI_EXIT_USAGE;
+		}
+		options.preferredRegion = region.at(0).toLatin1();
+	}
+
+	options.animImgf = GcImageWriter::animImageFormatFromName(
+		parser.value(iconFormatOption).toLatin1().constData());
+	if (options.extractIcons &&
+	    (options.animImgf == GcImageWriter::ANIMGF_UNKNOWN ||
+	     !GcImageWriter::isAnimImageFormatSupported(options.animImgf)))
+	{
+		fprintf(stderr, "mcrecover-cli: unsupported icon format: %s\n",
+			parser.value(iconFormatOption).toLocal8Bit().constData());
+		return CLI_EXIT_USAGE;
+	}
+
+	int jobs = QThread::idealThreadCount();
+	if (parser.isSet(jobsOption)) {
+		bool ok = false;
+		jobs = parser.value(jobsOption).toInt(&ok);
+		if (!ok || jobs <= 0) {
+			fprintf(stderr, "mcrecover-cli: invalid job count: %s\n",
+				parser.value(jobsOption).toLocal8Bit().constData());
+			return CLI_EXIT_USAGE;
+		}
+	}
+	if (jobs <= 0) {
+		jobs = 1;
+	}
+
+	// Find the memory card images.
+	const QStringList cardFilenames = FindCardImages(
+		parser.positionalArguments(), parser.isSet(recursiveOption));
+	if (cardFilenames.isEmpty()) {
+		fprintf(stderr, "mcrecover-cli: no memory card images specified\n");
+		return CLI_EXIT_USAGE;
+	}
+
+	// Load the databases.
+	QVector<QString> dbFilenames;
+	if (parser.isSet(dbOption)) {
+		foreach (const QString &dbFilename, parser.values(dbOption)) {
+			dbFilenames.append(QDir::fromNativeSeparators(dbFilename));
+		}
+	} else {
+		dbFilenames = GcnMcFileDb::GetDbFilenames();
+	}
+	if (dbFilenames.isEmpty() ||
+	    GcnMcFileDbManager::instance()->load(dbFilenames) != 0)
+	{
+		fprintf(stderr, "mcrecover-cli: unable to load the GCN MemCard file databases\n");
+		return CLI_EXIT_DB_ERROR;
+	}
+
+	// NOTE: Keep a reference to the databases until all tasks are done.
+	const QVector<QSharedPointer<GcnMcFileDb> > dbs = GcnMcFileDbManager::instance()->databases();
+	options.databases.reserve(dbs.size());
+	foreach (const QSharedPointer<GcnMcFileDb> &db, dbs) {
+		options.databases.append(db.data());
+	}
+
+	// Split the threads between concurrent cards and each card's search.
+	jobs = std::min(jobs, cardFilenames.size());
+	options.searchThreadCount = std::max(1, QThread::idealThreadCount() / jobs);
+
+	// Scan the cards.
+	QThreadPool threadPool;
+	threadPool.setMaxThreadCount(jobs);
+	CardScanReporter reporter(stdout);
+
+	const QDir outputDir(parser.value(outputOption));
+	QSet<QString> usedOutputDirs;
+	foreach (const QString &cardFilename, cardFilenames) {
+		// Each card gets its own output directory, named after the card.
+		// If multiple cards have the same name, add a suffix.
+		const QString baseName = QFileInfo(cardFilename).completeBaseName();
+		QString cardOutputDir = outputDir.absoluteFilePath(baseName);
+		for (int i = 2; usedOutputDirs.contains(cardOutputDir); i++) {
+			cardOutputDir = outputDir.absoluteFilePath(baseName + QChar(L'_') + QString::number(i));
+		}
+		usedOutputDirs.insert(cardOutputDir);
+
+		threadPool.start(new CardScanTask(&options, cardFilename, cardOutputDir, &reporter));
+	}
+	threadPool.waitForDone();
+
+	reporter.writeSummary();
+	return (reporter.isSuccessful() ? CLI_EXIT_SUCCESS : CLI_EXIT_CARD_ERRORS);
+}
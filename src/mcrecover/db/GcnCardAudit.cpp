@@ -0,0 +1,703 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program.                                  *
+ * GcnCardAudit.cpp: Parallel integrity audit for GCN memory cards.        *
+ *                                                                         *
+ * Copyright (c) 2013-2018 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "GcnCardAudit.hpp"
+
+// GcnCard
+#include "libmemcard/GcnCard.hpp"
+#include "libmemcard/GcnFile.hpp"
+
+// GCN Memory Card File Database.
+#include "db/GcnMcFileDb.hpp"
+#include "db/GcnMcFileDbManager.hpp"
+
+// Card definitions.
+#include "card.h"
+#include "util/array_size.h"
+
+// Checksum algorithm class.
+#include "libgctools/ChecksumPlan.hpp"
+
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstring>
+
+// C++ includes.
+#include <algorithm>
+#include <vector>
+
+// Qt includes.
+#include <QtCore/QAtomicInt>
+#include <QtCore/QFile>
+#include <QtCore/QPointer>
+#include <QtCore/QRunnable>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+
+/**
+ * Snapshot of a card being audited.
+ * Everything needed by the tasks is copied here,
+ * so the tasks never access the GcnCard.
+ */
+struct GcnCardAuditCard {
+	QPointer<GcnCard> card;
+	QString filename;
+
+	// Card image. (all physical blocks)
+	// If the card is memory-mapped, the tasks read the mapping
+	// directly; otherwise, the card task reads it into image.
+	Card::MappedImage mapping;
+	QByteArray image;
+
+	int blockSize;
+	int totalPhysBlocks;
+	int activeDatIdx;
+	int activeBatIdx;
+	std::vector<int> files;	// Indexes of this card's files in GcnCardAuditState::files.
+	GcnCardAuditResult result;
+
+	/**
+	 * Get the card image data.
+	 * @return Card image data.
+	 */
+	inline const uint8_t *imageData(void) const {
+		return (!mapping.isNull()
+			? mapping.block(0)
+			: reinterpret_cast<const uint8_t*>(image.constData()));
+	}
+
+	/**
+	 * Get the card image size.
+	 * @return Card image size, in bytes.
+	 */
+	inline int imageSize(void) const {
+		return (!mapping.isNull() ? totalPhysBlocks * blockSize : image.size());
+	}
+};
+
+/**
+ * Snapshot of a file being audited.
+ */
+struct GcnCardAuditFile {
+	QPointer<GcnFile> file;
+	int cardIdx;
+	QVector<uint16_t> fatEntries;
+	int length;		// File length, in blocks. (from the directory)
+	bool lostFile;
+	QSharedPointer<const ChecksumPlan> checksumPlan;	// nullptr if not checked
+	std::vector<Checksum::ChecksumValue> checksumValues;
+};
+
+/**
+ * Audit state.
+ * Shared by the tasks, so it outlives a cancelled audit.
+ */
+struct GcnCardAuditState {
+	int generation;
+	QAtomicInt cancelled;
+	std::vector<GcnCardAuditCard> cards;
+	std::vector<GcnCardAuditFile> files;
+
+	explicit GcnCardAuditState(int generation)
+		: generation(generation)
+		, cancelled(0) { }
+};
+
+class GcnCardAuditPrivate
+{
+	public:
+		explicit GcnCardAuditPrivate(GcnCardAudit *q);
+		~GcnCardAuditPrivate();
+
+	protected:
+		GcnCardAudit *const q_ptr;
+		Q_DECLARE_PUBLIC(GcnCardAudit)
+	private:
+		Q_DISABLE_COPY(GcnCardAuditPrivate)
+
+	public:
+		// GCN Memory Card File databases.
+		// These are owned by GcnMcFileDbManager.
+		QVector<QSharedPointer<GcnMcFileDb> > dbs;
+
+		// Thread pool.
+		QThreadPool threadPool;
+		int maxThreadCount;
+
+		// Current audit.
+		QSharedPointer<GcnCardAuditState> state;
+		int generation;
+		int tasksDone;
+		int tasksTotal;
+
+		/**
+		 * Find the checksum definitions for a file.
+		 * @param file GcnFile.
+		 * @return Checksum plan, or nullptr if not found.
+		 */
+		QSharedPointer<const ChecksumPlan> findChecksumPlan(const GcnFile *file) const;
+
+		/**
+		 * Read a card image that isn't memory-mapped.
+		 * Called from a thread pool task.
+		 * @param auditCard Card snapshot.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		static int readCard(GcnCardAuditCard *auditCard);
+
+		/**
+		 * Audit a card's system area.
+		 * Called from a thread pool task.
+		 * @param state Audit state.
+		 * @param auditCard Card snapshot.
+		 */
+		static void auditCard(const GcnCardAuditState *state, GcnCardAuditCard *auditCard);
+
+		/**
+		 * Calculate a file's checksums.
+		 * Called from a thread pool task.
+		 * @param state Audit state.
+		 * @param auditFile File snapshot.
+		 */
+		static void auditFile(const GcnCardAuditState *state, GcnCardAuditFile *auditFile);
+
+		/**
+		 * Start the file tasks for a card.
+		 * The card image must have been read by the card task.
+		 * @param cardIdx Card index.
+		 */
+		void startFileTasks(int cardIdx);
+
+		/**
+		 * Tasks have finished.
+		 * Emits auditProgress() and auditFinished().
+		 * @param count Number of tasks.
+		 */
+		void tasksFinished(int count = 1);
+};
+
+GcnCardAuditPrivate::GcnCardAuditPrivate(GcnCardAudit *q)
+	: q_ptr(q)
+	, maxThreadCount(0)
+	, generation(0)
+	, tasksDone(0)
+	, tasksTotal(0)
+{
+	threadPool.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+GcnCardAuditPrivate::~GcnCardAuditPrivate()
+{
+	// Tasks must finish before the audit state is released.
+	if (state) {
+		state->cancelled.storeRelease(1);
+	}
+	threadPool.waitForDone();
+}
+
+/**
+ * Find the checksum definitions for a file.
+ * @param file GcnFile.
+ * @return Checksum plan, or nullptr if not found.
+ */
+QSharedPointer<const ChecksumPlan> GcnCardAuditPrivate::findChecksumPlan(const GcnFile *file) const
+{
+	foreach (const QSharedPointer<GcnMcFileDb> &db, dbs) {
+		QSharedPointer<const ChecksumPlan> checksumPlan = db->findChecksumPlan(file);
+		if (checksumPlan)
+			return checksumPlan;
+	}
+	return QSharedPointer<const ChecksumPlan>();
+}
+
+/**
+ * Read a card image that isn't memory-mapped.
+ * Called from a thread pool task.
+ * @param auditCard Card snapshot.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int GcnCardAuditPrivate::readCard(GcnCardAuditCard *auditCard)
+{
+	// The card image is read using a separate read-only QFile,
+	// so the GcnCard is never accessed from the thread pool.
+	// NOTE: GCN card images don't have a header.
+	QFile file(auditCard->filename);
+	if (!file.open(QIODevice::ReadOnly))
+		return -EIO;
+
+	// Read the entire card in a single pass.
+	const qint64 size = (qint64)auditCard->totalPhysBlocks * auditCard->blockSize;
+	auditCard->image.resize((int)size);
+	if (file.read(auditCard->image.data(), size) != size) {
+		// Short read.
+		auditCard->image.clear();
+		return -EIO;
+	}
+	return 0;
+}
+
+/**
+ * Audit a card's system area.
+ * Called from a thread pool task.
+ * @param state Audit state.
+ * @param auditCard Card snapshot.
+ */
+void GcnCardAuditPrivate::auditCard(const GcnCardAuditState *state, GcnCardAuditCard *auditCard)
+{
+	GcnCardAuditResult &result = auditCard->result;
+	result.clear();
+
+	if (auditCard->mapping.isNull()) {
+		result.readError = readCard(auditCard);
+		if (result.readError != 0)
+			return;
+	}
+
+	const uint8_t *const image = auditCard->imageData();
+	if (auditCard->imageSize() < CARD_SYSAREA * auditCard->blockSize) {
+		// System area is missing.
+		return;
+	}
+
+	// NOTE: Header, directory, and block table checksums
+	// are checked by GcnCard when the card is opened.
+	static const uint32_t BAT_addr[2] = {CARD_SYSBAT, CARD_SYSBAT_BACK};
+	const int totalUserBlocks = std::min(auditCard->totalPhysBlocks - CARD_SYSAREA,
+		ARRAY_SIZE(card_bat::fat));
+
+	// FAT consistency.
+	// Count how many files use each block.
+	const card_bat *const bat = reinterpret_cast<const card_bat*>(
+		&image[BAT_addr[auditCard->activeBatIdx == 1 ? 1 : 0]]);
+	QVector<uint8_t> blockUsage(CARD_SYSAREA + totalUserBlocks, 0);
+	for (auto iter = auditCard->files.cbegin(); iter != auditCard->files.cend(); ++iter) {
+		const GcnCardAuditFile &auditFile = state->files.at(*iter);
+		if (auditFile.lostFile) {
+			// Lost files aren't in the directory.
+			continue;
+		}
+		result.files++;
+
+		bool badChain = (auditFile.fatEntries.size() != auditFile.length);
+		foreach (uint16_t block, auditFile.fatEntries) {
+			if (block < CARD_SYSAREA || block >= blockUsage.size()) {
+				// Invalid block.
+				badChain = true;
+				continue;
+			}
+
+			if (blockUsage[block] == 1) {
+				// Block is used by another file.
+				result.crossLinkedBlocks++;
+			}
+			if (blockUsage[block] < 0xFF)
+				blockUsage[block]++;
+			if (bat->fat[block - CARD_SYSAREA] == 0) {
+				// Block is marked as free.
+				result.freeBlocksInUse++;
+			}
+		}
+		if (badChain) {
+			result.badChains++;
+		}
+	}
+
+	for (int block = CARD_SYSAREA; block < blockUsage.size(); block++) {
+		if (blockUsage[block] == 0 && bat->fat[block - CARD_SYSAREA] != 0) {
+			// Block is allocated, but isn't used by any file.
+			result.orphanedBlocks++;
+		}
+	}
+}
+
+/**
+ * Calculate a file's checksums.
+ * Called from a thread pool task.
+ * @param state Audit state.
+ * @param auditFile File snapshot.
+ */
+void GcnCardAuditPrivate::auditFile(const GcnCardAuditState *state, GcnCardAuditFile *auditFile)
+{
+	const GcnCardAuditCard &auditCard = state->cards.at(auditFile->cardIdx);
+	const int blockSize = auditCard.blockSize;
+	if (auditFile->length <= 0 || auditFile->length > auditCard.totalPhysBlocks - CARD_SYSAREA) {
+		// File is empty, or is larger than the card.
+		auditFile->checksumValues.clear();
+		return;
+	}
+
+	// NOTE: The file size is determined by the directory entry,
+	// even if the FAT chain is shorter. (Same as File.)
+	const uint32_t fileSize = (uint32_t)auditFile->length * (uint32_t)blockSize;
+	const std::vector<ChecksumPlan::Range> ranges = auditFile->checksumPlan->ranges(fileSize);
+
+	// Gather the blocks covered by the checksums from the card image.
+	// NOTE: The rest of the buffer is left uninitialized,
+	// since the checksum plan won't access it.
+	QByteArray fileData(fileSize, Qt::Uninitialized);
+	uint8_t *const data = reinterpret_cast<uint8_t*>(fileData.data());
+	const uint8_t *const image = auditCard.imageData();
+	const int imageBlocks = auditCard.imageSize() / blockSize;
+	for (auto iter = ranges.cbegin(); iter != ranges.cend(); ++iter) {
+		const int blockStart = (int)(iter->start / blockSize);
+		const int blockEnd = (int)((iter->end - 1) / blockSize) + 1;
+		for (int i = blockStart; i < blockEnd; i++) {
+			const uint16_t physBlock = auditFile->fatEntries.value(i, 0xFFFF);
+			if (physBlock < imageBlocks) {
+				memcpy(&data[i * blockSize], &image[physBlock * blockSize], blockSize);
+			} else {
+				// Blocks that couldn't be read are zero-filled.
+				memset(&data[i * blockSize], 0, blockSize);
+			}
+		}
+	}
+
+	auditFile->checksumValues = auditFile->checksumPlan->exec(data, fileSize);
+}
+
+/**
+ * Tasks have finished.
+ * Emits auditProgress() and auditFinished().
+ * @param count Number of tasks.
+ */
+void GcnCardAuditPrivate::tasksFinished(int count)
+{
+	Q_Q(GcnCardAudit);
+	tasksDone += count;
+	emit q->auditProgress(tasksDone, tasksTotal);
+	if (tasksDone == tasksTotal) {
+		// Audit is finished.
+		state.clear();
+		emit q->auditFinished();
+	}
+}
+
+/** Tasks **/
+
+/**
+ * Audit a card's system area.
+ */
+class GcnCardAuditCardTask : public QRunnable
+{
+	public:
+		GcnCardAuditCardTask(GcnCardAudit *audit,
+			const QSharedPointer<GcnCardAuditState> &state, int cardIdx)
+			: audit(audit)
+			, state(state)
+			, cardIdx(cardIdx)
+		{ }
+
+		void run(void) final
+		{
+			if (state->cancelled.loadAcquire())
+				return;
+			GcnCardAuditPrivate::auditCard(state.data(), &state->cards[cardIdx]);
+			QMetaObject::invokeMethod(audit, "cardTask_finished_slot", Qt::QueuedConnection,
+				Q_ARG(int, state->generation), Q_ARG(int, cardIdx));
+		}
+
+	private:
+		GcnCardAudit *const audit;
+		const QSharedPointer<GcnCardAuditState> state;
+		const int cardIdx;
+};
+
+/**
+ * Calculate a file's checksums.
+ */
+class GcnCardAuditFileTask : public QRunnable
+{
+	public:
+		GcnCardAuditFileTask(GcnCardAudit *audit,
+			const QSharedPointer<GcnCardAuditState> &state, int fileIdx)
+			: audit(audit)
+			, state(state)
+			, fileIdx(fileIdx)
+		{ }
+
+		void run(void) final
+		{
+			if (state->cancelled.loadAcquire())
+				return;
+			GcnCardAuditPrivate::auditFile(state.data(), &state->files[fileIdx]);
+			QMetaObject::invokeMethod(audit, "fileTask_finished_slot", Qt::QueuedConnection,
+				Q_ARG(int, state->generation), Q_ARG(int, fileIdx));
+		}
+
+	private:
+		GcnCardAudit *const audit;
+		const QSharedPointer<GcnCardAuditState> state;
+		const int fileIdx;
+};
+
+/**
+ * Start the file tasks for a card.
+ * The card image must have been read by the card task.
+ * @param cardIdx Card index.
+ */
+void GcnCardAuditPrivate::startFileTasks(int cardIdx)
+{
+	Q_Q(GcnCardAudit);
+	const GcnCardAuditCard &auditCard = state->cards.at(cardIdx);
+	for (auto iter = auditCard.files.cbegin(); iter != auditCard.files.cend(); ++iter) {
+		if (state->files.at(*iter).checksumPlan) {
+			threadPool.start(new GcnCardAuditFileTask(q, state, *iter));
+		}
+	}
+}
+
+/** GcnCardAudit **/
+
+GcnCardAudit::GcnCardAudit(QObject *parent)
+	: super(parent)
+	, d_ptr(new GcnCardAuditPrivate(this))
+{ }
+
+GcnCardAudit::~GcnCardAudit()
+{
+	Q_D(GcnCardAudit);
+	delete d;
+}
+
+/**
+ * Load multiple GCN Memory Card File databases.
+ * Databases are shared with other users via GcnMcFileDbManager.
+ * @param dbFilenames Filenames of GCN Memory Card File database.
+ * @return 0 on success; non-zero on error.
+ */
+int GcnCardAudit::loadGcnMcFileDbs(const QVector<QString> &dbFilenames)
+{
+	Q_D(GcnCardAudit);
+	d->dbs.clear();
+
+	if (dbFilenames.isEmpty())
+		return 0;
+
+	// Load the databases.
+	// GcnMcFileDbManager only reloads databases that have changed.
+	GcnMcFileDbManager *const dbManager = GcnMcFileDbManager::instance();
+	int ret = dbManager->load(dbFilenames);
+	if (ret != 0)
+		return ret;
+
+	d->dbs = dbManager->databases();
+	return 0;
+}
+
+/**
+ * Get the maximum number of threads.
+ * @return Maximum number of threads. (0 == automatic)
+ */
+int GcnCardAudit::maxThreadCount(void) const
+{
+	Q_D(const GcnCardAudit);
+	return d->maxThreadCount;
+}
+
+/**
+ * Set the maximum number of threads.
+ * @param maxThreadCount Maximum number of threads. (0 == automatic)
+ */
+void GcnCardAudit::setMaxThreadCount(int maxThreadCount)
+{
+	Q_D(GcnCardAudit);
+	d->maxThreadCount = (maxThreadCount >= 0 ? maxThreadCount : 0);
+	d->threadPool.setMaxThreadCount(d->maxThreadCount > 0
+		? d->maxThreadCount : QThread::idealThreadCount());
+}
+
+/**
+ * Is an audit running?
+ * @return True if an audit is running.
+ */
+bool GcnCardAudit::isRunning(void) const
+{
+	Q_D(const GcnCardAudit);
+	return !d->state.isNull();
+}
+
+/**
+ * Audit multiple GcnCards.
+ *
+ * Each card is read once, on a thread pool. The system
+ * area checks and checksum calculations are also run on
+ * the thread pool, and results are reported as they're
+ * completed. If a card can't be read, its files aren't
+ * checked, and cardAudited() reports the read error.
+ *
+ * Files that already have checksums, e.g. "lost" files,
+ * aren't checked again.
+ *
+ * If an audit is already running, it's cancelled.
+ *
+ * @param cards GcnCards.
+ */
+void GcnCardAudit::start(const QList<GcnCard*> &cards)
+{
+	cancel();
+
+	Q_D(GcnCardAudit);
+	QSharedPointer<GcnCardAuditState> state(new GcnCardAuditState(++d->generation));
+	state->cards.reserve(cards.size());
+
+	foreach (GcnCard *card, cards) {
+		if (!card || !card->isOpen())
+			continue;
+
+		GcnCardAuditCard auditCard;
+		auditCard.card = card;
+		auditCard.filename = card->filename();
+		auditCard.blockSize = card->blockSize();
+		auditCard.totalPhysBlocks = card->totalPhysBlocks();
+		auditCard.activeDatIdx = card->activeDatIdx();
+		auditCard.activeBatIdx = card->activeBatIdx();
+
+		// If the entire card is memory-mapped, the tasks can
+		// read the mapping directly, so nothing is copied.
+		// Otherwise, the card task reads the card image.
+		auditCard.mapping = card->mappedImage();
+		if (auditCard.totalPhysBlocks <= 0 ||
+		    !auditCard.mapping.block(0) ||
+		    !auditCard.mapping.block(auditCard.totalPhysBlocks - 1))
+		{
+			auditCard.mapping = Card::MappedImage();
+		}
+
+		// Snapshot the files.
+		const int cardIdx = (int)state->cards.size();
+		const int fileCount = card->fileCount();
+		for (int i = 0; i < fileCount; i++) {
+			GcnFile *const file = qobject_cast<GcnFile*>(card->getFile(i));
+			if (!file)
+				continue;
+
+			GcnCardAuditFile auditFile;
+			auditFile.file = file;
+			auditFile.cardIdx = cardIdx;
+			auditFile.fatEntries = file->fatEntries();
+			auditFile.length = file->size();
+			auditFile.lostFile = file->isLostFile();
+			if (file->checksumStatus() == Checksum::CHKST_UNKNOWN) {
+				auditFile.checksumPlan = d->findChecksumPlan(file);
+				if (auditFile.checksumPlan && auditFile.checksumPlan->isEmpty()) {
+					auditFile.checksumPlan.clear();
+				}
+			}
+
+			auditCard.files.push_back((int)state->files.size());
+			state->files.push_back(auditFile);
+		}
+
+		state->cards.push_back(auditCard);
+	}
+
+	// Start the tasks.
+	d->state = state;
+	d->tasksDone = 0;
+	d->tasksTotal = (int)state->cards.size();
+	for (size_t i = 0; i < state->files.size(); i++) {
+		if (state->files.at(i).checksumPlan) {
+			d->tasksTotal++;
+		}
+	}
+	if (d->tasksTotal == 0) {
+		// Nothing to do.
+		d->state.clear();
+		emit auditFinished();
+		return;
+	}
+
+	// File tasks are started once their card has been read.
+	for (size_t i = 0; i < state->cards.size(); i++) {
+		d->threadPool.start(new GcnCardAuditCardTask(this, state, (int)i));
+	}
+}
+
+/**
+ * Cancel the running audit.
+ * Results that haven't been reported yet are discarded.
+ */
+void GcnCardAudit::cancel(void)
+{
+	Q_D(GcnCardAudit);
+	if (!d->state)
+		return;
+
+	// Tasks that are already running will finish,
+	// but their results will be ignored.
+	d->state->cancelled.storeRelease(1);
+	d->state.clear();
+	d->threadPool.clear();
+}
+
+/** Private slots. **/
+
+/**
+ * A card task has finished.
+ * @param generation Audit generation.
+ * @param cardIdx Card index.
+ */
+void GcnCardAudit::cardTask_finished_slot(int generation, int cardIdx)
+{
+	Q_D(GcnCardAudit);
+	if (!d->state || d->state->generation != generation) {
+		// Audit was cancelled.
+		return;
+	}
+
+	// Keep a reference in case a slot cancels the audit.
+	QSharedPointer<GcnCardAuditState> state = d->state;
+	const GcnCardAuditCard &auditCard = state->cards.at(cardIdx);
+	if (auditCard.card) {
+		emit cardAudited(auditCard.card, auditCard.result);
+	}
+	if (d->state != state)
+		return;
+
+	if (auditCard.result.readError == 0) {
+		d->startFileTasks(cardIdx);
+		d->tasksFinished();
+	} else {
+		// The card couldn't be read, so its files won't be checked.
+		int skipped = 0;
+		for (auto iter = auditCard.files.cbegin(); iter != auditCard.files.cend(); ++iter) {
+			if (state->files.at(*iter).checksumPlan) {
+				skipped++;
+			}
+		}
+		d->tasksFinished(1 + skipped);
+	}
+}
+
+/**
+ * A file task has finished.
+ * @param generation Audit generation.
+ * @param fileIdx File index.
+ */
+void GcnCardAudit::fileTask_finished_slot(int generation, int fileIdx)
+{
+	Q_D(GcnCardAudit);
+	if (!d->state || d->state->generation != generation) {
+		// Audit was cancelled.
+		return;
+	}
+
+	// Keep a reference in case a slot cancels the audit.
+	QSharedPointer<GcnCardAuditState> state = d->state;
+	const GcnCardAuditFile &auditFile = state->files.at(fileIdx);
+	if (auditFile.file && auditFile.file->checksumStatus() == Checksum::CHKST_UNKNOWN) {
+		// Set the checksum values in the file.
+		auditFile.file->setChecksumPlan(auditFile.checksumPlan,
+			QVector<Checksum::ChecksumValue>::fromStdVector(auditFile.checksumValues));
+		emit fileAudited(auditFile.file);
+	}
+	if (d->state == state) {
+		d->tasksFinished();
+	}
+}
@@ -0,0 +1,191 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program.                                  *
+ * GcnCardAudit.hpp: Parallel integrity audit for GCN memory cards.        *
+ *                                                                         *
+ * Copyright (c) 2013-2018 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __MCRECOVER_DB_GCNCARDAUDIT_HPP__
+#define __MCRECOVER_DB_GCNCARDAUDIT_HPP__
+
+// Qt includes.
+#include <QtCore/QList>
+#include <QtCore/QObject>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+class GcnCard;
+class GcnFile;
+
+/**
+ * Integrity audit result for a GcnCard's system area.
+ */
+struct GcnCardAuditResult {
+	// Read error.
+	// If the card image couldn't be read, nothing else is checked.
+	int readError;		// 0 on success; negative POSIX error code on error.
+
+	// FAT consistency.
+	// Checked using the active directory and block tables.
+	int files;		// Number of files in the directory.
+	int badChains;		// Files whose FAT chain doesn't match the file length.
+	int crossLinkedBlocks;	// Blocks used by more than one file.
+	int freeBlocksInUse;	// Blocks used by files, but marked as free.
+	int orphanedBlocks;	// Blocks marked as used, but not used by any file.
+
+	GcnCardAuditResult() { clear(); }
+
+	void clear(void)
+	{
+		readError = 0;
+		files = 0;
+		badChains = 0;
+		crossLinkedBlocks = 0;
+		freeBlocksInUse = 0;
+		orphanedBlocks = 0;
+	}
+
+	/**
+	 * Is the FAT consistent?
+	 * @return True if no FAT errors were found.
+	 */
+	inline bool isFatConsistent(void) const
+	{
+		return (badChains == 0 && crossLinkedBlocks == 0 &&
+			freeBlocksInUse == 0 && orphanedBlocks == 0);
+	}
+};
+
+class GcnCardAuditPrivate;
+class GcnCardAudit : public QObject
+{
+	Q_OBJECT
+	typedef QObject super;
+
+	Q_PROPERTY(int maxThreadCount READ maxThreadCount WRITE setMaxThreadCount)
+	Q_PROPERTY(bool running READ isRunning)
+
+	public:
+		explicit GcnCardAudit(QObject *parent = 0);
+		virtual ~GcnCardAudit();
+
+	protected:
+		GcnCardAuditPrivate *const d_ptr;
+		Q_DECLARE_PRIVATE(GcnCardAudit)
+	private:
+		Q_DISABLE_COPY(GcnCardAudit)
+
+	signals:
+		/**
+		 * A card's system area has been audited.
+		 * @param card GcnCard.
+		 * @param result Audit result.
+		 */
+		void cardAudited(GcnCard *card, const GcnCardAuditResult &result);
+
+		/**
+		 * A file's checksums have been calculated.
+		 * The checksum values have already been set in the file.
+		 * @param file GcnFile.
+		 */
+		void fileAudited(GcnFile *file);
+
+		/**
+		 * Audit progress.
+		 * @param tasksDone Number of tasks completed.
+		 * @param tasksTotal Total number of tasks.
+		 */
+		void auditProgress(int tasksDone, int tasksTotal);
+
+		/**
+		 * The audit has finished.
+		 * This is not emitted if the audit is cancelled.
+		 */
+		void auditFinished(void);
+
+	public:
+		/**
+		 * Load multiple GCN Memory Card File databases.
+		 * Databases are shared with other users via GcnMcFileDbManager.
+		 * @param dbFilenames Filenames of GCN Memory Card File database.
+		 * @return 0 on success; non-zero on error.
+		 */
+		int loadGcnMcFileDbs(const QVector<QString> &dbFilenames);
+
+		/**
+		 * Get the maximum number of threads.
+		 * @return Maximum number of threads. (0 == automatic)
+		 */
+		int maxThreadCount(void) const;
+
+		/**
+		 * Set the maximum number of threads.
+		 * @param maxThreadCount Maximum number of threads. (0 == automatic)
+		 */
+		void setMaxThreadCount(int maxThreadCount);
+
+		/**
+		 * Is an audit running?
+		 * @return True if an audit is running.
+		 */
+		bool isRunning(void) const;
+
+		/**
+		 * Audit a GcnCard.
+		 * @param card GcnCard.
+		 */
+		inline void start(GcnCard *card);
+
+		/**
+		 * Audit multiple GcnCards.
+		 *
+		 * Each card is read once, on a thread pool. The system
+		 * area checks and checksum calculations are also run on
+		 * the thread pool, and results are reported as they're
+		 * completed. If a card can't be read, its files aren't
+		 * checked, and cardAudited() reports the read error.
+		 *
+		 * Files that already have checksums, e.g. "lost" files,
+		 * aren't checked again.
+		 *
+		 * If an audit is already running, it's cancelled.
+		 *
+		 * @param cards GcnCards.
+		 */
+		void start(const QList<GcnCard*> &cards);
+
+		/**
+		 * Cancel the running audit.
+		 * Results that haven't been reported yet are discarded.
+		 */
+		void cancel(void);
+
+	private slots:
+		/**
+		 * A card task has finished.
+		 * @param generation Audit generation.
+		 * @param cardIdx Card index.
+		 */
+		void cardTask_finished_slot(int generation, int cardIdx);
+
+		/**
+		 * A file task has finished.
+		 * @param generation Audit generation.
+		 * @param fileIdx File index.
+		 */
+		void fileTask_finished_slot(int generation, int fileIdx);
+};
+
+/**
+ * Audit a GcnCard.
+ * @param card GcnCard.
+ */
+inline void GcnCardAudit::start(GcnCard *card)
+{
+	QList<GcnCard*> cards;
+	cards.append(card);
+	start(cards);
+}
+
+#endif /* __MCRECOVER_DB_GCNCARDAUDIT_HPP__ */
@@ -0,0 +1,302 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program.                                  *
+ * GcnChecksumSearch.cpp: Background checksum definition discovery.        *
+ *                                                                         *
+ * Copyright (c) 2013-2018 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "GcnChecksumSearch.hpp"
+
+// GcnFile
+#include "libmemcard/GcnFile.hpp"
+
+// Checksum definition discovery.
+#include "libgctools/ChecksumSearch.hpp"
+
+// C includes. (C++ namespace)
+#include <cerrno>
+
+// C++ includes.
+#include <atomic>
+#include <vector>
+
+// Qt includes.
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QRunnable>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+
+/**
+ * Search state.
+ * Shared by the tasks, so it outlives a cancelled search.
+ */
+struct GcnChecksumSearchState {
+	int generation;
+	std::atomic<bool> cancelled;
+	ChecksumSearch search;
+
+	// Results from finished tasks.
+	QMutex mutex;
+	std::vector<Checksum::ChecksumDef> results;
+	QAtomicInt tasksRemaining;
+
+	explicit GcnChecksumSearchState(int generation)
+		: generation(generation)
+		, cancelled(false)
+		, tasksRemaining(0) { }
+};
+
+class GcnChecksumSearchPrivate
+{
+	public:
+		explicit GcnChecksumSearchPrivate(GcnChecksumSearch *q);
+		~GcnChecksumSearchPrivate();
+
+	protected:
+		GcnChecksumSearch *const q_ptr;
+		Q_DECLARE_PUBLIC(GcnChecksumSearch)
+	private:
+		Q_DISABLE_COPY(GcnChecksumSearchPrivate)
+
+	public:
+		// Thread pool.
+		QThreadPool threadPool;
+
+		// Current search.
+		QSharedPointer<GcnChecksumSearchState> state;
+		int generation;
+
+		// Last search.
+		int sampleCount;
+		bool exhaustive;
+};
+
+GcnChecksumSearchPrivate::GcnChecksumSearchPrivate(GcnChecksumSearch *q)
+	: q_ptr(q)
+	, generation(0)
+	, sampleCount(0)
+	, exhaustive(false)
+{
+	threadPool.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+GcnChecksumSearchPrivate::~GcnChecksumSearchPrivate()
+{
+	// Tasks must finish before the search state is released.
+	if (state) {
+		state->cancelled.store(true);
+	}
+	threadPool.waitForDone();
+}
+
+/** Tasks **/
+
+/**
+ * Run one part of the search.
+ * The last task to finish notifies the GcnChecksumSearch.
+ */
+class GcnChecksumSearchTask : public QRunnable
+{
+	public:
+		GcnChecksumSearchTask(GcnChecksumSearch *search,
+			const QSharedPointer<GcnChecksumSearchState> &state, unsigned int task)
+			: search(search)
+			, state(state)
+			, task(task)
+		{ }
+
+		void run(void) final
+		{
+			if (!state->cancelled.load()) {
+				std::vector<Checksum::ChecksumDef> results;
+				state->search.runTask(task, results, &state->cancelled);
+				if (!results.empty()) {
+					QMutexLocker locker(&state->mutex);
+					state->results.insert(state->results.end(),
+						results.begin(), results.end());
+				}
+			}
+
+			if (state->tasksRemaining.fetchAndAddOrdered(-1) == 1) {
+				QMetaObject::invokeMethod(search, "search_finished_slot",
+					Qt::QueuedConnection, Q_ARG(int, state->generation));
+			}
+		}
+
+	private:
+		GcnChecksumSearch *const search;
+		const QSharedPointer<GcnChecksumSearchState> state;
+		const unsigned int task;
+};
+
+/**
+ * Build the prefix tables, then start the search tasks.
+ */
+class GcnChecksumSearchPrepareTask : public QRunnable
+{
+	public:
+		GcnChecksumSearchPrepareTask(GcnChecksumSearch *search, QThreadPool *threadPool,
+			const QSharedPointer<GcnChecksumSearchState> &state)
+			: search(search)
+			, threadPool(threadPool)
+			, state(state)
+		{ }
+
+		void run(void) final
+		{
+			unsigned int taskCount = 0;
+			if (!state->cancelled.load() && state->search.prepare() == 0) {
+				taskCount = state->search.taskCount();
+			}
+
+			if (taskCount == 0) {
+				// Nothing to search.
+				QMetaObject::invokeMethod(search, "search_finished_slot",
+					Qt::QueuedConnection, Q_ARG(int, state->generation));
+				return;
+			}
+
+			state->tasksRemaining.storeRelease((int)taskCount);
+			for (unsigned int i = 0; i < taskCount; i++) {
+				threadPool->start(new GcnChecksumSearchTask(search, state, i));
+			}
+		}
+
+	private:
+		GcnChecksumSearch *const search;
+		QThreadPool *const threadPool;
+		const QSharedPointer<GcnChecksumSearchState> state;
+};
+
+/** GcnChecksumSearch **/
+
+GcnChecksumSearch::GcnChecksumSearch(QObject *parent)
+	: super(parent)
+	, d_ptr(new GcnChecksumSearchPrivate(this))
+{ }
+
+GcnChecksumSearch::~GcnChecksumSearch()
+{
+	Q_D(GcnChecksumSearch);
+	delete d;
+}
+
+/**
+ * Is a search running?
+ * @return True if a search is running.
+ */
+bool GcnChecksumSearch::isRunning(void) const
+{
+	Q_D(const GcnChecksumSearch);
+	return !d->state.isNull();
+}
+
+/**
+ * Get the number of samples used by the last search.
+ * @return Number of samples.
+ */
+int GcnChecksumSearch::sampleCount(void) const
+{
+	Q_D(const GcnChecksumSearch);
+	return d->sampleCount;
+}
+
+/**
+ * Did the last search cover checksummed areas anywhere in the file?
+ * If false, only areas next to the stored checksum were searched,
+ * and more samples of the file are needed to search everywhere.
+ * Only valid after searchFinished() has been emitted.
+ * @return True if the search was exhaustive.
+ */
+bool GcnChecksumSearch::isExhaustive(void) const
+{
+	Q_D(const GcnChecksumSearch);
+	return d->exhaustive;
+}
+
+/**
+ * Search for checksum definitions for a GcnFile.
+ *
+ * The files should be different saves of the same game;
+ * each one is used as a sample. File data is loaded here,
+ * and the search itself is run on a thread pool.
+ *
+ * Checksums in GCN save files are big-endian, so only
+ * big-endian checksums are searched for.
+ *
+ * If a search is already running, it's cancelled.
+ *
+ * @param files GcnFiles.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int GcnChecksumSearch::start(const QList<GcnFile*> &files)
+{
+	Q_D(GcnChecksumSearch);
+	cancel();
+
+	QSharedPointer<GcnChecksumSearchState> state(
+		new GcnChecksumSearchState(++d->generation));
+
+	ChecksumSearch::Options options;
+	options.endians = (1U << Checksum::CHKENDIAN_BIG);
+	state->search.setOptions(options);
+
+	foreach (GcnFile *file, files) {
+		const QByteArray fileData = file->loadFileData();
+		if (fileData.isEmpty())
+			continue;
+		state->search.addSample(reinterpret_cast<const uint8_t*>(fileData.constData()),
+					(uint32_t)fileData.size());
+	}
+
+	d->sampleCount = state->search.sampleCount();
+	d->exhaustive = false;
+	if (d->sampleCount == 0)
+		return -ENOENT;
+
+	d->state = state;
+	d->threadPool.start(new GcnChecksumSearchPrepareTask(this, &d->threadPool, state));
+	return 0;
+}
+
+/**
+ * Cancel the running search.
+ */
+void GcnChecksumSearch::cancel(void)
+{
+	Q_D(GcnChecksumSearch);
+	if (!d->state)
+		return;
+
+	// Tasks that are already running will return early,
+	// and their results will be ignored.
+	d->state->cancelled.store(true);
+	d->state.clear();
+}
+
+/** Private slots. **/
+
+/**
+ * The search has finished.
+ * @param generation Search generation.
+ */
+void GcnChecksumSearch::search_finished_slot(int generation)
+{
+	Q_D(GcnChecksumSearch);
+	if (!d->state || d->state->generation != generation) {
+		// Search was cancelled.
+		return;
+	}
+
+	QSharedPointer<GcnChecksumSearchState> state = d->state;
+	d->state.clear();
+
+	// All tasks have finished, so the results can be used without locking.
+	ChecksumSearch::sortResults(state->results);
+	d->exhaustive = state->search.isExhaustive();
+	emit searchFinished(QVector<Checksum::ChecksumDef>::fromStdVector(state->results));
+}
@@ -0,0 +1,100 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program.                                  *
+ * GcnChecksumSearch.hpp: Background checksum definition discovery.        *
+ *                                                                         *
+ * Copyright (c) 2013-2018 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __MCRECOVER_DB_GCNCHECKSUMSEARCH_HPP__
+#define __MCRECOVER_DB_GCNCHECKSUMSEARCH_HPP__
+
+// Checksum algorithm class.
+#include "Checksum.hpp"
+
+// Qt includes.
+#include <QtCore/QList>
+#include <QtCore/QObject>
+#include <QtCore/QVector>
+
+class GcnFile;
+
+class GcnChecksumSearchPrivate;
+class GcnChecksumSearch : public QObject
+{
+	Q_OBJECT
+	typedef QObject super;
+
+	Q_PROPERTY(bool running READ isRunning)
+
+	public:
+		explicit GcnChecksumSearch(QObject *parent = 0);
+		virtual ~GcnChecksumSearch();
+
+	protected:
+		GcnChecksumSearchPrivate *const d_ptr;
+		Q_DECLARE_PRIVATE(GcnChecksumSearch)
+	private:
+		Q_DISABLE_COPY(GcnChecksumSearch)
+
+	signals:
+		/**
+		 * The search has finished.
+		 * This is not emitted if the search is cancelled.
+		 * @param checksumDefs Matching checksum definitions, sorted by address.
+		 */
+		void searchFinished(const QVector<Checksum::ChecksumDef> &checksumDefs);
+
+	public:
+		/**
+		 * Is a search running?
+		 * @return True if a search is running.
+		 */
+		bool isRunning(void) const;
+
+		/**
+		 * Get the number of samples used by the last search.
+		 * @return Number of samples.
+		 */
+		int sampleCount(void) const;
+
+		/**
+		 * Did the last search cover checksummed areas anywhere in the file?
+		 * If false, only areas next to the stored checksum were searched,
+		 * and more samples of the file are needed to search everywhere.
+		 * Only valid after searchFinished() has been emitted.
+		 * @return True if the search was exhaustive.
+		 */
+		bool isExhaustive(void) const;
+
+		/**
+		 * Search for checksum definitions for a GcnFile.
+		 *
+		 * The files should be different saves of the same game;
+		 * each one is used as a sample. File data is loaded here,
+		 * and the search itself is run on a thread pool.
+		 *
+		 * Checksums in GCN save files are big-endian, so only
+		 * big-endian checksums are searched for.
+		 *
+		 * If a search is already running, it's cancelled.
+		 *
+		 * @param files GcnFiles.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int start(const QList<GcnFile*> &files);
+
+		/**
+		 * Cancel the running search.
+		 */
+		void cancel(void);
+
+	private slots:
+		/**
+		 * The search has finished.
+		 * @param generation Search generation.
+		 */
+		void search_finished_slot(int generation);
+};
+
+#endif /* __MCRECOVER_DB_GCNCHECKSUMSEARCH_HPP__ */
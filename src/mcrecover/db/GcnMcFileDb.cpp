@@ -16,6 +16,7 @@
 #include "config/ConfigStore.hpp"
 
 #include "GcnMcFileDef.hpp"
+#include "GcnMcFileDbCache.hpp"
 #include "VarReplace.hpp"
 #include "libmemcard/TimeFuncs.hpp"
 
@@ -31,12 +32,17 @@
 #include <cstdio>
 #include <cstring>
 
+// C++ includes.
+#include <algorithm>
+
 // Qt includes.
 #include <QtCore/QCoreApplication>
 #include <QtCore/QDir>
 #include <QtCore/QFile>
+#include <QtCore/QHash>
 #include <QtCore/QMap>
 #include <QtCore/QTextCodec>
+#include <QtCore/QVarLengthArray>
 #include <QtCore/QVector>
 #include <QtCore/QXmlStreamReader>
 
@@ -55,12 +61,147 @@ class GcnMcFileDbPrivate
 		static const uint32_t BLOCK_SIZE_MASK = (BLOCK_SIZE - 1);
 
 	public:
+		/**
+		 * GCN memory card file definitions for a single search address.
+		 */
+		struct AddrFileDefs {
+			// File definitions, in database order.
+			QVector<GcnMcFileDef*> defs;
+
+			/**
+			 * Literal Game Descriptions.
+			 * - Key: Game Description.
+			 * - Value: Indexes into defs.
+			 */
+			QHash<QString, QVector<int> > gameDescLiterals;
+
+			// Indexes into defs for Game Descriptions
+			// that must be checked using regular expressions.
+			QVector<int> gameDescRegexes;
+
+			/**
+			 * Combined Game Description regex for this address.
+			 * This is an alternation of all regex Game Descriptions,
+			 * so a single match can determine if any of them might
+			 * match. If it doesn't match, none of them will.
+			 * Set by buildRegexSets(). (invalid if not usable)
+			 */
+			QRegularExpression gameDescRegexSet;
+
+			// If true, a blank comment window (all 0x00 or all 0xFF)
+			// matches at least one definition, so blank windows
+			// can't be skipped. Set by updateBlankMatches().
+			bool blankMayMatch;
+
+			AddrFileDefs() : blankMayMatch(true) { }
+
+			/**
+			 * Add a file definition.
+			 * @param gcnMcFileDef File definition.
+			 */
+			void append(GcnMcFileDef *gcnMcFileDef);
+		};
+
 		/**
 		 * GCN memory card file definitions.
 		 * - Key: Search address. (limited to BLOCK_SIZE-1)
-		 * - Value: QVector<>* of GcnMcFileDef*.
+		 * - Value: AddrFileDefs*.
+		 */
+		QMap<uint32_t, AddrFileDefs*> addr_file_defs;
+
+		/**
+		 * GCN memory card file definitions, indexed by ID6.
+		 * Used by addChecksumDefs().
+		 * - Key: ID6.
+		 * - Value: File definitions, in addr_file_defs order.
+		 */
+		QHash<QString, QVector<const GcnMcFileDef*> > id6_file_defs;
+
+		/**
+		 * Build the ID6 index.
+		 * This must be called after the database is loaded.
 		 */
-		QMap<uint32_t, QVector<GcnMcFileDef*>*> addr_file_defs;
+		void buildId6Index(void);
+
+		/**
+		 * Build the combined Game Description regexes for each address.
+		 * This must be called after the database is loaded.
+		 */
+		void buildRegexSets(void);
+
+		/**
+		 * Determine if blank comment windows can match for each address.
+		 * This must be called after the database is loaded.
+		 */
+		void updateBlankMatches(void);
+
+		/**
+		 * Lazily-decoded GCN comment field. (Game or File Description)
+		 * Each field is decoded at most once per text codec,
+		 * and only if it's actually needed.
+		 */
+		class CommentField {
+			public:
+				CommentField(const GcnMcFileDbPrivate *d_db, const char *field)
+					: d(d_db), buf(field), has_us(false), has_jp(false) { }
+
+				/**
+				 * Get the field, decoded as cp1252.
+				 * @return Decoded field.
+				 */
+				const QString &us(void);
+
+				/**
+				 * Get the field, decoded as Shift-JIS.
+				 * If the field is 7-bit ASCII, this is the same as us().
+				 * @return Decoded field.
+				 */
+				const QString &jp(void);
+
+			private:
+				const GcnMcFileDbPrivate *const d;
+				const char *const buf;
+				QString str_us, str_jp;
+				bool has_us, has_jp;
+		};
+
+		/**
+		 * Check a GCN comment window against the file definitions for an address.
+		 * @param afd		[in] File definitions for the comment address.
+		 * @param commentData	[in] Comment data. (64 bytes)
+		 * @param fileMatches	[out] Matches are appended here.
+		 */
+		void checkComment(const AddrFileDefs *afd, const char *commentData,
+			QVector<GcnSearchData> &fileMatches) const;
+
+		/**
+		 * Check if a region of memory is blank. (all 0x00 or all 0xFF)
+		 * @param buf Buffer.
+		 * @param siz Size of buffer.
+		 * @return True if blank; false if not.
+		 */
+		static bool IsBlank(const char *buf, int siz);
+
+		/**
+		 * Check if a regular expression is a fully-anchored literal,
+		 * e.g. "^Game Name \(tm\)$", and unescape it if it is.
+		 * NOTE: Compare the literal to LiteralSubject(), not the
+		 * original string, since '$' also matches before a final '\n'.
+		 * @param pattern	[in] Regular expression.
+		 * @param literal	[out] Unescaped literal string.
+		 * @return True if the regular expression is a literal; false if not.
+		 */
+		static bool RegexToLiteral(const QString &pattern, QString &literal);
+
+		/**
+		 * Get the part of a string that a fully-anchored literal
+		 * from RegexToLiteral() has to match.
+		 * The '$' anchor also matches before a final '\n',
+		 * so one trailing '\n' is removed.
+		 * @param str String.
+		 * @return String without a trailing '\n'.
+		 */
+		static QString LiteralSubject(const QString &str);
 
 		/**
 		 * Convert a region character to a GcnMcFileDef::regions_t bitfield value.
@@ -82,6 +223,20 @@ class GcnMcFileDbPrivate
 		 */
 		int load(const QString &filename);
 
+		/**
+		 * Add a file definition to the database.
+		 * The definition is added to the bucket for its search address.
+		 * @param gcnMcFileDef File definition. (This object takes ownership.)
+		 */
+		void addFileDef(GcnMcFileDef *gcnMcFileDef);
+
+		/**
+		 * Initialize the search regexes and literals for a file definition.
+		 * search.gameDesc and search.fileDesc must be set.
+		 * @param gcnMcFileDef File definition.
+		 */
+		static void initSearchRegexes(GcnMcFileDef *gcnMcFileDef);
+
 		void parseXml_GcnMcFileDb(QXmlStreamReader &xml);
 		GcnMcFileDef *parseXml_file(QXmlStreamReader &xml);
 		QString parseXml_element(QXmlStreamReader &xml);
@@ -166,6 +321,243 @@ uint8_t GcnMcFileDbPrivate::RegionCharToBitfield(QChar regionChr)
 }
 
 
+/**
+ * Add a file definition.
+ * @param gcnMcFileDef File definition.
+ */
+void GcnMcFileDbPrivate::AddrFileDefs::append(GcnMcFileDef *gcnMcFileDef)
+{
+	const int idx = defs.size();
+	defs.append(gcnMcFileDef);
+
+	if (gcnMcFileDef->search.gameDesc_isLiteral) {
+		// Literal Game Description.
+		gameDescLiterals[gcnMcFileDef->search.gameDesc_literal].append(idx);
+	} else {
+		// Game Description requires a regex.
+		gameDescRegexes.append(idx);
+	}
+}
+
+
+/**
+ * Check if a regular expression is a fully-anchored literal,
+ * e.g. "^Game Name \(tm\)$", and unescape it if it is.
+ * NOTE: Compare the literal to LiteralSubject(), not the
+ * original string, since '$' also matches before a final '\n'.
+ * @param pattern	[in] Regular expression.
+ * @param literal	[out] Unescaped literal string.
+ * @return True if the regular expression is a literal; false if not.
+ */
+bool GcnMcFileDbPrivate::RegexToLiteral(const QString &pattern, QString &literal)
+{
+	const int len = pattern.size();
+	if (len < 2 || pattern.at(0) != QChar(L'^') || pattern.at(len-1) != QChar(L'$'))
+		return false;
+
+	QString str;
+	str.reserve(len - 2);
+	for (int i = 1; i < len-1; i++) {
+		const QChar chr = pattern.at(i);
+		switch (chr.unicode()) {
+			case '\\': {
+				// Escape sequence.
+				// Only escaped non-alphanumeric ASCII characters
+				// are literals. Anything else, e.g. \d, is a
+				// character class or some other special sequence.
+				// NOTE: If this is the final '$', it's escaped,
+				// so the pattern isn't anchored.
+				i++;
+				if (i >= len-1)
+					return false;
+				const ushort esc = pattern.at(i).unicode();
+				if (esc >= 0x80 || isalnum(esc) || esc < 0x20)
+					return false;
+				str += pattern.at(i);
+				break;
+			}
+
+			case '^': case '$': case '.': case '|':
+			case '?': case '*': case '+':
+			case '(': case ')': case '[': case ']':
+			case '{': case '}':
+				// Metacharacter.
+				return false;
+
+			default:
+				// Literal character.
+				str += chr;
+				break;
+		}
+	}
+
+	literal = str;
+	return true;
+}
+
+/**
+ * Get the part of a string that a fully-anchored literal
+ * from RegexToLiteral() has to match.
+ * The '$' anchor also matches before a final '\n',
+ * so one trailing '\n' is removed.
+ * @param str String.
+ * @return String without a trailing '\n'.
+ */
+QString GcnMcFileDbPrivate::LiteralSubject(const QString &str)
+{
+	if (str.endsWith(QChar(L'\n')))
+		return str.left(str.size() - 1);
+	return str;
+}
+
+
+/**
+ * Build the ID6 index.
+ * This must be called after the database is loaded.
+ */
+void GcnMcFileDbPrivate::buildId6Index(void)
+{
+	id6_file_defs.clear();
+	foreach (const AddrFileDefs *afd, addr_file_defs) {
+		foreach (const GcnMcFileDef *gcnMcFileDef, afd->defs) {
+			const QString id6 = QString::fromLatin1(gcnMcFileDef->id6, sizeof(gcnMcFileDef->id6));
+			id6_file_defs[id6].append(gcnMcFileDef);
+		}
+	}
+}
+
+
+/**
+ * Build the combined Game Description regexes for each address.
+ * This must be called after the database is loaded.
+ */
+void GcnMcFileDbPrivate::buildRegexSets(void)
+{
+	for (QMap<uint32_t, AddrFileDefs*>::iterator iter = addr_file_defs.begin();
+	     iter != addr_file_defs.end(); ++iter)
+	{
+		AddrFileDefs *const afd = *iter;
+		afd->gameDescRegexSet = QRegularExpression();
+		if (afd->gameDescRegexes.size() < 2) {
+			// Not worth combining.
+			continue;
+		}
+
+		// Combine the regexes into a single alternation.
+		// Each pattern is wrapped in a non-capturing group,
+		// and captures are disabled, since the combined regex
+		// is only used to check if any of the patterns match.
+		// NOTE: Invalid regexes never match, so they're skipped.
+		QString pattern;
+		foreach (int idx, afd->gameDescRegexes) {
+			const GcnMcFileDef *const gcnMcFileDef = afd->defs.at(idx);
+			if (!gcnMcFileDef->search.gameDesc_regex.isValid())
+				continue;
+			if (!pattern.isEmpty())
+				pattern += QChar(L'|');
+			pattern += QLatin1String("(?:") + gcnMcFileDef->search.gameDesc + QChar(L')');
+		}
+
+		QRegularExpression regexSet(pattern, QRegularExpression::DontCaptureOption);
+		if (!regexSet.isValid()) {
+			// Combined regex is invalid.
+			// This might happen if a pattern uses backreferences.
+			// Check the individual regexes instead.
+			continue;
+		}
+#if QT_VERSION >= QT_VERSION_CHECK(5,4,0)
+		regexSet.optimize();
+#endif /* QT_VERSION >= QT_VERSION_CHECK(5,4,0) */
+		afd->gameDescRegexSet = regexSet;
+	}
+}
+
+
+/**
+ * Determine if blank comment windows can match for each address.
+ * This must be called after the database is loaded.
+ */
+void GcnMcFileDbPrivate::updateBlankMatches(void)
+{
+	char blank00[64], blankFF[64];
+	memset(blank00, 0x00, sizeof(blank00));
+	memset(blankFF, 0xFF, sizeof(blankFF));
+
+	for (QMap<uint32_t, AddrFileDefs*>::iterator iter = addr_file_defs.begin();
+	     iter != addr_file_defs.end(); ++iter)
+	{
+		AddrFileDefs *const afd = *iter;
+		QVector<GcnSearchData> fileMatches;
+		afd->blankMayMatch = true;
+		checkComment(afd, blank00, fileMatches);
+		checkComment(afd, blankFF, fileMatches);
+		afd->blankMayMatch = !fileMatches.isEmpty();
+	}
+}
+
+
+/**
+ * Get the field, decoded as cp1252.
+ * @return Decoded field.
+ */
+const QString &GcnMcFileDbPrivate::CommentField::us(void)
+{
+	if (!has_us) {
+		str_us = d->GetGcnCommentUtf16(buf, 32, d->textCodecUS);
+		has_us = true;
+	}
+	return str_us;
+}
+
+/**
+ * Get the field, decoded as Shift-JIS.
+ * If the field is 7-bit ASCII, this is the same as us().
+ * @return Decoded field.
+ */
+const QString &GcnMcFileDbPrivate::CommentField::jp(void)
+{
+	if (has_jp)
+		return str_jp;
+
+	// If the field is 7-bit ASCII, both codecs
+	// produce the same string, so don't decode it twice.
+	bool isAscii = true;
+	for (int i = 0; i < 32 && buf[i] != 0; i++) {
+		if ((uint8_t)buf[i] >= 0x80) {
+			isAscii = false;
+			break;
+		}
+	}
+
+	if (isAscii) {
+		str_jp = us();
+	} else {
+		str_jp = d->GetGcnCommentUtf16(buf, 32, d->textCodecJP);
+	}
+	has_jp = true;
+	return str_jp;
+}
+
+
+/**
+ * Check if a region of memory is blank. (all 0x00 or all 0xFF)
+ * @param buf Buffer.
+ * @param siz Size of buffer.
+ * @return True if blank; false if not.
+ */
+bool GcnMcFileDbPrivate::IsBlank(const char *buf, int siz)
+{
+	const char chr = buf[0];
+	if (chr != 0x00 && chr != (char)0xFF)
+		return false;
+	for (int i = 1; i < siz; i++) {
+		if (buf[i] != chr)
+			return false;
+	}
+	return true;
+}
+
+
 /**
  * Clear the GCN Memory Card File database.
  * This clears addr_file_defs.
@@ -173,15 +565,16 @@ uint8_t GcnMcFileDbPrivate::RegionCharToBitfield(QChar regionChr)
 void GcnMcFileDbPrivate::clear(void)
 {
 	// Delete all GcnMcFileDefs.
-	for (QMap<uint32_t, QVector<GcnMcFileDef*>*>::iterator iter = addr_file_defs.begin();
+	for (QMap<uint32_t, AddrFileDefs*>::iterator iter = addr_file_defs.begin();
 	     iter != addr_file_defs.end(); ++iter)
 	{
-		QVector<GcnMcFileDef*> *vec = *iter;
-		qDeleteAll(*vec);
-		delete vec;
+		AddrFileDefs *afd = *iter;
+		qDeleteAll(afd->defs);
+		delete afd;
 	}
 
 	addr_file_defs.clear();
+	id6_file_defs.clear();
 }
 
 
@@ -202,8 +595,26 @@ int GcnMcFileDbPrivate::load(const QString &filename)
 		errorString = file.errorString();
 		return -1;
 	}
+	const QByteArray xmlData = file.readAll();
+	file.close();
+
+	// Check if a cached copy of the parsed database is available.
+	const GcnMcFileDbCache::Key cacheKey = GcnMcFileDbCache::GetKey(filename, xmlData);
+	QVector<GcnMcFileDef*> cachedDefs;
+	if (GcnMcFileDbCache::load(cacheKey, cachedDefs) == 0) {
+		// Cache loaded.
+		foreach (GcnMcFileDef *gcnMcFileDef, cachedDefs) {
+			initSearchRegexes(gcnMcFileDef);
+			addFileDef(gcnMcFileDef);
+		}
+		buildId6Index();
+		buildRegexSets();
+		updateBlankMatches();
+		errorString = QString();
+		return 0;
+	}
 
-	QXmlStreamReader xml(&file);
+	QXmlStreamReader xml(xmlData);
 	while (!xml.atEnd() && !xml.hasError()) {
 		// Read the next element.
 		QXmlStreamReader::TokenType token = xml.readNext();
@@ -224,6 +635,12 @@ int GcnMcFileDbPrivate::load(const QString &filename)
 		}
 	}
 
+	// Build the indexes and combined regexes, and check
+	// which addresses can match blank comment windows.
+	buildId6Index();
+	buildRegexSets();
+	updateBlankMatches();
+
 	if (xml.hasError()) {
 		// XML parse error occurred.
 		errorString = xml.errorString() + QChar(L' ') +
@@ -234,11 +651,53 @@ int GcnMcFileDbPrivate::load(const QString &filename)
 	}
 
 	// Database parsed successfully.
+	// Save it to the cache.
+	// NOTE: Errors are ignored, since the cache is optional.
+	QVector<const GcnMcFileDef*> defs;
+	foreach (const AddrFileDefs *afd, addr_file_defs) {
+		foreach (const GcnMcFileDef *gcnMcFileDef, afd->defs) {
+			defs.append(gcnMcFileDef);
+		}
+	}
+	GcnMcFileDbCache::save(cacheKey, defs);
+
 	errorString = QString();
 	return 0;
 }
 
 
+/**
+ * Add a file definition to the database.
+ * The definition is added to the bucket for its search address.
+ * @param gcnMcFileDef File definition. (This object takes ownership.)
+ */
+void GcnMcFileDbPrivate::addFileDef(GcnMcFileDef *gcnMcFileDef)
+{
+	if (gcnMcFileDef->search.address > BLOCK_SIZE_MASK) {
+		// FIXME: Support for files with search address above 0x1FFF.
+		delete gcnMcFileDef;
+		return;
+	}
+
+	// Compile the checksum definitions.
+	if (!gcnMcFileDef->checksumDefs.isEmpty()) {
+		gcnMcFileDef->checksumPlan.reset(
+			new ChecksumPlan(gcnMcFileDef->checksumDefs.toStdVector()));
+	}
+
+	// Add the file to the database.
+	uint32_t address = gcnMcFileDef->search.address;
+	address &= BLOCK_SIZE_MASK;	// search the specific block only
+	AddrFileDefs *afd = addr_file_defs.value(address);
+	if (!afd) {
+		// Create a new AddrFileDefs.
+		afd = new AddrFileDefs();
+		addr_file_defs.insert(address, afd);
+	}
+	afd->append(gcnMcFileDef);
+}
+
+
 void GcnMcFileDbPrivate::parseXml_GcnMcFileDb(QXmlStreamReader &xml)
 {
 	const QLatin1String myTokenType("GcnMcFileDb");
@@ -259,20 +718,8 @@ void GcnMcFileDbPrivate::parseXml_GcnMcFileDb(QXmlStreamReader &xml)
 		    xml.name() == QLatin1String("file")) {
 			// Found a <file> element.
 			GcnMcFileDef *gcnMcFileDef = parseXml_file(xml);
-			if (gcnMcFileDef && gcnMcFileDef->search.address > BLOCK_SIZE_MASK) {
-				// FIXME: Support for files with search address above 0x1FFF.
-				delete gcnMcFileDef;
-			} else if (gcnMcFileDef) {
-				// Add the file to the database.
-				uint32_t address = gcnMcFileDef->search.address;
-				address &= BLOCK_SIZE_MASK;	// search the specific block only
-				QVector<GcnMcFileDef*>* vec = addr_file_defs.value(address);
-				if (!vec) {
-					// Create a new QVector.
-					vec = new QVector<GcnMcFileDef*>();
-					addr_file_defs.insert(address, vec);
-				}
-				vec->append(gcnMcFileDef);
+			if (gcnMcFileDef) {
+				addFileDef(gcnMcFileDef);
 			}
 		} else {
 			// Skip unreocgnized tokens.
@@ -442,15 +889,39 @@ void GcnMcFileDbPrivate::parseXml_file_search(QXmlStreamReader &xml, GcnMcFileDe
 	}
 
 	// Set the regular expressions.
+	initSearchRegexes(gcnMcFileDef);
+}
+
+
+/**
+ * Initialize the search regexes and literals for a file definition.
+ * search.gameDesc and search.fileDesc must be set.
+ * @param gcnMcFileDef File definition.
+ */
+void GcnMcFileDbPrivate::initSearchRegexes(GcnMcFileDef *gcnMcFileDef)
+{
 	gcnMcFileDef->search.gameDesc_regex.setPattern(gcnMcFileDef->search.gameDesc);
 	gcnMcFileDef->search.fileDesc_regex.setPattern(gcnMcFileDef->search.fileDesc);
+
+	// Check for literal strings.
+	// Most descriptions are "^literal$", which can be
+	// matched without using the regex engine.
+	gcnMcFileDef->search.gameDesc_isLiteral = RegexToLiteral(
+		gcnMcFileDef->search.gameDesc, gcnMcFileDef->search.gameDesc_literal);
+	gcnMcFileDef->search.fileDesc_isLiteral = RegexToLiteral(
+		gcnMcFileDef->search.fileDesc, gcnMcFileDef->search.fileDesc_literal);
+
 #if QT_VERSION >= QT_VERSION_CHECK(5,4,0)
 	// TODO: If compiling with older Qt, set QRegularExpression::OptimizeOnFirstUsageOption.
 	// This will allow optimization if used with newer Qt without recompiling.
 	// QRegularExpression::PatternOption enum value 0x0080
 	// QRegularExpression::setPatternOptions()
-	gcnMcFileDef->search.gameDesc_regex.optimize();
-	gcnMcFileDef->search.fileDesc_regex.optimize();
+	// NOTE: Literals don't use the regex engine in checkBlock(),
+	// so they're compiled on first use instead.
+	if (!gcnMcFileDef->search.gameDesc_isLiteral)
+		gcnMcFileDef->search.gameDesc_regex.optimize();
+	if (!gcnMcFileDef->search.fileDesc_isLiteral)
+		gcnMcFileDef->search.fileDesc_regex.optimize();
 #endif /* QT_VERSION >= QT_VERSION_CHECK(5,4,0) */
 }
 
@@ -894,13 +1365,129 @@ GcnSearchData GcnMcFileDbPrivate::constructSearchData(
 	dirEntry->commentaddr	= matchFileDef->search.address;
 
 	// Checksum data.
-	searchData.checksumDefs = matchFileDef->checksumDefs;
+	searchData.checksumPlan = matchFileDef->checksumPlan;
 
 	// Return the SearchData entry.
 	return searchData;
 }
 
 
+/**
+ * Check a GCN comment window against the file definitions for an address.
+ * @param afd		[in] File definitions for the comment address.
+ * @param commentData	[in] Comment data. (64 bytes)
+ * @param fileMatches	[out] Matches are appended here.
+ */
+void GcnMcFileDbPrivate::checkComment(const AddrFileDefs *afd, const char *commentData,
+	QVector<GcnSearchData> &fileMatches) const
+{
+	// Game description and file description.
+	// These are decoded on demand.
+	CommentField gameDesc(this, commentData);
+	CommentField fileDesc(this, commentData+32);
+
+	// Find definitions that might match the Game Description.
+	// Literal Game Descriptions are looked up in the hash;
+	// regex Game Descriptions are checked below.
+	QVarLengthArray<int, 32> candidates;
+	if (!afd->gameDescLiterals.isEmpty()) {
+		// The JP description is only decoded if the US description
+		// doesn't match, since decoding Shift-JIS is expensive.
+		auto lit = afd->gameDescLiterals.constFind(LiteralSubject(gameDesc.us()));
+		if (lit != afd->gameDescLiterals.cend()) {
+			candidates.append(lit->constData(), lit->size());
+		} else if (gameDesc.jp() != gameDesc.us()) {
+			lit = afd->gameDescLiterals.constFind(LiteralSubject(gameDesc.jp()));
+			if (lit != afd->gameDescLiterals.cend()) {
+				candidates.append(lit->constData(), lit->size());
+			}
+		}
+	}
+	if (!afd->gameDescRegexes.isEmpty()) {
+		// If the combined regex doesn't match either the US
+		// or JP description, none of the regexes will match.
+		bool regexMayMatch = true;
+		if (afd->gameDescRegexSet.isValid()) {
+			regexMayMatch = afd->gameDescRegexSet.match(gameDesc.us()).hasMatch() ||
+				(gameDesc.jp() != gameDesc.us() &&
+				 afd->gameDescRegexSet.match(gameDesc.jp()).hasMatch());
+		}
+		if (regexMayMatch) {
+			candidates.append(afd->gameDescRegexes.constData(), afd->gameDescRegexes.size());
+		}
+	}
+	if (candidates.isEmpty())
+		return;
+
+	// Matches must be processed in database order.
+	std::sort(candidates.begin(), candidates.end());
+
+	for (int i = 0; i < candidates.size(); i++) {
+		const GcnMcFileDef *const gcnMcFileDef = afd->defs.at(candidates[i]);
+
+		QStringList gameDescVars;
+		if (gcnMcFileDef->search.gameDesc_isLiteral) {
+			// Literal Game Description.
+			// This was matched by the hash lookup.
+			gameDescVars.append(gcnMcFileDef->search.gameDesc_literal);
+		} else {
+			// Check if the Game Description (US) matches.
+			QRegularExpressionMatch gameDescMatch =
+				gcnMcFileDef->search.gameDesc_regex.match(gameDesc.us());
+			if (!gameDescMatch.hasMatch()) {
+				// No match for US.
+				// Check if the Game Description (JP) matches.
+				gameDescMatch = gcnMcFileDef->search.gameDesc_regex.match(gameDesc.jp());
+				if (!gameDescMatch.hasMatch()) {
+					// No match for JP.
+					continue;
+				}
+			}
+			gameDescVars = gameDescMatch.capturedTexts();
+		}
+
+		QStringList fileDescVars;
+		if (gcnMcFileDef->search.fileDesc_isLiteral) {
+			// Literal File Description.
+			const QString &fileDescLiteral = gcnMcFileDef->search.fileDesc_literal;
+			if (fileDescLiteral != LiteralSubject(fileDesc.us()) &&
+			    fileDescLiteral != LiteralSubject(fileDesc.jp()))
+			{
+				// No match.
+				continue;
+			}
+			fileDescVars.append(fileDescLiteral);
+		} else {
+			// Check if the File Description (US) matches.
+			QRegularExpressionMatch fileDescMatch =
+				gcnMcFileDef->search.fileDesc_regex.match(fileDesc.us());
+			if (!fileDescMatch.hasMatch()) {
+				// No match for US.
+				// Check if the File Description (JP) matches.
+				fileDescMatch = gcnMcFileDef->search.fileDesc_regex.match(fileDesc.jp());
+				if (!fileDescMatch.hasMatch()) {
+					// No match for JP.
+					continue;
+				}
+			}
+			fileDescVars = fileDescMatch.capturedTexts();
+		}
+
+		// Found a match.
+		// Attempt to apply variable modifiers.
+		QDateTime qDateTime;
+		QHash<QString, QString> vars = VarReplace::StringListsToHash(
+			gameDescVars, fileDescVars);
+		int ret = VarReplace::ApplyModifiers(gcnMcFileDef->varModifiers, vars, &qDateTime);
+		if (ret == 0) {
+			// Variable modifiers applied successfully.
+			// Construct a GcnSearchData struct for this file entry.
+			fileMatches.append(constructSearchData(gcnMcFileDef, vars, qDateTime));
+		}
+	}
+}
+
+
 /** GcnMcFileDb **/
 
 GcnMcFileDb::GcnMcFileDb(QObject *parent)
@@ -950,60 +1537,23 @@ QVector<GcnSearchData> GcnMcFileDb::checkBlock(const void *buf, int siz) const
 	QVector<GcnSearchData> fileMatches;
 
 	Q_D(const GcnMcFileDb);
-	foreach (uint32_t address, d->addr_file_defs.keys()) {
+	const auto iter_end = d->addr_file_defs.cend();
+	for (auto iter = d->addr_file_defs.cbegin(); iter != iter_end; ++iter) {
 		// Make sure this address is within the bounds of the buffer.
 		// Game Description + File Description == 64 bytes. (0x40)
+		const uint32_t address = iter.key();
 		const int maxAddress = (int)(address + 0x40);
 		if (maxAddress < 0 || maxAddress > siz)
 			continue;
 
-		// Get the game description and file description.
+		// Skip blank comment windows if no definitions
+		// at this address can match them.
 		const char *const commentData = ((const char*)buf + address);
-		const QString gameDescUS = d->GetGcnCommentUtf16(commentData, 32, d->textCodecUS);
-		const QString gameDescJP = d->GetGcnCommentUtf16(commentData, 32, d->textCodecJP);
-		const QString fileDescUS = d->GetGcnCommentUtf16(commentData+32, 32, d->textCodecUS);
-		const QString fileDescJP = d->GetGcnCommentUtf16(commentData+32, 32, d->textCodecJP);
-
-		QVector<GcnMcFileDef*> *vec = d->addr_file_defs.value(address);
-		foreach (const GcnMcFileDef *gcnMcFileDef, *vec) {
-			// Check if the Game Description (US) matches.
-			QRegularExpressionMatch gameDescMatch =
-				gcnMcFileDef->search.gameDesc_regex.match(gameDescUS);
-			if (!gameDescMatch.hasMatch()) {
-				// No match for US.
-				// Check if the Game Description (JP) matches.
-				gameDescMatch = gcnMcFileDef->search.gameDesc_regex.match(gameDescJP);
-				if (!gameDescMatch.hasMatch()) {
-					// No match for JP.
-					continue;
-				}
-			}
-
-			// Check if the File Description (US) matches.
-			QRegularExpressionMatch fileDescMatch =
-				gcnMcFileDef->search.fileDesc_regex.match(fileDescUS);
-			if (!fileDescMatch.hasMatch()) {
-				// No match for US.
-				// Check if the Game Description (JP) matches.
-				fileDescMatch = gcnMcFileDef->search.fileDesc_regex.match(fileDescJP);
-				if (!fileDescMatch.hasMatch()) {
-					// No match for JP.
-					continue;
-				}
-			}
+		const GcnMcFileDbPrivate::AddrFileDefs *const afd = iter.value();
+		if (!afd->blankMayMatch && d->IsBlank(commentData, 0x40))
+			continue;
 
-			// Found a match.
-			// Attempt to apply variable modifiers.
-			QDateTime qDateTime;
-			QHash<QString, QString> vars = VarReplace::StringListsToHash(
-				gameDescMatch.capturedTexts(), fileDescMatch.capturedTexts());
-			int ret = VarReplace::ApplyModifiers(gcnMcFileDef->varModifiers, vars, &qDateTime);
-			if (ret == 0) {
-				// Variable modifiers applied successfully.
-				// Construct a GcnSearchData struct for this file entry.
-				fileMatches.append(d->constructSearchData(gcnMcFileDef, vars, qDateTime));
-			}
-		}
+		d->checkComment(afd, commentData, fileMatches);
 	}
 
 	// Return the matched files.
@@ -1095,22 +1645,14 @@ QVector<QString> GcnMcFileDb::GetDbFilenames(void)
 }
 
 /**
- * Add checksum definitions to an open file.
- *
- * NOTE: The file must NOT have checksum definitions before calling
- * this function.
- *
+ * Find the checksum definitions for an open file.
+ * The file isn't modified, so the checksums can be
+ * calculated later, e.g. in another thread.
  * @param file GcnFile
- * @return True if definitions were added by this class; false if not.
+ * @return Checksum plan, or nullptr if the file isn't in this database.
  */
-bool GcnMcFileDb::addChecksumDefs(GcnFile *file) const
+QSharedPointer<const ChecksumPlan> GcnMcFileDb::findChecksumPlan(const GcnFile *file) const
 {
-	assert(file->checksumStatus() == Checksum::CHKST_UNKNOWN);
-	if (file->checksumStatus() != Checksum::CHKST_UNKNOWN) {
-		// Checksum has already been obtained for this file.
-		return true;
-	}
-
 	// TODO: Filename regex?
 
 	// GCN file comments: "GameDesc\0FileDesc"
@@ -1119,46 +1661,75 @@ bool GcnMcFileDb::addChecksumDefs(GcnFile *file) const
 	if (desc.size() != 2) {
 		// No '\0' is present.
 		// Can't process this file.
-		return false;
+		return QSharedPointer<const ChecksumPlan>();
 	}
 
 	const QString &gameDesc = desc[0];
 	const QString &fileDesc = desc[1];
 
-	// TODO: QHash<> with the game ID?
-	const QString gameID = file->gameID();
+	// Look up definitions for this game ID.
 	Q_D(const GcnMcFileDb);
-	foreach (QVector<GcnMcFileDef*>* vec, d->addr_file_defs) {
-		foreach (GcnMcFileDef* gcnMcFileDef, *vec) {
-			// Check if this file matches.
-			if (gameID != QLatin1String(gcnMcFileDef->id6, sizeof(gcnMcFileDef->id6))) {
-				// No match.
-				continue;
-			}
+	auto iter = d->id6_file_defs.constFind(file->gameID());
+	if (iter == d->id6_file_defs.cend()) {
+		// No definitions for this game ID.
+		return QSharedPointer<const ChecksumPlan>();
+	}
 
-			// Make sure the GameDesc matches.
-			QRegularExpressionMatch gameDescMatch =
-				gcnMcFileDef->search.gameDesc_regex.match(gameDesc);
-			if (!gameDescMatch.hasMatch()) {
+	foreach (const GcnMcFileDef *gcnMcFileDef, *iter) {
+		// Make sure the GameDesc matches.
+		if (gcnMcFileDef->search.gameDesc_isLiteral) {
+			if (gameDesc != gcnMcFileDef->search.gameDesc_literal) {
 				// Not a match.
 				continue;
 			}
+		} else if (!gcnMcFileDef->search.gameDesc_regex.match(gameDesc).hasMatch()) {
+			// Not a match.
+			continue;
+		}
 
-			// Make sure the FileDesc matches.
-			QRegularExpressionMatch fileDescMatch =
-				gcnMcFileDef->search.fileDesc_regex.match(fileDesc);
-			if (!fileDescMatch.hasMatch()) {
+		// Make sure the FileDesc matches.
+		if (gcnMcFileDef->search.fileDesc_isLiteral) {
+			if (fileDesc != gcnMcFileDef->search.fileDesc_literal) {
 				// Not a match.
 				continue;
 			}
-
-			// File matches.
-			// Copy the checksum definitions.
-			file->setChecksumDefs(gcnMcFileDef->checksumDefs);
-			return true;
+		} else if (!gcnMcFileDef->search.fileDesc_regex.match(fileDesc).hasMatch()) {
+			// Not a match.
+			continue;
 		}
+
+		// File matches.
+		return gcnMcFileDef->checksumPlan;
 	}
 
 	// File information not found.
-	return false;
+	return QSharedPointer<const ChecksumPlan>();
+}
+
+/**
+ * Add checksum definitions to an open file.
+ *
+ * NOTE: The file must NOT have checksum definitions before calling
+ * this function.
+ *
+ * @param file GcnFile
+ * @return True if definitions were added by this class; false if not.
+ */
+bool GcnMcFileDb::addChecksumDefs(GcnFile *file) const
+{
+	assert(file->checksumStatus() == Checksum::CHKST_UNKNOWN);
+	if (file->checksumStatus() != Checksum::CHKST_UNKNOWN) {
+		// Checksum has already been obtained for this file.
+		return true;
+	}
+
+	QSharedPointer<const ChecksumPlan> checksumPlan = findChecksumPlan(file);
+	if (!checksumPlan) {
+		// File information not found.
+		return false;
+	}
+
+	// Copy the checksum definitions.
+	file->setChecksumPlan(checksumPlan);
+	return true;
 }
@@ -74,6 +74,15 @@ class GcnMcFileDb : public QObject
 		 */
 		static QVector<QString> GetDbFilenames(void);
 
+		/**
+		 * Find the checksum definitions for an open file.
+		 * The file isn't modified, so the checksums can be
+		 * calculated later, e.g. in another thread.
+		 * @param file GcnFile
+		 * @return Checksum plan, or nullptr if the file isn't in this database.
+		 */
+		QSharedPointer<const ChecksumPlan> findChecksumPlan(const GcnFile *file) const;
+
 		/**
 		 * Add checksum definitions to an open file.
 		 *
@@ -0,0 +1,315 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program.                                  *
+ * GcnMcFileDbCache.cpp: GCN Memory Card File Database cache.              *
+ *                                                                         *
+ * Copyright (c) 2013-2018 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "GcnMcFileDbCache.hpp"
+#include "GcnMcFileDef.hpp"
+#include "config/ConfigStore.hpp"
+
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstring>
+
+// Qt includes.
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSaveFile>
+
+// Cache file magic number and version.
+// Increment CACHE_VERSION if the format or GcnMcFileDef changes.
+static const quint32 CACHE_MAGIC = 0x4D434442;	// 'MCDB'
+static const quint32 CACHE_VERSION = 1;
+
+// Sanity limit for the number of items in a list.
+static const quint32 CACHE_MAX_ITEMS = 65536;
+
+/**
+ * Write a GcnMcFileDef to a data stream.
+ * @param ds Data stream.
+ * @param def GcnMcFileDef.
+ */
+static void WriteDef(QDataStream &ds, const GcnMcFileDef *def)
+{
+	ds << def->gameName << def->fileInfo;
+	ds.writeRawData(def->id6, sizeof(def->id6));
+	ds << (quint8)def->regions;
+
+	// Search definitions.
+	ds << (quint32)def->search.address;
+	ds << def->search.gameDesc << def->search.fileDesc;
+
+	// Checksum definitions.
+	ds << (quint32)def->checksumDefs.size();
+	foreach (const Checksum::ChecksumDef &checksumDef, def->checksumDefs) {
+		ds << (quint8)checksumDef.algorithm;
+		ds << (quint32)checksumDef.address;
+		ds << (quint32)checksumDef.param;
+		ds << (quint32)checksumDef.start;
+		ds << (quint32)checksumDef.length;
+		ds << (quint8)checksumDef.endian;
+	}
+
+	// Directory entry.
+	ds << def->dirEntry.filename;
+	ds << (quint8)def->dirEntry.bannerFormat;
+	ds << (quint32)def->dirEntry.iconAddress;
+	ds << (quint16)def->dirEntry.iconFormat;
+	ds << (quint16)def->dirEntry.iconSpeed;
+	ds << (quint8)def->dirEntry.permission;
+	ds << (quint16)def->dirEntry.length;
+
+	// Variable modifiers.
+	ds << (quint32)def->varModifiers.size();
+	for (QHash<QString, VarModifierDef>::const_iterator iter = def->varModifiers.cbegin();
+	     iter != def->varModifiers.cend(); ++iter)
+	{
+		const VarModifierDef &varDef = iter.value();
+		ds << iter.key();
+		ds << (quint8)varDef.useAs;
+		ds << (quint8)varDef.varType;
+		ds << (quint8)varDef.minWidth;
+		ds << (qint8)varDef.fillChar;
+		ds << (quint8)varDef.fieldAlign;
+		ds << (qint32)varDef.addValue;
+	}
+}
+
+/**
+ * Read a GcnMcFileDef from a data stream.
+ * @param ds Data stream.
+ * @return GcnMcFileDef, or nullptr on error.
+ */
+static GcnMcFileDef *ReadDef(QDataStream &ds)
+{
+	GcnMcFileDef *const def = new GcnMcFileDef;
+	quint8 u8; quint16 u16; quint32 u32;
+	qint8 s8; qint32 s32;
+
+	ds >> def->gameName >> def->fileInfo;
+	ds.readRawData(def->id6, sizeof(def->id6));
+	ds >> u8; def->regions = u8;
+
+	// Search definitions.
+	ds >> u32; def->search.address = u32;
+	ds >> def->search.gameDesc >> def->search.fileDesc;
+
+	// Checksum definitions.
+	quint32 count;
+	ds >> count;
+	if (count > CACHE_MAX_ITEMS) {
+		delete def;
+		return nullptr;
+	}
+	def->checksumDefs.reserve(count);
+	for (; count > 0 && ds.status() == QDataStream::Ok; count--) {
+		Checksum::ChecksumDef checksumDef;
+		ds >> u8;  checksumDef.algorithm = (Checksum::ChkAlgorithm)u8;
+		ds >> u32; checksumDef.address = u32;
+		ds >> u32; checksumDef.param = u32;
+		ds >> u32; checksumDef.start = u32;
+		ds >> u32; checksumDef.length = u32;
+		ds >> u8;  checksumDef.endian = (Checksum::ChkEndian)u8;
+		def->checksumDefs.append(checksumDef);
+	}
+
+	// Directory entry.
+	ds >> def->dirEntry.filename;
+	ds >> u8;  def->dirEntry.bannerFormat = u8;
+	ds >> u32; def->dirEntry.iconAddress = u32;
+	ds >> u16; def->dirEntry.iconFormat = u16;
+	ds >> u16; def->dirEntry.iconSpeed = u16;
+	ds >> u8;  def->dirEntry.permission = u8;
+	ds >> u16; def->dirEntry.length = u16;
+
+	// Variable modifiers.
+	ds >> count;
+	if (count > CACHE_MAX_ITEMS) {
+		delete def;
+		return nullptr;
+	}
+	for (; count > 0 && ds.status() == QDataStream::Ok; count--) {
+		QString id;
+		VarModifierDef varDef;
+		ds >> id;
+		ds >> u8;  varDef.useAs = u8;
+		ds >> u8;  varDef.varType = u8;
+		ds >> u8;  varDef.minWidth = u8;
+		ds >> s8;  varDef.fillChar = (char)s8;
+		ds >> u8;  varDef.fieldAlign = u8;
+		ds >> s32; varDef.addValue = s32;
+		def->varModifiers.insert(id, varDef);
+	}
+
+	if (ds.status() != QDataStream::Ok) {
+		// Read error.
+		delete def;
+		return nullptr;
+	}
+
+	return def;
+}
+
+/**
+ * Get the cache key for a database file.
+ * @param filename Database filename.
+ * @param data Database file contents.
+ * @return Cache key.
+ */
+GcnMcFileDbCache::Key GcnMcFileDbCache::GetKey(const QString &filename, const QByteArray &data)
+{
+	QFileInfo fileInfo(filename);
+	Key key;
+	key.filename = fileInfo.absoluteFilePath();
+	key.size = fileInfo.size();
+	key.mtime = fileInfo.lastModified().toMSecsSinceEpoch();
+	key.hash = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+	return key;
+}
+
+/**
+ * Get the cache filename for a database file.
+ * @param filename Absolute database filename.
+ * @return Cache filename.
+ */
+QString GcnMcFileDbCache::CacheFilename(const QString &filename)
+{
+	// Cache files are named using a hash of the database's
+	// absolute filename, so databases with the same filename
+	// in different directories don't conflict.
+	const QByteArray filenameHash = QCryptographicHash::hash(
+		filename.toUtf8(), QCryptographicHash::Sha1).toHex();
+
+	QDir configDir(ConfigStore::ConfigPath());
+	return configDir.absoluteFilePath(QLatin1String("cache/GcnMcFileDb.") +
+		QLatin1String(filenameHash.constData()) + QLatin1String(".cache"));
+}
+
+/**
+ * Load a database from the cache.
+ * NOTE: Search regexes are not initialized.
+ * @param key	[in] Cache key.
+ * @param defs	[out] File definitions. (caller must delete them)
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int GcnMcFileDbCache::load(const Key &key, QVector<GcnMcFileDef*> &defs)
+{
+	QFile file(CacheFilename(key.filename));
+	if (!file.open(QIODevice::ReadOnly)) {
+		// Cache file doesn't exist.
+		return -ENOENT;
+	}
+
+	// Map the cache file into memory.
+	// If mapping fails, read it instead.
+	const qint64 fileSize = file.size();
+	uchar *const map = file.map(0, fileSize);
+	QByteArray data;
+	if (map) {
+		data = QByteArray::fromRawData(reinterpret_cast<const char*>(map), (int)fileSize);
+	} else {
+		data = file.readAll();
+	}
+
+	QDataStream ds(data);
+	ds.setVersion(QDataStream::Qt_5_0);
+
+	// Check the header.
+	quint32 magic, version;
+	Key cacheKey;
+	ds >> magic >> version;
+	ds >> cacheKey.filename >> cacheKey.size >> cacheKey.mtime >> cacheKey.hash;
+
+	int ret = 0;
+	if (ds.status() != QDataStream::Ok ||
+	    magic != CACHE_MAGIC || version != CACHE_VERSION)
+	{
+		// Not a valid cache file, or the wrong version.
+		ret = -EINVAL;
+	} else if (cacheKey.filename != key.filename ||
+		   cacheKey.size != key.size ||
+		   cacheKey.mtime != key.mtime ||
+		   cacheKey.hash != key.hash)
+	{
+		// Cache file is out of date.
+		ret = -EINVAL;
+	} else {
+		// Read the file definitions.
+		quint32 count;
+		ds >> count;
+		if (ds.status() != QDataStream::Ok || count > CACHE_MAX_ITEMS) {
+			ret = -EIO;
+		} else {
+			defs.reserve(count);
+			for (; count > 0; count--) {
+				GcnMcFileDef *const def = ReadDef(ds);
+				if (!def) {
+					ret = -EIO;
+					break;
+				}
+				defs.append(def);
+			}
+		}
+	}
+
+	if (ret != 0) {
+		// Error loading the cache.
+		qDeleteAll(defs);
+		defs.clear();
+	}
+
+	// NOTE: data must not be used after unmapping.
+	data.clear();
+	if (map) {
+		file.unmap(map);
+	}
+	return ret;
+}
+
+/**
+ * Save a database to the cache.
+ * @param key	[in] Cache key.
+ * @param defs	[in] File definitions.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int GcnMcFileDbCache::save(const Key &key, const QVector<const GcnMcFileDef*> &defs)
+{
+	const QString cacheFilename = CacheFilename(key.filename);
+	if (!QDir().mkpath(QFileInfo(cacheFilename).absolutePath())) {
+		// Unable to create the cache directory.
+		return -EACCES;
+	}
+
+	// Use QSaveFile so an incomplete cache file
+	// is never left behind.
+	QSaveFile file(cacheFilename);
+	if (!file.open(QIODevice::WriteOnly)) {
+		return -EACCES;
+	}
+
+	QDataStream ds(&file);
+	ds.setVersion(QDataStream::Qt_5_0);
+
+	// Header.
+	ds << CACHE_MAGIC << CACHE_VERSION;
+	ds << key.filename << key.size << key.mtime << key.hash;
+
+	// File definitions.
+	ds << (quint32)defs.size();
+	foreach (const GcnMcFileDef *def, defs) {
+		WriteDef(ds, def);
+	}
+
+	if (ds.status() != QDataStream::Ok || !file.commit()) {
+		// Write error.
+		return -EIO;
+	}
+	return 0;
+}
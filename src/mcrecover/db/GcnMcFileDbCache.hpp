@@ -0,0 +1,80 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program.                                  *
+ * GcnMcFileDbCache.hpp: GCN Memory Card File Database cache.              *
+ *                                                                         *
+ * Copyright (c) 2013-2018 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __MCRECOVER_DB_GCNMCFILEDBCACHE_HPP__
+#define __MCRECOVER_DB_GCNMCFILEDBCACHE_HPP__
+
+// Qt includes.
+#include <QtCore/QByteArray>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+class GcnMcFileDef;
+
+/**
+ * Binary cache of parsed GCN Memory Card File databases.
+ *
+ * Parsing the XML databases is slow, so the parsed
+ * GcnMcFileDef tables are stored in the configuration
+ * directory. A cache file is only used if the database
+ * file's path, size, mtime, and content hash match.
+ */
+class GcnMcFileDbCache
+{
+	private:
+		GcnMcFileDbCache() { }
+		~GcnMcFileDbCache() { }
+		Q_DISABLE_COPY(GcnMcFileDbCache)
+
+	public:
+		/**
+		 * Cache key.
+		 * Identifies a specific version of a database file.
+		 */
+		struct Key {
+			QString filename;	// Absolute filename.
+			qint64 size;		// File size.
+			qint64 mtime;		// Modification time. (msecs since Unix epoch)
+			QByteArray hash;	// SHA-1 hash of the file contents.
+		};
+
+		/**
+		 * Get the cache key for a database file.
+		 * @param filename Database filename.
+		 * @param data Database file contents.
+		 * @return Cache key.
+		 */
+		static Key GetKey(const QString &filename, const QByteArray &data);
+
+		/**
+		 * Load a database from the cache.
+		 * NOTE: Search regexes are not initialized.
+		 * @param key	[in] Cache key.
+		 * @param defs	[out] File definitions. (caller must delete them)
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		static int load(const Key &key, QVector<GcnMcFileDef*> &defs);
+
+		/**
+		 * Save a database to the cache.
+		 * @param key	[in] Cache key.
+		 * @param defs	[in] File definitions.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		static int save(const Key &key, const QVector<const GcnMcFileDef*> &defs);
+
+	private:
+		/**
+		 * Get the cache filename for a database file.
+		 * @param filename Absolute database filename.
+		 * @return Cache filename.
+		 */
+		static QString CacheFilename(const QString &filename);
+};
+
+#endif /* __MCRECOVER_DB_GCNMCFILEDBCACHE_HPP__ */
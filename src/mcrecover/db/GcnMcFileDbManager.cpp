@@ -0,0 +1,198 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program.                                  *
+ * GcnMcFileDbManager.cpp: GCN Memory Card File Database manager.          *
+ *                                                                         *
+ * Copyright (c) 2013-2018 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "GcnMcFileDbManager.hpp"
+#include "GcnMcFileDb.hpp"
+
+// Qt includes.
+#include <QtCore/QDateTime>
+#include <QtCore/QFileInfo>
+#include <QtCore/QFileSystemWatcher>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+
+class GcnMcFileDbManagerPrivate
+{
+	public:
+		explicit GcnMcFileDbManagerPrivate(GcnMcFileDbManager *q);
+
+	protected:
+		GcnMcFileDbManager *const q_ptr;
+		Q_DECLARE_PUBLIC(GcnMcFileDbManager)
+	private:
+		Q_DISABLE_COPY(GcnMcFileDbManagerPrivate)
+
+	public:
+		/**
+		 * Loaded database.
+		 */
+		struct LoadedDb {
+			QSharedPointer<GcnMcFileDb> db;
+			qint64 size;		// File size when loaded.
+			qint64 mtime;		// File mtime when loaded.
+			bool changed;		// Set if the file watcher reported a change.
+		};
+
+		/**
+		 * Loaded databases.
+		 * - Key: Absolute filename.
+		 * - Value: LoadedDb.
+		 */
+		QHash<QString, LoadedDb> loadedDbs;
+
+		// Loaded databases, in load() order.
+		QVector<QSharedPointer<GcnMcFileDb> > dbs;
+
+		// File watcher.
+		QFileSystemWatcher *watcher;
+
+		// Mutex for loadedDbs and dbs.
+		mutable QMutex mutex;
+};
+
+GcnMcFileDbManagerPrivate::GcnMcFileDbManagerPrivate(GcnMcFileDbManager *q)
+	: q_ptr(q)
+	, watcher(new QFileSystemWatcher(q))
+{
+	QObject::connect(watcher, &QFileSystemWatcher::fileChanged,
+			 q, &GcnMcFileDbManager::fileChanged_slot);
+}
+
+/** GcnMcFileDbManager **/
+
+GcnMcFileDbManager::GcnMcFileDbManager()
+	: super(nullptr)
+	, d_ptr(new GcnMcFileDbManagerPrivate(this))
+{ }
+
+GcnMcFileDbManager::~GcnMcFileDbManager()
+{
+	Q_D(GcnMcFileDbManager);
+	delete d;
+}
+
+/**
+ * Get the GcnMcFileDbManager instance.
+ * The instance is created on the first call, and
+ * destroyed when the program exits.
+ * @return GcnMcFileDbManager instance.
+ */
+GcnMcFileDbManager *GcnMcFileDbManager::instance(void)
+{
+	// Function-local statics are initialized once, even if
+	// the first calls are made from multiple threads.
+	static GcnMcFileDbManager manager;
+	return &manager;
+}
+
+/**
+ * Load GCN Memory Card File databases.
+ *
+ * Databases that are already loaded and haven't changed
+ * are reused. Databases that aren't in dbFilenames are
+ * released.
+ *
+ * This must be called on the GUI thread, since it updates
+ * the QFileSystemWatcher used to detect database changes.
+ *
+ * @param dbFilenames Filenames of GCN Memory Card File databases.
+ * @return 0 on success; non-zero on error.
+ */
+int GcnMcFileDbManager::load(const QVector<QString> &dbFilenames)
+{
+	Q_D(GcnMcFileDbManager);
+	QMutexLocker locker(&d->mutex);
+
+	QHash<QString, GcnMcFileDbManagerPrivate::LoadedDb> newLoadedDbs;
+	QVector<QSharedPointer<GcnMcFileDb> > newDbs;
+	newDbs.reserve(dbFilenames.size());
+
+	foreach (const QString &dbFilename, dbFilenames) {
+		const QFileInfo fileInfo(dbFilename);
+		const QString absFilename = fileInfo.absoluteFilePath();
+		const qint64 size = fileInfo.size();
+		const qint64 mtime = fileInfo.lastModified().toMSecsSinceEpoch();
+
+		// Check if this database is already loaded.
+		auto iter = d->loadedDbs.constFind(absFilename);
+		if (iter != d->loadedDbs.cend() && !iter->changed &&
+		    iter->size == size && iter->mtime == mtime)
+		{
+			// Database hasn't changed.
+			newLoadedDbs.insert(absFilename, *iter);
+			newDbs.append(iter->db);
+			continue;
+		}
+
+		// Load the database.
+		QSharedPointer<GcnMcFileDb> db(new GcnMcFileDb());
+		int ret = db->load(dbFilename);
+		if (ret != 0) {
+			// TODO: Report if any DBs were unable to be loaded.
+			continue;
+		}
+
+		GcnMcFileDbManagerPrivate::LoadedDb loadedDb;
+		loadedDb.db = db;
+		loadedDb.size = size;
+		loadedDb.mtime = mtime;
+		loadedDb.changed = false;
+		newLoadedDbs.insert(absFilename, loadedDb);
+		newDbs.append(db);
+
+		// Watch the file for changes.
+		// NOTE: If the file was replaced, the watcher may have
+		// stopped watching it, so always re-add it.
+		d->watcher->removePath(absFilename);
+		d->watcher->addPath(absFilename);
+	}
+
+	// Stop watching files that are no longer loaded.
+	for (auto iter = d->loadedDbs.cbegin(); iter != d->loadedDbs.cend(); ++iter) {
+		if (!newLoadedDbs.contains(iter.key())) {
+			d->watcher->removePath(iter.key());
+		}
+	}
+
+	// NOTE: Databases that are still in use elsewhere
+	// will be deleted when the last reference is released.
+	d->loadedDbs = newLoadedDbs;
+	d->dbs = newDbs;
+
+	// Error if no DBs could be loaded.
+	return (d->dbs.isEmpty() ? -1 : 0);
+}
+
+/**
+ * Get the loaded databases.
+ * @return Loaded databases, in the order specified to load().
+ */
+QVector<QSharedPointer<GcnMcFileDb> > GcnMcFileDbManager::databases(void) const
+{
+	Q_D(const GcnMcFileDbManager);
+	QMutexLocker locker(&d->mutex);
+	return d->dbs;
+}
+
+/** Slots. **/
+
+/**
+ * A database file has changed.
+ * @param path Database filename.
+ */
+void GcnMcFileDbManager::fileChanged_slot(const QString &path)
+{
+	// Reload the database on the next call to load().
+	Q_D(GcnMcFileDbManager);
+	QMutexLocker locker(&d->mutex);
+	auto iter = d->loadedDbs.find(path);
+	if (iter != d->loadedDbs.end()) {
+		iter->changed = true;
+	}
+}
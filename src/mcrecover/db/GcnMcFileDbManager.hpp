@@ -0,0 +1,86 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program.                                  *
+ * GcnMcFileDbManager.hpp: GCN Memory Card File Database manager.          *
+ *                                                                         *
+ * Copyright (c) 2013-2018 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __MCRECOVER_DB_GCNMCFILEDBMANAGER_HPP__
+#define __MCRECOVER_DB_GCNMCFILEDBMANAGER_HPP__
+
+// Qt includes.
+#include <QtCore/QObject>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+class GcnMcFileDb;
+
+/**
+ * GCN Memory Card File Database manager.
+ *
+ * Databases are loaded once and shared by all users,
+ * e.g. GcnSearchThread and GcnCardAudit. A database is
+ * only reloaded if its file has changed.
+ *
+ * Loaded databases are read-only, so they can be used
+ * from multiple threads. Users should keep a copy of the
+ * QSharedPointers while using the databases, since a
+ * reload will release the manager's references.
+ */
+class GcnMcFileDbManagerPrivate;
+class GcnMcFileDbManager : public QObject
+{
+	Q_OBJECT
+	typedef QObject super;
+
+	private:
+		GcnMcFileDbManager();
+		virtual ~GcnMcFileDbManager();
+
+	protected:
+		GcnMcFileDbManagerPrivate *const d_ptr;
+		Q_DECLARE_PRIVATE(GcnMcFileDbManager)
+	private:
+		Q_DISABLE_COPY(GcnMcFileDbManager)
+
+	public:
+		/**
+		 * Get the GcnMcFileDbManager instance.
+		 * The instance is created on the first call, and
+		 * destroyed when the program exits.
+		 * @return GcnMcFileDbManager instance.
+		 */
+		static GcnMcFileDbManager *instance(void);
+
+		/**
+		 * Load GCN Memory Card File databases.
+		 *
+		 * Databases that are already loaded and haven't changed
+		 * are reused. Databases that aren't in dbFilenames are
+		 * released.
+		 *
+		 * This must be called on the GUI thread, since it updates
+		 * the QFileSystemWatcher used to detect database changes.
+		 *
+		 * @param dbFilenames Filenames of GCN Memory Card File databases.
+		 * @return 0 on success; non-zero on error.
+		 */
+		int load(const QVector<QString> &dbFilenames);
+
+		/**
+		 * Get the loaded databases.
+		 * @return Loaded databases, in the order specified to load().
+		 */
+		QVector<QSharedPointer<GcnMcFileDb> > databases(void) const;
+
+	private slots:
+		/**
+		 * A database file has changed.
+		 * @param path Database filename.
+		 */
+		void fileChanged_slot(const QString &path);
+};
+
+#endif /* __MCRECOVER_DB_GCNMCFILEDBMANAGER_HPP__ */
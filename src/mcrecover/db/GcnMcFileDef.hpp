@@ -17,8 +17,10 @@
 #include <QtCore/QString>
 #include <QtCore/QHash>
 #include <QtCore/QRegularExpression>
+#include <QtCore/QSharedPointer>
 
 #include "Checksum.hpp"
+#include "ChecksumPlan.hpp"
 #include "VarModifierDef.hpp"
 
 class GcnMcFileDef {
@@ -67,6 +69,14 @@ class GcnMcFileDef {
 			// Regular expressions.
 			QRegularExpression gameDesc_regex;
 			QRegularExpression fileDesc_regex;
+
+			// If the regular expression is a fully-anchored
+			// literal string, e.g. "^Game Name$", the string
+			// is stored here, and regex matching is skipped.
+			bool gameDesc_isLiteral;
+			bool fileDesc_isLiteral;
+			QString gameDesc_literal;
+			QString fileDesc_literal;
 		} search;
 
 		/**
@@ -75,6 +85,12 @@ class GcnMcFileDef {
 		 */
 		QVector<Checksum::ChecksumDef> checksumDefs;
 
+		/**
+		 * Compiled checksum definitions.
+		 * Shared by all files that use this definition.
+		 */
+		QSharedPointer<const ChecksumPlan> checksumPlan;
+
 		struct {
 			QString filename;
 			uint8_t bannerFormat;
@@ -102,6 +118,8 @@ class GcnMcFileDef {
 			memset(id6, 0, sizeof(id6));
 
 			search.address = 0;
+			search.gameDesc_isLiteral = false;
+			search.fileDesc_isLiteral = false;
 
 			dirEntry.bannerFormat = 0;
 			dirEntry.iconAddress = 0;
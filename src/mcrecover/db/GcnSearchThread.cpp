@@ -13,6 +13,7 @@
 
 // GCN Memory Card File Database.
 #include "db/GcnMcFileDb.hpp"
+#include "db/GcnMcFileDbManager.hpp"
 
 // Worker object.
 #include "GcnSearchWorker.hpp"
@@ -38,7 +39,18 @@ class GcnSearchThreadPrivate
 
 	public:
 		// GCN Memory Card File databases.
-		QVector<GcnMcFileDb*> dbs;
+		// These are owned by GcnMcFileDbManager.
+		QVector<QSharedPointer<GcnMcFileDb> > dbs;
+
+		// Databases used by the current search.
+		// References are held until the search is complete,
+		// in case the databases are reloaded during the search.
+		QVector<QSharedPointer<GcnMcFileDb> > searchDbs;
+
+		/**
+		 * Set the worker's databases for a new search.
+		 */
+		void setWorkerDatabases(void);
 
 		// Worker object.
 		// NOTE: This object cannot have a parent;
@@ -78,8 +90,21 @@ GcnSearchThreadPrivate::GcnSearchThreadPrivate(GcnSearchThread* q)
 GcnSearchThreadPrivate::~GcnSearchThreadPrivate()
 {
 	delete worker;
-	qDeleteAll(dbs);
-	dbs.clear();
+}
+
+/**
+ * Set the worker's databases for a new search.
+ */
+void GcnSearchThreadPrivate::setWorkerDatabases(void)
+{
+	searchDbs = dbs;
+
+	QVector<GcnMcFileDb*> workerDbs;
+	workerDbs.reserve(searchDbs.size());
+	foreach (const QSharedPointer<GcnMcFileDb> &db, searchDbs) {
+		workerDbs.append(db.data());
+	}
+	worker->setDatabases(workerDbs);
 }
 
 /**
@@ -95,6 +120,10 @@ void GcnSearchThreadPrivate::stopWorkerThread(void)
 	// TODO: Maybe we should keep the thread allocated?
 	delete workerThread;
 	workerThread = nullptr;
+
+	// Release the search databases.
+	worker->setDatabases(QVector<GcnMcFileDb*>());
+	searchDbs.clear();
 }
 
 /** GcnSearchThread **/
@@ -136,30 +165,21 @@ QString GcnSearchThread::errorString(void) const
 int GcnSearchThread::loadGcnMcFileDbs(const QVector<QString> &dbFilenames)
 {
 	Q_D(GcnSearchThread);
-	qDeleteAll(d->dbs);
 	d->dbs.clear();
 
 	if (dbFilenames.isEmpty())
 		return 0;
 
 	// Load the databases.
-	foreach (const QString &dbFilename, dbFilenames) {
-		GcnMcFileDb *db = new GcnMcFileDb(this);
-		int ret = db->load(dbFilename);
-		if (!ret) {
-			d->dbs.append(db);
-		} else {
-			delete db;
-		}
-	}
-
-	// TODO: Report if any DBs were unable to be loaded.
-	// For now, just error if no DBs could be loaded.
-	if (d->dbs.isEmpty()) {
+	// GcnMcFileDbManager only reloads databases that have changed.
+	GcnMcFileDbManager *const dbManager = GcnMcFileDbManager::instance();
+	int ret = dbManager->load(dbFilenames);
+	if (ret != 0) {
 		// TODO: Set the error string.
-		return -1;
+		return ret;
 	}
 
+	d->dbs = dbManager->databases();
 	return 0;
 }
 
@@ -201,13 +221,16 @@ int GcnSearchThread::searchMemCard(GcnCard *card, char preferredRegion, bool sea
 
 	// Set the GcnSearchWorker's properties.
 	d->worker->setCard(card);
-	d->worker->setDatabases(d->dbs);
+	d->setWorkerDatabases();
 	d->worker->setPreferredRegion(preferredRegion);
 	d->worker->setSearchUsedBlocks(searchUsedBlocks);
 	d->worker->setOrigThread(nullptr);
 
 	// Search for files.
-	return d->worker->searchMemCard();
+	int ret = d->worker->searchMemCard();
+	d->worker->setDatabases(QVector<GcnMcFileDb*>());
+	d->searchDbs.clear();
+	return ret;
 }
 
 /**
@@ -245,7 +268,7 @@ int GcnSearchThread::searchMemCard_async(GcnCard *card, char preferredRegion, bo
 
 	// Set the GcnSearchWorker's properties.
 	d->worker->setCard(card);
-	d->worker->setDatabases(d->dbs);
+	d->setWorkerDatabases();
 	d->worker->setPreferredRegion(preferredRegion);
 	d->worker->setSearchUsedBlocks(searchUsedBlocks);
 	d->worker->setOrigThread(QThread::currentThread());
@@ -10,25 +10,46 @@
 
 // GcnCard
 #include "libmemcard/GcnCard.hpp"
+#include "libmemcard/GcnFile.hpp"
 
 // GCN Memory Card File Database
 #include "db/GcnMcFileDb.hpp"
 
 // Checksum algorithm class.
 #include "Checksum.hpp"
+#include "libgctools/ChecksumPlan.hpp"
 
 // C includes. (C++ namespace)
 #include <cstdio>
 
 // C++ includes.
+#include <algorithm>
 #include <limits>
 #include <memory>
+#include <vector>
 using std::list;
 using std::unique_ptr;
+using std::vector;
 
 // Qt includes.
+#include <QtCore/QAtomicInt>
+#include <QtCore/QRunnable>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
 #include <QtCore/QVector>
 
+/**
+ * An existing file whose checksums are being verified
+ * before searching used blocks.
+ */
+struct GcnSearchFileCheck {
+	QSharedPointer<const ChecksumPlan> checksumPlan;
+	QVector<uint16_t> fatEntries;
+	QByteArray data;
+	bool intact;	// True if all checksums are good.
+};
+
 /** GcnSearchWorkerPrivate **/
 
 class GcnSearchWorkerPrivate
@@ -59,9 +80,71 @@ class GcnSearchWorkerPrivate
 		QVector<GcnMcFileDb*> databases;
 		char preferredRegion;
 		bool searchUsedBlocks;
+		// NOTE: Atomic, since it may be set from another
+		// thread while searchMemCard() is running.
+		QAtomicInt maxThreadCount;
 
 		// Original thread.
 		QThread *origThread;
+
+		/**
+		 * Number of blocks to read and check per batch.
+		 * Blocks are read sequentially, since Card isn't
+		 * thread-safe; the database checks are parallelized.
+		 * If the card is memory-mapped, blocks are checked
+		 * in place without copying.
+		 */
+		static const int BLOCK_BATCH_SIZE = 64;
+
+		/**
+		 * Check a block against all loaded databases.
+		 * NOTE: This function is called from multiple threads.
+		 * It must not modify any data in GcnSearchWorkerPrivate.
+		 * @param buf Block data.
+		 * @param siz Size of block data.
+		 * @return Matching entries from all databases.
+		 */
+		QVector<GcnSearchData> checkBlock(const uint8_t *buf, int siz) const;
+
+		/**
+		 * Select an entry from a list of matches, using the preferred region.
+		 * @param searchDataEntries Matching entries. (must not be empty)
+		 * @return Selected entry.
+		 */
+		GcnSearchData selectEntry(const QVector<GcnSearchData> &searchDataEntries) const;
+
+		/**
+		 * Construct the FAT entries for a file that was found,
+		 * and add it to filesFoundList.
+		 * @param searchData	[in] Search data. (dirEntry.block must be set)
+		 * @param usedBlockMap	[in/out] Used block map.
+		 * @param totalPhysBlocks [in] Total number of blocks in the card.
+		 */
+		void addFoundFile(GcnSearchData searchData, QVector<uint8_t> &usedBlockMap, int totalPhysBlocks);
+
+		/**
+		 * Verify a file's checksums.
+		 * NOTE: This function is called from multiple threads.
+		 * @param fileCheck File to verify.
+		 */
+		static void verifyFile(GcnSearchFileCheck *fileCheck);
+
+		/**
+		 * Find blocks that belong to intact files.
+		 *
+		 * The checksums of existing files on the card are verified
+		 * in parallel. If all of a file's checksums are good, its
+		 * blocks can't hold the first block of a different lost
+		 * file, so they don't need to be searched.
+		 *
+		 * Files without checksum definitions can't be verified,
+		 * so their blocks are still searched.
+		 *
+		 * @param totalPhysBlocks	[in] Total number of blocks in the card.
+		 * @param threadPool		[in,opt] Thread pool for checksum verification.
+		 * @return Block map. (non-zero for blocks that belong to intact files)
+		 */
+		QVector<uint8_t> findIntactFileBlocks(int totalPhysBlocks, QThreadPool *threadPool) const;
 };
 
 GcnSearchWorkerPrivate::GcnSearchWorkerPrivate(GcnSearchWorker* q)
@@ -69,9 +152,314 @@ GcnSearchWorkerPrivate::GcnSearchWorkerPrivate(GcnSearchWorker* q)
 	, card(nullptr)
 	, preferredRegion(0)
 	, searchUsedBlocks(false)
+	, maxThreadCount(0)
 	, origThread(nullptr)
 { }
 
+/**
+ * Check a block against all loaded databases.
+ * NOTE: This function is called from multiple threads.
+ * It must not modify any data in GcnSearchWorkerPrivate.
+ * @param buf Block data.
+ * @param siz Size of block data.
+ * @return Matching entries from all databases.
+ */
+QVector<GcnSearchData> GcnSearchWorkerPrivate::checkBlock(const uint8_t *buf, int siz) const
+{
+	QVector<GcnSearchData> searchDataEntries;
+	foreach (const GcnMcFileDb *db, databases) {
+		searchDataEntries += db->checkBlock(buf, siz);
+	}
+	return searchDataEntries;
+}
+
+/**
+ * Select an entry from a list of matches, using the preferred region.
+ * @param searchDataEntries Matching entries. (must not be empty)
+ * @return Selected entry.
+ */
+GcnSearchData GcnSearchWorkerPrivate::selectEntry(const QVector<GcnSearchData> &searchDataEntries) const
+{
+	if (searchDataEntries.size() == 1 || preferredRegion == 0) {
+		// Only one entry, or no preferred region.
+		return searchDataEntries.at(0);
+	}
+
+	// Find an entry matching the preferred region.
+	for (int i = 0; i < searchDataEntries.size(); i++) {
+		const GcnSearchData &schk = searchDataEntries.at(i);
+		if (schk.dirEntry.gamecode[3] == preferredRegion) {
+			// Found a match!
+			return schk;
+		}
+	}
+
+	// No region match. Use the first entry.
+	return searchDataEntries.at(0);
+}
+
+/**
+ * Construct the FAT entries for a file that was found,
+ * and add it to filesFoundList.
+ * @param searchData	[in] Search data. (dirEntry.block must be set)
+ * @param usedBlockMap	[in/out] Used block map.
+ * @param totalPhysBlocks [in] Total number of blocks in the card.
+ */
+void GcnSearchWorkerPrivate::addFoundFile(GcnSearchData searchData, QVector<uint8_t> &usedBlockMap, int totalPhysBlocks)
+{
+	// NOTE: GcnMcFileDb doesn't initialize fatEntries.
+	// Hence, we have to make a copy and initialize the list.
+	fprintf(stderr, "FOUND A MATCH: %-.4s%-.2s %-.32s\n",
+		searchData.dirEntry.gamecode,
+		searchData.dirEntry.company,
+		searchData.dirEntry.filename);
+	fprintf(stderr, "bannerFmt == %02X, iconAddress == %08X, iconFormat == %02X, iconSpeed == %02X\n",
+		searchData.dirEntry.bannerfmt,
+		searchData.dirEntry.iconaddr,
+		searchData.dirEntry.iconfmt,
+		searchData.dirEntry.iconspeed);
+
+	if (searchData.dirEntry.length == 0) {
+		// This only happens if an entry is either
+		// missing a <dirEntry>, or has <length>0</length>.
+		// TODO: Check for this in GcnMcFileDb.
+		searchData.dirEntry.length = 1;
+	}
+
+	// Construct the FAT entries for this file.
+	searchData.fatEntries.clear();
+	searchData.fatEntries.reserve(searchData.dirEntry.length);
+
+	// First block is always valid.
+	searchData.fatEntries.append(searchData.dirEntry.block);
+	if (usedBlockMap[searchData.dirEntry.block] < std::numeric_limits<uint8_t>::max())
+		usedBlockMap[searchData.dirEntry.block]++;
+
+	uint16_t blocksRemaining = (searchData.dirEntry.length - 1);
+	uint16_t block = (searchData.dirEntry.block + 1);
+	bool wasWrapped = false;
+
+	// Skip used blocks and go after empty blocks only.
+	while (blocksRemaining > 0) {
+		if (block >= totalPhysBlocks) {
+			// Wraparound.
+			// Do NOT mark the wrapped blocks as used,
+			// since they might be used by actual files.
+			block = 5;
+			wasWrapped = true;
+			continue;
+		} else if (block == searchData.dirEntry.block) {
+			// ERROR: We wrapped around!
+			// Use the "naive" algorithm after the last valid block.
+			break;
+		}
+
+		// Check if this block is used.
+		if (usedBlockMap[block] == 0) {
+			// Block is not used.
+			searchData.fatEntries.append(block);
+			if (!wasWrapped)
+				usedBlockMap[block]++;
+			blocksRemaining--;
+		}
+
+		// Next block.
+		block++;
+	}
+
+	// Naive block algorithm for the remaining blocks.
+	block = (searchData.fatEntries.value(searchData.fatEntries.size() - 1) + 1);
+	wasWrapped = false;
+	while (blocksRemaining > 0) {
+		if (block >= totalPhysBlocks) {
+			// Wraparound.
+			// Do NOT mark the wrapped blocks as used,
+			// since they might be used by actual files.
+			block = 5;
+			continue;
+		}
+
+		// Add this block.
+		searchData.fatEntries.append(block);
+		if (usedBlockMap[block] < std::numeric_limits<uint8_t>::max()) {
+			if (!wasWrapped)
+				usedBlockMap[block]++;
+		}
+		block++;
+		blocksRemaining--;
+	}
+
+	// Add the search data to the list. (front of list)
+	filesFoundList.push_front(searchData);
+}
+
+/**
+ * Verify a file's checksums.
+ * NOTE: This function is called from multiple threads.
+ * @param fileCheck File to verify.
+ */
+void GcnSearchWorkerPrivate::verifyFile(GcnSearchFileCheck *fileCheck)
+{
+	const vector<Checksum::ChecksumValue> checksumValues = fileCheck->checksumPlan->exec(
+		reinterpret_cast<const uint8_t*>(fileCheck->data.constData()),
+		(uint32_t)fileCheck->data.size());
+	fileCheck->intact = (Checksum::ChecksumStatus(checksumValues) == Checksum::CHKST_GOOD);
+}
+
+/** GcnSearchVerifyTask **/
+
+/**
+ * Verify an existing file's checksums.
+ * Used by GcnSearchWorkerPrivate::findIntactFileBlocks() with QThreadPool.
+ */
+class GcnSearchVerifyTask : public QRunnable
+{
+	public:
+		explicit GcnSearchVerifyTask(GcnSearchFileCheck *fileCheck)
+			: fileCheck(fileCheck)
+		{ }
+
+		void run(void) final
+		{
+			GcnSearchWorkerPrivate::verifyFile(fileCheck);
+		}
+
+	private:
+		GcnSearchFileCheck *const fileCheck;
+};
+
+/**
+ * Find blocks that belong to intact files.
+ *
+ * The checksums of existing files on the card are verified
+ * in parallel. If all of a file's checksums are good, its
+ * blocks can't hold the first block of a different lost
+ * file, so they don't need to be searched.
+ *
+ * Files without checksum definitions can't be verified,
+ * so their blocks are still searched.
+ *
+ * @param totalPhysBlocks	[in] Total number of blocks in the card.
+ * @param threadPool		[in,opt] Thread pool for checksum verification.
+ * @return Block map. (non-zero for blocks that belong to intact files)
+ */
+QVector<uint8_t> GcnSearchWorkerPrivate::findIntactFileBlocks(int totalPhysBlocks, QThreadPool *threadPool) const
+{
+	QVector<uint8_t> intactBlockMap(totalPhysBlocks, 0);
+	const int blockSize = card->blockSize();
+
+	// Files are read sequentially, since Card isn't thread-safe.
+	// NOTE: fileChecks must not be reallocated while tasks are running.
+	const QVector<File*> files = card->getFiles(Card::FTYPE_NORMAL);
+	vector<GcnSearchFileCheck> fileChecks;
+	fileChecks.reserve(files.size());
+
+	foreach (File *file, files) {
+		const GcnFile *const gcnFile = qobject_cast<const GcnFile*>(file);
+		if (!gcnFile)
+			continue;
+
+		// Find the checksum definitions.
+		QSharedPointer<const ChecksumPlan> checksumPlan;
+		foreach (const GcnMcFileDb *db, databases) {
+			checksumPlan = db->findChecksumPlan(gcnFile);
+			if (checksumPlan)
+				break;
+		}
+		if (!checksumPlan || checksumPlan->isEmpty()) {
+			// File can't be verified.
+			continue;
+		}
+
+		// Make sure the FAT entries are valid.
+		const QVector<uint16_t> fatEntries = file->fatEntries();
+		if (fatEntries.isEmpty())
+			continue;
+		bool fatValid = true;
+		foreach (uint16_t block, fatEntries) {
+			if (block < 5 || block >= totalPhysBlocks) {
+				fatValid = false;
+				break;
+			}
+		}
+		if (!fatValid)
+			continue;
+
+		// Read the file.
+		GcnSearchFileCheck fileCheck;
+		fileCheck.checksumPlan = checksumPlan;
+		fileCheck.fatEntries = fatEntries;
+		fileCheck.intact = false;
+		const int fileSize = fatEntries.size() * blockSize;
+		fileCheck.data = QByteArray(fileSize, Qt::Uninitialized);
+		if (card->readBlocks(fileCheck.data.data(), fileSize, fatEntries) != fileSize) {
+			// Error reading the file.
+			continue;
+		}
+
+		fileChecks.push_back(fileCheck);
+		GcnSearchFileCheck *const pFileCheck = &fileChecks.back();
+		if (threadPool) {
+			// Verify the file in the thread pool.
+			threadPool->start(new GcnSearchVerifyTask(pFileCheck));
+		} else {
+			// Verify the file in this thread.
+			verifyFile(pFileCheck);
+		}
+	}
+	if (threadPool) {
+		threadPool->waitForDone();
+	}
+
+	// Mark the blocks of intact files.
+	int intactFiles = 0, intactBlocks = 0;
+	for (auto iter = fileChecks.cbegin(); iter != fileChecks.cend(); ++iter) {
+		if (!iter->intact)
+			continue;
+		intactFiles++;
+		foreach (uint16_t block, iter->fatEntries) {
+			if (intactBlockMap[block] == 0) {
+				intactBlockMap[block] = 1;
+				intactBlocks++;
+			}
+		}
+	}
+
+	fprintf(stderr, "Skipping %d block(s) used by %d intact file(s).\n",
+		intactBlocks, intactFiles);
+	return intactBlockMap;
+}
+
+/** GcnSearchBlockTask **/
+
+/**
+ * Check a single block against the databases.
+ * Used by GcnSearchWorker::searchMemCard() with QThreadPool.
+ */
+class GcnSearchBlockTask : public QRunnable
+{
+	public:
+		GcnSearchBlockTask(const GcnSearchWorkerPrivate *d_worker,
+			const uint8_t *blockBuf, int blockSize,
+			QVector<GcnSearchData> *searchDataEntries)
+			: d(d_worker)
+			, buf(blockBuf)
+			, siz(blockSize)
+			, result(searchDataEntries)
+		{ }
+
+		void run(void) final
+		{
+			*result = d->checkBlock(buf, siz);
+		}
+
+	private:
+		const GcnSearchWorkerPrivate *const d;
+		const uint8_t *const buf;
+		const int siz;
+		QVector<GcnSearchData> *const result;
+};
+
 /** GcnSearchWorker **/
 
 GcnSearchWorker::GcnSearchWorker(QObject *parent)
@@ -189,6 +577,9 @@ bool GcnSearchWorker::searchUsedBlocks(void) const
 
 /**
  * Should we search used blocks?
+ * Blocks belonging to files whose checksums are all
+ * valid are skipped, since they can't be part of
+ * a different lost file.
  * @param searchUsedBlocks True to search used blocks; false to not.
  */
 void GcnSearchWorker::setSearchUsedBlocks(bool searchUsedBlocks)
@@ -198,6 +589,36 @@ void GcnSearchWorker::setSearchUsedBlocks(bool searchUsedBlocks)
 	d->searchUsedBlocks = searchUsedBlocks;
 }
 
+/**
+ * Get the maximum number of threads used to check blocks.
+ * @return Maximum number of threads. (0 == automatic)
+ */
+int GcnSearchWorker::maxThreadCount(void) const
+{
+	Q_D(const GcnSearchWorker);
+	return d->maxThreadCount.load();
+}
+
+/**
+ * Set the maximum number of threads used to check blocks.
+ *
+ * Blocks are read from the card sequentially, but the
+ * database checks are run in parallel. The results are
+ * merged in block search order, so the files found are
+ * identical regardless of the number of threads.
+ *
+ * The thread count is read when searchMemCard() starts.
+ * If a search is running, it keeps using its thread count,
+ * and the new value is used by the next search.
+ *
+ * @param maxThreadCount Maximum number of threads. (0 == automatic; 1 == single-threaded)
+ */
+void GcnSearchWorker::setMaxThreadCount(int maxThreadCount)
+{
+	Q_D(GcnSearchWorker);
+	d->maxThreadCount.store(maxThreadCount >= 0 ? maxThreadCount : 0);
+}
+
 /**
  * Get the "original thread".
  *
@@ -262,6 +683,18 @@ int GcnSearchWorker::searchMemCard(void)
 	// FIXME: GCN-specific assumptions used here. (first block is 5, etc)
 	// Add more information to Card to indicate the usable area.
 
+	// Thread pool for the checksum and database checks.
+	// NOTE: The thread count is only read here, so changing it
+	// during the search doesn't affect this search.
+	int threadCount = d->maxThreadCount.load();
+	if (threadCount <= 0)
+		threadCount = QThread::idealThreadCount();
+	unique_ptr<QThreadPool> threadPool;
+	if (threadCount > 1) {
+		threadPool.reset(new QThreadPool());
+		threadPool->setMaxThreadCount(threadCount);
+	}
+
 	// Block search list.
 	QVector<uint16_t> blockSearchList;
 	const int totalPhysBlocks = d->card->totalPhysBlocks();
@@ -280,175 +713,115 @@ int GcnSearchWorker::searchMemCard(void)
 			}
 		}
 	} else {
-		// Search through all blocks.
+		// Search through all blocks, except for blocks
+		// that belong to intact files.
 		// TODO: Mark system blocks as used?
-		usedBlockMap = QVector<uint8_t>(totalPhysBlocks, 0);
+		usedBlockMap = d->findIntactFileBlocks(totalPhysBlocks, threadPool.get());
 
 		// Put together a block search list.
 		blockSearchList.reserve(totalPhysBlocks - 5);
 		for (int i = (usedBlockMap.size() - 1); i >= 5; i--) {
-			blockSearchList.append((uint16_t)i);
+			if (usedBlockMap[i] == 0) {
+				blockSearchList.append((uint16_t)i);
+			}
 		}
 	}
 
 	if (blockSearchList.isEmpty()) {
 		// No blocks to search.
-		// This may happen if searchUsedBlocks == false
-		// and the card is full.
+		// This may happen if the card is full, and either
+		// searchUsedBlocks == false or all files are intact.
 		d->errorString = tr("searchMemCard(): No blocks to search.");
 		emit searchError(d->errorString);
 		return 0;
 	}
 
-	// Block buffer.
+	// Block buffers.
+	// Blocks are processed in batches. Each batch is read
+	// sequentially, checked in parallel, and then merged
+	// in block search order.
 	const int blockSize = d->card->blockSize();
-	unique_ptr<uint8_t[]> buf(new uint8_t[blockSize]);
+	const int batchSize = std::min(blockSearchList.size(), (int)GcnSearchWorkerPrivate::BLOCK_BATCH_SIZE);
+	unique_ptr<uint8_t[]> buf(new uint8_t[(size_t)blockSize * batchSize]);
+	QVector<bool> blockRead(batchSize);
+	QVector<QVector<GcnSearchData> > batchEntries(batchSize);
 
 	fprintf(stderr, "--------------------------------\n");
 	fprintf(stderr, "SCANNING MEMORY CARD...\n");
 
+	// The whole card is about to be read.
+	d->card->setSequentialAccessHint(true);
+
+	// If the card is memory-mapped, blocks are checked in place.
+	// Keep a reference to the mapping for the whole scan, so the
+	// block pointers stay valid even if the card is reopened.
+	const Card::MappedImage mapping = d->card->mappedImage();
+
 	const int totalSearchBlocks = blockSearchList.size();
 	int currentPhysBlock = blockSearchList.value(0);
 	emit searchStarted(totalPhysBlocks, totalSearchBlocks, currentPhysBlock);
 
 	int currentSearchBlock = -1;	// compensate for currentSearchBlock++
-	foreach (currentPhysBlock, blockSearchList) {
-		currentSearchBlock++;
-		fprintf(stderr, "Searching block: %d...\n", currentPhysBlock);
-		emit searchUpdate(currentPhysBlock, currentSearchBlock, d->filesFoundList.size());
-
-		int ret = d->card->readBlock(buf.get(), blockSize, currentPhysBlock);
-		if (ret != blockSize) {
-			// Error reading block.
-			fprintf(stderr, "ERROR reading block %d - readBlock() returned %d.\n", currentPhysBlock, ret);
-			continue;
-		}
-
-		// Check the block in the databases.
-		QVector<GcnSearchData> searchDataEntries;
-		foreach (GcnMcFileDb *db, d->databases) {
-			QVector<GcnSearchData> curEntries = db->checkBlock(buf.get(), blockSize);
-			searchDataEntries += curEntries;
-		}
-
-		// TODO: Search for preferred region. For now, just use the first hit.
-		if (!searchDataEntries.isEmpty()) {
-			// Matched!
-			GcnSearchData searchData;
-			if (searchDataEntries.size() == 1 || d->preferredRegion == 0) {
-				// Only one entry, or no preferred region.
-				searchData = searchDataEntries.at(0);
+	for (int batchStart = 0; batchStart < totalSearchBlocks; batchStart += batchSize) {
+		const int batchCount = std::min(batchSize, totalSearchBlocks - batchStart);
+
+		// Read the blocks in this batch.
+		for (int i = 0; i < batchCount; i++) {
+			const int physBlock = blockSearchList.at(batchStart + i);
+			batchEntries[i].clear();
+
+			// If the card is memory-mapped, check the block in place.
+			const uint8_t *blockBuf = mapping.block(physBlock);
+			if (blockBuf) {
+				blockRead[i] = true;
 			} else {
-				// Find an entry matching the preferred region.
-				bool isMatch = false;
-				for (int i = 0; i < searchDataEntries.size(); i++) {
-					const GcnSearchData &schk = searchDataEntries.at(i);
-					if (schk.dirEntry.gamecode[3] == d->preferredRegion) {
-						// Found a match!
-						searchData = schk;
-						isMatch = true;
-						break;
-					}
-				}
-
-				if (!isMatch) {
-					// No region match. Use the first entry.
-					searchData = searchDataEntries.at(0);
+				uint8_t *const readBuf = &buf[(size_t)blockSize * i];
+				int ret = d->card->readBlock(readBuf, blockSize, physBlock);
+				blockRead[i] = (ret == blockSize);
+				if (!blockRead[i]) {
+					// Error reading block.
+					fprintf(stderr, "ERROR reading block %d - readBlock() returned %d.\n", physBlock, ret);
+					continue;
 				}
+				blockBuf = readBuf;
 			}
 
-			// NOTE: GcnMcFileDb doesn't initialize fatEntries.
-			// Hence, we have to make a copy and initialize the list.
-			fprintf(stderr, "FOUND A MATCH: %-.4s%-.2s %-.32s\n",
-				searchData.dirEntry.gamecode,
-				searchData.dirEntry.company,
-				searchData.dirEntry.filename);
-			fprintf(stderr, "bannerFmt == %02X, iconAddress == %08X, iconFormat == %02X, iconSpeed == %02X\n",
-				searchData.dirEntry.bannerfmt,
-				searchData.dirEntry.iconaddr,
-				searchData.dirEntry.iconfmt,
-				searchData.dirEntry.iconspeed);
-
-			// NOTE: dirEntry's block start is not set by d->db->checkBlock().
-			// Set it here.
-			searchData.dirEntry.block = currentPhysBlock;
-			if (searchData.dirEntry.length == 0) {
-				// This only happens if an entry is either
-				// missing a <dirEntry>, or has <length>0</length>.
-				// TODO: Check for this in GcnMcFileDb.
-				searchData.dirEntry.length = 1;
+			if (threadPool) {
+				// Check the block in the thread pool.
+				threadPool->start(new GcnSearchBlockTask(d, blockBuf, blockSize, &batchEntries[i]));
+			} else {
+				// Check the block in this thread.
+				batchEntries[i] = d->checkBlock(blockBuf, blockSize);
 			}
+		}
+		if (threadPool) {
+			threadPool->waitForDone();
+		}
 
-			// Construct the FAT entries for this file.
-			searchData.fatEntries.clear();
-			searchData.fatEntries.reserve(searchData.dirEntry.length);
-
-			// First block is always valid.
-			searchData.fatEntries.append(searchData.dirEntry.block);
-			if (usedBlockMap[searchData.dirEntry.block] < std::numeric_limits<uint8_t>::max())
-				usedBlockMap[searchData.dirEntry.block]++;
-
-			uint16_t blocksRemaining = (searchData.dirEntry.length - 1);
-			uint16_t block = (searchData.dirEntry.block + 1);
-			bool wasWrapped = false;
-
-			// Skip used blocks and go after empty blocks only.
-			while (blocksRemaining > 0) {
-				if (block >= totalPhysBlocks) {
-					// Wraparound.
-					// Do NOT mark the wrapped blocks as used,
-					// since they might be used by actual files.
-					block = 5;
-					wasWrapped = true;
-					continue;
-				} else if (block == searchData.dirEntry.block) {
-					// ERROR: We wrapped around!
-					// Use the "naive" algorithm after the last valid block.
-					break;
-				}
-
-				// Check if this block is used.
-				if (usedBlockMap[block] == 0) {
-					// Block is not used.
-					searchData.fatEntries.append(block);
-					if (!wasWrapped)
-						usedBlockMap[block]++;
-					blocksRemaining--;
-				}
-
-				// Next block.
-				block++;
-			}
+		// Merge the results in block search order.
+		for (int i = 0; i < batchCount; i++) {
+			currentPhysBlock = blockSearchList.at(batchStart + i);
+			currentSearchBlock++;
+			fprintf(stderr, "Searching block: %d...\n", currentPhysBlock);
+			emit searchUpdate(currentPhysBlock, currentSearchBlock, d->filesFoundList.size());
 
-			// Naive block algorithm for the remaining blocks.
-			block = (searchData.fatEntries.value(searchData.fatEntries.size() - 1) + 1);
-			wasWrapped = false;
-			while (blocksRemaining > 0) {
-				if (block >= totalPhysBlocks) {
-					// Wraparound.
-					// Do NOT mark the wrapped blocks as used,
-					// since they might be used by actual files.
-					block = 5;
-					continue;
-				}
+			const QVector<GcnSearchData> &searchDataEntries = batchEntries.at(i);
+			if (!blockRead[i] || searchDataEntries.isEmpty())
+				continue;
 
-				// Add this block.
-				searchData.fatEntries.append(block);
-				if (usedBlockMap[block] < std::numeric_limits<uint8_t>::max()) {
-					if (!wasWrapped)
-						usedBlockMap[block]++;
-				}
-				block++;
-				blocksRemaining--;
-			}
+			// Matched!
+			GcnSearchData searchData = d->selectEntry(searchDataEntries);
 
-			// Add the search data to the list. (front of list)
-			d->filesFoundList.push_front(searchData);
+			// NOTE: dirEntry's block start is not set by d->db->checkBlock().
+			// Set it here.
+			searchData.dirEntry.block = currentPhysBlock;
+			d->addFoundFile(searchData, usedBlockMap, totalPhysBlocks);
 		}
 	}
 
 	// Send an update for the last block.
 	emit searchUpdate(5, currentSearchBlock, d->filesFoundList.size());
+	d->card->setSequentialAccessHint(false);
 
 	// Search is finished.
 	emit searchFinished(d->filesFoundList.size());
@@ -42,6 +42,7 @@ class GcnSearchWorker : public QObject
 	Q_PROPERTY(QVector<GcnMcFileDb*> databases READ databases WRITE setDatabases)
 	Q_PROPERTY(char preferredRegion READ preferredRegion WRITE setPreferredRegion)
 	Q_PROPERTY(bool searchUsedBlocks READ searchUsedBlocks WRITE setSearchUsedBlocks)
+	Q_PROPERTY(int maxThreadCount READ maxThreadCount WRITE setMaxThreadCount)
 	Q_PROPERTY(QThread* origThread READ origThread WRITE setOrigThread)
 
 	public:
@@ -154,10 +155,35 @@ class GcnSearchWorker : public QObject
 
 		/**
 		 * Should we search used blocks?
+		 * Blocks belonging to files whose checksums are all
+		 * valid are skipped, since they can't be part of
+		 * a different lost file.
 		 * @param searchUsedBlocks True to search used blocks; false to not.
 		 */
 		void setSearchUsedBlocks(bool searchUsedBlocks);
 
+		/**
+		 * Get the maximum number of threads used to check blocks.
+		 * @return Maximum number of threads. (0 == automatic)
+		 */
+		int maxThreadCount(void) const;
+
+		/**
+		 * Set the maximum number of threads used to check blocks.
+		 *
+		 * Blocks are read from the card sequentially, but the
+		 * database checks are run in parallel. The results are
+		 * merged in block search order, so the files found are
+		 * identical regardless of the number of threads.
+		 *
+		 * The thread count is read when searchMemCard() starts.
+		 * If a search is running, it keeps using its thread count,
+		 * and the new value is used by the next search.
+		 *
+		 * @param maxThreadCount Maximum number of threads. (0 == automatic; 1 == single-threaded)
+		 */
+		void setMaxThreadCount(int maxThreadCount);
+
 		/**
 		 * Get the "original thread".
 		 *
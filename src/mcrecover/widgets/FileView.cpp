@@ -275,18 +275,22 @@ void FileView::setFile(const File *file)
 {
 	Q_D(FileView);
 
-	// Disconnect the File's destroyed() signal if a File is already set.
+	// Disconnect the File's signals if a File is already set.
 	if (d->file) {
 		disconnect(d->file, &QObject::destroyed,
 			   this, &FileView::file_destroyed_slot);
+		disconnect(d->file, &File::checksumValuesChanged,
+			   this, &FileView::file_checksumValuesChanged_slot);
 	}
 
 	d->file = file;
 
-	// Connect the File's destroyed() signal.
+	// Connect the File's signals.
 	if (d->file) {
 		connect(d->file, &QObject::destroyed,
 			this, &FileView::file_destroyed_slot);
+		connect(d->file, &File::checksumValuesChanged,
+			this, &FileView::file_checksumValuesChanged_slot);
 	}
 
 	// Update the widget display.
@@ -364,6 +368,14 @@ void FileView::file_destroyed_slot(QObject *obj)
 	}
 }
 
+/**
+ * File's checksum values have changed.
+ */
+void FileView::file_checksumValuesChanged_slot(void)
+{
+	Q_D(FileView);
+	d->updateWidgetDisplay();
+}
 
 /**
  * Animation timer slot.
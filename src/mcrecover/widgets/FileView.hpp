@@ -72,6 +72,11 @@ class FileView : public QWidget
 		 */
 		void file_destroyed_slot(QObject *obj = 0);
 
+		/**
+		 * File's checksum values have changed.
+		 */
+		void file_checksumValuesChanged_slot(void);
+
 		/**
 		 * Animation timer slot.
 		 */
@@ -11,6 +11,9 @@
 // Search Thread.
 #include "db/GcnSearchThread.hpp"
 
+// Card audit.
+#include "db/GcnCardAudit.hpp"
+
 // Qt includes.
 #include <QtCore/QDir>
 #include <QtCore/QTimer>
@@ -50,6 +53,10 @@ class StatusBarManagerPrivate
 		// NOTE: We don't own this!
 		GcnSearchThread *searchThread;
 
+		// Card audit.
+		// NOTE: We don't own this!
+		GcnCardAudit *cardAudit;
+
 		// Last status message.
 		QString lastStatusMessage;
 
@@ -68,8 +75,19 @@ class StatusBarManagerPrivate
 		int totalSearchBlocks;
 		int lostFilesFound;
 
-		// Number of seconds to wait before hiding the
-		// progress bar after the search has completed.
+		// Are we currently auditing a memory card?
+		bool auditing;
+
+		// Audit status from last GcnCardAudit update.
+		int auditTasksDone;
+		int auditTasksTotal;
+
+		// Is the progress bar showing the audit?
+		// If false, it's showing the search.
+		bool progressIsAudit;
+
+		// Number of seconds to wait before hiding the progress
+		// bar after the search or card audit has completed.
 		static const int SECONDS_TO_HIDE_PROGRESS_BAR = 5;
 
 		// TaskbarButtonManager.
@@ -85,12 +103,17 @@ StatusBarManagerPrivate::StatusBarManagerPrivate(StatusBarManager *q)
 	, lblMessage(nullptr)
 	, progressBar(nullptr)
 	, searchThread(nullptr)
+	, cardAudit(nullptr)
 	, scanning(false)
 	, currentPhysBlock(0)
 	, totalPhysBlocks(0)
 	, currentSearchBlock(0)
 	, totalSearchBlocks(0)
 	, lostFilesFound(0)
+	, auditing(false)
+	, auditTasksDone(0)
+	, auditTasksTotal(0)
+	, progressIsAudit(false)
 	, taskbarButtonManager(nullptr)
 {
 	// Default message.
@@ -126,6 +149,11 @@ void StatusBarManagerPrivate::updateStatusBar(void)
 		QString filesFoundText = StatusBarManager::tr("%n lost file(s) found.", nullptr, lostFilesFound);
 		q->lblFilesFound->setText(filesFoundText);
 		*/
+	} else if (auditing) {
+		// We're auditing the memory card.
+		lastStatusMessage = StatusBarManager::tr("Checking the memory card image (%L1 of %L2 checks done)...")
+					.arg(auditTasksDone)
+					.arg(auditTasksTotal);
 	}
 
 	// Set the status bar message.
@@ -141,18 +169,20 @@ void StatusBarManagerPrivate::updateStatusBar(void)
 		lblMessage->resize(w, lblMessage->height());
 	}
 
-	// Make sure the progress bar is visible when scanning.
-	if (scanning && progressBar)
+	// Make sure the progress bar is visible when scanning or auditing.
+	if ((scanning || auditing) && progressBar)
 		progressBar->setVisible(true);
 
 	// Set the progress bar values.
 	if (progressBar && progressBar->isVisible()) {
-		progressBar->setMaximum(totalSearchBlocks);
-		progressBar->setValue(currentSearchBlock);
+		const int progressMax = (progressIsAudit ? auditTasksTotal : totalSearchBlocks);
+		const int progressValue = (progressIsAudit ? auditTasksDone : currentSearchBlock);
+		progressBar->setMaximum(progressMax);
+		progressBar->setValue(progressValue);
 		if (taskbarButtonManager) {
 			// TODO: Set max only in initialization?
-			taskbarButtonManager->setProgressBarValue(currentSearchBlock);
-			taskbarButtonManager->setProgressBarMax(totalSearchBlocks);
+			taskbarButtonManager->setProgressBarValue(progressValue);
+			taskbarButtonManager->setProgressBarMax(progressMax);
 		}
 	} else {
 		if (taskbarButtonManager) {
@@ -314,6 +344,54 @@ void StatusBarManager::setSearchThread(GcnSearchThread *searchThread)
 	d->updateStatusBar();
 }
 
+/**
+ * Get the GcnCardAudit.
+ * @return GcnCardAudit.
+ */
+GcnCardAudit *StatusBarManager::cardAudit(void) const
+{
+	Q_D(const StatusBarManager);
+	return d->cardAudit;
+}
+
+/**
+ * Set the GcnCardAudit.
+ * @param cardAudit GcnCardAudit.
+ */
+void StatusBarManager::setCardAudit(GcnCardAudit *cardAudit)
+{
+	Q_D(StatusBarManager);
+	if (d->cardAudit == cardAudit)
+		return;
+
+	if (d->cardAudit) {
+		// Disconnect signals from the current cardAudit.
+		disconnect(d->cardAudit, &QObject::destroyed,
+			   this, &StatusBarManager::object_destroyed_slot);
+		disconnect(d->cardAudit, &GcnCardAudit::auditProgress,
+			   this, &StatusBarManager::auditProgress_slot);
+		disconnect(d->cardAudit, &GcnCardAudit::auditFinished,
+			   this, &StatusBarManager::auditFinished_slot);
+	}
+
+	d->cardAudit = cardAudit;
+
+	if (cardAudit) {
+		// Connect signals to the new cardAudit.
+		connect(d->cardAudit, &QObject::destroyed,
+			this, &StatusBarManager::object_destroyed_slot);
+		connect(d->cardAudit, &GcnCardAudit::auditProgress,
+			this, &StatusBarManager::auditProgress_slot);
+		connect(d->cardAudit, &GcnCardAudit::auditFinished,
+			this, &StatusBarManager::auditFinished_slot);
+	}
+
+	d->auditing = false;
+	d->auditTasksDone = 0;
+	d->auditTasksTotal = 0;
+	d->updateStatusBar();
+}
+
 /**
  * Get the TaskbarButtonManager.
  * @return TaskbarButtonManager.
@@ -367,6 +445,7 @@ void StatusBarManager::opened(const QString &filename, const QString &productNam
 
 	Q_D(StatusBarManager);
 	d->scanning = false;
+	d->auditing = false;
 	d->progressBar->setVisible(false);
 	d->lastStatusMessage = tr("Loaded %1 image %2")
 				.arg(productName)
@@ -385,6 +464,7 @@ void StatusBarManager::closed(const QString &productName)
 {
 	Q_D(StatusBarManager);
 	d->scanning = false;
+	d->auditing = false;
 	d->progressBar->setVisible(false);
 	d->lastStatusMessage = tr("%1 image closed.").arg(productName);
 	d->updateStatusBar();
@@ -433,6 +513,8 @@ void StatusBarManager::object_destroyed_slot(QObject *obj)
 		d->progressBar = nullptr;
 	} else if (obj == d->searchThread) {
 		d->searchThread = nullptr;
+	} else if (obj == d->cardAudit) {
+		d->cardAudit = nullptr;
 	} else if (obj == d->taskbarButtonManager) {
 		d->taskbarButtonManager = nullptr;
 	}
@@ -450,6 +532,7 @@ void StatusBarManager::searchStarted_slot(int totalPhysBlocks, int totalSearchBl
 
 	// Initialize the search status.
 	d->scanning = true;
+	d->progressIsAudit = false;
 	// NOTE: When scanning, lastStatusMessage is set by updateStatusBar().
 	d->currentPhysBlock = firstPhysBlock;
 	d->totalPhysBlocks = totalPhysBlocks;
@@ -529,10 +612,58 @@ void StatusBarManager::searchError_slot(QString errorString)
 	// TODO: Keep the progress bar visible but indicate an error.
 }
 
+/**
+ * Update card audit status.
+ * @param tasksDone Number of audit tasks completed.
+ * @param tasksTotal Total number of audit tasks.
+ */
+void StatusBarManager::auditProgress_slot(int tasksDone, int tasksTotal)
+{
+	Q_D(StatusBarManager);
+
+	// Update the audit status.
+	// NOTE: The search status takes precedence.
+	d->auditing = true;
+	d->auditTasksDone = tasksDone;
+	d->auditTasksTotal = tasksTotal;
+	if (!d->scanning) {
+		// NOTE: When auditing, lastStatusMessage is set by updateStatusBar().
+		d->progressIsAudit = true;
+		d->updateStatusBar();
+
+		// Stop the Hide Progress Bar timer.
+		d->tmrHideProgressBar.stop();
+	}
+}
+
+/**
+ * Card audit has completed.
+ */
+void StatusBarManager::auditFinished_slot(void)
+{
+	Q_D(StatusBarManager);
+	if (!d->auditing) {
+		// No progress was reported, e.g. if
+		// the card didn't need to be checked.
+		return;
+	}
+
+	// Update the audit status.
+	d->auditing = false;
+	d->auditTasksDone = d->auditTasksTotal;
+	if (d->progressIsAudit && !d->scanning) {
+		d->lastStatusMessage = tr("Memory card image check complete.");
+		d->updateStatusBar();
+
+		// Hide the progress bar after a few seconds.
+		d->tmrHideProgressBar.start();
+	}
+}
+
 /**
  * Hide the progress bar.
  * This is usually done a few seconds after the
- * search is completed.
+ * search or card audit is completed.
  */
 void StatusBarManager::hideProgressBar_slot(void)
 {
@@ -16,6 +16,7 @@ class QStatusBar;
 // Card definitions.
 #include "card.h"
 
+class GcnCardAudit;
 class GcnSearchThread;
 class TaskbarButtonManager;
 
@@ -27,6 +28,7 @@ class StatusBarManager : public QObject
 
 	Q_PROPERTY(QStatusBar* statusBar READ statusBar WRITE setStatusBar)
 	Q_PROPERTY(GcnSearchThread* searchThread READ searchThread WRITE setSearchThread)
+	Q_PROPERTY(GcnCardAudit* cardAudit READ cardAudit WRITE setCardAudit)
 
 	public:
 		explicit StatusBarManager(QObject *parent = 0);
@@ -64,6 +66,18 @@ class StatusBarManager : public QObject
 		 */
 		void setSearchThread(GcnSearchThread *searchThread);
 
+		/**
+		 * Get the GcnCardAudit.
+		 * @return GcnCardAudit.
+		 */
+		GcnCardAudit *cardAudit(void) const;
+
+		/**
+		 * Set the GcnCardAudit.
+		 * @param cardAudit GcnCardAudit.
+		 */
+		void setCardAudit(GcnCardAudit *cardAudit);
+
 		/**
 		 * Get the TaskbarButtonManager.
 		 * @return TaskbarButtonManager.
@@ -137,10 +151,22 @@ class StatusBarManager : public QObject
 		 */
 		void searchError_slot(QString errorString);
 
+		/**
+		 * Update card audit status.
+		 * @param tasksDone Number of audit tasks completed.
+		 * @param tasksTotal Total number of audit tasks.
+		 */
+		void auditProgress_slot(int tasksDone, int tasksTotal);
+
+		/**
+		 * Card audit has completed.
+		 */
+		void auditFinished_slot(void);
+
 		/**
 		 * Hide the progress bar.
 		 * This is usually done a few seconds after the
-		 * search is completed.
+		 * search or card audit is completed.
 		 */
 		void hideProgressBar_slot(void);
 };
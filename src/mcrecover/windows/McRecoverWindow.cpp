@@ -29,7 +29,7 @@
 
 // File database.
 #include "db/GcnMcFileDb.hpp"
-#include "db/GcnCheckFiles.hpp"
+#include "db/GcnCardAudit.hpp"
 
 // Search classes.
 #include "db/GcnSearchThread.hpp"
@@ -125,6 +125,9 @@ class McRecoverWindowPrivate
 		// Search thread.
 		GcnSearchThread *searchThread;
 
+		// Integrity audit.
+		GcnCardAudit *cardAudit;
+
 		/**
 		 * Initialize the toolbar.
 		 */
@@ -235,6 +238,7 @@ McRecoverWindowPrivate::McRecoverWindowPrivate(McRecoverWindow *q)
 	, proxyModel(new MemCardSortFilterProxyModel(q))
 	, cols_init(false)
 	, searchThread(new GcnSearchThread(q))
+	, cardAudit(new GcnCardAudit(q))
 	, statusBarManager(nullptr)
 	, uiBusyCounter(0)
 	, preferredRegion(0)
@@ -258,6 +262,10 @@ McRecoverWindowPrivate::McRecoverWindowPrivate(McRecoverWindow *q)
 	QObject::connect(searchThread, &GcnSearchThread::searchFinished,
 			 q, &McRecoverWindow::searchThread_searchFinished_slot);
 
+	// Connect the GcnCardAudit slots.
+	QObject::connect(cardAudit, &GcnCardAudit::cardAudited,
+			 q, &McRecoverWindow::cardAudit_cardAudited_slot);
+
 	// Connect searchThread to the mark-as-busy slots.
 	QObject::connect(searchThread, &GcnSearchThread::searchStarted,
 			 q, &McRecoverWindow::markUiBusy);
@@ -298,6 +306,7 @@ McRecoverWindowPrivate::~McRecoverWindowPrivate()
 
 	// TODO: Wait for searchThread to finish?
 	delete searchThread;
+	delete cardAudit;
 	delete taskbarButtonManager;
 }
 
@@ -905,6 +914,7 @@ McRecoverWindow::McRecoverWindow(QWidget *parent)
 	d->updateLstFileList();
 	d->initToolbar();
 	d->statusBarManager = new StatusBarManager(d->ui.statusBar, this);
+	d->statusBarManager->setCardAudit(d->cardAudit);
 	d->updateWindowTitle();
 
 	// Shh... it's a secret to everybody.
@@ -1009,20 +1019,17 @@ void McRecoverWindow::openCard(const QString &filename, FileType type)
 
 	d->filename = filename;
 
-	// If GCN, check file checksums.
-	// TODO: Run this in a separate thread after loading?
+	// If GCN, audit the card and check file checksums.
+	// This runs in the background; checksum status is
+	// updated as each file is checked.
 	if (type == FileType::GCN) {
-		// TODO: Singleton database management class.
 		// Get the database filenames.
+		// NOTE: Databases are shared using GcnMcFileDbManager,
+		// so they're only reloaded if they've changed.
 		QVector<QString> dbFilenames = GcnMcFileDb::GetDbFilenames();
-		if (!dbFilenames.isEmpty()) {
-			// Load the databases.
-			GcnCheckFiles checkFiles;
-			int ret = checkFiles.loadGcnMcFileDbs(dbFilenames);
-			if (ret == 0) {
-				// Check the files.
-				checkFiles.addChecksumDefs(qobject_cast<GcnCard*>(d->card));
-			}
+		int ret = d->cardAudit->loadGcnMcFileDbs(dbFilenames);
+		if (ret == 0) {
+			d->cardAudit->start(qobject_cast<GcnCard*>(d->card));
 		}
 	}
 
@@ -1139,6 +1146,7 @@ void McRecoverWindow::closeCard(bool noMsg)
 		productName = d->card->productName();
 	}
 
+	d->cardAudit->cancel();
 	d->model->setCard(nullptr);
 	d->ui.mcCardView->setCard(nullptr);
 	d->ui.mcfFileView->setFile(nullptr);
@@ -1512,10 +1520,8 @@ void McRecoverWindow::on_actionScan_triggered(void)
 	}
 
 	// Load the databases.
-	// TODO: Optimize database loading:
-	// - Only if the database is not loaded,
-	//   or if the database file has been changed.
-	// TODO: Singleton database management class.
+	// NOTE: Databases are shared using GcnMcFileDbManager,
+	// so they're only reloaded if they've changed.
 	int ret = d->searchThread->loadGcnMcFileDbs(dbFilenames);
 	if (ret != 0)
 		return;
@@ -1724,6 +1730,59 @@ void McRecoverWindow::searchThread_searchFinished_slot(int lostFilesFound)
 	QList<GcnFile*> files = gcnCard->addLostFiles(filesFoundList);
 }
 
+/**
+ * A card's system area has been audited.
+ * @param card GcnCard.
+ * @param result Audit result.
+ */
+void McRecoverWindow::cardAudit_cardAudited_slot(GcnCard *card, const GcnCardAuditResult &result)
+{
+	Q_D(McRecoverWindow);
+	if (card != d->card)
+		return;
+
+	static const QChar chrBullet(0x2022);  // U+2022: BULLET
+	if (result.readError != 0) {
+		// The card image couldn't be read.
+		QString msg = tr("An error occurred while auditing this %1 image:")
+			.arg(card->productName());
+		msg += QChar(L'\n') + chrBullet + QChar(L' ') +
+			QLatin1String(strerror(-result.readError)) + QChar(L'.');
+		msg += QChar(L'\n') + tr("The block allocation table and file checksums weren't checked.");
+		d->ui.msgWidget->showMessage(msg, MessageWidget::ICON_WARNING, 0, d->card);
+		return;
+	}
+	if (result.isFatConsistent())
+		return;
+
+	// NOTE: Header, directory, and block table checksums
+	// are already reported when the card is opened.
+	QStringList sl_fatErrors;
+	if (result.badChains > 0) {
+		sl_fatErrors += tr("%n file(s) have an invalid block chain.", "", result.badChains);
+	}
+	if (result.crossLinkedBlocks > 0) {
+		sl_fatErrors += tr("%n block(s) are used by more than one file.", "", result.crossLinkedBlocks);
+	}
+	if (result.freeBlocksInUse > 0) {
+		sl_fatErrors += tr("%n block(s) are used by files, but are marked as free.", "", result.freeBlocksInUse);
+	}
+	if (result.orphanedBlocks > 0) {
+		sl_fatErrors += tr("%n block(s) are allocated, but aren't used by any file.", "", result.orphanedBlocks);
+	}
+
+	QString msg;
+	msg.reserve(1024);
+	msg += tr("The block allocation table in this %1 image is inconsistent:")
+		.arg(card->productName());
+	foreach (const QString &str, sl_fatErrors) {
+		msg += QChar(L'\n') + chrBullet + QChar(L' ') + str;
+	}
+
+	// Show a warning message.
+	d->ui.msgWidget->showMessage(msg, MessageWidget::ICON_WARNING, 0, d->card);
+}
+
 /**
  * lstFileList selectionModel: Current row selection has changed.
  * @param selected Selected index.
@@ -17,6 +17,8 @@
 
 // MemCard Recover classes.
 class MemCardFile;
+class GcnCard;
+struct GcnCardAuditResult;
 
 class McRecoverWindowPrivate;
 class McRecoverWindow : public QMainWindow
@@ -116,6 +118,9 @@ class McRecoverWindow : public QMainWindow
 		// SearchThread has finished.
 		void searchThread_searchFinished_slot(int lostFilesFound);
 
+		// GcnCardAudit has audited a card.
+		void cardAudit_cardAudited_slot(GcnCard *card, const GcnCardAuditResult &result);
+
 		// lstFileList slots.
 		void lstFileList_selectionModel_selectionChanged(const QItemSelection& selected, const QItemSelection& deselected);
 
@@ -9,8 +9,12 @@
 #include "XmlTemplateDialog.hpp"
 
 // MemCard
+#include "libmemcard/Card.hpp"
 #include "libmemcard/GcnFile.hpp"
 
+// Checksum definition discovery.
+#include "db/GcnChecksumSearch.hpp"
+
 // Qt includes.
 #include <QtCore/QXmlStreamWriter>
 #include <QtGui/QFontDatabase>
@@ -25,6 +29,7 @@ class XmlTemplateDialogPrivate
 {
 	public:
 		XmlTemplateDialogPrivate(XmlTemplateDialog *q, const GcnFile *file);
+		~XmlTemplateDialogPrivate();
 
 	protected:
 		XmlTemplateDialog *const q_ptr;
@@ -40,6 +45,23 @@ class XmlTemplateDialogPrivate
 		// XML template.
 		QString xmlTemplate;
 
+		// Checksum definition discovery.
+		GcnChecksumSearch *checksumSearch;
+		QVector<Checksum::ChecksumDef> checksumDefs;
+		enum ChecksumSearchStatus {
+			CHKSEARCH_NONE,		// Search wasn't started.
+			CHKSEARCH_RUNNING,	// Search is running.
+			CHKSEARCH_FINISHED,	// Search has finished.
+		};
+		ChecksumSearchStatus checksumSearchStatus;
+
+		/**
+		 * Start searching for checksum definitions.
+		 * Other saves of the same file on the same card
+		 * are used as additional samples.
+		 */
+		void startChecksumSearch(void);
+
 		/**
 		 * Update the window text.
 		 */
@@ -61,8 +83,59 @@ class XmlTemplateDialogPrivate
 XmlTemplateDialogPrivate::XmlTemplateDialogPrivate(XmlTemplateDialog* q, const GcnFile *file)
 	: q_ptr(q)
 	, file(file)
+	, checksumSearch(nullptr)
+	, checksumSearchStatus(CHKSEARCH_NONE)
 { }
 
+XmlTemplateDialogPrivate::~XmlTemplateDialogPrivate()
+{
+	// Make sure the search is stopped before the file goes away.
+	delete checksumSearch;
+}
+
+/**
+ * Start searching for checksum definitions.
+ * Other saves of the same file on the same card
+ * are used as additional samples.
+ */
+void XmlTemplateDialogPrivate::startChecksumSearch(void)
+{
+	if (!file)
+		return;
+
+	// The file being templated is always the first sample.
+	// loadFileData() only reads the card, so casting away
+	// const is safe here.
+	QList<GcnFile*> files;
+	files.append(const_cast<GcnFile*>(file));
+
+	Card *const card = qobject_cast<Card*>(file->parent());
+	if (card) {
+		const QString gameID = file->gameID();
+		const QString filename = file->filename();
+		foreach (File *cardFile, card->getFiles()) {
+			GcnFile *const gcnFile = qobject_cast<GcnFile*>(cardFile);
+			if (gcnFile && gcnFile != file &&
+			    gcnFile->gameID() == gameID &&
+			    gcnFile->filename() == filename)
+			{
+				files.append(gcnFile);
+			}
+		}
+	}
+
+	Q_Q(XmlTemplateDialog);
+	if (!checksumSearch) {
+		checksumSearch = new GcnChecksumSearch(q);
+		QObject::connect(checksumSearch, &GcnChecksumSearch::searchFinished,
+				 q, &XmlTemplateDialog::checksumSearch_searchFinished_slot);
+	}
+
+	checksumDefs.clear();
+	checksumSearchStatus = (checksumSearch->start(files) == 0
+		? CHKSEARCH_RUNNING : CHKSEARCH_NONE);
+}
+
 /**
  * Update the window text.
  */
@@ -84,6 +157,37 @@ void XmlTemplateDialogPrivate::updateWindowText(void)
 			"and may also need to add variable modifiers.")
 			.arg(file->gameID())
 			.arg(file->filename());
+
+		templateDesc += QChar(L'\n');
+		switch (checksumSearchStatus) {
+			case CHKSEARCH_NONE:
+			default:
+				break;
+			case CHKSEARCH_RUNNING:
+				//: Template description: checksum search is running.
+				templateDesc += XmlTemplateDialog::tr("Searching for checksums...");
+				break;
+			case CHKSEARCH_FINISHED: {
+				const int samples = checksumSearch->sampleCount();
+				if (checksumDefs.isEmpty()) {
+					//: Template description: no checksums found. %Ln == number of saves searched.
+					templateDesc += XmlTemplateDialog::tr(
+						"No checksums were found in %Ln save(s).", "", samples);
+				} else {
+					//: Template description: checksums found. %Ln == number of checksums.
+					templateDesc += XmlTemplateDialog::tr(
+						"Found %Ln checksum(s); verify them before use.", "",
+						checksumDefs.size());
+				}
+				if (!checksumSearch->isExhaustive()) {
+					templateDesc += QChar(L'\n');
+					//: Template description: checksum search only covered areas next to the checksum.
+					templateDesc += XmlTemplateDialog::tr(
+						"Load a card with more saves of this file to search the entire file.");
+				}
+				break;
+			}
+		}
 	} else {
 		//: Window title: No file loaded.
 		winTitle = XmlTemplateDialog::tr("Generated XML Template: No file loaded");
@@ -166,6 +270,42 @@ void XmlTemplateDialogPrivate::generateXmlTemplate(void)
 	// <variables> block.
 	// TODO: Autodetect certain variables?
 
+	// <checksum> blocks.
+	foreach (const Checksum::ChecksumDef &checksumDef, checksumDefs) {
+		xml.writeStartElement(QLatin1String("checksum"));
+
+		xml.writeStartElement(QLatin1String("algorithm"));
+		bool defaultPoly = true;
+		switch (checksumDef.algorithm) {
+			case Checksum::CHKALG_CRC16:
+				defaultPoly = (checksumDef.param == Checksum::CRC16_POLY_CCITT);
+				break;
+			case Checksum::CHKALG_CRC32:
+				defaultPoly = (checksumDef.param == Checksum::CRC32_POLY_ZLIB);
+				break;
+			default:
+				break;
+		}
+		if (!defaultPoly) {
+			snprintf(tmp, sizeof(tmp), "0x%X", checksumDef.param);
+			xml.writeAttribute(QLatin1String("poly"), QLatin1String(tmp));
+		}
+		xml.writeCharacters(QLatin1String(Checksum::ChkAlgorithmToString(checksumDef.algorithm)));
+		xml.writeEndElement();
+
+		snprintf(tmp, sizeof(tmp), "0x%04X", checksumDef.address);
+		xml.writeTextElement(QLatin1String("address"), QLatin1String(tmp));
+
+		xml.writeStartElement(QLatin1String("range"));
+		snprintf(tmp, sizeof(tmp), "0x%04X", checksumDef.start);
+		xml.writeAttribute(QLatin1String("start"), QLatin1String(tmp));
+		snprintf(tmp, sizeof(tmp), "0x%04X", checksumDef.length);
+		xml.writeAttribute(QLatin1String("length"), QLatin1String(tmp));
+		xml.writeEndElement();
+
+		xml.writeEndElement();
+	}
+
 	// <dirEntry> block.
 	xml.writeStartElement(QLatin1String("dirEntry"));
 	xml.writeTextElement(QLatin1String("filename"), file->filename());
@@ -254,6 +394,9 @@ void XmlTemplateDialog::init(void)
 
 	// FIXME: QPlainTextEdit cursor doesn't show up when readOnly.
 
+	// Search for checksums in the background.
+	d->startChecksumSearch();
+
 	// Update the window text.
 	d->generateXmlTemplate();
 	d->updateWindowText();
@@ -286,3 +429,18 @@ void XmlTemplateDialog::changeEvent(QEvent *event)
 	// Pass the event to the base class.
 	super::changeEvent(event);
 }
+
+/** Slots. **/
+
+/**
+ * The checksum search has finished.
+ * @param checksumDefs Matching checksum definitions.
+ */
+void XmlTemplateDialog::checksumSearch_searchFinished_slot(const QVector<Checksum::ChecksumDef> &checksumDefs)
+{
+	Q_D(XmlTemplateDialog);
+	d->checksumDefs = checksumDefs;
+	d->checksumSearchStatus = XmlTemplateDialogPrivate::CHKSEARCH_FINISHED;
+	d->generateXmlTemplate();
+	d->updateWindowText();
+}
@@ -10,6 +10,10 @@
 #define __MCRECOVER_XMLTEMPLATEDIALOG_HPP__
 
 #include <QDialog>
+#include <QtCore/QVector>
+
+// Checksum algorithm class.
+#include "Checksum.hpp"
 
 class GcnFile;
 
@@ -35,6 +39,13 @@ class XmlTemplateDialog : public QDialog
 	protected:
 		// State change event. (Used for switching the UI language at runtime.)
 		void changeEvent(QEvent *event) final;
+
+	protected slots:
+		/**
+		 * The checksum search has finished.
+		 * @param checksumDefs Matching checksum definitions.
+		 */
+		void checksumSearch_searchFinished_slot(const QVector<Checksum::ChecksumDef> &checksumDefs);
 };
 
 #endif /* __MCRECOVER_XMLTEMPLATEDIALOG_HPP__ */